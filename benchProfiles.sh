@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+
+# Runs cefForms with --bench-panels once per process profile and software
+# mode and prints RSS, PSS, frame time and CPU per frame side by side. Extra
+# arguments go to every run, e.g.
+#   SOFTWARE_MODES="off on" ./benchProfiles.sh --vk-device=llvmpipe
+# Environment: BUILD_DIR (default ./build), PANELS (30), SECONDS_PER_RUN (30),
+# PROFILES (none kiosk-lowmem operator-lowlatency bench), SOFTWARE_MODES
+# (auto).
+
+set -u
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+BUILD_DIR="${BUILD_DIR:-"$SCRIPT_DIR/build"}"
+PANELS="${PANELS:-30}"
+SECONDS_PER_RUN="${SECONDS_PER_RUN:-30}"
+PROFILES="${PROFILES:-none kiosk-lowmem operator-lowlatency bench}"
+SOFTWARE_MODES="${SOFTWARE_MODES:-auto}"
+
+if [[ ! -x "$BUILD_DIR/cefForms" ]]; then
+  echo "cefForms not found in $BUILD_DIR (set BUILD_DIR)"
+  exit 1
+fi
+
+# cefForms loads its pages from ./assets.
+cd "$BUILD_DIR" || exit 1
+
+results=()
+for profile in $PROFILES; do
+  for mode in $SOFTWARE_MODES; do
+    args=(--bench-panels="$PANELS" --bench-seconds="$SECONDS_PER_RUN" --page-metrics-ms=0 --software-mode="$mode")
+    if [[ "$profile" != "none" ]]; then
+      args+=(--process-profile="$profile")
+    fi
+    echo "== $profile, software mode $mode"
+    log="bench_${profile}_$mode.log"
+    line="$(./cefForms "${args[@]}" "$@" 2>&1 | tee "$log" | grep '^Bench result:' | tail -n 1)"
+    if [[ -z "$line" ]]; then
+      echo "   no result, see $BUILD_DIR/$log"
+      continue
+    fi
+    results+=("$line")
+  done
+done
+
+echo
+printf '%-20s %4s %6s %6s %8s %8s %8s %9s %9s %9s %9s\n' \
+  profile sw panels procs "p50 ms" "p95 ms" "p99 ms" "CPU ms/f" "RSS MB" "peak MB" "PSS MB"
+for line in "${results[@]}"; do
+  get() { sed -n "s/.* $1=\([^ ]*\).*/\1/p" <<< "$line"; }
+  printf '%-20s %4s %6s %6s %8s %8s %8s %9s %9s %9s %9s\n' \
+    "$(get profile)" "$(get software)" "$(get panels)" "$(get processes)" "$(get frame_ms_p50)" \
+    "$(get frame_ms_p95)" "$(get frame_ms_p99)" "$(get cpu_ms_per_frame)" "$(get rss_mb)" "$(get rss_peak_mb)" \
+    "$(get pss_mb)"
+done
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "include/cef_audio_handler.h"
+#include "include/cef_command_line.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AudioMeterSnapshot {
+    std::string label;
+    bool active = false;
+    float peak = 0.0f;
+    float rms = 0.0f;
+    uint64_t overruns = 0;
+    uint64_t underruns = 0;
+};
+
+// One browser's captured audio, always stored as interleaved stereo at the
+// mixer rate. Written by the CEF audio thread, drained by the mixer thread.
+class AudioStream {
+public:
+    AudioStream(std::string label, int sampleRate);
+
+    const std::string& GetLabel() const { return m_Label; }
+
+    // Audio-thread side; no locks or allocation.
+    void Begin(int sampleRate, int channels);
+    void Push(const float** planes, int frames);
+    void End();
+    // Called when the owning handler goes away; the mixer drops the stream
+    // once it has drained what is buffered.
+    void Detach() { m_Detached = true; }
+
+    AudioMeterSnapshot GetMeter() const;
+
+private:
+    friend class AudioMixer;
+
+    std::string m_Label;
+    int m_MixerRate;
+    SpscRing<float> m_Ring;
+    std::atomic<int> m_Channels{0};
+    std::atomic<bool> m_Active{false};
+    std::atomic<bool> m_RateMismatch{false};
+    std::atomic<bool> m_Detached{false};
+    std::atomic<float> m_Peak{0.0f};
+    std::atomic<float> m_Rms{0.0f};
+    std::atomic<uint64_t> m_Overruns{0};
+    std::atomic<uint64_t> m_Underruns{0};
+    // Mixer-thread only: waits for a couple of blocks before draining.
+    bool m_Primed = false;
+};
+
+// CefAudioHandler for one panel. Requests stereo at the mixer rate so the
+// mixer never has to resample, and hands packets to the panel's AudioStream.
+class AudioCaptureHandler : public CefAudioHandler {
+public:
+    AudioCaptureHandler(std::shared_ptr<AudioStream> stream, int sampleRate);
+    ~AudioCaptureHandler() override;
+
+    // CefAudioHandler methods
+    virtual bool GetAudioParameters(CefRefPtr<CefBrowser> browser, CefAudioParameters& params) override;
+    virtual void OnAudioStreamStarted(CefRefPtr<CefBrowser> browser,
+                                      const CefAudioParameters& params,
+                                      int channels) override;
+    virtual void OnAudioStreamPacket(CefRefPtr<CefBrowser> browser,
+                                     const float** data,
+                                     int frames,
+                                     int64_t pts) override;
+    virtual void OnAudioStreamStopped(CefRefPtr<CefBrowser> browser) override;
+    virtual void OnAudioStreamError(CefRefPtr<CefBrowser> browser, const CefString& message) override;
+
+private:
+    std::shared_ptr<AudioStream> m_Stream;
+    int m_SampleRate;
+
+    IMPLEMENT_REFCOUNTING(AudioCaptureHandler);
+};
+
+// Mixes every panel's stream into one interleaved stereo stream on its own
+// thread, in 10 ms blocks paced by the wall clock, and writes it to an
+// optional 16-bit WAV sink. Capturing mutes Chromium's own audio output.
+class AudioMixer {
+public:
+    explicit AudioMixer(int sampleRate = 48000);
+    ~AudioMixer();
+
+    // Returns a mixer if --audio-capture is present; --audio-wav=PATH adds a
+    // WAV sink.
+    static std::unique_ptr<AudioMixer> FromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+
+    bool OpenWav(const std::string& path);
+    void Start();
+    void Stop();
+
+    // Creates the audio handler for a panel. Handlers may be created and
+    // released while the mixer runs.
+    CefRefPtr<AudioCaptureHandler> CreateHandler(const std::string& label);
+
+    std::vector<AudioMeterSnapshot> GetMeters() const;
+    AudioMeterSnapshot GetMixMeter() const;
+
+private:
+    void Run();
+    void MixBlock(size_t frames);
+    void WriteWav(const float* samples, size_t count);
+    void FinishWav();
+    void PublishMetrics();
+
+    int m_SampleRate;
+    std::thread m_Thread;
+    std::atomic<bool> m_Running{false};
+
+    mutable std::mutex m_StreamsMutex;
+    std::vector<std::shared_ptr<AudioStream>> m_Streams;
+
+    std::vector<float> m_Mix;
+    std::vector<float> m_Scratch;
+    std::atomic<float> m_MixPeak{0.0f};
+    std::atomic<float> m_MixRms{0.0f};
+
+    std::ofstream m_Wav;
+    uint64_t m_WavDataBytes = 0;
+    std::vector<int16_t> m_WavBuffer;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Vulkan-free block compression for static panel textures.
+enum class BlockFormat { Bc1, Bc7 };
+
+const char* BlockFormatName(BlockFormat format);
+// Accepts "bc1" and "bc7", case-insensitive.
+bool ParseBlockFormat(const std::string& value, BlockFormat& format);
+
+// Bytes per 4x4 block: 8 for BC1, 16 for BC7.
+size_t BlockBytes(BlockFormat format);
+size_t CompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// Encodes tightly packed RGBA8 pixels. Blocks are row-major; partial edge
+// blocks repeat the last column and row. BC1 is opaque 4-color mode from
+// the block's inset bounding box. BC7 uses mode 6 only (one subset, RGBA
+// endpoints with p-bits, 4-bit indices), which is fast to encode and close
+// to lossless on flat UI content.
+std::vector<uint8_t> CompressRgba(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height);
+
+struct CompressedTexture {
+    std::string key;
+    // Echoes the generation passed to Submit, so results for a texture that
+    // changed in the meantime can be dropped.
+    uint64_t generation = 0;
+    BlockFormat format = BlockFormat::Bc7;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> blocks;
+    double encodeMs = 0.0;
+};
+
+// Encodes on one background thread so the frame loop never pays for it.
+class BlockCompressionWorker {
+public:
+    BlockCompressionWorker() = default;
+    ~BlockCompressionWorker();
+
+    void Start();
+    void Stop();
+
+    // Queues |rgba| for encoding, replacing any queued job for |key|.
+    void Submit(const std::string& key, uint64_t generation, BlockFormat format,
+                uint32_t width, uint32_t height, std::vector<uint8_t> rgba);
+    // Results finished since the last call.
+    std::vector<CompressedTexture> TakeResults();
+
+private:
+    struct Job {
+        std::string key;
+        uint64_t generation = 0;
+        BlockFormat format = BlockFormat::Bc7;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    void Run();
+
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Running = false;
+    std::deque<Job> m_Jobs;
+    std::vector<CompressedTexture> m_Results;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "include/cef_base.h"
+#include "include/cef_command_line.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct BrowserResourceUsage {
+    int browserId = 0;
+    std::string label;
+    int64_t taskId = -1;
+    std::string taskTitle;
+    double cpuPercent = 0.0;
+    int64_t memoryBytes = -1;
+    int64_t gpuMemoryBytes = -1;
+    bool killable = false;
+    int overLimitSamples = 0;
+};
+
+// A limit of zero disables that check. A renderer must stay over a limit for
+// |graceSamples| consecutive samples before the watchdog acts on it.
+struct BrowserResourceLimits {
+    double maxCpuPercent = 0.0;
+    int64_t maxMemoryBytes = 0;
+    int graceSamples = 3;
+};
+
+// Periodically maps tracked browsers to their renderer task through
+// CefTaskManager. Sampling runs as a delayed task on the CEF UI thread so the
+// render loop only ever reads the last published snapshot.
+class BrowserResourceSampler : public CefBaseRefCounted {
+public:
+    using LimitExceededCallback = std::function<void(int browserId)>;
+
+    explicit BrowserResourceSampler(int intervalMs = 1000);
+
+    // Reads --resource-sample-ms, --renderer-max-cpu, --renderer-max-memory-mb
+    // and --renderer-limit-grace.
+    static int IntervalFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+    static BrowserResourceLimits LimitsFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+
+    // Must be called on the CEF UI thread.
+    void Start();
+    void Stop();
+
+    void Track(int browserId, const std::string& label);
+    void Untrack(int browserId);
+
+    void SetLimits(const BrowserResourceLimits& limits);
+    // Called on the UI thread after a renderer over its limits is killed,
+    // once for every tracked browser that lived in that process, so callers
+    // recreate all of them and not just the one that went over.
+    void SetLimitExceededCallback(LimitExceededCallback callback);
+
+    std::vector<BrowserResourceUsage> GetSnapshot() const;
+
+private:
+    void Sample();
+    void ScheduleNext();
+
+    int m_IntervalMs;
+    bool m_Running = false;
+
+    mutable std::mutex m_Mutex;
+    std::map<int, BrowserResourceUsage> m_Usage;
+    BrowserResourceLimits m_Limits;
+    LimitExceededCallback m_LimitExceeded;
+
+    IMPLEMENT_REFCOUNTING(BrowserResourceSampler);
+};
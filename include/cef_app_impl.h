@@ -2,15 +2,28 @@
 
 #include "include/cef_app.h"
 #include "include/cef_browser_process_handler.h"
+#include "include/cef_render_process_handler.h"
 
-class CefAppImpl : public CefApp, public CefBrowserProcessHandler {
+class CefAppImpl : public CefApp, public CefBrowserProcessHandler, public CefRenderProcessHandler {
 public:
     CefAppImpl() = default;
+
+    // Starts Chromium without a display server (ozone headless on Linux),
+    // as --offscreen does. Tools that never open a window set it.
+    void SetHeadless(bool headless) { m_Headless = headless; }
+    // Rasterizes and composites in Chromium's software path, for hosts whose
+    // only Vulkan device is a CPU implementation (see software_mode.h). Set
+    // before CefInitialize.
+    void SetSoftwareMode(bool softwareMode) { m_SoftwareMode = softwareMode; }
     
     // CefApp methods
     virtual CefRefPtr<CefBrowserProcessHandler> GetBrowserProcessHandler() override {
         return this;
     }
+
+    virtual CefRefPtr<CefRenderProcessHandler> GetRenderProcessHandler() override {
+        return this;
+    }
     
     // CefApp methods
     virtual void OnBeforeCommandLineProcessing(const CefString& process_type,
@@ -18,7 +31,18 @@ public:
     
     // CefBrowserProcessHandler methods
     virtual void OnContextInitialized() override;
+    // Only called with CefSettings.external_message_pump; forwarded to
+    // IdleScheduler so an idle render loop wakes to pump.
+    virtual void OnScheduleMessagePumpWork(int64_t delay_ms) override;
+
+    // CefRenderProcessHandler methods. Answers RendererWatchdog pings.
+    virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                          CefRefPtr<CefFrame> frame,
+                                          CefProcessId source_process,
+                                          CefRefPtr<CefProcessMessage> message) override;
     
 private:
+    bool m_Headless = false;
+    bool m_SoftwareMode = false;
     IMPLEMENT_REFCOUNTING(CefAppImpl);
 };
@@ -1,9 +1,17 @@
 #pragma once
 
+#include "include/cef_audio_handler.h"
 #include "include/cef_client.h"
+#include "include/cef_display_handler.h"
+#include "include/cef_load_handler.h"
 #include "include/cef_render_handler.h"
+#include "include/cef_request_handler.h"
 #include "include/cef_life_span_handler.h"
+#include "devtools_perf_probe.h"
+#include "page_load_telemetry.h"
+#include "renderer_watchdog.h"
 #include <chrono>
+#include <cstdint>
 #include <mutex>
 #include <vector>
 
@@ -18,28 +26,64 @@ public:
                         const RectList& dirtyRects,
                         const void* buffer,
                         int width, int height) override;
+    virtual void OnPopupShow(CefRefPtr<CefBrowser> browser, bool show) override;
+    virtual void OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect) override;
     
     // Custom methods
-    void GetTextureData(std::vector<uint8_t>& data, int& width, int& height);
+    // |damage|, when given, receives the union of the view's dirty rects
+    // since the last call that took it (the whole view after a resize) and
+    // is reset.
+    void GetTextureData(std::vector<uint8_t>& data, int& width, int& height, CefRect* damage = nullptr);
+    // As GetTextureData but leaves the pixels BGRA, for GpuFrameConverter.
+    void GetRawTextureData(std::vector<uint8_t>& data, int& width, int& height, CefRect* damage = nullptr);
     bool IsDirty() const { return m_IsDirty; }
     void ClearDirty() { m_IsDirty = false; }
     double GetPaintFps() const;
     void Resize(int width, int height);
+    void SetLoadTracker(CefRefPtr<PageLoadTracker> tracker) { m_LoadTracker = tracker; }
+    // Default-constructed until the first PET_VIEW paint.
+    std::chrono::steady_clock::time_point GetFirstPaintTime() const;
+    std::chrono::steady_clock::time_point GetLastPaintTime() const;
+    uint64_t GetPaintCount() const;
+    // The popup widget (e.g. an open <select>) is painted separately from
+    // the view; its rect is in view coordinates.
+    bool IsPopupVisible() const;
+    bool IsPopupDirty() const;
+    void ClearPopupDirty();
+    CefRect GetPopupRect() const;
+    void GetPopupData(std::vector<uint8_t>& data, int& width, int& height);
     
 private:
     mutable std::mutex m_Mutex;
+    CefRect TakeDamage();
+
     std::vector<uint8_t> m_Buffer;
     int m_Width;
     int m_Height;
     bool m_IsDirty;
+    CefRect m_Damage;
     double m_PaintFps;
     int m_PaintSamples;
     std::chrono::steady_clock::time_point m_LastPaintSample;
+    std::chrono::steady_clock::time_point m_FirstPaintTime;
+    std::chrono::steady_clock::time_point m_LastPaintTime;
+    uint64_t m_PaintCount = 0;
+    CefRefPtr<PageLoadTracker> m_LoadTracker;
+    std::vector<uint8_t> m_PopupBuffer;
+    int m_PopupWidth = 0;
+    int m_PopupHeight = 0;
+    CefRect m_PopupRect;
+    bool m_PopupVisible = false;
+    bool m_PopupDirty = false;
     
     IMPLEMENT_REFCOUNTING(CefRenderHandlerImpl);
 };
 
-class CefClientImpl : public CefClient, public CefLifeSpanHandler {
+class CefClientImpl : public CefClient,
+                      public CefLifeSpanHandler,
+                      public CefLoadHandler,
+                      public CefDisplayHandler,
+                      public CefRequestHandler {
 public:
     CefClientImpl(CefRefPtr<CefRenderHandlerImpl> renderHandler);
     
@@ -51,16 +95,83 @@ public:
     virtual CefRefPtr<CefLifeSpanHandler> GetLifeSpanHandler() override {
         return this;
     }
+
+    virtual CefRefPtr<CefAudioHandler> GetAudioHandler() override {
+        return m_AudioHandler;
+    }
+
+    virtual CefRefPtr<CefLoadHandler> GetLoadHandler() override {
+        return this;
+    }
+
+    virtual CefRefPtr<CefDisplayHandler> GetDisplayHandler() override {
+        return this;
+    }
+
+    virtual CefRefPtr<CefRequestHandler> GetRequestHandler() override {
+        return this;
+    }
+
+    virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                          CefRefPtr<CefFrame> frame,
+                                          CefProcessId source_process,
+                                          CefRefPtr<CefProcessMessage> message) override;
     
     // CefLifeSpanHandler methods
     virtual void OnAfterCreated(CefRefPtr<CefBrowser> browser) override;
     virtual void OnBeforeClose(CefRefPtr<CefBrowser> browser) override;
+
+    // CefLoadHandler methods
+    virtual void OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                      bool isLoading,
+                                      bool canGoBack,
+                                      bool canGoForward) override;
+    virtual void OnLoadStart(CefRefPtr<CefBrowser> browser,
+                             CefRefPtr<CefFrame> frame,
+                             TransitionType transition_type) override;
+    virtual void OnLoadEnd(CefRefPtr<CefBrowser> browser,
+                           CefRefPtr<CefFrame> frame,
+                           int httpStatusCode) override;
+    virtual void OnLoadError(CefRefPtr<CefBrowser> browser,
+                             CefRefPtr<CefFrame> frame,
+                             ErrorCode errorCode,
+                             const CefString& errorText,
+                             const CefString& failedUrl) override;
+
+    // CefDisplayHandler methods
+    virtual void OnAddressChange(CefRefPtr<CefBrowser> browser,
+                                 CefRefPtr<CefFrame> frame,
+                                 const CefString& url) override;
+
+    // CefRequestHandler methods
+    virtual bool OnRenderProcessUnresponsive(CefRefPtr<CefBrowser> browser,
+                                             CefRefPtr<CefUnresponsiveProcessCallback> callback) override;
+    virtual void OnRenderProcessTerminated(CefRefPtr<CefBrowser> browser,
+                                           TerminationStatus status,
+                                           int error_code,
+                                           const CefString& error_string) override;
     
     // Custom methods
     CefRefPtr<CefBrowser> GetBrowser() const { return m_Browser; }
+    // Optional; must be set before the browser is created. Without one,
+    // Chromium plays audio itself.
+    void SetAudioHandler(CefRefPtr<CefAudioHandler> handler) { m_AudioHandler = handler; }
+    // Navigation timeline of this browser. The app reports texture uploads
+    // and presents to it, and calls BeginNavigation before loading a URL.
+    CefRefPtr<PageLoadTracker> GetLoadTracker() const { return m_LoadTracker; }
+    CefRefPtr<CefRenderHandlerImpl> GetRenderHandlerImpl() const { return m_RenderHandler; }
+    // Set by RendererWatchdog::Watch; receives pongs, crashes and hangs.
+    void SetRendererWatchdog(RendererWatchdog* watchdog) { m_Watchdog = watchdog; }
+    // Told when the renderer dies so it drops requests that will never be
+    // answered.
+    void SetPerfProbe(CefRefPtr<DevToolsPerfProbe> probe) { m_PerfProbe = probe; }
     
 private:
     CefRefPtr<CefRenderHandlerImpl> m_RenderHandler;
+    CefRefPtr<CefAudioHandler> m_AudioHandler;
+    CefRefPtr<PageLoadTracker> m_LoadTracker;
+    RendererWatchdog* m_Watchdog = nullptr;
+    CefRefPtr<DevToolsPerfProbe> m_PerfProbe;
     CefRefPtr<CefBrowser> m_Browser;
     
     IMPLEMENT_REFCOUNTING(CefClientImpl);
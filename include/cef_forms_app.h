@@ -1,17 +1,17 @@
 #pragma once
 
 #include "cef_app_impl.h"
-#include "include/cef_render_process_handler.h"
+#include "shared_state_segment.h"
+#include "state_replica.h"
 #include "include/wrapper/cef_message_router.h"
+#include <map>
+#include <memory>
+#include <string>
 
-class CefFormsApp : public CefAppImpl, public CefRenderProcessHandler {
+class CefFormsApp : public CefAppImpl {
 public:
     CefFormsApp() = default;
 
-    virtual CefRefPtr<CefRenderProcessHandler> GetRenderProcessHandler() override {
-        return this;
-    }
-
     // CefRenderProcessHandler methods
     virtual void OnContextCreated(CefRefPtr<CefBrowser> browser,
                                  CefRefPtr<CefFrame> frame,
@@ -23,8 +23,16 @@ public:
                                         CefRefPtr<CefFrame> frame,
                                         CefProcessId source_process,
                                         CefRefPtr<CefProcessMessage> message) override;
+    virtual void OnBrowserDestroyed(CefRefPtr<CefBrowser> browser) override;
+
+    // Renderer-side replica lookup backing window.hostState.
+    const StateReplica::Entry* FindReplicaEntry(int browserId, const std::string& key) const;
+    // Read-only simulator segment mapped for |browserId|, if the host offered one.
+    const SharedStateSegment* FindSharedSegment(int browserId) const;
 
 private:
     CefRefPtr<CefMessageRouterRendererSide> m_MessageRouter;
+    StateReplicaSet m_Replicas;
+    std::map<int, std::unique_ptr<SharedStateSegment>> m_SharedSegments;
     IMPLEMENT_REFCOUNTING(CefFormsApp);
 };
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "cef_client_impl.h"
+#include "state_replica.h"
 #include "include/wrapper/cef_message_router.h"
+#include <string>
 
 class CefFormsClient : public CefClientImpl {
 public:
@@ -13,10 +15,37 @@ public:
                                         CefRefPtr<CefProcessMessage> message) override;
 
     virtual void OnBeforeClose(CefRefPtr<CefBrowser> browser) override;
+    // Cancels the router's pending queries from the dead renderer before the
+    // base class handles the termination.
+    virtual void OnRenderProcessTerminated(CefRefPtr<CefBrowser> browser,
+                                           TerminationStatus status,
+                                           int error_code,
+                                           const CefString& error_string) override;
 
     void AddMessageHandler(CefMessageRouterBrowserSide::Handler* handler);
 
+    // Stores |json| as the latest value of |key| and forwards it to the
+    // renderer replica read by window.hostState. Must be called on the UI
+    // thread. Publishing before answering a cefQuery guarantees the page reads
+    // its own write: both travel over the same frame's message channel (see
+    // StatePublisher::Publish).
+    void PublishState(const std::string& key, const std::string& json);
+
+    // Shared-memory segment the renderer should map for window.hostState.snapshot.
+    // Sent alongside the replica resync whenever a new context asks for it.
+    void SetSharedStateName(const std::string& name) { m_SharedStateName = name; }
+
+    // Carries the published state of a client being replaced (e.g. after a
+    // renderer crash) so the new page's resync receives the latest snapshot.
+    void InheritState(const CefFormsClient& previous) { m_PublishedState = previous.m_PublishedState; }
+
+    static CefRefPtr<CefFormsClient> FromBrowser(CefRefPtr<CefBrowser> browser);
+
 private:
+    void SendStateUpdate(CefRefPtr<CefFrame> frame, const StateUpdate& update);
+
     CefRefPtr<CefMessageRouterBrowserSide> m_MessageRouter;
+    StatePublisher m_PublishedState;
+    std::string m_SharedStateName;
     IMPLEMENT_REFCOUNTING(CefFormsClient);
 };
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "include/cef_browser.h"
+#include "include/cef_command_line.h"
+#include "include/cef_devtools_message_observer.h"
+#include "include/cef_registration.h"
+#include "metrics_registry.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct PagePerfSnapshot {
+    std::string label;
+    bool attached = false;
+    double jsHeapUsedMb = 0.0;
+    double jsHeapTotalMb = 0.0;
+    double nodes = 0.0;
+    double layoutsPerSecond = 0.0;
+    double layoutMsPerSecond = 0.0;
+    double styleMsPerSecond = 0.0;
+    double scriptMsPerSecond = 0.0;
+    double taskMsPerSecond = 0.0;
+    uint64_t longTasks = 0;
+    double longTaskP95Ms = 0.0;
+    double longTaskMaxMs = 0.0;
+    double layoutShiftScore = 0.0;
+};
+
+// Page-side cost probe for one panel. Enables the Performance and
+// PerformanceTimeline DevTools domains, polls Performance.getMetrics at a low
+// rate and drains long tasks recorded by a PerformanceObserver in an isolated
+// world, out of the page's reach, so page jank can be told apart from host-side
+// frame time. All methods run on the CEF UI thread except GetSnapshot().
+class DevToolsPerfProbe : public CefDevToolsMessageObserver {
+public:
+    DevToolsPerfProbe(const std::string& label, int intervalMs);
+
+    // Reads --page-metrics-ms; 0 disables the probe.
+    static int IntervalFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+
+    void Attach(CefRefPtr<CefBrowser> browser);
+    void Detach();
+    // Results of requests in flight to a dead renderer never arrive.
+    void OnRenderProcessTerminated();
+
+    PagePerfSnapshot GetSnapshot() const;
+
+    // CefDevToolsMessageObserver methods
+    virtual void OnDevToolsMethodResult(CefRefPtr<CefBrowser> browser,
+                                        int message_id,
+                                        bool success,
+                                        const void* result,
+                                        size_t result_size) override;
+    virtual void OnDevToolsEvent(CefRefPtr<CefBrowser> browser,
+                                 const CefString& method,
+                                 const void* params,
+                                 size_t params_size) override;
+
+private:
+    // Requests that make up one long task drain: the main frame, then the
+    // probe world's context in it (both skipped while the context is known),
+    // then the drain itself.
+    enum class LongTaskStep { FrameTree, IsolatedWorld, Drain };
+
+    int Execute(const std::string& method, CefRefPtr<CefDictionaryValue> params);
+    void ScheduleNext();
+    void Poll(int generation);
+    void HandleMetrics(CefRefPtr<CefDictionaryValue> result);
+    void DrainLongTasks();
+    void HandleLongTaskStep(bool success, CefRefPtr<CefDictionaryValue> result);
+    void HandleLongTasks(CefRefPtr<CefDictionaryValue> result);
+
+    std::string m_Label;
+    std::string m_MetricPrefix;
+    int m_IntervalMs;
+    int m_Generation = 0;
+
+    CefRefPtr<CefBrowser> m_Browser;
+    CefRefPtr<CefRegistration> m_Registration;
+    int m_MetricsRequestId = 0;
+    int m_LongTaskRequestId = 0;
+    LongTaskStep m_LongTaskStep = LongTaskStep::Drain;
+    // Execution context of the probe world in the current document; 0 until
+    // looked up.
+    int m_ProbeContextId = 0;
+    // A request unanswered for kRequestTimeoutIntervals polls is given up
+    // and reissued, so a dropped result cannot stall polling.
+    std::chrono::steady_clock::time_point m_MetricsIssuedAt;
+    std::chrono::steady_clock::time_point m_LongTaskIssuedAt;
+
+    std::map<std::string, double> m_LastCumulative;
+    MetricsRegistry::Histogram m_LongTaskHistogram;
+
+    mutable std::mutex m_Mutex;
+    PagePerfSnapshot m_Snapshot;
+
+    IMPLEMENT_REFCOUNTING(DevToolsPerfProbe);
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+struct GLFWwindow;
+class VulkanRenderer;
+
+// Where VulkanRenderer's frames go: a window's swapchain, or offscreen
+// images that are read back to host memory. The renderer owns the device,
+// the frame's command buffer, the render pass and the framebuffers; the
+// presenter owns the images it renders into and whatever happens to them
+// after the frame (present, copy out).
+class FramePresenter {
+public:
+    enum class AcquireResult { Acquired, NotReady, OutOfDate };
+
+    virtual ~FramePresenter() = default;
+
+    // Extensions the presenter needs, enabled on the instance and required
+    // of (and enabled on) the device.
+    virtual std::vector<const char*> GetInstanceExtensions() const = 0;
+    virtual std::vector<const char*> GetDeviceExtensions() const = 0;
+    // Called once the instance exists, before a device is picked; creates
+    // the surface, if any. DetachInstance runs after the device is gone.
+    virtual bool AttachInstance(VkInstance instance) = 0;
+    virtual void DetachInstance(VkInstance instance) = 0;
+    // Whether |family| (already known to support graphics) can deliver
+    // frames, e.g. present to the surface.
+    virtual bool SupportsQueueFamily(VkPhysicalDevice device, uint32_t family) const = 0;
+
+    // Creates the images once the device exists; Destroy releases them.
+    virtual bool Create(VulkanRenderer& renderer) = 0;
+    virtual void Destroy(VulkanRenderer& renderer) = 0;
+    // True when the images no longer match the output (window resized,
+    // swapchain out of date, new offscreen size requested).
+    virtual bool NeedsRecreate() const = 0;
+    // False while there is nothing to render to (minimized window). The
+    // renderer keeps the current images then.
+    virtual bool HasOutput() const = 0;
+    // Rebuilds the images for the current output; the device is idle.
+    virtual bool Recreate(VulkanRenderer& renderer) = 0;
+
+    virtual VkFormat GetFormat() const = 0;
+    virtual VkExtent2D GetExtent() const = 0;
+    virtual const std::vector<VkImage>& GetImages() const = 0;
+    virtual const std::vector<VkImageView>& GetImageViews() const = 0;
+    // Layout the image is left in after rendering.
+    virtual VkImageLayout GetFinalLayout() const = 0;
+    // Swapchains hand images over with semaphores: Acquire signals the one
+    // it is given and Present waits on the one the frame signals. Offscreen
+    // images are ordered by the frame's own submission instead.
+    virtual bool UsesSemaphores() const = 0;
+
+    // Picks the image for the next frame. False when the output must be
+    // recreated first.
+    virtual bool Acquire(VkSemaphore imageAvailable, uint32_t& imageIndex) = 0;
+    // Acquire that never waits: NotReady while no image is free yet, with
+    // |imageAvailable| left unsignaled. Presenters that never wait anyway
+    // only report Acquire's result.
+    virtual AcquireResult TryAcquire(VkSemaphore imageAvailable, uint32_t& imageIndex) {
+        return Acquire(imageAvailable, imageIndex) ? AcquireResult::Acquired : AcquireResult::OutOfDate;
+    }
+    // Records work after rendering into the frame's command buffer, with the
+    // image in GetFinalLayout().
+    virtual void RecordAfterRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex) = 0;
+    virtual void Present(VkQueue queue, VkSemaphore renderFinished, uint32_t imageIndex) = 0;
+    // The frame that rendered |imageIndex| has completed on the GPU.
+    virtual void OnFrameComplete(uint32_t imageIndex) = 0;
+};
+
+// Presents to a GLFW window. Recreated when the framebuffer size changes or
+// the surface reports out of date or suboptimal.
+class SwapchainPresenter : public FramePresenter {
+public:
+    explicit SwapchainPresenter(GLFWwindow* window) : m_Window(window) {}
+
+    std::vector<const char*> GetInstanceExtensions() const override;
+    std::vector<const char*> GetDeviceExtensions() const override;
+    bool AttachInstance(VkInstance instance) override;
+    void DetachInstance(VkInstance instance) override;
+    bool SupportsQueueFamily(VkPhysicalDevice device, uint32_t family) const override;
+
+    bool Create(VulkanRenderer& renderer) override;
+    void Destroy(VulkanRenderer& renderer) override;
+    bool NeedsRecreate() const override;
+    bool HasOutput() const override;
+    bool Recreate(VulkanRenderer& renderer) override;
+
+    VkFormat GetFormat() const override { return m_Format; }
+    VkExtent2D GetExtent() const override { return m_Extent; }
+    const std::vector<VkImage>& GetImages() const override { return m_Images; }
+    const std::vector<VkImageView>& GetImageViews() const override { return m_ImageViews; }
+    VkImageLayout GetFinalLayout() const override { return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+    bool UsesSemaphores() const override { return true; }
+
+    bool Acquire(VkSemaphore imageAvailable, uint32_t& imageIndex) override;
+    // Acquire with a zero timeout. The swapchain is FIFO, so this is
+    // NotReady while the window's display still holds every image: each
+    // window is paced by its own display.
+    AcquireResult TryAcquire(VkSemaphore imageAvailable, uint32_t& imageIndex) override;
+    void RecordAfterRendering(VkCommandBuffer, uint32_t) override {}
+    void Present(VkQueue queue, VkSemaphore renderFinished, uint32_t imageIndex) override;
+    void OnFrameComplete(uint32_t) override {}
+
+private:
+    bool CreateSwapchain(VulkanRenderer& renderer);
+    AcquireResult AcquireImage(uint64_t timeout, VkSemaphore imageAvailable, uint32_t& imageIndex);
+    void DestroyViews();
+
+    GLFWwindow* m_Window = nullptr;
+    VkInstance m_Instance = VK_NULL_HANDLE;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
+    VkSwapchainKHR m_Swapchain = VK_NULL_HANDLE;
+    VkFormat m_Format = VK_FORMAT_B8G8R8A8_UNORM;
+    VkExtent2D m_Extent = {0, 0};
+    // Framebuffer size the swapchain was created for.
+    VkExtent2D m_WindowExtent = {0, 0};
+    bool m_Dirty = false;
+    std::vector<VkImage> m_Images;
+    std::vector<VkImageView> m_ImageViews;
+};
+
+// Renders into a ring of RGBA8 images with no surface, window or display
+// server, so it runs on hosts without X11 or Wayland (lavapipe included).
+// After rendering, each frame is copied into a host-visible buffer that
+// belongs to its ring slot; ReadPixels returns the newest completed one.
+class OffscreenPresenter : public FramePresenter {
+public:
+    static constexpr uint32_t kDefaultRingSize = 2;
+
+    OffscreenPresenter(uint32_t width, uint32_t height, uint32_t ringSize = kDefaultRingSize);
+
+    // Takes effect at the next BeginFrame.
+    void Resize(uint32_t width, uint32_t height);
+    // Tightly packed RGBA8 of the newest completed frame. False before the
+    // first frame completes.
+    bool ReadPixels(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height) const;
+    uint64_t GetCompletedFrames() const { return m_CompletedFrames; }
+
+    std::vector<const char*> GetInstanceExtensions() const override { return {}; }
+    std::vector<const char*> GetDeviceExtensions() const override { return {}; }
+    bool AttachInstance(VkInstance) override { return true; }
+    void DetachInstance(VkInstance) override {}
+    bool SupportsQueueFamily(VkPhysicalDevice, uint32_t) const override { return true; }
+
+    bool Create(VulkanRenderer& renderer) override;
+    void Destroy(VulkanRenderer& renderer) override;
+    bool NeedsRecreate() const override;
+    bool HasOutput() const override { return m_RequestedExtent.width > 0 && m_RequestedExtent.height > 0; }
+    bool Recreate(VulkanRenderer& renderer) override;
+
+    VkFormat GetFormat() const override { return m_Format; }
+    VkExtent2D GetExtent() const override { return m_Extent; }
+    const std::vector<VkImage>& GetImages() const override { return m_Images; }
+    const std::vector<VkImageView>& GetImageViews() const override { return m_ImageViews; }
+    VkImageLayout GetFinalLayout() const override { return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; }
+    bool UsesSemaphores() const override { return false; }
+
+    bool Acquire(VkSemaphore imageAvailable, uint32_t& imageIndex) override;
+    void RecordAfterRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex) override;
+    void Present(VkQueue, VkSemaphore, uint32_t) override {}
+    void OnFrameComplete(uint32_t imageIndex) override;
+
+private:
+    struct Slot {
+        VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+        VkBuffer readback = VK_NULL_HANDLE;
+        VkDeviceMemory readbackMemory = VK_NULL_HANDLE;
+        const uint8_t* mapped = nullptr;
+    };
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkFormat m_Format = VK_FORMAT_R8G8B8A8_UNORM;
+    VkExtent2D m_Extent = {0, 0};
+    VkExtent2D m_RequestedExtent = {0, 0};
+    uint32_t m_RingSize = kDefaultRingSize;
+    uint32_t m_NextSlot = 0;
+    // Slot holding the newest completed frame, or -1.
+    int m_CompletedSlot = -1;
+    uint64_t m_CompletedFrames = 0;
+    std::vector<VkImage> m_Images;
+    std::vector<VkImageView> m_ImageViews;
+    std::vector<Slot> m_Slots;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "cef_client_impl.h"
+#include "include/cef_command_line.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct FrameRateLimits {
+    int minFps = 1;
+    int maxFps = 144;
+};
+
+struct FrameRateStats {
+    std::string label;
+    std::string panelClass;
+    int frameRate = 0;
+    double paintFps = 0.0;
+    bool focused = false;
+    FrameRateLimits limits;
+    uint64_t changes = 0;
+    double savedPaintsPerSecond = 0.0;
+    double savedFramesPerSecond = 0.0;
+};
+
+// Picks each panel's windowless frame rate from what it actually paints.
+// Offscreen browsers only paint on damage, so a panel whose paint rate stays
+// well under its frame rate is stepped down (after a hold period, to avoid
+// flapping on bursty pages) and one that saturates its rate is stepped up at
+// once. Rates move along a fixed ladder between the panel class's min and max;
+// the focused panel never drops below the focus rate so input stays
+// responsive.
+//
+// Savings are reported against the fixed rate the panel was created with,
+// both as paints (a panel saturating a lower cap would have painted at the
+// baseline) and as begin-frame slots.
+//
+// Call Update() once per frame on the CEF UI thread.
+class FrameRateGovernor {
+public:
+    // Reads --panel-fps-min, --panel-fps-max, per-class --panel-fps-<class>-min
+    // and --panel-fps-<class>-max overrides, and --panel-fps-focus.
+    void ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+    static bool EnabledFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+    FrameRateLimits GetLimits(const std::string& panelClass) const;
+
+    // Starts governing |client|'s browser, which was created at |baselineFps|.
+    // Re-attaching a label (e.g. after the browser was recreated) keeps its
+    // current rate.
+    void Attach(const std::string& label, const std::string& panelClass,
+                CefRefPtr<CefClientImpl> client, int baselineFps);
+    void Detach(const std::string& label);
+    void SetFocused(const std::string& label, bool focused);
+
+    void Update();
+
+    // Current rate for |label|; apps driving external begin frames pace them
+    // with it. Returns 0 for unknown labels.
+    int GetFrameRate(const std::string& label) const;
+    double GetSavedPaintsPerSecond() const;
+    std::vector<FrameRateStats> GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Panel {
+        CefRefPtr<CefClientImpl> client;
+        FrameRateStats stats;
+        int baselineFps = 60;
+        int appliedBrowserId = 0;
+        int appliedFps = 0;
+        uint64_t lastPaintCount = 0;
+        int downStreak = 0;
+    };
+
+    void SamplePanel(Panel& panel, double seconds);
+    void Apply(Panel& panel);
+    int ClampToLimits(const Panel& panel, int fps) const;
+
+    FrameRateLimits m_DefaultLimits;
+    std::map<std::string, FrameRateLimits> m_ClassLimits;
+    int m_FocusFps = 60;
+    int m_SampleMs = 500;
+    // Consecutive low samples before stepping down.
+    int m_DownHoldSamples = 4;
+
+    Clock::time_point m_LastSample = Clock::now();
+    std::map<std::string, Panel> m_Panels;
+};
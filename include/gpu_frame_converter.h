@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+struct FrameConversionResult {
+    uint64_t sequence = 0;
+    uint32_t tilesChecked = 0;
+    // Row-major indices of the image's tiles whose pixels changed.
+    std::vector<uint32_t> changedTiles;
+};
+
+// Optional compute path for CEF frames. The raw BGRA region is staged in a
+// storage buffer and frame_convert.comp swizzles it into the sampled RGBA
+// image, comparing each pixel with what the image held to build a per-tile
+// changed mask. This replaces the per-pixel CPU swizzle in
+// CefRenderHandlerImpl::GetTextureData.
+//
+// The converter owns its command buffers and submits on the given queue.
+// The final barrier makes the write visible to fragment shaders in any later
+// submission on that queue, so the frame needs no semaphore. Each tile mask
+// is read back once its fence signals, without stalling the frame that
+// produced it.
+//
+// Only needs a device and a queue (no window or swapchain), so it can be
+// tested headless.
+class GpuFrameConverter {
+public:
+    static constexpr uint32_t kTileSize = 16;  // matches frame_convert.comp
+
+    bool Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily);
+    void Cleanup();
+
+    // RGBA8 image that the converter can write and shaders can sample. It
+    // has no contents until its first Convert, which converts it whole.
+    VkImage CreateImage(uint32_t width, uint32_t height, VkDeviceMemory& memory);
+    void DestroyImage(VkImage image, VkDeviceMemory memory);
+
+    // Converts |damage| (widened to whole tiles) of the |width| x |height|
+    // BGRA frame |bgra| into |image|, which is left in
+    // SHADER_READ_ONLY_OPTIMAL. |view| must be an RGBA8 view of |image|.
+    bool Convert(VkImage image, VkImageView view, uint32_t width, uint32_t height,
+                 const void* bgra, const VkRect2D& damage);
+
+    // Moves the newest finished tile mask into |result|; false when none
+    // finished since the last call. With |wait|, first waits for every
+    // submitted conversion.
+    bool PollResult(FrameConversionResult& result, bool wait = false);
+
+private:
+    static constexpr size_t kSlots = 4;
+
+    // One conversion in flight, with its own buffers and descriptor set so a
+    // slot is only reused once its fence signals.
+    struct Slot {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkBuffer pixelBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory pixelMemory = VK_NULL_HANDLE;
+        void* pixels = nullptr;
+        VkDeviceSize pixelCapacity = 0;
+        VkBuffer maskBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory maskMemory = VK_NULL_HANDLE;
+        uint32_t* mask = nullptr;
+        VkDeviceSize maskCapacity = 0;
+        bool pending = false;
+        uint64_t sequence = 0;
+        // Region in tiles, to map the mask back to image tiles.
+        uint32_t tileX = 0, tileY = 0, tilesX = 0, tilesY = 0, imageTilesX = 0;
+    };
+
+    bool CreatePipeline();
+    bool CreateSlots();
+    bool EnsureBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory, void** mapped, VkDeviceSize& capacity);
+    void DestroyBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize& capacity);
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    void Harvest(Slot& slot);
+
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkQueue m_Queue = VK_NULL_HANDLE;
+    VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_Pipeline = VK_NULL_HANDLE;
+
+    std::array<Slot, kSlots> m_Slots;
+    size_t m_NextSlot = 0;
+    uint64_t m_Sequence = 0;
+    // Images that hold converted contents and so are compared against.
+    std::unordered_set<VkImage> m_Initialized;
+    FrameConversionResult m_Latest;
+    bool m_HasLatest = false;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+class VulkanRenderer;
+
+struct ReadbackResult {
+    // False when the image format is not 4 bytes per pixel or the renderer
+    // shut down before the copy completed.
+    bool ok = false;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    // Tightly packed rows, 4 bytes per pixel in |format|'s byte order.
+    std::vector<uint8_t> pixels;
+};
+
+// Asynchronous image -> host copies. Requests are recorded into the next
+// frame's command buffer (after rendering, outside any render pass) and
+// their futures resolve once that frame is known to be complete, which the
+// renderer learns by polling its fence or timeline, never by waiting.
+//
+// Copies land in a small pool of persistently mapped, host-cached buffers
+// (reads from uncached write-combined memory are very slow), reused by size
+// across requests. Publishes readback.* metrics.
+class ReadbackPool {
+public:
+    // Free buffers kept for reuse; larger ones are preferred.
+    static constexpr size_t kMaxFreeBuffers = 4;
+
+    bool Initialize(VulkanRenderer& renderer);
+    // Resolves what has completed, fails the rest and frees every buffer.
+    // The device must be idle.
+    void Cleanup();
+
+    // |image| must be in |layout| (and have TRANSFER_SRC usage) when the
+    // frame runs; it is put back in |layout| after the copy.
+    std::future<ReadbackResult> Request(VkImage image, VkImageLayout layout, VkFormat format, const VkRect2D& region);
+    // Records every queued request into |commandBuffer|, which is submitted
+    // as frame number |frame|.
+    void Record(VkCommandBuffer commandBuffer, uint64_t frame);
+    // Resolves the requests of every frame up to |completedFrame|.
+    void Resolve(uint64_t completedFrame);
+    // Requests queued or in flight.
+    size_t GetPendingCount() const { return m_Queued.size() + m_InFlight.size(); }
+
+private:
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint8_t* mapped = nullptr;
+        // Host-cached memory is usually not coherent and needs an
+        // invalidate before the host reads it.
+        bool coherent = true;
+    };
+    struct Pending {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkRect2D region{};
+        uint64_t frame = 0;
+        Buffer buffer;
+        std::promise<ReadbackResult> promise;
+        std::chrono::steady_clock::time_point requested;
+    };
+
+    bool AcquireBuffer(VkDeviceSize size, Buffer& buffer);
+    void RecycleBuffer(Buffer buffer);
+    void DestroyBuffer(Buffer& buffer);
+    void PublishPoolMetrics();
+
+    VulkanRenderer* m_Renderer = nullptr;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+    std::vector<Pending> m_Queued;
+    std::vector<Pending> m_InFlight;
+    std::vector<Buffer> m_Free;
+    size_t m_LiveBuffers = 0;
+    VkDeviceSize m_LiveBytes = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+// Lets a render loop block instead of drawing frames nobody asked for.
+//
+// Other threads report work: browser paints and new simulator state call
+// RequestFrame, and CEF's external message pump calls SchedulePumpWork. Both
+// wake the loop through the callback set with SetWakeCallback (the apps
+// install glfwPostEmptyEvent), so the first frame after a paint or input is
+// not delayed by the sleep. The loop thread asks GetWaitSeconds how long it
+// may block, calls OnPumpWork before CefDoMessageLoopWork and asks
+// ShouldRender whether the iteration needs a frame at all.
+//
+// Disabled (the default), GetWaitSeconds is always 0 and ShouldRender always
+// true, so the loop runs as before.
+class IdleScheduler {
+public:
+    // Frames still drawn after the last activity, so ImGui hover and layout
+    // state settle before the loop goes quiet.
+    static constexpr int kSettleFrames = 3;
+    // Longest sleep without a pump request. CEF's reference external pump
+    // also runs at least at 30 Hz, since not all of its work is scheduled.
+    static constexpr double kMaxWaitSeconds = 1.0 / 30.0;
+
+    static IdleScheduler& Get();
+
+    void SetEnabled(bool enabled) { m_Enabled = enabled; }
+    bool IsEnabled() const { return m_Enabled; }
+    // Called from any thread to end a wait early.
+    void SetWakeCallback(std::function<void()> wake);
+
+    // Any thread. Something changed that needs drawing.
+    void RequestFrame();
+    // Any thread. From CefBrowserProcessHandler::OnScheduleMessagePumpWork.
+    void SchedulePumpWork(int64_t delayMs);
+
+    // Loop thread. Seconds the loop may block waiting for events; 0 while a
+    // frame is wanted, the loop is settling or the app reports |busy|.
+    double GetWaitSeconds(bool busy);
+    // Loop thread, right before CefDoMessageLoopWork. Clears a pump request
+    // that has come due; work scheduled while pumping sets a new one.
+    void OnPumpWork();
+    // Loop thread. Whether this iteration draws. |activity| is input or
+    // other app state the scheduler cannot see (e.g. a resized window).
+    bool ShouldRender(bool activity);
+    // Loop thread, after each drawn frame.
+    void OnFrameRendered();
+
+    uint64_t GetSkippedIterations() const { return m_Skipped; }
+
+private:
+    static constexpr int64_t kNoDeadline = INT64_MAX;
+    static int64_t Now();
+    void Wake();
+
+    std::atomic<bool> m_Enabled{false};
+    std::atomic<bool> m_FrameRequested{true};
+    // steady_clock ticks.
+    std::atomic<int64_t> m_PumpDeadline{kNoDeadline};
+    std::atomic<int64_t> m_SleepUntil{0};
+    int m_SettleFrames = kSettleFrames;
+    uint64_t m_Skipped = 0;
+    std::mutex m_WakeMutex;
+    std::function<void()> m_Wake;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ImageDiffOptions {
+    // Per-pixel perceptual threshold in [0, 1], as a fraction of the largest
+    // possible YIQ distance. 0.1 absorbs rasterizer and blending rounding
+    // while still catching swapped channels or a sampled (blurred) texture.
+    double threshold = 0.1;
+    // Fraction of pixels allowed to exceed |threshold| before the images
+    // count as different.
+    double maxDiffRatio = 0.0;
+};
+
+struct ImageDiffResult {
+    size_t differentPixels = 0;
+    // Square root of the largest PixelDelta seen, on the same scale as
+    // threshold.
+    double maxDelta = 0.0;
+    bool matches = false;
+    // RGBA visualisation when requested: unchanged pixels as faded
+    // grayscale, differing ones in red.
+    std::vector<uint8_t> diff;
+};
+
+// Perceptual per-pixel color distance between two RGBA8 pixels, blended over
+// white, in the YIQ space (Kotsarenko and Ramos, "Measuring perceived color
+// difference using YIQ NTSC transmission color space"), squared and scaled
+// so the most distant pair of colors is 1. Black against white is about 0.93.
+double PixelDelta(const uint8_t* a, const uint8_t* b);
+
+// Compares two RGBA8 images of the same size.
+ImageDiffResult CompareImages(const uint8_t* expected, const uint8_t* actual, uint32_t width, uint32_t height,
+                              const ImageDiffOptions& options, bool wantDiff);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "audio_capture.h"
+#include "browser_resource_sampler.h"
+#include "devtools_perf_probe.h"
+#include "frame_rate_governor.h"
+#include "layer_compositor.h"
+#include "page_load_telemetry.h"
+#include "renderer_watchdog.h"
+#include "request_context_pool.h"
+#include <vector>
+
+// Overlay widgets shared by ImGuiCefVulkan and cefForms. Each function draws
+// into the current ImGui window.
+namespace ImGuiLayer {
+void DrawResourceTable(const std::vector<BrowserResourceUsage>& usage);
+void DrawPagePerfTable(const std::vector<PagePerfSnapshot>& pages);
+void DrawRequestContextTable(const std::vector<RequestContextStats>& contexts);
+void DrawFrameRateTable(const std::vector<FrameRateStats>& panels);
+void DrawWatchdogTable(const std::vector<RendererWatchdogStats>& renderers);
+void DrawPageLoadTable(const std::vector<PageLoadUrlStats>& urls);
+void DrawAudioMeters(const std::vector<AudioMeterSnapshot>& meters);
+void DrawMetricsTable();
+void DrawCompositorStats(const CompositorStats& stats);
+
+// True when the platform backend has queued input since the last NewFrame;
+// idle rendering draws a frame for it.
+bool HasQueuedInput();
+
+// Browser layers drawn by LayerCompositor instead of ImGui::Image.
+// CompositeImage reserves |width| x |height| at the cursor like ImGui::Image
+// and submits |texture| there, clipped to the current window and ordered by
+// the window's display order. The window background is submitted as a solid
+// layer underneath, so host windows pass ImGuiWindowFlags_NoBackground; call
+// it once per window per frame.
+void CompositeImage(LayerCompositor& compositor, uint32_t texture, float width, float height);
+// Submits a popup layer at |x|, |y| (ImGui screen coordinates) above the
+// current window's image.
+void CompositePopup(LayerCompositor& compositor, uint32_t texture, float x, float y, float width, float height);
+}  // namespace ImGuiLayer
@@ -0,0 +1,30 @@
+#pragma once
+
+class VulkanRenderer;
+
+// ImGui multi-viewport support on VulkanRenderer (--multi-viewport in
+// cefForms): ImGui windows dragged out of the main window become OS windows,
+// each drawn into a VulkanRenderer::WindowTarget with the main window's
+// device, queue and textures. Each window draws ImGui with vertex and index
+// buffers of its own, so windows are recorded and submitted without waiting
+// for each other. Needs the ImGui docking branch.
+namespace ImGuiViewports {
+// Sets ImGuiConfigFlags_ViewportsEnable. Call before the GLFW and Vulkan
+// backends are initialized. False when this ImGui build has no platform
+// windows (no IMGUI_HAS_VIEWPORT).
+bool Enable();
+// Replaces the Vulkan backend's renderer callbacks with ones that render
+// through |renderer|. Call after ImGui_ImplVulkan_Init. False, with
+// viewports turned off again, when the pipeline cannot be created.
+bool Install(VulkanRenderer& renderer);
+// Creates, updates and draws the platform windows for the frame just
+// rendered, then waits for the GPU to finish them. Call after
+// VulkanRenderer::EndFrame (or in its place, when BeginFrame had no image),
+// every frame that called ImGui::Render. Only windows that got an image
+// from VulkanRenderer::AcquireWindowTargets are drawn; the others keep
+// their previous image instead of holding up the loop.
+void RenderPlatformWindows();
+// Releases the window targets. Call before ImGui_ImplVulkan_Shutdown, which
+// would otherwise treat them as its own per-viewport data.
+void Shutdown();
+}  // namespace ImGuiViewports
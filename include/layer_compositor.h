@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+class VulkanRenderer;
+
+enum class CompositorLayerKind { Background, View, Popup, Overlay };
+
+// One textured quad. Coordinates are framebuffer pixels.
+struct CompositorLayer {
+    uint32_t texture = 0;
+    CompositorLayerKind kind = CompositorLayerKind::View;
+    // Lower orders draw first; ties keep submission order.
+    int order = 0;
+    float x = 0.0f, y = 0.0f, width = 0.0f, height = 0.0f;
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+    float clipMinX = 0.0f, clipMinY = 0.0f, clipMaxX = 0.0f, clipMaxY = 0.0f;
+    float tint[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+};
+
+struct CompositorStats {
+    uint32_t layers = 0;
+    uint32_t drawCalls = 0;
+    uint32_t descriptorBinds = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t textures = 0;
+    bool descriptorIndexing = false;
+};
+
+// Draws every browser layer (views, popups, overlays) of a frame with one
+// pipeline and one descriptor set holding an array of all layer textures.
+// Per-layer data lives in a storage buffer indexed by gl_InstanceIndex.
+//
+// With descriptor indexing (Vulkan 1.2 or VK_EXT_descriptor_indexing) the
+// array is partially bound and indexed non-uniformly, so a frame is one
+// instanced draw whatever the panel count. Without it, each layer is its own
+// draw (firstInstance = layer) so the index stays dynamically uniform; binds
+// stay constant either way.
+//
+// Layers are recorded before ImGui, so ImGui draws all of its windows and
+// controls on top. Texture slot 0 is a white texel used for solid layers.
+class LayerCompositor {
+public:
+    static constexpr uint32_t kMaxTextures = 64;  // matches layer_compositor.frag
+    static constexpr uint32_t kMaxLayers = 256;
+    static constexpr uint32_t kInvalidTexture = UINT32_MAX;
+    static constexpr uint32_t kSolidTexture = 0;
+
+    bool Initialize(VulkanRenderer& renderer, bool descriptorIndexing);
+    void Cleanup();
+
+    // |view| must be in SHADER_READ_ONLY_OPTIMAL when the frame is recorded.
+    // Returns kInvalidTexture when all slots are in use.
+    uint32_t RegisterTexture(VkImageView view);
+    void UpdateTexture(uint32_t texture, VkImageView view);
+    void ReleaseTexture(uint32_t texture);
+
+    void Submit(const CompositorLayer& layer);
+    // Records the submitted layers into |commandBuffer| inside the frame's
+    // render pass (or dynamic rendering scope) and clears them.
+    void Record(VkCommandBuffer commandBuffer, VkExtent2D extent);
+
+    bool UsesDescriptorIndexing() const { return m_DescriptorIndexing; }
+    CompositorStats GetStats() const { return m_Stats; }
+
+private:
+    // std430 mirror of the Layer struct in layer_compositor.vert.
+    struct GpuLayer {
+        float rect[4];
+        float uv[4];
+        float clip[4];
+        float tint[4];
+        uint32_t texture;
+        uint32_t pad[3];
+    };
+
+    bool CreateSolidTexture();
+    bool CreateDescriptors();
+    bool CreatePipeline();
+    VkShaderModule CreateShaderModule(const uint32_t* code, size_t size);
+    void WriteTexture(uint32_t texture, VkImageView view);
+
+    VulkanRenderer* m_Renderer = nullptr;
+    VkDevice m_Device = VK_NULL_HANDLE;
+    bool m_DescriptorIndexing = false;
+
+    VkSampler m_Sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_DescriptorSet = VK_NULL_HANDLE;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_Pipeline = VK_NULL_HANDLE;
+
+    VkBuffer m_LayerBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_LayerMemory = VK_NULL_HANDLE;
+    GpuLayer* m_MappedLayers = nullptr;
+
+    VkImage m_SolidImage = VK_NULL_HANDLE;
+    VkDeviceMemory m_SolidMemory = VK_NULL_HANDLE;
+    VkImageView m_SolidView = VK_NULL_HANDLE;
+
+    std::vector<VkImageView> m_Textures;
+    std::vector<CompositorLayer> m_Layers;
+    CompositorStats m_Stats;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Process-wide store for named gauges, counters and histograms. Samplers and
+// panels publish into it from any thread; the ImGui overlay reads a snapshot
+// once per frame.
+class MetricsRegistry {
+public:
+    struct Sample {
+        std::string name;
+        double value;
+    };
+
+    // Histogram buckets are powers of two in the recorded unit (usually
+    // milliseconds): [0,1), [1,2), [2,4) ... with the last bucket open ended.
+    static constexpr size_t kHistogramBuckets = 18;
+
+    struct Histogram {
+        uint64_t count = 0;
+        double sum = 0.0;
+        double max = 0.0;
+        std::array<uint64_t, kHistogramBuckets> buckets{};
+
+        void Record(double value);
+        double Percentile(double fraction) const;
+        double Mean() const { return count ? sum / count : 0.0; }
+    };
+
+    struct HistogramSample {
+        std::string name;
+        Histogram histogram;
+    };
+
+    static MetricsRegistry& Get();
+
+    void SetGauge(const std::string& name, double value);
+    void AddCounter(const std::string& name, double delta = 1.0);
+    void RecordHistogram(const std::string& name, double value);
+    void RemovePrefix(const std::string& prefix);
+
+    std::vector<Sample> GetGauges() const;
+    std::vector<Sample> GetCounters() const;
+    std::vector<HistogramSample> GetHistograms() const;
+
+private:
+    MetricsRegistry() = default;
+
+    mutable std::mutex m_Mutex;
+    std::map<std::string, double> m_Gauges;
+    std::map<std::string, double> m_Counters;
+    std::map<std::string, Histogram> m_Histograms;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "include/cef_base.h"
+#include "include/cef_command_line.h"
+#include "metrics_registry.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One main-frame navigation of one panel. Stage times are milliseconds from
+// navigation start; a negative value means the stage was never reached.
+struct PageLoadRecord {
+    std::string panel;
+    std::string url;
+    int64_t startedAtMs = 0;  // wall clock, ms since the Unix epoch
+    int httpStatus = 0;
+    int errorCode = 0;        // cef_errorcode_t, 0 when the load did not fail
+    std::string errorText;
+    bool completed = false;   // reached first present
+    double loadStartMs = -1.0;
+    double loadEndMs = -1.0;
+    double firstPaintMs = -1.0;
+    double firstUploadMs = -1.0;
+    double firstPresentMs = -1.0;
+};
+
+struct PageLoadUrlStats {
+    std::string url;
+    uint64_t loads = 0;
+    uint64_t errors = 0;
+    int lastStatus = 0;
+    MetricsRegistry::Histogram loadEndMs;
+    MetricsRegistry::Histogram firstPresentMs;
+};
+
+// Process-wide sink for finished navigations. Aggregates per-URL histograms
+// (query and fragment stripped, so dynamic URLs do not explode the key space),
+// publishes them as load.<url>.* metrics and appends each record as a JSON
+// line to a small rolling log: once the file reaches its cap it is renamed to
+// <path>.1, replacing the previous generation.
+class PageLoadLog {
+public:
+    static PageLoadLog& Get();
+
+    // Reads --load-log=PATH (defaults to |defaultPath|) and --load-log-kb
+    // (the roll size; 0 disables the on-disk log).
+    void ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine, const std::filesystem::path& defaultPath);
+    void SetLogFile(const std::filesystem::path& path, uint64_t maxBytes);
+
+    void Record(const PageLoadRecord& record);
+
+    std::vector<PageLoadUrlStats> GetUrlStats() const;
+    std::vector<PageLoadRecord> GetRecent() const;
+
+    static std::string UrlKey(const std::string& url);
+    static std::string ToJson(const PageLoadRecord& record);
+
+private:
+    PageLoadLog() = default;
+    void AppendLine(const std::string& line);
+
+    static constexpr size_t kRecentLimit = 32;
+
+    mutable std::mutex m_Mutex;
+    std::map<std::string, PageLoadUrlStats> m_Urls;
+    std::deque<PageLoadRecord> m_Recent;
+    std::filesystem::path m_Path;
+    uint64_t m_MaxBytes = 0;
+    uint64_t m_FileBytes = 0;
+    std::ofstream m_File;
+};
+
+// Per-browser navigation timeline: navigation start -> OnLoadStart ->
+// OnLoadEnd -> first OnPaint -> first texture upload -> first present. CEF
+// load and display callbacks feed it through CefClientImpl, the render handler
+// reports paints, and the app's frame loop reports uploads and presents. Each
+// stage only counts once the previous one was reached, so paints of the old
+// page before commit are ignored. The record is handed to PageLoadLog once both
+// the first present and the load end (or a load error) have been seen, or
+// otherwise when the next navigation starts or the browser closes.
+//
+// All methods must be called on the CEF UI thread.
+class PageLoadTracker : public CefBaseRefCounted {
+public:
+    explicit PageLoadTracker(std::string panel = "Browser");
+
+    void SetPanel(const std::string& panel) { m_Panel = panel; }
+
+    // Marks an app-initiated navigation (CreateBrowser, LoadURL). Navigations
+    // started by the page itself begin at OnLoadingStateChange instead.
+    void BeginNavigation(const std::string& url);
+    void OnLoadingStateChange(bool isLoading);
+    void OnAddressChange(const std::string& url);
+    void OnLoadStart();
+    void OnLoadEnd(int httpStatus);
+    void OnLoadError(int errorCode, const std::string& errorText, const std::string& failedUrl);
+    void OnPaint();
+    void OnUpload();
+    void OnPresent();
+    void OnClose();
+
+private:
+    double Elapsed() const;
+    void Finish();
+
+    std::string m_Panel;
+    bool m_Active = false;
+    std::chrono::steady_clock::time_point m_Start;
+    PageLoadRecord m_Record;
+
+    IMPLEMENT_REFCOUNTING(PageLoadTracker);
+};
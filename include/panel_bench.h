@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ProcessTreeMemory {
+    int processes = 0;
+    uint64_t rssBytes = 0;
+    // Proportional set size: shared pages split between the processes
+    // mapping them, so renderers sharing Chromium's code are not counted
+    // thirty times. 0 where the platform does not report it.
+    uint64_t pssBytes = 0;
+};
+
+// Memory of this process and every process it started (Chromium's
+// renderer, GPU and utility processes). Linux reads /proc; Windows only
+// counts this process.
+ProcessTreeMemory SampleProcessTreeMemory();
+
+// User plus system CPU time of the same processes, in seconds, so the cost
+// of Chromium's raster and compositing counts along with the render loop's.
+double SampleProcessTreeCpuSeconds();
+
+// --bench-panels: measures a fixed panel load for one process profile.
+// After a warm-up that starts once every panel has painted, it records the
+// render loop's frame times and samples the process tree's memory and CPU
+// time once a second, then reports one "Bench result:" line of key=value
+// pairs that benchProfiles.sh collects.
+class PanelBench {
+public:
+    PanelBench(std::string profile, int panels, double warmupSeconds, double seconds);
+
+    // Loop thread, after each drawn frame. |ready| stays false until every
+    // panel has painted; the warm-up only starts once it is true.
+    void OnFrame(double frameMs, bool ready);
+    bool IsDone() const { return m_Done; }
+    // Reported as software=on|off, to compare runs with --software-mode.
+    void SetSoftwareMode(bool softwareMode) { m_SoftwareMode = softwareMode; }
+
+    // Given the frame times and memory samples so far.
+    std::string FormatReport() const;
+
+    // Nearest-rank percentile of |values|; 0 when empty.
+    static double Percentile(std::vector<double> values, double fraction);
+
+    // For tests: feeds a memory sample instead of reading the process tree.
+    void AddMemorySample(const ProcessTreeMemory& memory);
+    // For tests: process tree CPU seconds once |frames| frames were measured.
+    // cpu_ms_per_frame spans the first and the last sample.
+    void AddCpuSample(double cpuSeconds, size_t frames);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::string m_Profile;
+    int m_Panels;
+    Clock::duration m_Warmup;
+    Clock::duration m_Duration;
+    bool m_Ready = false;
+    bool m_Done = false;
+    Clock::time_point m_ReadyAt;
+    Clock::time_point m_NextSample;
+    std::vector<double> m_FrameMs;
+    std::vector<ProcessTreeMemory> m_Memory;
+    bool m_SoftwareMode = false;
+    bool m_HasCpuSample = false;
+    double m_CpuFirst = 0.0, m_CpuLast = 0.0;
+    size_t m_CpuFirstFrames = 0, m_CpuLastFrames = 0;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Decompresses a zlib stream (stored, fixed and dynamic Huffman blocks) and
+// checks its Adler-32. Dependency-free counterpart of the encoder's deflate.
+bool InflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+// Decodes a non-interlaced PNG of any color type and bit depth into RGBA8
+// rows. 16-bit samples keep their high byte; tRNS transparency is applied.
+// Golden images may come from other tools (e.g. optimizers that switch to
+// a palette), so this is more general than what EncodePng writes. On
+// failure |error| says why.
+bool DecodePng(const uint8_t* data, size_t size, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height,
+               std::string* error = nullptr);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Byte order of 4-byte pixels: Rgba from Vulkan readback, Bgra straight
+// from CefRenderHandler::OnPaint.
+enum class PixelOrder { Rgba, Bgra };
+
+// Packs |pixels| 4-byte pixels into 3-byte RGB, dropping alpha. Uses SSSE3
+// (picked at run time) or NEON when available, scalar otherwise.
+void PackRgb(const uint8_t* src, uint8_t* dst, size_t pixels, PixelOrder order);
+// Scalar reference for PackRgb.
+void PackRgbScalar(const uint8_t* src, uint8_t* dst, size_t pixels, PixelOrder order);
+// Name of the PackRgb path in use: "ssse3", "neon" or "scalar".
+const char* PackRgbPath();
+
+// Encodes tightly packed RGB8 rows as an opaque 8-bit truecolor PNG.
+// Dependency-free: each row gets the cheapest of the None/Sub/Up/Paeth
+// filters, and the zlib stream is one fixed-Huffman deflate block with a
+// short hash-chain LZ77 search, which is well suited to flat UI content.
+std::vector<uint8_t> EncodePngRgb(const uint8_t* rgb, uint32_t width, uint32_t height);
+// PackRgb followed by EncodePngRgb.
+std::vector<uint8_t> EncodePng(const uint8_t* pixels, uint32_t width, uint32_t height, PixelOrder order);
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+uint32_t Adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
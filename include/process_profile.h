@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+enum class SiteIsolation {
+    // Whatever Chromium's field trials pick (strict on desktop).
+    Default,
+    // --site-per-process: every site in its own renderer, whatever the trials
+    // say. A slow panel cannot stall panels from other sites.
+    Strict,
+    // --disable-site-isolation-trials and --process-per-site: panels from one
+    // site share a renderer. Only for trusted panel content.
+    Relaxed,
+};
+
+enum class CompositingMode { Gpu, Software };
+
+// A named bundle of Chromium process-model and memory switches, picked with
+// --process-profile=NAME. Zero fields leave Chromium's default in place.
+struct ProcessProfile {
+    std::string name;
+    std::string summary;
+    int rendererProcessLimit = 0;
+    SiteIsolation siteIsolation = SiteIsolation::Default;
+    // --num-raster-threads; Chromium accepts 1 to 4.
+    int rasterThreads = 0;
+    // V8 old-space limit per renderer, passed through --js-flags.
+    int v8HeapMb = 0;
+    CompositingMode compositing = CompositingMode::Gpu;
+    int64_t diskCacheMb = 0;
+    // --disable-renderer-backgrounding: panels keep foreground priority and
+    // timers when Chromium thinks they are in the background.
+    bool keepRenderersForeground = false;
+    // --disable-frame-rate-limit and --disable-gpu-vsync, as --unlimited-fps.
+    bool unthrottledFrames = false;
+};
+
+struct ProfileSwitch {
+    std::string name;
+    // Empty for a switch without a value.
+    std::string value;
+};
+
+struct ProfileResolution {
+    // Switches to append, in order. Existing switches are never replaced,
+    // except --js-flags, which gets the heap limit appended to it.
+    std::vector<ProfileSwitch> apply;
+    // Switches the command line already set, which win over the profile.
+    std::vector<std::string> kept;
+    // Conflicts and out-of-range values; the profile is still applied.
+    std::vector<std::string> warnings;
+};
+
+// kiosk-lowmem, operator-lowlatency and bench.
+const std::vector<ProcessProfile>& GetProcessProfiles();
+const ProcessProfile* FindProcessProfile(const std::string& name);
+// "kiosk-lowmem, operator-lowlatency, bench", for error messages.
+std::string ProcessProfileNames();
+
+// The profile's full switch bundle, before looking at the command line.
+std::vector<ProfileSwitch> GetProfileSwitches(const ProcessProfile& profile);
+
+// Merges the profile with the switches already on the command line
+// (|existing| maps switch name to value) and checks the combination.
+ProfileResolution ResolveProcessProfile(const ProcessProfile& profile,
+                                        const std::map<std::string, std::string>& existing);
+
+// "--name=value --flag ..." for logging.
+std::string FormatProfileSwitches(const std::vector<ProfileSwitch>& switches);
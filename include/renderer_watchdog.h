@@ -0,0 +1,122 @@
+#pragma once
+
+#include "include/cef_command_line.h"
+#include "include/cef_frame.h"
+#include "include/cef_process_message.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class CefClientImpl;
+
+// Sent by the watchdog to a panel's main frame; the renderer answers with the
+// same sequence number as soon as its main thread gets to the message.
+inline constexpr char kWatchdogPingMessage[] = "watchdog.ping";
+inline constexpr char kWatchdogPongMessage[] = "watchdog.pong";
+
+struct RendererWatchdogStats {
+    std::string label;
+    int browserId = 0;
+    double idleMs = 0.0;       // since the last paint or pong
+    bool pingOutstanding = false;
+    bool recovering = false;
+    bool recoveryFailed = false;  // gave up after the retry limit
+    int recoveryAttempts = 0;     // in the current recovery
+    uint64_t pings = 0;
+    uint64_t pongs = 0;
+    uint64_t crashes = 0;
+    uint64_t hangs = 0;
+    uint64_t recoveries = 0;
+    double lastRecoverMs = -1.0;
+    std::string lastReason;
+};
+
+// Per-panel liveness monitor. A panel counts as alive while it paints or
+// answers pings; once it has been idle for the ping interval it is pinged over
+// the same frame message channel the bridges use, and if no pong arrives
+// within the hang timeout the renderer is declared hung. Termination reported
+// through CefRequestHandler triggers recovery immediately.
+//
+// Recovery is posted as a separate UI task so it never runs inside a CEF
+// callback or the frame loop; the app's callback recreates the browser and
+// calls Watch() again with the new client. Time to recover runs from detection
+// to the new browser's first paint and is published as
+// watchdog.<label>.recover_ms.
+//
+// A replacement that crashes, hangs or does not paint within the hang timeout
+// of being created is recreated again, after a backoff that doubles from the
+// ping interval. After --watchdog-max-retries retries the panel is marked
+// failed and left alone until it paints again.
+//
+// All methods must be called on the CEF UI thread.
+class RendererWatchdog : public CefBaseRefCounted {
+public:
+    using RecoverCallback = std::function<void(const std::string& label)>;
+
+    RendererWatchdog() = default;
+    ~RendererWatchdog() override;
+
+    // Reads --watchdog-interval-ms, --watchdog-ping-ms, --watchdog-hang-ms and
+    // --watchdog-max-retries.
+    void ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+    // Opt-in through --renderer-watchdog: recovery reloads the page and loses
+    // its in-page state.
+    static bool EnabledFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+
+    void SetRecoverCallback(RecoverCallback callback) { m_RecoverCallback = std::move(callback); }
+
+    // Starts (or resumes, after a recovery) watching |client| under |label|.
+    void Watch(const std::string& label, CefRefPtr<CefClientImpl> client);
+    void Unwatch(const std::string& label);
+
+    void Start();
+    void Stop();
+
+    // Reported by CefClientImpl.
+    void OnPong(CefClientImpl* client);
+    void OnTerminated(CefClientImpl* client, int status);
+    void OnUnresponsive(CefClientImpl* client);
+
+    std::vector<RendererWatchdogStats> GetStats() const;
+
+    // Renderer side: answers a ping on |frame|. Returns true if |message| was a ping.
+    static bool HandleRendererMessage(CefRefPtr<CefFrame> frame, CefRefPtr<CefProcessMessage> message);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        CefRefPtr<CefClientImpl> client;
+        RendererWatchdogStats stats;
+        Clock::time_point lastActivity;
+        Clock::time_point firstPingSent;
+        Clock::time_point lastPingSent;
+        Clock::time_point detectedAt;         // latest recovery attempt
+        Clock::time_point recoveryStartedAt;  // first detection
+        Clock::time_point recoveryDeadline;   // replacement must paint by then
+        bool recreatePending = false;         // Recover task posted, not yet run
+        int pingSequence = 0;
+    };
+
+    Entry* FindEntry(CefClientImpl* client);
+    void Tick(int generation);
+    void CheckEntry(Entry& entry, Clock::time_point now);
+    void BeginRecovery(Entry& entry, const char* reason);
+    bool CanRestartRecovery(const Entry& entry) const;
+    void Recover(int generation, std::string label);
+
+    int m_IntervalMs = 250;
+    int m_PingMs = 1000;
+    // Twice Chromium's own 15 s hang monitor, so a page that blocks its main
+    // thread for a few seconds is left alone.
+    int m_HangMs = 30000;
+    int m_MaxRetries = 5;
+    int m_Generation = 0;
+    RecoverCallback m_RecoverCallback;
+    std::map<std::string, Entry> m_Entries;
+
+    IMPLEMENT_REFCOUNTING(RendererWatchdog);
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "include/cef_browser.h"
+#include "include/cef_command_line.h"
+#include "include/cef_devtools_message_observer.h"
+#include "include/cef_registration.h"
+#include "include/cef_request_context.h"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+enum class PanelCacheMode { Global, Memory, Disk };
+
+struct PanelCacheOptions {
+    // Global keeps the profile at the cache root, so existing cookies,
+    // localStorage and logins survive and panels keep sharing them.
+    PanelCacheMode mode = PanelCacheMode::Global;
+    // Per-class cap on the on-disk cache; 0 leaves it to Chromium.
+    uint64_t capBytes = 0;
+};
+
+struct RequestContextStats {
+    std::string panelClass;
+    PanelCacheMode mode = PanelCacheMode::Global;
+    std::string cachePath;
+    uint64_t responses = 0;
+    uint64_t cacheHits = 0;
+    double hitRate = 0.0;
+    uint64_t diskBytes = 0;
+    uint64_t diskBytesWritten = 0;
+    uint64_t capBytes = 0;
+    uint64_t evictions = 0;
+};
+
+// Optional CefRequestContext per panel class ("delivery", "todo", ...) so
+// panels do not contend on a single profile and disk cache. Each class is
+// left on the global context (the default), in-memory (no cache_path), or on
+// disk under <cache root>/<class>, with an optional size cap. Memory and disk
+// contexts are opt-in through --panel-cache-*: they start from an empty
+// profile and do not share storage with other classes. Response cache hits are
+// counted from DevTools Network events and disk usage is sampled from the
+// HTTP cache directory (<path>/Cache); both are published as cache.<class>.*
+// metrics.
+//
+// All methods must be called on the CEF UI thread.
+class RequestContextPool : public CefBaseRefCounted {
+public:
+    explicit RequestContextPool(std::filesystem::path cacheRoot);
+
+    // Launch switches parsed before CefInitialize, when the global command
+    // line is not yet available.
+    static CefRefPtr<CefCommandLine> ParseLaunchCommandLine(int argc, char* argv[]);
+    // Honors --cache-root, e.g. a tmpfs mount on kiosks with slow storage.
+    static std::filesystem::path CacheRootFromCommandLine(CefRefPtr<CefCommandLine> commandLine,
+                                                          const std::filesystem::path& fallback);
+
+    // Reads --panel-cache, --panel-cache-mb, per-class --panel-cache-<class>
+    // and --panel-cache-<class>-mb overrides, and --cache-sample-ms.
+    void ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+    PanelCacheOptions GetOptions(const std::string& panelClass) const;
+
+    // Returns the context for |panelClass|, creating it on first use. Returns
+    // nullptr for classes configured to use the global context.
+    CefRefPtr<CefRequestContext> GetContext(const std::string& panelClass);
+
+    // Starts counting cache hits for |browser| under |panelClass|.
+    void AttachBrowser(const std::string& panelClass, CefRefPtr<CefBrowser> browser);
+    void DetachBrowser(int browserId);
+
+    void Start();
+    void Stop();
+
+    std::vector<RequestContextStats> GetStats() const;
+
+private:
+    class NetworkObserver;
+    struct ContextState {
+        PanelCacheOptions options;
+        std::filesystem::path cachePath;
+        CefRefPtr<CefRequestContext> context;
+        RequestContextStats stats;
+        bool sampled = false;
+        // Set when a clear was sent; the next sample checks whether it helped.
+        bool clearPending = false;
+        // Set when a clear left the cache over its cap (e.g. entries pinned
+        // by open pages); the cap is not enforced again until it drops below.
+        bool capUnreachable = false;
+    };
+    struct Attachment {
+        std::string panelClass;
+        CefRefPtr<CefBrowser> browser;
+        CefRefPtr<CefRegistration> registration;
+    };
+
+    ContextState& GetState(const std::string& panelClass);
+    void RecordResponse(const std::string& panelClass, bool fromCache);
+    void Sample(int generation);
+    void SampleContext(const std::string& panelClass, ContextState& state);
+
+    std::filesystem::path m_CacheRoot;
+    PanelCacheOptions m_DefaultOptions;
+    std::map<std::string, PanelCacheOptions> m_ClassOptions;
+    int m_SampleIntervalMs = 5000;
+    int m_Generation = 0;
+
+    std::map<std::string, ContextState> m_Contexts;
+    std::map<int, Attachment> m_Attachments;
+
+    IMPLEMENT_REFCOUNTING(RequestContextPool);
+};
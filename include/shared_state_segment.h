@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Process message telling the renderer which segment to map.
+// Arguments: [0] segment name (string).
+constexpr char kSharedStateAttachMessage[] = "shared_state.attach";
+
+constexpr uint32_t kSharedStateMaxRows = 64;
+constexpr size_t kSharedStateTextLength = 32;
+
+// Columnar simulator snapshot. Plain data only: it is copied verbatim into and
+// out of shared memory. Value-initialize it ({}) so unused bytes compare equal.
+struct SharedStateColumns {
+    uint32_t rows;
+    int32_t id[kSharedStateMaxRows];
+    int32_t ptd[kSharedStateMaxRows];
+    int32_t delivered[kSharedStateMaxRows];
+    int32_t eta[kSharedStateMaxRows];
+    uint8_t callDispatch[kSharedStateMaxRows];
+    char name[kSharedStateMaxRows][kSharedStateTextLength];
+    char status[kSharedStateMaxRows][kSharedStateTextLength];
+    char statusText[kSharedStateMaxRows][kSharedStateTextLength];
+
+    static void SetText(char (&target)[kSharedStateTextLength], const std::string& value);
+    static std::string GetText(const char (&source)[kSharedStateTextLength]);
+};
+
+// Named shared-memory segment holding the latest SharedStateColumns behind a
+// seqlock. The browser process creates it and is the only writer; renderers
+// open it read-only and pull a copy only when the version has moved, so a
+// simulator tick costs no IPC and an unchanged snapshot costs no copy.
+class SharedStateSegment {
+public:
+    // Writer side. Returns nullptr if the platform refuses the mapping.
+    static std::unique_ptr<SharedStateSegment> Create(const std::string& name);
+    // Reader side; maps the segment read-only.
+    static std::unique_ptr<SharedStateSegment> Open(const std::string& name);
+    // Per-process name, so several app instances never share a segment.
+    static std::string DefaultName();
+
+    ~SharedStateSegment();
+    SharedStateSegment(const SharedStateSegment&) = delete;
+    SharedStateSegment& operator=(const SharedStateSegment&) = delete;
+
+    // Publishes |columns| as a new version. Returns false, without touching the
+    // segment, when the data is identical to the previous write.
+    bool Write(const SharedStateColumns& columns);
+
+    // Latest completed version; 0 until the first write.
+    uint64_t GetVersion() const;
+
+    // Copies a consistent snapshot. Returns false if the writer kept the
+    // segment busy for every retry or the segment is not initialized.
+    bool Read(SharedStateColumns& columns, uint64_t& version) const;
+
+    const std::string& GetName() const { return m_Name; }
+
+private:
+    struct Layout;
+
+    SharedStateSegment(std::string name, void* mapping, bool owner);
+
+    Layout* GetLayout() const { return static_cast<Layout*>(m_Mapping); }
+
+    std::string m_Name;
+    void* m_Mapping = nullptr;
+    bool m_Owner = false;
+#ifdef _WIN32
+    void* m_Handle = nullptr;
+#endif
+    std::unique_ptr<SharedStateColumns> m_LastWritten;
+};
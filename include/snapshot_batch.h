@@ -0,0 +1,78 @@
+#pragma once
+
+#include "png_encoder.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// CEF- and Vulkan-free parts of the snapshot tool: the page list and the
+// PNG writer pool.
+
+struct SnapshotJob {
+    std::string url;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Empty until the tool picks a name under --snapshot-dir.
+    std::string output;
+};
+
+// "WIDTHxHEIGHT", both non-zero.
+bool ParseSnapshotSize(const std::string& value, uint32_t& width, uint32_t& height);
+// URLs with a scheme pass through; anything else is a local path and
+// becomes an absolute file:// URL.
+std::string ToSnapshotUrl(const std::string& target);
+// "<index>-<host and path>.png" with everything but [A-Za-z0-9.-] folded
+// to '_'. The index keeps names unique when URLs differ only in the query.
+std::string SnapshotFileName(const std::string& url, size_t index);
+// One page per line: "URL [WIDTHxHEIGHT] [OUTPUT]". Blank lines and lines
+// starting with '#' are skipped. Malformed lines are reported in |errors|
+// and dropped.
+std::vector<SnapshotJob> ParseSnapshotList(std::istream& in, uint32_t defaultWidth, uint32_t defaultHeight,
+                                           std::vector<std::string>* errors = nullptr);
+
+// Encodes and writes PNGs on a small thread pool so the capture loop only
+// pays for the readback. Publishes snapshot.encode_ms and
+// snapshot.png_bytes.
+class SnapshotWriter {
+public:
+    SnapshotWriter() = default;
+    ~SnapshotWriter();
+
+    void Start(size_t threads);
+    void Stop();
+
+    // Takes ownership of |pixels|, 4 bytes per pixel in |order|.
+    void Submit(const std::string& path, std::vector<uint8_t> pixels, uint32_t width, uint32_t height,
+                PixelOrder order);
+    // Blocks until every submitted image is written. Returns the number of
+    // failed writes so far.
+    size_t Wait();
+    size_t GetWritten() const;
+
+private:
+    struct Job {
+        std::string path;
+        std::vector<uint8_t> pixels;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        PixelOrder order = PixelOrder::Rgba;
+    };
+
+    void Run();
+
+    std::vector<std::thread> m_Threads;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Idle;
+    bool m_Running = false;
+    std::deque<Job> m_Jobs;
+    size_t m_Busy = 0;
+    size_t m_Written = 0;
+    size_t m_Failed = 0;
+};
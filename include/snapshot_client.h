@@ -0,0 +1,109 @@
+#pragma once
+
+#include "cef_client_impl.h"
+#include "include/cef_resource_request_handler.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+
+// Console line the ready script logs once the page's ready expression is
+// true. Pages can also log it themselves.
+extern const char kSnapshotReadyMarker[];
+
+// Counts a browser's requests in flight, so the snapshot tool can wait for
+// the network to go quiet. Called on the IO thread; read from the UI thread.
+class NetworkIdleTracker : public CefResourceRequestHandler {
+public:
+    // With |offline|, http(s) requests to anything but loopback are
+    // cancelled, so a run against local files cannot reach the network.
+    explicit NetworkIdleTracker(bool offline) : m_Offline(offline) {}
+
+    virtual ReturnValue OnBeforeResourceLoad(CefRefPtr<CefBrowser> browser,
+                                             CefRefPtr<CefFrame> frame,
+                                             CefRefPtr<CefRequest> request,
+                                             CefRefPtr<CefCallback> callback) override;
+    virtual void OnResourceLoadComplete(CefRefPtr<CefBrowser> browser,
+                                        CefRefPtr<CefFrame> frame,
+                                        CefRefPtr<CefRequest> request,
+                                        CefRefPtr<CefResponse> response,
+                                        URLRequestStatus status,
+                                        int64_t received_content_length) override;
+
+    // No request in flight, and none started or finished for |quiet|.
+    bool IsIdle(std::chrono::milliseconds quiet) const;
+    size_t GetInFlight() const;
+    uint64_t GetBlocked() const { return m_Blocked; }
+
+    static bool IsLoopbackOrLocal(const std::string& url);
+
+private:
+    const bool m_Offline;
+    mutable std::mutex m_Mutex;
+    std::set<uint64_t> m_InFlight;
+    std::chrono::steady_clock::time_point m_LastActivity = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> m_Blocked{0};
+
+    IMPLEMENT_REFCOUNTING(NetworkIdleTracker);
+};
+
+// Client for one snapshot page. Tracks whether the main frame is still
+// loading, whether it failed, and whether the page signalled ready through
+// the console (see SetReadyExpression).
+class SnapshotClient : public CefClientImpl {
+public:
+    SnapshotClient(CefRefPtr<CefRenderHandlerImpl> renderHandler, bool offline);
+
+    // A JavaScript expression; once the main frame loads, a script polls it
+    // every 50 ms and logs kSnapshotReadyMarker when it is truthy.
+    void SetReadyExpression(const std::string& expression) { m_ReadyExpression = expression; }
+
+    virtual CefRefPtr<CefResourceRequestHandler> GetResourceRequestHandler(
+        CefRefPtr<CefBrowser> browser,
+        CefRefPtr<CefFrame> frame,
+        CefRefPtr<CefRequest> request,
+        bool is_navigation,
+        bool is_download,
+        const CefString& request_initiator,
+        bool& disable_default_handling) override {
+        return m_Network;
+    }
+
+    virtual void OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                      bool isLoading,
+                                      bool canGoBack,
+                                      bool canGoForward) override;
+    virtual void OnLoadEnd(CefRefPtr<CefBrowser> browser,
+                           CefRefPtr<CefFrame> frame,
+                           int httpStatusCode) override;
+    virtual void OnLoadError(CefRefPtr<CefBrowser> browser,
+                             CefRefPtr<CefFrame> frame,
+                             ErrorCode errorCode,
+                             const CefString& errorText,
+                             const CefString& failedUrl) override;
+    virtual bool OnConsoleMessage(CefRefPtr<CefBrowser> browser,
+                                  cef_log_severity_t level,
+                                  const CefString& message,
+                                  const CefString& source,
+                                  int line) override;
+
+    // The main frame finished loading at least once and is not loading now.
+    bool IsLoaded() const { return m_Loaded && !m_Loading; }
+    bool HasFailed() const { return m_Failed; }
+    std::string GetError() const;
+    bool IsReadySignalled() const { return m_ReadySignalled; }
+    CefRefPtr<NetworkIdleTracker> GetNetwork() const { return m_Network; }
+
+private:
+    CefRefPtr<NetworkIdleTracker> m_Network;
+    std::string m_ReadyExpression;
+    std::atomic<bool> m_Loading{true};
+    std::atomic<bool> m_Loaded{false};
+    std::atomic<bool> m_Failed{false};
+    std::atomic<bool> m_ReadySignalled{false};
+    mutable std::mutex m_ErrorMutex;
+    std::string m_Error;
+
+    IMPLEMENT_REFCOUNTING(SnapshotClient);
+};
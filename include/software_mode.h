@@ -0,0 +1,39 @@
+#pragma once
+
+#include "vulkan_device_selection.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// --software-mode[=auto|on|off], for hosts without a usable GPU. In software
+// mode Chromium rasterizes and composites on the CPU (--disable-gpu,
+// --disable-gpu-compositing), so OnPaint hands over a plain bitmap without a
+// GPU process readback, and VulkanRenderer drops the work a CPU Vulkan
+// implementation such as lavapipe pays for in full: anisotropic and
+// bilinear sampling at 1:1, mip chains and per-upload staging allocations.
+enum class SoftwareModeSetting { Auto, On, Off };
+
+// A bare --software-mode means on. False for anything but auto, on or off.
+bool ParseSoftwareModeSetting(const std::string& value, SoftwareModeSetting& setting);
+
+struct SoftwareModeDecision {
+    bool enabled = false;
+    std::string reason;
+    // Set when the switch value was not understood.
+    std::string warning;
+};
+
+// Auto turns software mode on when the device the renderer would pick for
+// |deviceOverride| is a CPU implementation, or when there is no usable
+// device at all. |devices| comes from VulkanRenderer::ProbePhysicalDevices,
+// which runs before CEF starts and so before there is a window to check
+// presentation against.
+SoftwareModeDecision DecideSoftwareMode(SoftwareModeSetting setting, const std::vector<PhysicalDeviceInfo>& devices,
+                                        const std::string& deviceOverride);
+
+// The launch-time decision: |present| and |value| are --software-mode on the
+// command line (absent means auto), and |probe| only runs for auto, since
+// creating an instance and enumerating devices costs startup time. An
+// invalid value is treated as auto with a warning.
+SoftwareModeDecision ResolveSoftwareMode(bool present, const std::string& value, const std::string& deviceOverride,
+                                         const std::function<std::vector<PhysicalDeviceInfo>()>& probe);
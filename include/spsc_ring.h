@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring. Neither side blocks or
+// allocates after construction, so the producer can run on a real-time thread
+// such as Chromium's audio capture thread. Capacity is rounded up to a power
+// of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : m_Buffer(RoundUp(capacity)),
+          m_Mask(m_Buffer.size() - 1) {}
+
+    size_t Capacity() const { return m_Buffer.size(); }
+
+    // Producer side.
+    size_t WriteAvailable() const {
+        return Capacity() - (m_Head.load(std::memory_order_relaxed) - m_Tail.load(std::memory_order_acquire));
+    }
+    // Slot |offset| past the current write position; valid for offsets below
+    // WriteAvailable() until CommitWrite().
+    T& WriteSlot(size_t offset) {
+        return m_Buffer[(m_Head.load(std::memory_order_relaxed) + offset) & m_Mask];
+    }
+    void CommitWrite(size_t count) {
+        m_Head.store(m_Head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+    size_t Write(const T* data, size_t count) {
+        count = std::min(count, WriteAvailable());
+        for (size_t i = 0; i < count; ++i) WriteSlot(i) = data[i];
+        CommitWrite(count);
+        return count;
+    }
+
+    // Consumer side.
+    size_t ReadAvailable() const {
+        return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_relaxed);
+    }
+    size_t Read(T* out, size_t count) {
+        count = std::min(count, ReadAvailable());
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i) out[i] = m_Buffer[(tail + i) & m_Mask];
+        m_Tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    static size_t RoundUp(size_t value) {
+        size_t capacity = 1;
+        while (capacity < value) capacity <<= 1;
+        return capacity;
+    }
+
+    std::vector<T> m_Buffer;
+    size_t m_Mask;
+    // Separate cache lines so producer and consumer do not false-share.
+    alignas(64) std::atomic<size_t> m_Head{0};
+    alignas(64) std::atomic<size_t> m_Tail{0};
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+// Process message names used to keep renderer-side replicas in sync.
+// Update arguments: [0] key (string), [1] version (double), [2] JSON (string).
+constexpr char kStateReplicaUpdateMessage[] = "state_replica.update";
+constexpr char kStateReplicaRequestMessage[] = "state_replica.request";
+
+// Versioned key -> JSON store. The browser process publishes into one copy per
+// client and forwards every change to the renderer, which applies it to its
+// local copy so hot read paths can be answered synchronously from V8 without a
+// cefQuery round trip. Not thread-safe; each copy is owned by a single thread
+// (the browser UI thread or the renderer main thread).
+class StateReplica {
+public:
+    struct Entry {
+        uint64_t version = 0;
+        std::string json;
+    };
+
+    // Authoritative side: stores |json| under the next version for |key|.
+    uint64_t Publish(const std::string& key, std::string json);
+
+    // Replica side: accepts the update only if it is newer than what is held,
+    // so duplicated or reordered updates can never roll state back.
+    bool Apply(const std::string& key, uint64_t version, std::string json);
+
+    const Entry* Find(const std::string& key) const;
+    const std::map<std::string, Entry>& GetEntries() const { return m_Entries; }
+    void Clear() { m_Entries.clear(); }
+
+private:
+    std::map<std::string, Entry> m_Entries;
+};
+
+// One entry as carried by kStateReplicaUpdateMessage.
+struct StateUpdate {
+    std::string key;
+    uint64_t version = 0;
+    std::string json;
+};
+
+// Browser side of the replica protocol, kept free of CEF so the ordering it
+// promises can be tested. |send| puts an update on the page's main frame
+// message channel (and drops it while there is no browser yet).
+class StatePublisher {
+public:
+    using SendUpdate = std::function<void(const StateUpdate&)>;
+
+    // Stores |json| under the next version and sends it before returning, so
+    // anything sent on the same channel afterwards, such as the reply to the
+    // cefQuery that made the write, reaches the renderer after the update.
+    void Publish(const std::string& key, std::string json, const SendUpdate& send);
+    // Answers kStateReplicaRequestMessage from a new V8 context: sends every
+    // published entry.
+    void Resync(const SendUpdate& send) const;
+
+    const StateReplica& GetState() const { return m_State; }
+
+private:
+    StateReplica m_State;
+};
+
+// Renderer side: one replica per browser, filled by updates and emptied when
+// the browser goes away.
+class StateReplicaSet {
+public:
+    // A V8 context was created. Returns true when the browser has to be asked
+    // for a resync (kStateReplicaRequestMessage): on every main frame
+    // context, since a new or recreated renderer starts empty.
+    bool OnContextCreated(int browserId, bool isMainFrame);
+    // Applies a kStateReplicaUpdateMessage; false when it was stale.
+    bool OnUpdate(int browserId, const StateUpdate& update);
+    void OnBrowserDestroyed(int browserId) { m_Replicas.erase(browserId); }
+
+    const StateReplica::Entry* Find(int browserId, const std::string& key) const;
+
+private:
+    std::map<int, StateReplica> m_Replicas;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "layer_compositor.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+
+class VulkanRenderer;
+
+// Owns one browser texture: image, memory, view and the binding that draws
+// it, an ImGui descriptor set or a layer compositor slot.
+//
+// The binding is created once. Attaching a new image (resize, format swap)
+// rewrites it in place with vkUpdateDescriptorSets instead of allocating
+// another set. That is safe because textures change between frames and
+// EndFrame waits for its frame. Replaced images, and everything on
+// Release, are destroyed through VulkanRenderer::DeferUntilFrameComplete,
+// so no submitted frame or upload still references them.
+//
+// Live images and descriptor sets are published as textures.* gauges.
+class TextureHandle {
+public:
+    // Destroys an image and its memory; defaults to vkDestroyImage and
+    // vkFreeMemory. Images from GpuFrameConverter go back to the converter.
+    using ImageDeleter = std::function<void(VkImage, VkDeviceMemory)>;
+
+    TextureHandle() = default;
+    TextureHandle(const TextureHandle&) = delete;
+    TextureHandle& operator=(const TextureHandle&) = delete;
+
+    // Takes ownership of |image| and |memory|, creates a view and points the
+    // binding at it. The previous image, if any, is retired. On failure the
+    // new image is destroyed and the previous one stays attached.
+    bool Attach(VulkanRenderer* renderer, VkSampler sampler, VkImage image, VkDeviceMemory memory,
+                VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels = 1,
+                ImageDeleter deleter = {});
+    // Retires the image and the binding.
+    void Release(VulkanRenderer* renderer);
+
+    bool IsValid() const { return m_Image != VK_NULL_HANDLE; }
+    VkImage GetImage() const { return m_Image; }
+    VkImageView GetView() const { return m_View; }
+    VkFormat GetFormat() const { return m_Format; }
+    uint32_t GetWidth() const { return m_Width; }
+    uint32_t GetHeight() const { return m_Height; }
+    uint32_t GetMipLevels() const { return m_MipLevels; }
+    // VK_NULL_HANDLE when the texture is drawn through the compositor.
+    VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+    // LayerCompositor::kInvalidTexture without the compositor.
+    uint32_t GetLayerTexture() const { return m_LayerTexture; }
+
+private:
+    void RetireImage(VulkanRenderer* renderer);
+
+    VkImage m_Image = VK_NULL_HANDLE;
+    VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+    VkImageView m_View = VK_NULL_HANDLE;
+    ImageDeleter m_Deleter;
+    VkFormat m_Format = VK_FORMAT_UNDEFINED;
+    uint32_t m_Width = 0;
+    uint32_t m_Height = 0;
+    uint32_t m_MipLevels = 1;
+    VkDescriptorSet m_DescriptorSet = VK_NULL_HANDLE;
+    uint32_t m_LayerTexture = LayerCompositor::kInvalidTexture;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "include/cef_command_line.h"
+#include "include/cef_trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records Chromium tracing (CefBeginTracing/CefEndTracing) together with our
+// own frame, upload, IPC and simulator events, then merges both into a single
+// Chrome trace JSON file that opens in Perfetto or chrome://tracing. Native
+// timestamps are shifted onto Chromium's trace clock so both sides line up.
+//
+// Start/Stop/Tick must be called on the CEF UI thread. Record* and TraceScope
+// may be used from any thread and cost a single atomic load while idle. Event
+// names and categories must be string literals.
+class TraceCapture : public CefEndTracingCallback {
+public:
+    static TraceCapture& Get();
+
+    // Reads --trace=N (capture the first N seconds), --trace-categories and
+    // --trace-file. Returns true if a startup capture was requested.
+    bool ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine);
+
+    bool Start();
+    bool Stop();
+    void Toggle();
+    void Tick();
+    // Ends a running capture and pumps CEF until it is written; call before
+    // CefShutdown. No capture can start afterwards.
+    void Shutdown();
+
+    bool IsActive() const { return m_Active.load(std::memory_order_relaxed); }
+    const std::string& GetOutputPath() const { return m_OutputPath; }
+
+    void RecordComplete(const char* name, const char* category,
+                        std::chrono::steady_clock::time_point start,
+                        std::chrono::steady_clock::time_point end);
+    void RecordInstant(const char* name, const char* category);
+
+    // CefEndTracingCallback methods
+    virtual void OnEndTracingComplete(const CefString& tracing_file) override;
+
+private:
+    struct Event {
+        const char* name;
+        const char* category;
+        char phase;
+        int64_t timestampUs;
+        int64_t durationUs;
+        int64_t threadId;
+    };
+
+    TraceCapture() = default;
+
+    int64_t ToTraceMicros(std::chrono::steady_clock::time_point time) const;
+    void Append(const Event& event);
+    static void WriteMerged(const std::string& chromiumFile, const std::string& outputPath,
+                            std::vector<Event> events, int64_t processId);
+
+    std::atomic<bool> m_Active{false};
+    std::atomic<int64_t> m_ClockOffsetUs{0};
+    bool m_EndPending = false;
+    bool m_ShutDown = false;
+    std::string m_Categories;
+    std::string m_OutputPath = "imguicef_trace.json";
+    int m_StartupSeconds = 0;
+    std::chrono::steady_clock::time_point m_StopAt{};
+
+    std::mutex m_Mutex;
+    std::vector<Event> m_Events;
+    std::thread m_Writer;
+
+    IMPLEMENT_REFCOUNTING(TraceCapture);
+};
+
+// Records a complete ("X") event for the enclosing scope while a capture runs.
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category)
+        : m_Name(name),
+          m_Category(category),
+          m_Active(TraceCapture::Get().IsActive()) {
+        if (m_Active) m_Start = std::chrono::steady_clock::now();
+    }
+
+    ~TraceScope() {
+        if (m_Active) {
+            TraceCapture::Get().RecordComplete(m_Name, m_Category, m_Start, std::chrono::steady_clock::now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_Name;
+    const char* m_Category;
+    bool m_Active;
+    std::chrono::steady_clock::time_point m_Start;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Vulkan-free description of a physical device so selection can be unit
+// tested without a loader or ICD. VulkanRenderer fills it from the device's
+// properties, memory heaps, extensions, features and queue families.
+enum class PhysicalDeviceKind { Other, Integrated, Discrete, Virtual, Cpu };
+
+struct PhysicalDeviceInfo {
+    std::string name;
+    std::string uuid;  // deviceUUID, or pipelineCacheUUID on Vulkan 1.0
+    PhysicalDeviceKind kind = PhysicalDeviceKind::Other;
+    uint32_t apiVersion = 0;
+    uint32_t vendorId = 0;
+    uint32_t deviceId = 0;
+    uint64_t deviceLocalBytes = 0;
+    std::vector<std::string> missingExtensions;
+    std::vector<std::string> missingFeatures;
+    // First family with both graphics and present support for the window
+    // surface, or -1.
+    int queueFamily = -1;
+};
+
+// Returns -1 for devices that cannot drive the renderer (missing extensions
+// or features, no graphics+present queue family). Otherwise discrete beats
+// integrated beats virtual beats CPU; device-local memory breaks ties within
+// a kind.
+int64_t ScorePhysicalDevice(const PhysicalDeviceInfo& device);
+
+// Formats a 16-byte UUID as 8-4-4-4-12 lowercase hex, the form `vulkaninfo`
+// prints and the override accepts.
+std::string FormatDeviceUuid(const uint8_t (&uuid)[16]);
+
+struct PhysicalDeviceSelection {
+    int index = -1;
+    std::string reason;
+    std::vector<int64_t> scores;
+};
+
+// Picks the device to use. A non-empty |override| matches a device UUID
+// (exactly, case-insensitive, dashes optional), a decimal index into
+// |devices|, or a case-insensitive substring of the device name. An override
+// that matches nothing or an unsuitable device falls back to scoring, with
+// the reason recorded.
+PhysicalDeviceSelection SelectPhysicalDevice(const std::vector<PhysicalDeviceInfo>& devices,
+                                             const std::string& override);
+
+// Human-readable capability report, one line per device, marking the choice.
+std::string FormatDeviceReport(const std::vector<PhysicalDeviceInfo>& devices,
+                               const PhysicalDeviceSelection& selection);
+
+const char* PhysicalDeviceKindName(PhysicalDeviceKind kind);
@@ -1,46 +1,203 @@
 #pragma once
 
+#include "frame_presenter.h"
+#include "gpu_readback.h"
+#include "layer_compositor.h"
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
+struct PhysicalDeviceInfo;
+
 class VulkanRenderer {
 public:
+    // Name substring, UUID or index of the GPU to use; see
+    // SelectPhysicalDevice in vulkan_device_selection.h. Must be set before
+    // Initialize. Falls back to the IMGUICEF_VK_DEVICE environment variable.
+    void SetDeviceOverride(const std::string& value) { m_DeviceOverride = value; }
+    // Allows the Vulkan 1.3 path (dynamic rendering, synchronization2 and
+    // timeline semaphores) on devices that support it; otherwise the 1.0
+    // render pass path is used. Must be set before Initialize.
+    void SetAllowVulkan13(bool allow) { m_AllowVulkan13 = allow; }
+    // Creates the layer compositor during Initialize when the device can
+    // index a sampler array from a shader.
+    void SetCompositorEnabled(bool enabled) { m_CompositorEnabled = enabled; }
+    // For CPU Vulkan implementations (see software_mode.h): samplers filter
+    // nearest at 1:1 without anisotropy, which is then not required of the
+    // device, textures get no mip chain, and UpdateTextureImage reuses mapped
+    // staging buffers instead of allocating one per upload. Must be set
+    // before Initialize.
+    void SetSoftwareMode(bool enabled) { m_SoftwareMode = enabled; }
+    bool IsSoftwareMode() const { return m_SoftwareMode; }
+    // Enumerates the physical devices through a short-lived instance with no
+    // surface, so it can run before CEF and the window exist. Presentation
+    // support is not checked; queueFamily is the first graphics family.
+    static std::vector<PhysicalDeviceInfo> ProbePhysicalDevices();
+    // |value|, or IMGUICEF_VK_DEVICE when it is empty.
+    static std::string EffectiveDeviceOverride(const std::string& value);
+    // Presents to |window| through a SwapchainPresenter.
     bool Initialize(GLFWwindow* window);
+    // Renders through |presenter|, e.g. an OffscreenPresenter with no window
+    // or display server at all.
+    bool Initialize(std::unique_ptr<FramePresenter> presenter);
     void Cleanup();
-    void BeginFrame();
+    // False when no image could be acquired, even after recreating the
+    // presenter (minimized window, surface still out of date). Nothing is
+    // recorded then: skip the main window's draw data and EndFrame. Without
+    // window targets the acquire waits, so the main window's display paces
+    // the loop. With them it never waits and is false while the main
+    // display still holds every image, so a slow main monitor does not hold
+    // up the other windows.
+    bool BeginFrame();
     void EndFrame();
+    // Records the compositor's layers into the current frame. Call after
+    // ImGui::Render and before the ImGui draw data is recorded, so ImGui
+    // draws on top.
+    void CompositeLayers();
+    // nullptr when the compositor is disabled or unsupported.
+    LayerCompositor* GetCompositor() { return m_Compositor.get(); }
+    FramePresenter* GetPresenter() { return m_Presenter.get(); }
+    // Runs |release| once the frame being recorded (or the next one, between
+    // frames) and every earlier frame have completed, so resources it frees
+    // are no longer referenced by the GPU.
+    void DeferUntilFrameComplete(std::function<void()> release);
+    // Waits for the device and runs every deferred release. Call before
+    // shutting down anything the releases use (ImGui, the compositor).
+    void FlushDeferredReleases();
+    // Copies |region| of |image| to the host without stalling: the copy is
+    // recorded into the next frame after rendering and the future resolves
+    // once that frame completes. |image| needs TRANSFER_SRC usage and must be
+    // in |layout| (SHADER_READ_ONLY_OPTIMAL for textures) when the frame runs.
+    std::future<ReadbackResult> ReadbackImage(VkImage image, VkImageLayout layout, VkFormat format,
+                                              const VkRect2D& region);
+    // Resolves readbacks whose frames have completed. BeginFrame and
+    // EndFrame do this too; call it when polling a future between frames.
+    void PollReadbacks();
+
+    // A secondary OS window (an ImGui platform window) drawn with this
+    // renderer's device, queue, render pass and descriptor pool, so textures
+    // created here can be drawn in any window. It has its own surface,
+    // swapchain, command buffer and semaphores; the renderer owns it between
+    // CreateWindowTarget and DestroyWindowTarget.
+    struct WindowTarget {
+        std::unique_ptr<SwapchainPresenter> presenter;
+        std::vector<VkFramebuffer> framebuffers;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkSemaphore imageAvailable = VK_NULL_HANDLE;
+        VkSemaphore renderFinished = VK_NULL_HANDLE;
+        // 1.0 path; the 1.3 path signals the renderer's timeline instead.
+        VkFence inFlight = VK_NULL_HANDLE;
+        // Image held from AcquireWindowTargets until RenderWindowTarget.
+        uint32_t imageIndex = 0;
+        bool acquired = false;
+        // Submitted since the last FinishWindowFrames.
+        bool submitted = false;
+    };
+    // Call once, before the first frame, when window targets will be drawn.
+    // EndFrame then leaves deferred releases to FinishWindowFrames, since
+    // windows drawn after it still use the frame's textures.
+    void EnableWindowTargets() { m_WindowTargetsEnabled = true; }
+    // nullptr when the surface cannot be created, the graphics queue cannot
+    // present to it, or it has no size yet.
+    WindowTarget* CreateWindowTarget(GLFWwindow* window);
+    void DestroyWindowTarget(WindowTarget* target);
+    // Acquires the next image of every window target without waiting, so
+    // each window is paced by its own display. A window whose display still
+    // holds every image, or that is minimized, is skipped this time
+    // (vulkan.window_frames_skipped). Returns how many windows hold an image;
+    // a held image stays held until the window is rendered or destroyed.
+    uint32_t AcquireWindowTargets();
+    // Records |record| into the image AcquireWindowTargets got for the
+    // window, between the same begin and end rendering as the main frame,
+    // then submits and presents it. False, with the previous image left on
+    // screen, when the window holds no image. Does not wait for the GPU, so
+    // windows are not serialized against each other or the main window.
+    bool RenderWindowTarget(WindowTarget* target, const std::function<void(VkCommandBuffer)>& record);
+    // Waits for the GPU (not the displays) to finish the window frames
+    // submitted since the last call, then runs the deferred releases that
+    // EndFrame leaves to it (see EnableWindowTargets). Textures are
+    // replaced between loop iterations, so call it after the last
+    // RenderWindowTarget of every iteration that drew an ImGui frame.
+    void FinishWindowFrames();
     
     VkCommandBuffer GetCommandBuffer() { return m_CommandBuffer; }
     VkInstance GetInstance() { return m_Instance; }
     VkDevice GetDevice() { return m_Device; }
     VkPhysicalDevice GetPhysicalDevice() { return m_PhysicalDevice; }
     VkQueue GetGraphicsQueue() { return m_GraphicsQueue; }
+    // VK_NULL_HANDLE on the 1.3 path; pipelines then target
+    // GetColorAttachmentFormat() through dynamic rendering.
     VkRenderPass GetRenderPass() { return m_RenderPass; }
+    bool UsesDynamicRendering() const { return m_DynamicRendering; }
+    const VkFormat* GetColorAttachmentFormat() const { return &m_ColorFormat; }
+    uint32_t GetApiVersion() const { return m_DeviceApiVersion; }
+    uint64_t GetSwapchainRecreateCount() const { return m_SwapchainRecreations; }
     VkDescriptorPool GetDescriptorPool() { return m_DescriptorPool; }
+    // Records a layout transition with the stage and access masks the
+    // renderer uses for it; unknown transitions are skipped.
+    void RecordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                            uint32_t baseMipLevel = 0, uint32_t levelCount = 1);
     uint32_t GetQueueFamily() { return m_QueueFamily; }
+    const std::string& GetDeviceReport() const { return m_DeviceReport; }
     
-    VkImage CreateTextureImage(uint32_t width, uint32_t height, const void* data, VkDeviceMemory& textureMemory);
-    void UpdateTextureImage(VkImage image, uint32_t width, uint32_t height, const void* data);
-    VkImageView CreateImageView(VkImage image, VkFormat format);
+    // Levels in a full mip chain for |width| x |height|, or 1 when the device
+    // cannot linear-blit RGBA8 images or in software mode.
+    uint32_t GetMipLevelCount(uint32_t width, uint32_t height) const;
+    // With |mipLevels| > 1 the chain is generated on the GPU after the upload.
+    VkImage CreateTextureImage(uint32_t width, uint32_t height, const void* data, VkDeviceMemory& textureMemory,
+                               uint32_t mipLevels = 1);
+    // |data| is the whole level 0. |damage|, when given, limits the copy and
+    // the mip blits to that region of it.
+    void UpdateTextureImage(VkImage image, uint32_t width, uint32_t height, const void* data,
+                            uint32_t mipLevels = 1, const VkRect2D* damage = nullptr);
+    // True when |format| can be sampled with optimal tiling. BC formats also
+    // need the textureCompressionBC feature, which is enabled when present.
+    bool SupportsSampledFormat(VkFormat format) const;
+    // Single-level image of a block-compressed |format| holding |blocks|.
+    VkImage CreateCompressedTextureImage(VkFormat format, uint32_t width, uint32_t height, const void* blocks,
+                                         VkDeviceSize size, VkDeviceMemory& textureMemory);
+    VkImageView CreateImageView(VkImage image, VkFormat format, uint32_t mipLevels = 1);
     VkSampler CreateTextureSampler();
+    
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                     VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 
 private:
-    GLFWwindow* m_Window = nullptr;
+    std::unique_ptr<FramePresenter> m_Presenter;
+    std::string m_DeviceOverride;
+    std::string m_DeviceReport;
+    uint32_t m_InstanceApiVersion = VK_API_VERSION_1_0;
+    uint32_t m_DeviceApiVersion = VK_API_VERSION_1_0;
+    bool m_AllowVulkan13 = true;
+    bool m_DynamicRendering = false;
+    bool m_EnableDynamicRenderingExtension = false;
+    bool m_CompositorEnabled = false;
+    bool m_SoftwareMode = false;
+    bool m_SamplerAnisotropy = false;
+    bool m_DescriptorIndexing = false;
+    bool m_SampledImageDynamicIndexing = false;
+    bool m_LinearBlit = false;
+    bool m_TextureCompressionBC = false;
+    std::unique_ptr<LayerCompositor> m_Compositor;
     VkInstance m_Instance = VK_NULL_HANDLE;
     VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
     VkDevice m_Device = VK_NULL_HANDLE;
     VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
-    VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
-    VkSwapchainKHR m_Swapchain = VK_NULL_HANDLE;
     VkRenderPass m_RenderPass = VK_NULL_HANDLE;
     VkCommandPool m_CommandPool = VK_NULL_HANDLE;
     VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
     VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
     
-    std::vector<VkImage> m_SwapchainImages;
-    std::vector<VkImageView> m_SwapchainImageViews;
+    // One per presenter image on the 1.0 path.
     std::vector<VkFramebuffer> m_Framebuffers;
+    // The presenter's format, kept here so ImGui and the compositor can
+    // point at it.
+    VkFormat m_ColorFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    uint64_t m_SwapchainRecreations = 0;
     
     uint32_t m_QueueFamily = 0;
     uint32_t m_ImageIndex = 0;
@@ -48,22 +205,102 @@ private:
     VkSemaphore m_ImageAvailableSemaphore = VK_NULL_HANDLE;
     VkSemaphore m_RenderFinishedSemaphore = VK_NULL_HANDLE;
     VkFence m_InFlightFence = VK_NULL_HANDLE;
+
+    // 1.3 path: one timeline orders uploads before the frame that samples
+    // them and replaces the per-frame fence and per-upload queue idle.
+    struct PendingUpload {
+        uint64_t value = 0;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    };
+    VkSemaphore m_Timeline = VK_NULL_HANDLE;
+    uint64_t m_TimelineValue = 0;
+    uint64_t m_LastUploadValue = 0;
+    uint64_t m_LastFrameValue = 0;
+    std::vector<PendingUpload> m_PendingUploads;
+
+    // Software mode: staging buffers stay mapped and go back here once their
+    // upload completes, so a CPU device does not allocate, fault in and free
+    // a frame-sized buffer for every paint.
+    struct StagingBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+        bool inUse = false;
+    };
+    std::vector<StagingBuffer> m_StagingPool;
+
+    // Frames submitted so far; a deferred release waits for the frame after
+    // the last submitted one, which also orders it after earlier uploads.
+    struct DeferredRelease {
+        uint64_t frame = 0;
+        std::function<void()> release;
+    };
+    uint64_t m_FramesSubmitted = 0;
+    std::vector<DeferredRelease> m_DeferredReleases;
+    uint64_t m_CompletedFrames = 0;
+    ReadbackPool m_Readback;
+    std::vector<std::unique_ptr<WindowTarget>> m_WindowTargets;
+    uint64_t m_LastWindowFrameValue = 0;
+    bool m_WindowTargetsEnabled = false;
     
     bool CreateInstance();
     bool SelectPhysicalDevice();
+    PhysicalDeviceInfo QueryPhysicalDevice(VkPhysicalDevice device);
+    bool SupportsVulkan13Path();
+    bool SupportsDescriptorIndexing();
+    bool HasDeviceExtension(const char* name);
     bool CreateLogicalDevice();
-    bool CreateSwapchain();
+    bool RecreatePresenter(FramePresenter& presenter, std::vector<VkFramebuffer>& framebuffers);
+    void DestroyFramebuffers(std::vector<VkFramebuffer>& framebuffers);
     bool CreateRenderPass();
-    bool CreateFramebuffers();
+    bool CreateFramebuffers(FramePresenter& presenter, std::vector<VkFramebuffer>& framebuffers);
     bool CreateCommandPool();
     bool CreateDescriptorPool();
     bool CreateSyncObjects();
+    bool AcquireWindowTarget(WindowTarget& target);
+    // Consumes the pending signal of a held image's semaphore, so the
+    // target can be destroyed without rendering it.
+    void DrainAcquiredImage(WindowTarget& target);
+    void ReleaseWindowTarget(WindowTarget& target);
+    // Begins |commandBuffer| and the render pass (or dynamic rendering) on
+    // |imageIndex|, cleared to black. Shared by the main frame and window
+    // targets.
+    void BeginRendering(VkCommandBuffer commandBuffer, FramePresenter& presenter, uint32_t imageIndex,
+                        const std::vector<VkFramebuffer>& framebuffers);
+    // Ends rendering and leaves the image in the presenter's final layout.
+    void EndRendering(VkCommandBuffer commandBuffer, FramePresenter& presenter, uint32_t imageIndex);
+    // Submits a recorded frame after this frame's uploads, waiting on
+    // |imageAvailable| and signaling |renderFinished| when |semaphores|.
+    // Returns the timeline value the frame signals on the 1.3 path; 1.0
+    // signals |fence|.
+    uint64_t SubmitFrame(VkCommandBuffer commandBuffer, bool semaphores, VkSemaphore imageAvailable,
+                         VkSemaphore renderFinished, VkFence fence);
+    void RunDeferredReleases(uint64_t completedFrame);
     
-    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-                     VkBuffer& buffer, VkDeviceMemory& bufferMemory);
     void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
     
     VkCommandBuffer BeginSingleTimeCommands();
     void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
+    // Submits an upload and releases its staging buffer once the GPU is done
+    // with it: immediately on the 1.0 path, deferred on the timeline on 1.3.
+    void SubmitUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, VkDeviceMemory stagingMemory);
+    // A mapped, host-coherent staging buffer of at least |size| bytes: from
+    // the pool in software mode, otherwise newly allocated.
+    bool AcquireStagingBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory, void*& mapped);
+    // Returns a pooled buffer to the pool, or frees any other buffer.
+    void ReleaseStagingBuffer(VkBuffer buffer, VkDeviceMemory memory);
+    void DestroyStagingPool();
+    uint64_t SubmitOnTimeline(VkCommandBuffer commandBuffer);
+    void WaitForTimeline(uint64_t value);
+    void ReclaimUploads();
+    // Latest frame known to be complete, from the timeline or fence status
+    // without waiting.
+    uint64_t PollCompletedFrames();
+    // Blits |damage| of level 0 down the chain and leaves every level in
+    // SHADER_READ_ONLY_OPTIMAL.
+    void RecordMipChain(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height,
+                        uint32_t mipLevels, const VkRect2D& damage);
 };
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 450
+
+// Same binding as ImGui_ImplVulkan_AddTexture's descriptor sets, so every
+// ImTextureID can be bound here unchanged.
+layout(set = 0, binding = 0) uniform sampler2D sourceTexture;
+
+layout(location = 0) in vec4 inColor;
+layout(location = 1) in vec2 inUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = inColor * texture(sourceTexture, inUv);
+}
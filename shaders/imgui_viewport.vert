@@ -0,0 +1,21 @@
+#version 450
+
+// ImGui's own vertex shader (imgui_impl_vulkan), for platform windows drawn
+// by ImGuiViewports. Inputs match ImDrawVert.
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in vec4 inColor;
+
+layout(push_constant) uniform PushConstants {
+    vec2 scale;
+    vec2 translate;
+} pc;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec2 outUv;
+
+void main() {
+    outColor = inColor;
+    outUv = inUv;
+    gl_Position = vec4(inPosition * pc.scale + pc.translate, 0.0, 1.0);
+}
@@ -0,0 +1,31 @@
+#version 450
+
+// Built twice: with LAYER_NONUNIFORM for devices with descriptor indexing,
+// where every layer is one instance of a single draw, and without it for
+// the fallback that issues one draw per layer so the index stays
+// dynamically uniform.
+#ifdef LAYER_NONUNIFORM
+#extension GL_EXT_nonuniform_qualifier : require
+#define LAYER_TEXTURE(index) textures[nonuniformEXT(index)]
+#else
+#define LAYER_TEXTURE(index) textures[index]
+#endif
+
+// Must match LayerCompositor::kMaxTextures.
+layout(set = 0, binding = 0) uniform sampler2D textures[64];
+
+layout(location = 0) in vec2 inUv;
+layout(location = 1) flat in uint inTexture;
+layout(location = 2) flat in vec4 inTint;
+layout(location = 3) flat in vec4 inClip;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Layers are clipped to their ImGui window without per-layer scissors,
+    // which would split the draw.
+    if (any(lessThan(gl_FragCoord.xy, inClip.xy)) || any(greaterThanEqual(gl_FragCoord.xy, inClip.zw))) {
+        discard;
+    }
+    outColor = LAYER_TEXTURE(inTexture) * inTint;
+}
@@ -0,0 +1,39 @@
+#version 450
+
+// One instance per browser layer; see LayerCompositor::GpuLayer.
+struct Layer {
+    vec4 rect;      // x, y, width, height in framebuffer pixels
+    vec4 uv;        // u0, v0, u1, v1
+    vec4 clip;      // min x, min y, max x, max y in framebuffer pixels
+    vec4 tint;
+    uint texture;
+    uint pad0;
+    uint pad1;
+    uint pad2;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Layers {
+    Layer layers[];
+};
+
+layout(push_constant) uniform PushConstants {
+    vec2 scale;
+    vec2 translate;
+} pc;
+
+layout(location = 0) out vec2 outUv;
+layout(location = 1) flat out uint outTexture;
+layout(location = 2) flat out vec4 outTint;
+layout(location = 3) flat out vec4 outClip;
+
+void main() {
+    Layer layer = layers[gl_InstanceIndex];
+    // Triangle strip: (0,0) (1,0) (0,1) (1,1).
+    vec2 corner = vec2(float(gl_VertexIndex & 1), float(gl_VertexIndex >> 1));
+    vec2 position = layer.rect.xy + corner * layer.rect.zw;
+    outUv = mix(layer.uv.xy, layer.uv.zw, corner);
+    outTexture = layer.texture;
+    outTint = layer.tint;
+    outClip = layer.clip;
+    gl_Position = vec4(position * pc.scale + pc.translate, 0.0, 1.0);
+}
@@ -0,0 +1,318 @@
+#include "../include/audio_capture.h"
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+constexpr int kOutputChannels = 2;
+constexpr int kBlocksPerSecond = 100;
+// One second of stereo per panel absorbs scheduling hiccups on either side.
+constexpr size_t kRingSeconds = 1;
+// Blocks buffered before a stream is mixed, so bursty packets do not underrun.
+constexpr size_t kPrimeBlocks = 2;
+constexpr int kMetricsEveryBlocks = 10;
+
+void WriteLittleEndian(std::ofstream& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+double ToDb(float value) {
+    return value > 0.0f ? 20.0 * std::log10(value) : -120.0;
+}
+}  // namespace
+
+AudioStream::AudioStream(std::string label, int sampleRate)
+    : m_Label(std::move(label)),
+      m_MixerRate(sampleRate),
+      m_Ring(static_cast<size_t>(sampleRate) * kOutputChannels * kRingSeconds) {}
+
+void AudioStream::Begin(int sampleRate, int channels) {
+    m_RateMismatch = sampleRate != m_MixerRate;
+    if (m_RateMismatch) {
+        std::cerr << "Audio stream for " << m_Label << " runs at " << sampleRate
+                  << " Hz instead of " << m_MixerRate << " Hz; metering only" << std::endl;
+    }
+    m_Channels = channels;
+    m_Active = true;
+}
+
+void AudioStream::Push(const float** planes, int frames) {
+    const int channels = m_Channels.load(std::memory_order_relaxed);
+    if (!planes || frames <= 0 || channels <= 0) return;
+
+    float peak = 0.0f;
+    double sumSquares = 0.0;
+    for (int c = 0; c < channels; ++c) {
+        for (int f = 0; f < frames; ++f) {
+            const float sample = planes[c][f];
+            peak = std::max(peak, std::fabs(sample));
+            sumSquares += static_cast<double>(sample) * sample;
+        }
+    }
+    m_Peak.store(peak, std::memory_order_relaxed);
+    m_Rms.store(static_cast<float>(std::sqrt(sumSquares / (static_cast<double>(frames) * channels))),
+                std::memory_order_relaxed);
+
+    if (m_RateMismatch.load(std::memory_order_relaxed)) return;
+
+    // Mono is duplicated to both sides; channels past the first two are dropped.
+    const float* left = planes[0];
+    const float* right = channels > 1 ? planes[1] : planes[0];
+    const size_t writable = m_Ring.WriteAvailable() / kOutputChannels;
+    const size_t count = std::min(static_cast<size_t>(frames), writable);
+    for (size_t f = 0; f < count; ++f) {
+        m_Ring.WriteSlot(f * kOutputChannels) = left[f];
+        m_Ring.WriteSlot(f * kOutputChannels + 1) = right[f];
+    }
+    m_Ring.CommitWrite(count * kOutputChannels);
+    if (count < static_cast<size_t>(frames)) {
+        m_Overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AudioStream::End() {
+    m_Active = false;
+    m_Peak = 0.0f;
+    m_Rms = 0.0f;
+}
+
+AudioMeterSnapshot AudioStream::GetMeter() const {
+    AudioMeterSnapshot meter;
+    meter.label = m_Label;
+    meter.active = m_Active.load(std::memory_order_relaxed);
+    meter.peak = m_Peak.load(std::memory_order_relaxed);
+    meter.rms = m_Rms.load(std::memory_order_relaxed);
+    meter.overruns = m_Overruns.load(std::memory_order_relaxed);
+    meter.underruns = m_Underruns.load(std::memory_order_relaxed);
+    return meter;
+}
+
+AudioCaptureHandler::AudioCaptureHandler(std::shared_ptr<AudioStream> stream, int sampleRate)
+    : m_Stream(std::move(stream)),
+      m_SampleRate(sampleRate) {}
+
+AudioCaptureHandler::~AudioCaptureHandler() {
+    m_Stream->End();
+    m_Stream->Detach();
+}
+
+bool AudioCaptureHandler::GetAudioParameters(CefRefPtr<CefBrowser> browser, CefAudioParameters& params) {
+    params.sample_rate = m_SampleRate;
+    params.channel_layout = CEF_CHANNEL_LAYOUT_STEREO;
+    params.frames_per_buffer = m_SampleRate / kBlocksPerSecond;
+    return true;
+}
+
+void AudioCaptureHandler::OnAudioStreamStarted(CefRefPtr<CefBrowser> browser,
+                                               const CefAudioParameters& params,
+                                               int channels) {
+    m_Stream->Begin(params.sample_rate, channels);
+}
+
+void AudioCaptureHandler::OnAudioStreamPacket(CefRefPtr<CefBrowser> browser,
+                                              const float** data,
+                                              int frames,
+                                              int64_t pts) {
+    m_Stream->Push(data, frames);
+}
+
+void AudioCaptureHandler::OnAudioStreamStopped(CefRefPtr<CefBrowser> browser) {
+    m_Stream->End();
+}
+
+void AudioCaptureHandler::OnAudioStreamError(CefRefPtr<CefBrowser> browser, const CefString& message) {
+    std::cerr << "Audio stream error (" << m_Stream->GetLabel() << "): " << message.ToString() << std::endl;
+    m_Stream->End();
+}
+
+AudioMixer::AudioMixer(int sampleRate)
+    : m_SampleRate(sampleRate) {}
+
+AudioMixer::~AudioMixer() {
+    Stop();
+}
+
+std::unique_ptr<AudioMixer> AudioMixer::FromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    if (!commandLine || !commandLine->HasSwitch("audio-capture")) return nullptr;
+    auto mixer = std::make_unique<AudioMixer>();
+    if (commandLine->HasSwitch("audio-wav")) {
+        mixer->OpenWav(commandLine->GetSwitchValue("audio-wav").ToString());
+    }
+    return mixer;
+}
+
+bool AudioMixer::OpenWav(const std::string& path) {
+    FinishWav();
+    m_Wav.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_Wav) {
+        std::cerr << "Failed to open audio sink " << path << std::endl;
+        return false;
+    }
+    // Sizes are patched in FinishWav once the length is known.
+    const uint32_t blockAlign = kOutputChannels * sizeof(int16_t);
+    m_Wav.write("RIFF", 4);
+    WriteLittleEndian(m_Wav, 0, 4);
+    m_Wav.write("WAVEfmt ", 8);
+    WriteLittleEndian(m_Wav, 16, 4);
+    WriteLittleEndian(m_Wav, 1, 2);
+    WriteLittleEndian(m_Wav, kOutputChannels, 2);
+    WriteLittleEndian(m_Wav, static_cast<uint32_t>(m_SampleRate), 4);
+    WriteLittleEndian(m_Wav, static_cast<uint32_t>(m_SampleRate) * blockAlign, 4);
+    WriteLittleEndian(m_Wav, blockAlign, 2);
+    WriteLittleEndian(m_Wav, 16, 2);
+    m_Wav.write("data", 4);
+    WriteLittleEndian(m_Wav, 0, 4);
+    m_WavDataBytes = 0;
+    return true;
+}
+
+void AudioMixer::Start() {
+    if (m_Running) return;
+    const size_t blockSamples = static_cast<size_t>(m_SampleRate / kBlocksPerSecond) * kOutputChannels;
+    m_Mix.assign(blockSamples, 0.0f);
+    m_Scratch.assign(blockSamples, 0.0f);
+    m_WavBuffer.assign(blockSamples, 0);
+    m_Running = true;
+    m_Thread = std::thread(&AudioMixer::Run, this);
+}
+
+void AudioMixer::Stop() {
+    m_Running = false;
+    if (m_Thread.joinable()) m_Thread.join();
+    FinishWav();
+}
+
+CefRefPtr<AudioCaptureHandler> AudioMixer::CreateHandler(const std::string& label) {
+    auto stream = std::make_shared<AudioStream>(label, m_SampleRate);
+    {
+        std::lock_guard<std::mutex> lock(m_StreamsMutex);
+        m_Streams.push_back(stream);
+    }
+    return new AudioCaptureHandler(stream, m_SampleRate);
+}
+
+std::vector<AudioMeterSnapshot> AudioMixer::GetMeters() const {
+    std::lock_guard<std::mutex> lock(m_StreamsMutex);
+    std::vector<AudioMeterSnapshot> meters;
+    meters.reserve(m_Streams.size());
+    for (const auto& stream : m_Streams) {
+        meters.push_back(stream->GetMeter());
+    }
+    return meters;
+}
+
+AudioMeterSnapshot AudioMixer::GetMixMeter() const {
+    AudioMeterSnapshot meter;
+    meter.label = "Mix";
+    meter.peak = m_MixPeak.load(std::memory_order_relaxed);
+    meter.rms = m_MixRms.load(std::memory_order_relaxed);
+    meter.active = meter.peak > 0.0f;
+    return meter;
+}
+
+void AudioMixer::Run() {
+    const auto blockDuration = std::chrono::microseconds(1000000 / kBlocksPerSecond);
+    const size_t blockFrames = static_cast<size_t>(m_SampleRate / kBlocksPerSecond);
+    auto next = std::chrono::steady_clock::now();
+    int blocks = 0;
+    while (m_Running) {
+        next += blockDuration;
+        std::this_thread::sleep_until(next);
+        // After a long stall, resync instead of mixing a burst of catch-up blocks.
+        const auto now = std::chrono::steady_clock::now();
+        if (now - next > blockDuration * 20) next = now;
+
+        MixBlock(blockFrames);
+        if (++blocks % kMetricsEveryBlocks == 0) PublishMetrics();
+    }
+}
+
+void AudioMixer::MixBlock(size_t frames) {
+    ZoneScoped;
+    const size_t samples = frames * kOutputChannels;
+    std::fill(m_Mix.begin(), m_Mix.begin() + samples, 0.0f);
+    bool mixed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_StreamsMutex);
+        for (auto it = m_Streams.begin(); it != m_Streams.end();) {
+            AudioStream& stream = **it;
+            // Flags first: samples pushed before End or Detach are then
+            // already visible in the ring.
+            const bool detached = stream.m_Detached;
+            const bool flushing = detached || !stream.m_Active;
+            const size_t available = stream.m_Ring.ReadAvailable();
+            if (detached && available == 0) {
+                it = m_Streams.erase(it);
+                continue;
+            }
+            ++it;
+            if (!stream.m_Primed) {
+                // Nothing more is coming for a stopped stream, so its tail
+                // (or a sound shorter than the prime) is mixed as it is.
+                if (available == 0 || (available < samples * kPrimeBlocks && !flushing)) continue;
+                stream.m_Primed = true;
+            }
+            const size_t read = stream.m_Ring.Read(m_Scratch.data(), samples);
+            if (read < samples) {
+                stream.m_Primed = false;
+                if (stream.m_Active) stream.m_Underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < read; ++i) m_Mix[i] += m_Scratch[i];
+            mixed = mixed || read > 0;
+        }
+    }
+
+    float peak = 0.0f;
+    double sumSquares = 0.0;
+    for (size_t i = 0; i < samples; ++i) {
+        m_Mix[i] = std::clamp(m_Mix[i], -1.0f, 1.0f);
+        peak = std::max(peak, std::fabs(m_Mix[i]));
+        sumSquares += static_cast<double>(m_Mix[i]) * m_Mix[i];
+    }
+    m_MixPeak.store(peak, std::memory_order_relaxed);
+    m_MixRms.store(static_cast<float>(std::sqrt(sumSquares / samples)), std::memory_order_relaxed);
+
+    // Silence between streams is not written, so the file only holds audio.
+    if (mixed && m_Wav.is_open()) WriteWav(m_Mix.data(), samples);
+}
+
+void AudioMixer::WriteWav(const float* samples, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        m_WavBuffer[i] = static_cast<int16_t>(std::lround(samples[i] * 32767.0f));
+    }
+    m_Wav.write(reinterpret_cast<const char*>(m_WavBuffer.data()),
+                static_cast<std::streamsize>(count * sizeof(int16_t)));
+    m_WavDataBytes += count * sizeof(int16_t);
+}
+
+void AudioMixer::FinishWav() {
+    if (!m_Wav.is_open()) return;
+    const uint32_t dataBytes = static_cast<uint32_t>(std::min<uint64_t>(m_WavDataBytes, 0xffffffffu - 36));
+    m_Wav.seekp(4);
+    WriteLittleEndian(m_Wav, 36 + dataBytes, 4);
+    m_Wav.seekp(40);
+    WriteLittleEndian(m_Wav, dataBytes, 4);
+    m_Wav.close();
+}
+
+void AudioMixer::PublishMetrics() {
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    for (const AudioMeterSnapshot& meter : GetMeters()) {
+        const std::string prefix = "audio." + meter.label + ".";
+        registry.SetGauge(prefix + "peak_db", ToDb(meter.peak));
+        registry.SetGauge(prefix + "rms_db", ToDb(meter.rms));
+        registry.SetGauge(prefix + "overruns", static_cast<double>(meter.overruns));
+        registry.SetGauge(prefix + "underruns", static_cast<double>(meter.underruns));
+    }
+    registry.SetGauge("audio.mix.peak_db", ToDb(m_MixPeak.load(std::memory_order_relaxed)));
+}
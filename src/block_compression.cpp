@@ -0,0 +1,321 @@
+#include "../include/block_compression.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+// BC7 4-bit index interpolation weights, out of 64.
+constexpr int kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Gathers a 4x4 block of RGBA pixels, repeating the last column and row.
+void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t block[64]) {
+    for (uint32_t y = 0; y < 4; ++y) {
+        const uint32_t sy = std::min(by * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+            const uint32_t sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+        }
+    }
+}
+
+// Per-channel bounding box of the block, inset by 1/16 of its size so the
+// endpoints sit on the colours that are actually there rather than the
+// extremes of noise.
+void InsetBounds(const uint8_t block[64], int channels, int minColor[4], int maxColor[4]) {
+    for (int c = 0; c < channels; ++c) {
+        minColor[c] = 255;
+        maxColor[c] = 0;
+    }
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            minColor[c] = std::min<int>(minColor[c], block[i * 4 + c]);
+            maxColor[c] = std::max<int>(maxColor[c], block[i * 4 + c]);
+        }
+    }
+    for (int c = 0; c < channels; ++c) {
+        const int inset = (maxColor[c] - minColor[c]) >> 4;
+        minColor[c] += inset;
+        maxColor[c] -= inset;
+    }
+}
+
+int SquaredDistance(const uint8_t* pixel, const int* color, int channels) {
+    int sum = 0;
+    for (int c = 0; c < channels; ++c) {
+        const int d = pixel[c] - color[c];
+        sum += d * d;
+    }
+    return sum;
+}
+
+uint16_t To565(const int color[3]) {
+    return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 |
+                                 ((color[2] * 31 + 127) / 255));
+}
+
+void From565(uint16_t value, int color[3]) {
+    const int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+void EncodeBc1Block(const uint8_t block[64], uint8_t out[8]) {
+    int minColor[4], maxColor[4];
+    InsetBounds(block, 3, minColor, maxColor);
+    uint16_t c0 = To565(maxColor), c1 = To565(minColor);
+    if (c0 < c1) std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    // c0 == c1 would select the 3-colour mode; a flat block needs only
+    // index 0 anyway.
+    if (c0 != c1) {
+        int palette[4][3];
+        From565(c0, palette[0]);
+        From565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = SquaredDistance(&block[i * 4], palette[0], 3);
+            for (int p = 1; p < 4; ++p) {
+                const int error = SquaredDistance(&block[i * 4], palette[p], 3);
+                if (error < bestError) {
+                    best = p;
+                    bestError = error;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+        }
+    }
+    out[0] = static_cast<uint8_t>(c0);
+    out[1] = static_cast<uint8_t>(c0 >> 8);
+    out[2] = static_cast<uint8_t>(c1);
+    out[3] = static_cast<uint8_t>(c1 >> 8);
+    for (int i = 0; i < 4; ++i) out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+}
+
+// Quantizes an 8-bit RGBA endpoint to 7 bits per channel plus the p-bit.
+void QuantizeBc7Endpoint(const int color[4], int pbit, int quantized[4], int decoded[4]) {
+    for (int c = 0; c < 4; ++c) {
+        quantized[c] = std::clamp((color[c] - pbit + 1) >> 1, 0, 127);
+        decoded[c] = (quantized[c] << 1) | pbit;
+    }
+}
+
+void PutBits(uint8_t out[16], int& position, uint32_t value, int count) {
+    for (int i = 0; i < count; ++i, ++position) {
+        if (value & (1u << i)) out[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+    }
+}
+
+struct Bc7Candidate {
+    int q0[4], q1[4], p0 = 0, p1 = 0;
+    int indices[16];
+    int error = -1;
+};
+
+// Quantizes the endpoints with the given p-bits and picks each pixel's
+// nearest palette entry.
+void EvaluateBc7(const uint8_t block[64], const int lo[4], const int hi[4], int p0, int p1, Bc7Candidate& candidate) {
+    int e0[4], e1[4];
+    candidate.p0 = p0;
+    candidate.p1 = p1;
+    QuantizeBc7Endpoint(lo, p0, candidate.q0, e0);
+    QuantizeBc7Endpoint(hi, p1, candidate.q1, e1);
+    int palette[16][4];
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            palette[i][c] = ((64 - kBc7Weights[i]) * e0[c] + kBc7Weights[i] * e1[c] + 32) >> 6;
+        }
+    }
+    candidate.error = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, bestError = SquaredDistance(&block[i * 4], palette[0], 4);
+        for (int p = 1; p < 16 && bestError > 0; ++p) {
+            const int error = SquaredDistance(&block[i * 4], palette[p], 4);
+            if (error < bestError) {
+                best = p;
+                bestError = error;
+            }
+        }
+        candidate.indices[i] = best;
+        candidate.error += bestError;
+    }
+}
+
+// Least-squares endpoints for the candidate's index assignment. Returns
+// false when every pixel uses the same weight.
+bool RefineBc7Endpoints(const uint8_t block[64], const Bc7Candidate& candidate, int lo[4], int hi[4]) {
+    double aa = 0.0, ab = 0.0, bb = 0.0, ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; ++i) {
+        const double b = kBc7Weights[candidate.indices[i]] / 64.0, a = 1.0 - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < 4; ++c) {
+            ax[c] += a * block[i * 4 + c];
+            bx[c] += b * block[i * 4 + c];
+        }
+    }
+    const double det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6) return false;
+    for (int c = 0; c < 4; ++c) {
+        lo[c] = std::clamp(static_cast<int>(std::lround((bb * ax[c] - ab * bx[c]) / det)), 0, 255);
+        hi[c] = std::clamp(static_cast<int>(std::lround((aa * bx[c] - ab * ax[c]) / det)), 0, 255);
+    }
+    return true;
+}
+
+void EncodeBc7Block(const uint8_t block[64], uint8_t out[16]) {
+    int lo[4], hi[4];
+    InsetBounds(block, 4, lo, hi);
+    // Mode 6 shares one p-bit across each endpoint's channels, so try all
+    // four pairs, then one least-squares refit of the best.
+    Bc7Candidate best, candidate;
+    for (int p = 0; p < 4 && best.error != 0; ++p) {
+        EvaluateBc7(block, lo, hi, p & 1, p >> 1, candidate);
+        if (best.error < 0 || candidate.error < best.error) best = candidate;
+    }
+    if (best.error > 0 && RefineBc7Endpoints(block, best, lo, hi)) {
+        for (int p = 0; p < 4; ++p) {
+            EvaluateBc7(block, lo, hi, p & 1, p >> 1, candidate);
+            if (candidate.error < best.error) best = candidate;
+        }
+    }
+    int* q0 = best.q0;
+    int* q1 = best.q1;
+    int p0 = best.p0, p1 = best.p1;
+    int* indices = best.indices;
+
+    // The first index is stored with its top bit implied zero.
+    if (indices[0] & 8) {
+        std::swap(q0, q1);
+        std::swap(p0, p1);
+        for (int i = 0; i < 16; ++i) indices[i] = 15 - indices[i];
+    }
+
+    std::memset(out, 0, 16);
+    int position = 0;
+    PutBits(out, position, 1u << 6, 7);  // mode 6
+    for (int c = 0; c < 4; ++c) {
+        PutBits(out, position, static_cast<uint32_t>(q0[c]), 7);
+        PutBits(out, position, static_cast<uint32_t>(q1[c]), 7);
+    }
+    PutBits(out, position, static_cast<uint32_t>(p0), 1);
+    PutBits(out, position, static_cast<uint32_t>(p1), 1);
+    PutBits(out, position, static_cast<uint32_t>(indices[0]), 3);
+    for (int i = 1; i < 16; ++i) PutBits(out, position, static_cast<uint32_t>(indices[i]), 4);
+}
+}  // namespace
+
+const char* BlockFormatName(BlockFormat format) {
+    return format == BlockFormat::Bc1 ? "bc1" : "bc7";
+}
+
+bool ParseBlockFormat(const std::string& value, BlockFormat& format) {
+    std::string lower;
+    for (char c : value) lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    if (lower == "bc1") format = BlockFormat::Bc1;
+    else if (lower == "bc7") format = BlockFormat::Bc7;
+    else return false;
+    return true;
+}
+
+size_t BlockBytes(BlockFormat format) {
+    return format == BlockFormat::Bc1 ? 8 : 16;
+}
+
+size_t CompressedSize(BlockFormat format, uint32_t width, uint32_t height) {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+std::vector<uint8_t> CompressRgba(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height) {
+    ZoneScoped;
+    std::vector<uint8_t> blocks(CompressedSize(format, width, height));
+    if (blocks.empty()) return blocks;
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t blockBytes = BlockBytes(format);
+    uint8_t block[64];
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            LoadBlock(rgba, width, height, bx, by, block);
+            uint8_t* out = &blocks[(static_cast<size_t>(by) * blocksX + bx) * blockBytes];
+            if (format == BlockFormat::Bc1) EncodeBc1Block(block, out);
+            else EncodeBc7Block(block, out);
+        }
+    }
+    return blocks;
+}
+
+BlockCompressionWorker::~BlockCompressionWorker() {
+    Stop();
+}
+
+void BlockCompressionWorker::Start() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Running) return;
+    m_Running = true;
+    m_Thread = std::thread(&BlockCompressionWorker::Run, this);
+}
+
+void BlockCompressionWorker::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Running = false;
+        m_Jobs.clear();
+    }
+    m_Wake.notify_all();
+    if (m_Thread.joinable()) m_Thread.join();
+}
+
+void BlockCompressionWorker::Submit(const std::string& key, uint64_t generation, BlockFormat format,
+                                    uint32_t width, uint32_t height, std::vector<uint8_t> rgba) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.erase(std::remove_if(m_Jobs.begin(), m_Jobs.end(), [&](const Job& job) { return job.key == key; }),
+                     m_Jobs.end());
+        m_Jobs.push_back({ key, generation, format, width, height, std::move(rgba) });
+    }
+    m_Wake.notify_one();
+}
+
+std::vector<CompressedTexture> BlockCompressionWorker::TakeResults() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<CompressedTexture> results;
+    results.swap(m_Results);
+    return results;
+}
+
+void BlockCompressionWorker::Run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Wake.wait(lock, [this] { return !m_Running || !m_Jobs.empty(); });
+        if (!m_Running) return;
+        Job job = std::move(m_Jobs.front());
+        m_Jobs.pop_front();
+        lock.unlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        CompressedTexture result;
+        result.key = job.key;
+        result.generation = job.generation;
+        result.format = job.format;
+        result.width = job.width;
+        result.height = job.height;
+        result.blocks = CompressRgba(job.format, job.rgba.data(), job.width, job.height);
+        result.encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        m_Results.push_back(std::move(result));
+    }
+}
@@ -0,0 +1,192 @@
+#include "../include/browser_resource_sampler.h"
+#include "../include/metrics_registry.h"
+#include "include/base/cef_callback.h"
+#include "include/cef_task.h"
+#include "include/cef_task_manager.h"
+#include "include/wrapper/cef_closure_task.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+// Labels need not be unique (a recreated panel keeps its label), so the
+// browser id keeps each browser's series apart and stops Untrack from
+// removing another browser's.
+std::string MetricPrefix(const BrowserResourceUsage& usage) {
+    return "renderer." + usage.label + "." + std::to_string(usage.browserId) + ".";
+}
+
+double SwitchAsDouble(CefRefPtr<CefCommandLine> commandLine, const char* name, double fallback) {
+    if (!commandLine || !commandLine->HasSwitch(name)) return fallback;
+    try {
+        return std::stod(commandLine->GetSwitchValue(name).ToString());
+    } catch (...) {
+        std::cerr << "Ignoring invalid --" << name << " value" << std::endl;
+        return fallback;
+    }
+}
+}  // namespace
+
+int BrowserResourceSampler::IntervalFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    return std::max(100, static_cast<int>(SwitchAsDouble(commandLine, "resource-sample-ms", 1000.0)));
+}
+
+BrowserResourceLimits BrowserResourceSampler::LimitsFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    BrowserResourceLimits limits;
+    limits.maxCpuPercent = SwitchAsDouble(commandLine, "renderer-max-cpu", 0.0);
+    limits.maxMemoryBytes = static_cast<int64_t>(
+        SwitchAsDouble(commandLine, "renderer-max-memory-mb", 0.0) * 1024.0 * 1024.0);
+    limits.graceSamples = std::max(1, static_cast<int>(SwitchAsDouble(commandLine, "renderer-limit-grace", 3.0)));
+    return limits;
+}
+
+BrowserResourceSampler::BrowserResourceSampler(int intervalMs)
+    : m_IntervalMs(intervalMs) {
+}
+
+void BrowserResourceSampler::Start() {
+    if (m_Running) return;
+    m_Running = true;
+    ScheduleNext();
+}
+
+void BrowserResourceSampler::Stop() {
+    m_Running = false;
+}
+
+void BrowserResourceSampler::Track(int browserId, const std::string& label) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    BrowserResourceUsage& usage = m_Usage[browserId];
+    usage.browserId = browserId;
+    usage.label = label;
+}
+
+void BrowserResourceSampler::Untrack(int browserId) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Usage.find(browserId);
+    if (it == m_Usage.end()) return;
+    MetricsRegistry::Get().RemovePrefix(MetricPrefix(it->second));
+    m_Usage.erase(it);
+}
+
+void BrowserResourceSampler::SetLimits(const BrowserResourceLimits& limits) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Limits = limits;
+}
+
+void BrowserResourceSampler::SetLimitExceededCallback(LimitExceededCallback callback) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_LimitExceeded = std::move(callback);
+}
+
+std::vector<BrowserResourceUsage> BrowserResourceSampler::GetSnapshot() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<BrowserResourceUsage> snapshot;
+    snapshot.reserve(m_Usage.size());
+    for (const auto& entry : m_Usage) {
+        snapshot.push_back(entry.second);
+    }
+    return snapshot;
+}
+
+void BrowserResourceSampler::ScheduleNext() {
+    CefPostDelayedTask(TID_UI, base::BindOnce(&BrowserResourceSampler::Sample, this), m_IntervalMs);
+}
+
+void BrowserResourceSampler::Sample() {
+    ZoneScoped;
+    if (!m_Running) return;
+
+    CefRefPtr<CefTaskManager> manager = CefTaskManager::GetTaskManager();
+    if (!manager) {
+        ScheduleNext();
+        return;
+    }
+
+    // KillTask and the callback run after the lock is released.
+    struct Kill {
+        int64_t taskId = -1;
+        std::string label;
+        // Every tracked browser in the task's process, not only the one
+        // over the limit: process-per-site puts several panels in one.
+        std::vector<int> browserIds;
+    };
+    std::vector<Kill> kills;
+    LimitExceededCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        MetricsRegistry& metrics = MetricsRegistry::Get();
+        for (auto& [browserId, usage] : m_Usage) {
+            usage.taskId = manager->GetTaskIdForBrowserId(browserId);
+            CefTaskInfo info;
+            if (usage.taskId < 0 || !manager->GetTaskInfo(usage.taskId, info)) {
+                usage.cpuPercent = 0.0;
+                usage.memoryBytes = -1;
+                usage.gpuMemoryBytes = -1;
+                usage.killable = false;
+                usage.overLimitSamples = 0;
+                continue;
+            }
+
+            usage.taskTitle = CefString(&info.title).ToString();
+            usage.cpuPercent = info.cpu_usage;
+            usage.memoryBytes = info.memory;
+            usage.gpuMemoryBytes = info.gpu_memory;
+            usage.killable = info.is_killable != 0;
+
+            const std::string prefix = MetricPrefix(usage);
+            metrics.SetGauge(prefix + "cpu_percent", usage.cpuPercent);
+            if (usage.memoryBytes >= 0) {
+                metrics.SetGauge(prefix + "memory_mb", usage.memoryBytes / (1024.0 * 1024.0));
+            }
+            if (usage.gpuMemoryBytes >= 0) {
+                metrics.SetGauge(prefix + "gpu_memory_mb", usage.gpuMemoryBytes / (1024.0 * 1024.0));
+            }
+
+            const bool overCpu = m_Limits.maxCpuPercent > 0.0 && usage.cpuPercent > m_Limits.maxCpuPercent;
+            const bool overMemory = m_Limits.maxMemoryBytes > 0 && usage.memoryBytes > m_Limits.maxMemoryBytes;
+            usage.overLimitSamples = (overCpu || overMemory) ? usage.overLimitSamples + 1 : 0;
+
+            if (usage.overLimitSamples >= m_Limits.graceSamples && usage.killable) {
+                std::cerr << "Renderer for '" << usage.label << "' exceeded limits (cpu "
+                          << usage.cpuPercent << "%, memory " << usage.memoryBytes
+                          << " bytes); killing task " << usage.taskId << std::endl;
+                const int64_t taskId = usage.taskId;
+                const bool queued = std::any_of(kills.begin(), kills.end(),
+                                                [taskId](const Kill& kill) { return kill.taskId == taskId; });
+                if (!queued) kills.push_back({ taskId, usage.label, {} });
+                usage.overLimitSamples = 0;
+            }
+        }
+        for (Kill& kill : kills) {
+            for (const auto& [browserId, usage] : m_Usage) {
+                if (usage.taskId == kill.taskId) kill.browserIds.push_back(browserId);
+            }
+        }
+        callback = m_LimitExceeded;
+    }
+
+    std::vector<int> killed;
+    for (const Kill& kill : kills) {
+        if (manager->KillTask(kill.taskId)) {
+            killed.insert(killed.end(), kill.browserIds.begin(), kill.browserIds.end());
+            // Keyed by label only: the browser id changes when the panel is
+            // recreated, and Untrack removes the per-browser series.
+            MetricsRegistry::Get().AddCounter("renderer." + kill.label + ".watchdog_kills");
+        }
+    }
+
+    if (callback) {
+        for (int browserId : killed) {
+            callback(browserId);
+        }
+    }
+
+    ScheduleNext();
+}
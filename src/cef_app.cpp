@@ -1,5 +1,10 @@
 #include "../include/cef_app_impl.h"
+#include "../include/idle_scheduler.h"
+#include "../include/process_profile.h"
+#include "../include/renderer_watchdog.h"
 #include <iostream>
+#include <map>
+#include <string>
 
 #ifdef _WIN32
 #include <filesystem>
@@ -41,10 +46,55 @@ std::filesystem::path GetExecutableDirectory() {
 }  // namespace
 #endif
 
+namespace {
+// --process-profile=NAME. Runs after the app's own switches so explicit
+// choices such as --panel-cache-mb's disk cache size win over the profile.
+void ApplyProcessProfile(CefRefPtr<CefCommandLine> command_line) {
+    if (!command_line->HasSwitch("process-profile")) return;
+    const std::string name = command_line->GetSwitchValue("process-profile").ToString();
+    const ProcessProfile* profile = FindProcessProfile(name);
+    if (!profile) {
+        std::cerr << "Ignoring unknown --process-profile " << name << " (known: " << ProcessProfileNames() << ")"
+                  << std::endl;
+        return;
+    }
+
+    CefCommandLine::SwitchMap switches;
+    command_line->GetSwitches(switches);
+    std::map<std::string, std::string> existing;
+    for (const auto& [key, value] : switches) existing[key.ToString()] = value.ToString();
+
+    const ProfileResolution resolution = ResolveProcessProfile(*profile, existing);
+    for (const ProfileSwitch& entry : resolution.apply) {
+        if (entry.value.empty()) command_line->AppendSwitch(entry.name);
+        else command_line->AppendSwitchWithValue(entry.name, entry.value);
+    }
+    std::cout << "Process profile " << profile->name << " (" << profile->summary
+              << "): " << FormatProfileSwitches(resolution.apply) << std::endl;
+    for (const std::string& kept : resolution.kept) {
+        std::cout << "  kept from the command line: " << kept << std::endl;
+    }
+    for (const std::string& warning : resolution.warnings) {
+        std::cerr << "  warning: " << warning << std::endl;
+    }
+}
+}  // namespace
+
 void CefAppImpl::OnContextInitialized() {
     std::cout << "CEF context initialized" << std::endl;
 }
 
+void CefAppImpl::OnScheduleMessagePumpWork(int64_t delay_ms) {
+    IdleScheduler::Get().SchedulePumpWork(delay_ms);
+}
+
+bool CefAppImpl::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                          CefRefPtr<CefFrame> frame,
+                                          CefProcessId source_process,
+                                          CefRefPtr<CefProcessMessage> message) {
+    return RendererWatchdog::HandleRendererMessage(frame, message);
+}
+
 void CefAppImpl::OnBeforeCommandLineProcessing(const CefString& process_type,
                                                CefRefPtr<CefCommandLine> command_line) {
     if (process_type.empty() && !command_line->HasSwitch("show-fps-counter")) {
@@ -56,6 +106,31 @@ void CefAppImpl::OnBeforeCommandLineProcessing(const CefString& process_type,
         command_line->AppendSwitch("disable-gpu-vsync");
     }
 
+    // Chromium has a single disk cache size for every profile; use the panel
+    // cap so its own eviction runs before the per-class cap has to clear.
+    if (process_type.empty() && command_line->HasSwitch("panel-cache-mb") &&
+        !command_line->HasSwitch("disk-cache-size")) {
+        try {
+            const long long megabytes = std::stoll(command_line->GetSwitchValue("panel-cache-mb").ToString());
+            if (megabytes > 0) {
+                command_line->AppendSwitchWithValue("disk-cache-size", std::to_string(megabytes * 1024 * 1024));
+            }
+        } catch (...) {
+        }
+    }
+
+    // Without a GPU, Chromium's GPU process would rasterize through
+    // SwiftShader and read every frame back for OnPaint; the software
+    // compositor paints straight into the shared bitmap instead. Before the
+    // process profile, so a profile sees these as set.
+    if (process_type.empty() && m_SoftwareMode) {
+        for (const char* name : { "disable-gpu", "disable-gpu-compositing" }) {
+            if (!command_line->HasSwitch(name)) command_line->AppendSwitch(name);
+        }
+    }
+
+    if (process_type.empty()) ApplyProcessProfile(command_line);
+
 #ifdef _WIN32
     const std::filesystem::path executable_dir = GetExecutableDirectory();
     const std::filesystem::path development_cef_dir = executable_dir / "cef";
@@ -82,5 +157,12 @@ void CefAppImpl::OnBeforeCommandLineProcessing(const CefString& process_type,
     if (process_type.empty() && !command_line->HasSwitch("no-zygote")) {
         command_line->AppendSwitch("no-zygote");
     }
+
+    // Offscreen runs have no X11 or Wayland display for Chromium to connect
+    // to; windowless rendering does not need one.
+    if (process_type.empty() && (m_Headless || command_line->HasSwitch("offscreen")) &&
+        !command_line->HasSwitch("ozone-platform")) {
+        command_line->AppendSwitchWithValue("ozone-platform", "headless");
+    }
 #endif
 }
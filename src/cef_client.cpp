@@ -1,4 +1,6 @@
 #include "../include/cef_client_impl.h"
+#include "../include/idle_scheduler.h"
+#include "../include/trace_capture.h"
 #include <cstring>
 #include <algorithm>
 #include <iostream>
@@ -9,6 +11,32 @@
 #define ZoneScoped
 #endif
 
+namespace {
+void CopyBgraToRgba(const std::vector<uint8_t>& source, std::vector<uint8_t>& data) {
+    data.resize(source.size());
+    for (size_t i = 0; i < source.size(); i += 4) {
+        data[i] = source[i + 2];     // R
+        data[i + 1] = source[i + 1]; // G
+        data[i + 2] = source[i];     // B
+        data[i + 3] = source[i + 3]; // A
+    }
+}
+
+void UnionRect(CefRect& target, const CefRect& rect) {
+    if (rect.IsEmpty()) return;
+    if (target.IsEmpty()) {
+        target = rect;
+        return;
+    }
+    const int right = std::max(target.x + target.width, rect.x + rect.width);
+    const int bottom = std::max(target.y + target.height, rect.y + rect.height);
+    target.x = std::min(target.x, rect.x);
+    target.y = std::min(target.y, rect.y);
+    target.width = right - target.x;
+    target.height = bottom - target.y;
+}
+}  // namespace
+
 // CefRenderHandlerImpl implementation
 CefRenderHandlerImpl::CefRenderHandlerImpl(int width, int height)
     : m_Width(width),
@@ -31,13 +59,26 @@ void CefRenderHandlerImpl::OnPaint(CefRefPtr<CefBrowser> browser,
                                    const void* buffer,
                                    int width, int height) {
     ZoneScoped;
+    TraceScope trace("cef_on_paint", "host");
     std::lock_guard<std::mutex> lock(m_Mutex);
     
+    if (type == PET_POPUP) {
+        m_PopupWidth = width;
+        m_PopupHeight = height;
+        m_PopupBuffer.resize(static_cast<size_t>(width) * height * 4);
+        std::memcpy(m_PopupBuffer.data(), buffer, m_PopupBuffer.size());
+        m_PopupDirty = true;
+        IdleScheduler::Get().RequestFrame();
+        return;
+    }
+    
     if (width != m_Width || height != m_Height) {
         m_Width = width;
         m_Height = height;
         m_Buffer.resize(width * height * 4);
+        m_Damage = CefRect(0, 0, width, height);
     }
+    for (const CefRect& rect : dirtyRects) UnionRect(m_Damage, rect);
     
     // Copy the entire buffer (BGRA format)
     std::memcpy(m_Buffer.data(), buffer, width * height * 4);
@@ -46,29 +87,84 @@ void CefRenderHandlerImpl::OnPaint(CefRefPtr<CefBrowser> browser,
     if (type == PET_VIEW) {
         ++m_PaintSamples;
         const auto now = std::chrono::steady_clock::now();
+        if (m_FirstPaintTime == std::chrono::steady_clock::time_point()) m_FirstPaintTime = now;
+        m_LastPaintTime = now;
+        ++m_PaintCount;
         const std::chrono::duration<double> elapsed = now - m_LastPaintSample;
         if (elapsed.count() >= 0.5) {
             m_PaintFps = static_cast<double>(m_PaintSamples) / elapsed.count();
             m_PaintSamples = 0;
             m_LastPaintSample = now;
         }
+        if (m_LoadTracker) m_LoadTracker->OnPaint();
     }
+    IdleScheduler::Get().RequestFrame();
 }
 
-void CefRenderHandlerImpl::GetTextureData(std::vector<uint8_t>& data, int& width, int& height) {
+void CefRenderHandlerImpl::GetTextureData(std::vector<uint8_t>& data, int& width, int& height, CefRect* damage) {
     std::lock_guard<std::mutex> lock(m_Mutex);
     
     width = m_Width;
     height = m_Height;
-    data.resize(m_Buffer.size());
+    CopyBgraToRgba(m_Buffer, data);
+    if (damage) *damage = TakeDamage();
+}
+
+void CefRenderHandlerImpl::GetRawTextureData(std::vector<uint8_t>& data, int& width, int& height, CefRect* damage) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
     
-    // Convert BGRA to RGBA
-    for (size_t i = 0; i < m_Buffer.size(); i += 4) {
-        data[i] = m_Buffer[i + 2];     // R
-        data[i + 1] = m_Buffer[i + 1]; // G
-        data[i + 2] = m_Buffer[i];     // B
-        data[i + 3] = m_Buffer[i + 3]; // A
+    width = m_Width;
+    height = m_Height;
+    data = m_Buffer;
+    if (damage) *damage = TakeDamage();
+}
+
+CefRect CefRenderHandlerImpl::TakeDamage() {
+    const CefRect damage = m_Damage.IsEmpty() ? CefRect(0, 0, m_Width, m_Height) : m_Damage;
+    m_Damage = CefRect();
+    return damage;
+}
+
+void CefRenderHandlerImpl::OnPopupShow(CefRefPtr<CefBrowser> browser, bool show) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_PopupVisible = show;
+    if (!show) {
+        m_PopupRect = CefRect();
+        m_PopupDirty = false;
     }
+    IdleScheduler::Get().RequestFrame();
+}
+
+void CefRenderHandlerImpl::OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect& rect) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_PopupRect = rect;
+}
+
+bool CefRenderHandlerImpl::IsPopupVisible() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_PopupVisible && !m_PopupRect.IsEmpty();
+}
+
+bool CefRenderHandlerImpl::IsPopupDirty() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_PopupDirty;
+}
+
+void CefRenderHandlerImpl::ClearPopupDirty() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_PopupDirty = false;
+}
+
+CefRect CefRenderHandlerImpl::GetPopupRect() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_PopupRect;
+}
+
+void CefRenderHandlerImpl::GetPopupData(std::vector<uint8_t>& data, int& width, int& height) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    width = m_PopupWidth;
+    height = m_PopupHeight;
+    CopyBgraToRgba(m_PopupBuffer, data);
 }
 
 double CefRenderHandlerImpl::GetPaintFps() const {
@@ -76,16 +172,34 @@ double CefRenderHandlerImpl::GetPaintFps() const {
     return m_PaintFps;
 }
 
+std::chrono::steady_clock::time_point CefRenderHandlerImpl::GetFirstPaintTime() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FirstPaintTime;
+}
+
+std::chrono::steady_clock::time_point CefRenderHandlerImpl::GetLastPaintTime() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_LastPaintTime;
+}
+
+uint64_t CefRenderHandlerImpl::GetPaintCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_PaintCount;
+}
+
 void CefRenderHandlerImpl::Resize(int width, int height) {
     std::lock_guard<std::mutex> lock(m_Mutex);
     m_Width = width;
     m_Height = height;
     m_Buffer.resize(width * height * 4);
+    m_Damage = CefRect(0, 0, width, height);
 }
 
 // CefClientImpl implementation
 CefClientImpl::CefClientImpl(CefRefPtr<CefRenderHandlerImpl> renderHandler)
-    : m_RenderHandler(renderHandler) {
+    : m_RenderHandler(renderHandler),
+      m_LoadTracker(new PageLoadTracker()) {
+    if (m_RenderHandler) m_RenderHandler->SetLoadTracker(m_LoadTracker);
 }
 
 void CefClientImpl::OnAfterCreated(CefRefPtr<CefBrowser> browser) {
@@ -93,5 +207,69 @@ void CefClientImpl::OnAfterCreated(CefRefPtr<CefBrowser> browser) {
 }
 
 void CefClientImpl::OnBeforeClose(CefRefPtr<CefBrowser> browser) {
+    m_LoadTracker->OnClose();
     m_Browser = nullptr;
 }
+
+void CefClientImpl::OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                         bool isLoading,
+                                         bool canGoBack,
+                                         bool canGoForward) {
+    m_LoadTracker->OnLoadingStateChange(isLoading);
+    // The overlays show loading state.
+    IdleScheduler::Get().RequestFrame();
+}
+
+void CefClientImpl::OnLoadStart(CefRefPtr<CefBrowser> browser,
+                                CefRefPtr<CefFrame> frame,
+                                TransitionType transition_type) {
+    if (frame->IsMain()) m_LoadTracker->OnLoadStart();
+}
+
+void CefClientImpl::OnLoadEnd(CefRefPtr<CefBrowser> browser,
+                              CefRefPtr<CefFrame> frame,
+                              int httpStatusCode) {
+    if (frame->IsMain()) m_LoadTracker->OnLoadEnd(httpStatusCode);
+}
+
+void CefClientImpl::OnLoadError(CefRefPtr<CefBrowser> browser,
+                                CefRefPtr<CefFrame> frame,
+                                ErrorCode errorCode,
+                                const CefString& errorText,
+                                const CefString& failedUrl) {
+    if (frame->IsMain()) m_LoadTracker->OnLoadError(errorCode, errorText.ToString(), failedUrl.ToString());
+}
+
+void CefClientImpl::OnAddressChange(CefRefPtr<CefBrowser> browser,
+                                    CefRefPtr<CefFrame> frame,
+                                    const CefString& url) {
+    if (frame->IsMain()) m_LoadTracker->OnAddressChange(url.ToString());
+}
+
+bool CefClientImpl::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                             CefRefPtr<CefFrame> frame,
+                                             CefProcessId source_process,
+                                             CefRefPtr<CefProcessMessage> message) {
+    if (message->GetName() == kWatchdogPongMessage) {
+        if (m_Watchdog) m_Watchdog->OnPong(this);
+        return true;
+    }
+    return false;
+}
+
+bool CefClientImpl::OnRenderProcessUnresponsive(CefRefPtr<CefBrowser> browser,
+                                                CefRefPtr<CefUnresponsiveProcessCallback> callback) {
+    // Chromium's hang monitor usually fires after the watchdog's own ping
+    // timeout; whichever is first recreates the browser. Returning false keeps
+    // Chromium's default handling for the old renderer.
+    if (m_Watchdog) m_Watchdog->OnUnresponsive(this);
+    return false;
+}
+
+void CefClientImpl::OnRenderProcessTerminated(CefRefPtr<CefBrowser> browser,
+                                              TerminationStatus status,
+                                              int error_code,
+                                              const CefString& error_string) {
+    if (m_PerfProbe) m_PerfProbe->OnRenderProcessTerminated();
+    if (m_Watchdog) m_Watchdog->OnTerminated(this, static_cast<int>(status));
+}
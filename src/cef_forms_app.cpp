@@ -1,4 +1,6 @@
 #include "../include/cef_forms_app.h"
+#include "include/cef_v8.h"
+#include <algorithm>
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
@@ -6,6 +8,88 @@
 #define ZoneScoped
 #endif
 
+namespace {
+template <typename T>
+CefRefPtr<CefV8Value> IntColumn(const T* values, uint32_t rows) {
+    CefRefPtr<CefV8Value> array = CefV8Value::CreateArray(static_cast<int>(rows));
+    for (uint32_t i = 0; i < rows; ++i) {
+        array->SetValue(static_cast<int>(i), CefV8Value::CreateInt(static_cast<int32_t>(values[i])));
+    }
+    return array;
+}
+
+CefRefPtr<CefV8Value> TextColumn(const char (*values)[kSharedStateTextLength], uint32_t rows) {
+    CefRefPtr<CefV8Value> array = CefV8Value::CreateArray(static_cast<int>(rows));
+    for (uint32_t i = 0; i < rows; ++i) {
+        array->SetValue(static_cast<int>(i), CefV8Value::CreateString(SharedStateColumns::GetText(values[i])));
+    }
+    return array;
+}
+
+// Returns the simulator snapshot as columns, or null when the segment has not
+// moved past |sinceVersion|, in which case nothing is copied at all.
+CefRefPtr<CefV8Value> ReadSnapshot(const SharedStateSegment* segment, uint64_t sinceVersion) {
+    if (!segment || segment->GetVersion() <= sinceVersion) return CefV8Value::CreateNull();
+    auto columns = std::make_unique<SharedStateColumns>();
+    uint64_t version = 0;
+    if (!segment->Read(*columns, version) || version <= sinceVersion) return CefV8Value::CreateNull();
+
+    const uint32_t rows = columns->rows;
+    CefRefPtr<CefV8Value> result = CefV8Value::CreateObject(nullptr, nullptr);
+    result->SetValue("version", CefV8Value::CreateDouble(static_cast<double>(version)), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("rows", CefV8Value::CreateUInt(rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("id", IntColumn(columns->id, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("ptd", IntColumn(columns->ptd, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("delivered", IntColumn(columns->delivered, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("eta", IntColumn(columns->eta, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("callDispatch", IntColumn(columns->callDispatch, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("name", TextColumn(columns->name, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("status", TextColumn(columns->status, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    result->SetValue("status_text", TextColumn(columns->statusText, rows), V8_PROPERTY_ATTRIBUTE_NONE);
+    return result;
+}
+
+// Backs window.hostState.read(key), version(key) and snapshot(sinceVersion).
+// All of them are answered inside the renderer process; read/version from the
+// replica, snapshot from the shared-memory segment.
+class HostStateHandler : public CefV8Handler {
+public:
+    explicit HostStateHandler(CefRefPtr<CefFormsApp> app) : m_App(app) {}
+
+    virtual bool Execute(const CefString& name,
+                         CefRefPtr<CefV8Value> object,
+                         const CefV8ValueList& arguments,
+                         CefRefPtr<CefV8Value>& retval,
+                         CefString& exception) override {
+        CefRefPtr<CefV8Context> context = CefV8Context::GetCurrentContext();
+        if (name == "snapshot") {
+            const double since = arguments.size() == 1 && arguments[0]->IsDouble() ? arguments[0]->GetDoubleValue() : 0.0;
+            retval = ReadSnapshot(m_App->FindSharedSegment(context->GetBrowser()->GetIdentifier()),
+                                  static_cast<uint64_t>(std::max(0.0, since)));
+            return true;
+        }
+        if (arguments.size() != 1 || !arguments[0]->IsString()) {
+            exception = "hostState." + name.ToString() + " expects a key string";
+            return true;
+        }
+        const StateReplica::Entry* entry =
+            m_App->FindReplicaEntry(context->GetBrowser()->GetIdentifier(), arguments[0]->GetStringValue());
+        if (name == "read") {
+            retval = entry ? CefV8Value::CreateString(entry->json) : CefV8Value::CreateNull();
+        } else if (name == "version") {
+            retval = CefV8Value::CreateDouble(entry ? static_cast<double>(entry->version) : 0.0);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+private:
+    CefRefPtr<CefFormsApp> m_App;
+    IMPLEMENT_REFCOUNTING(HostStateHandler);
+};
+}  // namespace
+
 void CefFormsApp::OnContextCreated(CefRefPtr<CefBrowser> browser,
                                   CefRefPtr<CefFrame> frame,
                                   CefRefPtr<CefV8Context> context) {
@@ -15,6 +99,19 @@ void CefFormsApp::OnContextCreated(CefRefPtr<CefBrowser> browser,
         m_MessageRouter = CefMessageRouterRendererSide::Create(config);
     }
     m_MessageRouter->OnContextCreated(browser, frame, context);
+
+    CefRefPtr<CefV8Handler> handler = new HostStateHandler(this);
+    CefRefPtr<CefV8Value> hostState = CefV8Value::CreateObject(nullptr, nullptr);
+    hostState->SetValue("read", CefV8Value::CreateFunction("read", handler), V8_PROPERTY_ATTRIBUTE_READONLY);
+    hostState->SetValue("version", CefV8Value::CreateFunction("version", handler), V8_PROPERTY_ATTRIBUTE_READONLY);
+    hostState->SetValue("snapshot", CefV8Value::CreateFunction("snapshot", handler), V8_PROPERTY_ATTRIBUTE_READONLY);
+    context->GetGlobal()->SetValue("hostState", hostState, V8_PROPERTY_ATTRIBUTE_READONLY);
+
+    // A fresh renderer (or a crashed and recreated one) starts empty; ask the
+    // browser to resend everything it has published so far.
+    if (m_Replicas.OnContextCreated(browser->GetIdentifier(), frame->IsMain())) {
+        frame->SendProcessMessage(PID_BROWSER, CefProcessMessage::Create(kStateReplicaRequestMessage));
+    }
 }
 
 void CefFormsApp::OnContextReleased(CefRefPtr<CefBrowser> browser,
@@ -29,8 +126,40 @@ bool CefFormsApp::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
                                           CefRefPtr<CefFrame> frame,
                                           CefProcessId source_process,
                                           CefRefPtr<CefProcessMessage> message) {
+    if (CefAppImpl::OnProcessMessageReceived(browser, frame, source_process, message)) return true;
+    if (message->GetName() == kStateReplicaUpdateMessage) {
+        CefRefPtr<CefListValue> args = message->GetArgumentList();
+        if (args->GetSize() >= 3) {
+            m_Replicas.OnUpdate(browser->GetIdentifier(), { args->GetString(0).ToString(),
+                                                            static_cast<uint64_t>(args->GetDouble(1)),
+                                                            args->GetString(2).ToString() });
+        }
+        return true;
+    }
+    if (message->GetName() == kSharedStateAttachMessage) {
+        const std::string name = message->GetArgumentList()->GetString(0).ToString();
+        const SharedStateSegment* current = FindSharedSegment(browser->GetIdentifier());
+        if (!current || current->GetName() != name) {
+            m_SharedSegments[browser->GetIdentifier()] = SharedStateSegment::Open(name);
+        }
+        return true;
+    }
     if (m_MessageRouter) {
         return m_MessageRouter->OnProcessMessageReceived(browser, frame, source_process, message);
     }
     return false;
 }
+
+void CefFormsApp::OnBrowserDestroyed(CefRefPtr<CefBrowser> browser) {
+    m_Replicas.OnBrowserDestroyed(browser->GetIdentifier());
+    m_SharedSegments.erase(browser->GetIdentifier());
+}
+
+const StateReplica::Entry* CefFormsApp::FindReplicaEntry(int browserId, const std::string& key) const {
+    return m_Replicas.Find(browserId, key);
+}
+
+const SharedStateSegment* CefFormsApp::FindSharedSegment(int browserId) const {
+    auto it = m_SharedSegments.find(browserId);
+    return it == m_SharedSegments.end() ? nullptr : it->second.get();
+}
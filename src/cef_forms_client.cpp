@@ -1,4 +1,6 @@
 #include "../include/cef_forms_client.h"
+#include "../include/shared_state_segment.h"
+#include "../include/trace_capture.h"
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
@@ -17,6 +19,16 @@ bool CefFormsClient::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
                                             CefProcessId source_process,
                                             CefRefPtr<CefProcessMessage> message) {
     ZoneScoped;
+    TraceScope trace("ipc_receive", "ipc");
+    if (message->GetName() == kStateReplicaRequestMessage) {
+        m_PublishedState.Resync([&](const StateUpdate& update) { SendStateUpdate(frame, update); });
+        if (!m_SharedStateName.empty()) {
+            CefRefPtr<CefProcessMessage> attach = CefProcessMessage::Create(kSharedStateAttachMessage);
+            attach->GetArgumentList()->SetString(0, m_SharedStateName);
+            frame->SendProcessMessage(PID_RENDERER, attach);
+        }
+        return true;
+    }
     if (m_MessageRouter->OnProcessMessageReceived(browser, frame, source_process, message)) {
         return true;
     }
@@ -28,6 +40,36 @@ void CefFormsClient::OnBeforeClose(CefRefPtr<CefBrowser> browser) {
     CefClientImpl::OnBeforeClose(browser);
 }
 
+void CefFormsClient::OnRenderProcessTerminated(CefRefPtr<CefBrowser> browser,
+                                               TerminationStatus status,
+                                               int error_code,
+                                               const CefString& error_string) {
+    m_MessageRouter->OnRenderProcessTerminated(browser);
+    CefClientImpl::OnRenderProcessTerminated(browser, status, error_code, error_string);
+}
+
 void CefFormsClient::AddMessageHandler(CefMessageRouterBrowserSide::Handler* handler) {
     m_MessageRouter->AddHandler(handler, false);
 }
+
+void CefFormsClient::PublishState(const std::string& key, const std::string& json) {
+    CefRefPtr<CefBrowser> browser = GetBrowser();
+    CefRefPtr<CefFrame> frame = browser ? browser->GetMainFrame() : nullptr;
+    m_PublishedState.Publish(key, json, [&](const StateUpdate& update) { SendStateUpdate(frame, update); });
+}
+
+CefRefPtr<CefFormsClient> CefFormsClient::FromBrowser(CefRefPtr<CefBrowser> browser) {
+    if (!browser) return nullptr;
+    CefRefPtr<CefClient> client = browser->GetHost()->GetClient();
+    return dynamic_cast<CefFormsClient*>(client.get());
+}
+
+void CefFormsClient::SendStateUpdate(CefRefPtr<CefFrame> frame, const StateUpdate& update) {
+    if (!frame) return;
+    CefRefPtr<CefProcessMessage> message = CefProcessMessage::Create(kStateReplicaUpdateMessage);
+    CefRefPtr<CefListValue> args = message->GetArgumentList();
+    args->SetString(0, update.key);
+    args->SetDouble(1, static_cast<double>(update.version));
+    args->SetString(2, update.json);
+    frame->SendProcessMessage(PID_RENDERER, message);
+}
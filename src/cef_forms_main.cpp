@@ -35,10 +35,27 @@
 #include "include/internal/cef_types.h"
 
 #include "../include/vulkan_renderer.h"
+#include "../include/imgui_viewports.h"
 #include "../include/cef_app_impl.h"
 #include "../include/cef_client_impl.h"
 #include "../include/cef_forms_app.h"
 #include "../include/cef_forms_client.h"
+#include "../include/audio_capture.h"
+#include "../include/block_compression.h"
+#include "../include/browser_resource_sampler.h"
+#include "../include/devtools_perf_probe.h"
+#include "../include/frame_rate_governor.h"
+#include "../include/idle_scheduler.h"
+#include "../include/metrics_registry.h"
+#include "../include/page_load_telemetry.h"
+#include "../include/panel_bench.h"
+#include "../include/renderer_watchdog.h"
+#include "../include/request_context_pool.h"
+#include "../include/shared_state_segment.h"
+#include "../include/software_mode.h"
+#include "../include/texture_handle.h"
+#include "../include/trace_capture.h"
+#include "../include/imgui_layer.h"
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
@@ -76,6 +93,10 @@ void SetCefPath(cef_string_t& target, const std::filesystem::path& path) {
 }
 #endif
 
+VkFormat ToVkFormat(BlockFormat format) {
+    return format == BlockFormat::Bc1 ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+}
+
 // --- CORE DATA STRUCTURES ---
 
 enum class CommandType { CallDispatch, SkipDelivery };
@@ -128,45 +149,57 @@ private:
 class TodoHandler : public CefMessageRouterBrowserSide::Handler, public CefBaseRefCounted {
 public:
     virtual bool OnQuery(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, int64_t query_id, const CefString& request, bool persistent, CefRefPtr<Callback> callback) override {
+        TraceScope trace("todo_query", "ipc");
         CefRefPtr<CefValue> root = CefParseJSON(request, JSON_PARSER_RFC);
         if (!root || root->GetType() != VTYPE_DICTIONARY) return false;
         auto dict = root->GetDictionary();
         std::string action = dict->GetString("action").ToString();
 
-        static std::vector<TodoData> todos;
-        static int nextId = 1;
-
         if (action == "create") {
             auto data = dict->GetDictionary("data");
-            todos.push_back({ nextId++, data->GetString("text").ToString(), data->GetBool("completed") });
+            s_Todos.push_back({ s_NextId++, data->GetString("text").ToString(), data->GetBool("completed") });
+            Publish(browser);
             callback->Success("");
         } else if (action == "read") {
-            CefRefPtr<CefListValue> list = CefListValue::Create();
-            for (size_t i = 0; i < todos.size(); ++i) {
-                CefRefPtr<CefDictionaryValue> td = CefDictionaryValue::Create();
-                td->SetInt("id", todos[i].id);
-                td->SetString("text", todos[i].text);
-                td->SetBool("completed", todos[i].completed);
-                list->SetDictionary(static_cast<int>(i), td);
-            }
-            CefRefPtr<CefValue> val = CefValue::Create(); val->SetList(list);
-            callback->Success(CefWriteJSON(val, JSON_WRITER_DEFAULT));
+            callback->Success(Publish(browser));
         } else if (action == "update") {
             auto data = dict->GetDictionary("data");
             int id = data->GetInt("id");
-            auto it = std::find_if(todos.begin(), todos.end(), [id](const TodoData& t) { return t.id == id; });
-            if (it != todos.end() && data->HasKey("completed")) {
+            auto it = std::find_if(s_Todos.begin(), s_Todos.end(), [id](const TodoData& t) { return t.id == id; });
+            if (it != s_Todos.end() && data->HasKey("completed")) {
                 it->completed = data->GetBool("completed");
+                Publish(browser);
                 callback->Success("");
             } else callback->Failure(404, "Not found");
         } else if (action == "delete") {
             int id = dict->GetDictionary("data")->GetInt("id");
-            todos.erase(std::remove_if(todos.begin(), todos.end(), [id](const TodoData& t) { return t.id == id; }), todos.end());
+            s_Todos.erase(std::remove_if(s_Todos.begin(), s_Todos.end(), [id](const TodoData& t) { return t.id == id; }), s_Todos.end());
+            Publish(browser);
             callback->Success("");
         }
         return true;
     }
 private:
+    // Pushes the list into the page's hostState replica ahead of the query
+    // response, so a read issued from onSuccess already sees the write.
+    std::string Publish(CefRefPtr<CefBrowser> browser) {
+        CefRefPtr<CefListValue> list = CefListValue::Create();
+        for (size_t i = 0; i < s_Todos.size(); ++i) {
+            CefRefPtr<CefDictionaryValue> td = CefDictionaryValue::Create();
+            td->SetInt("id", s_Todos[i].id);
+            td->SetString("text", s_Todos[i].text);
+            td->SetBool("completed", s_Todos[i].completed);
+            list->SetDictionary(static_cast<int>(i), td);
+        }
+        CefRefPtr<CefValue> val = CefValue::Create(); val->SetList(list);
+        std::string json = CefWriteJSON(val, JSON_WRITER_DEFAULT).ToString();
+        if (auto client = CefFormsClient::FromBrowser(browser)) client->PublishState("todos", json);
+        return json;
+    }
+
+    // Shared across handler instances so the list survives closing the panel.
+    static inline std::vector<TodoData> s_Todos;
+    static inline int s_NextId = 1;
     IMPLEMENT_REFCOUNTING(TodoHandler);
 };
 
@@ -198,6 +231,11 @@ public:
         m_Inbox.Push(cmd);
     }
 
+    // Must be set before Start(); the worker thread is the segment's only writer.
+    void SetSharedState(SharedStateSegment* segment) {
+        m_SharedState = segment;
+    }
+
     bool ConsumeState(std::string& state) {
         if (!m_HasNewState) return false;
         std::lock_guard<std::recursive_mutex> lock(m_StateMutex);
@@ -231,6 +269,7 @@ private:
         std::uniform_int_distribution<int> distribution(0, 29);
 
         while (m_Running) {
+            const auto tickStart = std::chrono::steady_clock::now();
             Command cmd;
             while (m_Inbox.Pop(cmd)) {
                 auto it = std::find_if(m_Drivers.begin(), m_Drivers.end(), [cmd](const DriverData& d) { return d.id == cmd.driverId; });
@@ -259,12 +298,35 @@ private:
                 m_LatestState = GetCurrentStateJSON();
                 m_HasNewState = true;
             }
+            // Pushed state goes out from the render loop; the shared segment
+            // is pulled by the page itself.
+            if (!m_SharedState) IdleScheduler::Get().RequestFrame();
+            if (m_SharedState) WriteSharedState();
+            TraceCapture::Get().RecordComplete("simulator_tick", "simulator", tickStart, std::chrono::steady_clock::now());
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
     }
 
+    void WriteSharedState() {
+        SharedStateColumns columns{};
+        columns.rows = static_cast<uint32_t>(std::min<size_t>(m_Drivers.size(), kSharedStateMaxRows));
+        for (uint32_t i = 0; i < columns.rows; ++i) {
+            const DriverData& d = m_Drivers[i];
+            columns.id[i] = d.id;
+            columns.ptd[i] = d.ptd;
+            columns.delivered[i] = d.delivered;
+            columns.eta[i] = d.eta;
+            columns.callDispatch[i] = d.callDispatch ? 1 : 0;
+            SharedStateColumns::SetText(columns.name[i], d.name);
+            SharedStateColumns::SetText(columns.status[i], d.status);
+            SharedStateColumns::SetText(columns.statusText[i], d.status_text);
+        }
+        m_SharedState->Write(columns);
+    }
+
     std::vector<DriverData> m_Drivers;
     MessageQueue m_Inbox;
+    SharedStateSegment* m_SharedState = nullptr;
     std::thread m_Thread;
     std::atomic<bool> m_Running;
     
@@ -279,6 +341,7 @@ class DeliveryBridge : public CefMessageRouterBrowserSide::Handler, public CefBa
 public:
     DeliveryBridge(DeliverySimulator* sim) : m_Sim(sim) {}
     virtual bool OnQuery(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, int64_t query_id, const CefString& request, bool persistent, CefRefPtr<Callback> callback) override {
+        TraceScope trace("delivery_query", "ipc");
         CefRefPtr<CefValue> root = CefParseJSON(request, JSON_PARSER_RFC);
         if (!root || root->GetType() != VTYPE_DICTIONARY) return false;
         auto dict = root->GetDictionary();
@@ -307,35 +370,87 @@ private:
 struct BrowserInstance {
     CefRefPtr<CefFormsClient> client;
     CefRefPtr<CefRenderHandlerImpl> renderHandler;
-    VkImage textureImage = VK_NULL_HANDLE;
-    VkDeviceMemory textureMemory = VK_NULL_HANDLE;
-    VkImageView textureView = VK_NULL_HANDLE;
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    // RGBA8, or a BC format while the panel is static and compressed.
+    TextureHandle texture;
     int width = 800, height = 600;
+    // Smallest on-screen scale the texture was drawn at in the last frame;
+    // the mip chain exists only while it is below the threshold.
+    float drawScale = 1.0f;
+    float nextDrawScale = 1.0f;
     std::string name;
+    std::string url;
+    CefMessageRouterBrowserSide::Handler* handler = nullptr;
+    int browserId = 0;
+    CefRefPtr<DevToolsPerfProbe> perfProbe;
+    bool usesSharedState = false;
+    // Browsers of the same class share one request context and cache.
+    std::string panelClass;
 
-    void UpdateTexture(VulkanRenderer* renderer, VkSampler sampler) {
-        if (!renderer || !renderHandler || !renderHandler->IsDirty()) return;
-        std::vector<uint8_t> data; int w, h;
-        renderHandler->GetTextureData(data, w, h);
+    // Bumped on every upload so a compression result for older contents is
+    // dropped.
+    uint64_t textureGeneration = 0;
+    std::chrono::steady_clock::time_point lastUpload = std::chrono::steady_clock::now();
+    bool compressionQueued = false;
+
+    void NoteDrawScale(float scale) { nextDrawScale = std::min(nextDrawScale, scale); }
+    bool IsCompressed() const { return texture.IsValid() && texture.GetFormat() != VK_FORMAT_R8G8B8A8_UNORM; }
+
+    void UpdateTexture(VulkanRenderer* renderer, VkSampler sampler, float mipThreshold) {
+        if (!renderer || !renderHandler) return;
+        drawScale = nextDrawScale; nextDrawScale = 1.0f;
+        const bool dirty = renderHandler->IsDirty();
+        const bool wantMips = drawScale < mipThreshold;
+        if (!dirty && (!texture.IsValid() || (wantMips ? renderer->GetMipLevelCount(width, height) : 1) == texture.GetMipLevels())) return;
+        std::vector<uint8_t> data; int w, h; CefRect damage;
+        renderHandler->GetTextureData(data, w, h, &damage);
         if (w <= 0 || h <= 0 || data.empty()) return;
 
-        if (textureImage == VK_NULL_HANDLE || w != width || h != height) {
+        const uint32_t levels = wantMips ? renderer->GetMipLevelCount(w, h) : 1;
+        // A compressed texture cannot take a partial upload, so any damage
+        // swaps it back to RGBA8.
+        if (!texture.IsValid() || w != width || h != height || levels != texture.GetMipLevels() || IsCompressed()) {
             width = w; height = h;
-            if (textureView != VK_NULL_HANDLE) vkDestroyImageView(renderer->GetDevice(), textureView, nullptr);
-            if (textureImage != VK_NULL_HANDLE) { vkDestroyImage(renderer->GetDevice(), textureImage, nullptr); vkFreeMemory(renderer->GetDevice(), textureMemory, nullptr); }
-            textureImage = renderer->CreateTextureImage(width, height, data.data(), textureMemory);
-            if (textureImage == VK_NULL_HANDLE) return;
-            textureView = renderer->CreateImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM);
-            descriptorSet = ImGui_ImplVulkan_AddTexture(sampler, textureView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        } else renderer->UpdateTextureImage(textureImage, width, height, data.data());
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkImage image = renderer->CreateTextureImage(width, height, data.data(), memory, levels);
+            if (!texture.Attach(renderer, sampler, image, memory, VK_FORMAT_R8G8B8A8_UNORM, width, height, levels)) return;
+        } else {
+            const VkRect2D region = { { damage.x, damage.y }, { (uint32_t)damage.width, (uint32_t)damage.height } };
+            renderer->UpdateTextureImage(texture.GetImage(), width, height, data.data(), texture.GetMipLevels(), &region);
+        }
+        ++textureGeneration;
+        lastUpload = std::chrono::steady_clock::now();
+        compressionQueued = false;
         renderHandler->ClearDirty();
+        if (client && dirty) client->GetLoadTracker()->OnUpload();
+    }
+
+    // Hands the current contents to |worker| once the texture has gone
+    // |staticSeconds| without an upload. Mipmapped textures stay RGBA8.
+    void QueueCompression(BlockCompressionWorker& worker, BlockFormat format, double staticSeconds) {
+        if (!renderHandler || compressionQueued || !texture.IsValid() || IsCompressed() || texture.GetMipLevels() != 1) return;
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now() - lastUpload).count() < staticSeconds) return;
+        // No damage pointer: the pending damage belongs to the next upload.
+        std::vector<uint8_t> data; int w, h;
+        renderHandler->GetTextureData(data, w, h);
+        if (w != width || h != height || data.empty()) return;
+        worker.Submit(name, textureGeneration, format, width, height, std::move(data));
+        compressionQueued = true;
+    }
+
+    // Swaps in the compressed image if |result| still matches the texture.
+    bool ApplyCompressed(VulkanRenderer* renderer, VkSampler sampler, const CompressedTexture& result, VkFormat format) {
+        if (result.generation != textureGeneration || IsCompressed() ||
+            result.width != static_cast<uint32_t>(width) || result.height != static_cast<uint32_t>(height)) return false;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImage image = renderer->CreateCompressedTextureImage(format, result.width, result.height, result.blocks.data(),
+                                                               result.blocks.size(), memory);
+        return texture.Attach(renderer, sampler, image, memory, format, result.width, result.height);
     }
 
-    void Cleanup(VkDevice device) {
-        if (device == VK_NULL_HANDLE) return;
-        if (textureView != VK_NULL_HANDLE) vkDestroyImageView(device, textureView, nullptr);
-        if (textureImage != VK_NULL_HANDLE) { vkDestroyImage(device, textureImage, nullptr); vkFreeMemory(device, textureMemory, nullptr); }
+    void Cleanup(VulkanRenderer* renderer) {
+        if (!renderer) return;
+        texture.Release(renderer);
+        if (perfProbe) { perfProbe->Detach(); perfProbe = nullptr; }
         client = nullptr; renderHandler = nullptr;
     }
 };
@@ -355,12 +470,51 @@ private:
     BrowserInstance m_DeliveryDashboard;
     BrowserInstance m_TodoApp;
     DeliverySimulator m_Simulator;
+    std::unique_ptr<SharedStateSegment> m_SharedState;
+    CefRefPtr<BrowserResourceSampler> m_ResourceSampler;
+    CefRefPtr<RequestContextPool> m_ContextPool;
+    CefRefPtr<RendererWatchdog> m_Watchdog;
+    std::unique_ptr<FrameRateGovernor> m_FrameGovernor;
+    std::unique_ptr<AudioMixer> m_AudioMixer;
 
     bool m_ShowDelivery = true;
     bool m_ShowTodo = false;
+    bool m_ShowPerformance = false;
+    bool m_ShowPanels = false;
+    // --idle-render: block in glfwWaitEventsTimeout while nothing changes.
+    bool m_IdleRender = false;
+    // --software-mode, detected before CEF starts.
+    bool m_SoftwareMode = false;
+    // --multi-viewport: windows dragged outside the main window become OS
+    // windows with their own swapchains.
+    bool m_MultiViewport = false;
+    // Panels drawn smaller than this fraction of their render size get a mip chain.
+    float m_MipThreshold = 0.75f;
+    // --compress-static-panels: seconds without an upload before a panel's
+    // texture is block-compressed; the worker is null when disabled.
+    double m_CompressAfterSeconds = 10.0;
+    BlockFormat m_StaticPanelFormat = BlockFormat::Bc7;
+    std::unique_ptr<BlockCompressionWorker> m_PanelCompressor;
+    // --bench-panels: extra copies of one page, all drawn every frame, while
+    // m_Bench measures frame times and memory.
+    std::vector<std::unique_ptr<BrowserInstance>> m_BenchPanels;
+    std::unique_ptr<PanelBench> m_Bench;
+    std::string m_BenchUrl;
 
     bool InitializeCEF(int argc, char* argv[]);
+    void StartResourceSampler();
+    void StartWatchdog();
     void CreateBrowser(BrowserInstance& instance, const std::string& url, CefMessageRouterBrowserSide::Handler* handler);
+    void RecreateBrowser(BrowserInstance& instance);
+    void TrackBrowser(BrowserInstance& instance);
+    void StartPanelCompressor();
+    void UpdatePanelCompression();
+    void StartBench();
+    void UpdateBench(double frameMs);
+    void RenderBenchWindow();
+    std::vector<BrowserInstance*> GetPanels();
+    void RenderPerformanceWindow();
+    void RenderPanelsWindow();
     void RenderBrowserWindow(BrowserInstance& instance, bool* p_open, const std::string& url, CefMessageRouterBrowserSide::Handler* handler);
 };
 
@@ -370,25 +524,112 @@ bool Application::Initialize(int argc, char* argv[]) {
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     m_Window = glfwCreateWindow(1400, 900, "cefForms Multi-UI", nullptr, nullptr);
     if (!m_Window) return false;
+    if (m_IdleRender) {
+        IdleScheduler::Get().SetWakeCallback([] { glfwPostEmptyEvent(); });
+        glfwSetWindowRefreshCallback(m_Window, [](GLFWwindow*) { IdleScheduler::Get().RequestFrame(); });
+        IdleScheduler::Get().SetEnabled(true);
+    }
     m_Renderer = std::make_unique<VulkanRenderer>();
+    m_Renderer->SetDeviceOverride(CefCommandLine::GetGlobalCommandLine()->GetSwitchValue("vk-device").ToString());
+    m_Renderer->SetAllowVulkan13(!CefCommandLine::GetGlobalCommandLine()->HasSwitch("disable-vulkan13"));
+    m_Renderer->SetCompositorEnabled(CefCommandLine::GetGlobalCommandLine()->HasSwitch("layer-compositor"));
+    m_Renderer->SetSoftwareMode(m_SoftwareMode);
+    if (CefCommandLine::GetGlobalCommandLine()->HasSwitch("mip-threshold")) {
+        try {
+            m_MipThreshold = std::stof(CefCommandLine::GetGlobalCommandLine()->GetSwitchValue("mip-threshold").ToString());
+        } catch (...) {
+            std::cerr << "Ignoring invalid --mip-threshold value" << std::endl;
+        }
+    }
     if (!m_Renderer->Initialize(m_Window)) return false;
 
     IMGUI_CHECKVERSION(); ImGui::CreateContext();
+    if (CefCommandLine::GetGlobalCommandLine()->HasSwitch("multi-viewport")) {
+        // The compositor only draws into the main window's frame.
+        if (m_Renderer->GetCompositor()) {
+            std::cerr << "Ignoring --multi-viewport: not supported with --layer-compositor" << std::endl;
+        } else if (!ImGuiViewports::Enable()) {
+            std::cerr << "Ignoring --multi-viewport: ImGui was built without the docking branch" << std::endl;
+        } else {
+            m_MultiViewport = true;
+        }
+    }
     ImGui::StyleColorsDark();
+    if (m_MultiViewport) {
+        // Platform windows have nothing behind them to round off or blend with.
+        ImGui::GetStyle().WindowRounding = 0.0f;
+        ImGui::GetStyle().Colors[ImGuiCol_WindowBg].w = 1.0f;
+    }
+    if (m_SoftwareMode) {
+        // No anti-aliased fringes for the CPU to rasterize and blend.
+        ImGui::GetStyle().AntiAliasedLines = false;
+        ImGui::GetStyle().AntiAliasedLinesUseTex = false;
+        ImGui::GetStyle().AntiAliasedFill = false;
+    }
     ImGui_ImplGlfw_InitForVulkan(m_Window, true);
     ImGui_ImplVulkan_InitInfo ii = {};
     ii.Instance = m_Renderer->GetInstance(); ii.PhysicalDevice = m_Renderer->GetPhysicalDevice();
     ii.Device = m_Renderer->GetDevice(); ii.QueueFamily = m_Renderer->GetQueueFamily();
     ii.Queue = m_Renderer->GetGraphicsQueue(); ii.DescriptorPool = m_Renderer->GetDescriptorPool();
     ii.RenderPass = m_Renderer->GetRenderPass(); ii.MinImageCount = 2; ii.ImageCount = 2;
+    ii.ApiVersion = m_Renderer->GetApiVersion(); ii.UseDynamicRendering = m_Renderer->UsesDynamicRendering();
+    ii.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    ii.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    ii.PipelineRenderingCreateInfo.pColorAttachmentFormats = m_Renderer->GetColorAttachmentFormat();
     ImGui_ImplVulkan_Init(&ii);
+    if (m_MultiViewport && !ImGuiViewports::Install(*m_Renderer)) m_MultiViewport = false;
 
     m_CefTextureSampler = m_Renderer->CreateTextureSampler();
+    StartPanelCompressor();
     m_DeliveryDashboard.name = "Delivery Dashboard";
     m_TodoApp.name = "ToDo Application";
+    m_DeliveryDashboard.panelClass = "delivery";
+    m_TodoApp.panelClass = "todo";
+    if (!CefCommandLine::GetGlobalCommandLine()->HasSwitch("disable-shared-state")) {
+        m_SharedState = SharedStateSegment::Create(SharedStateSegment::DefaultName());
+        m_Simulator.SetSharedState(m_SharedState.get());
+        m_DeliveryDashboard.usesSharedState = true;
+    }
+    StartResourceSampler();
+    StartWatchdog();
+    StartBench();
+    if (FrameRateGovernor::EnabledFromCommandLine(CefCommandLine::GetGlobalCommandLine())) {
+        m_FrameGovernor = std::make_unique<FrameRateGovernor>();
+        m_FrameGovernor->ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine());
+    }
+    m_AudioMixer = AudioMixer::FromCommandLine(CefCommandLine::GetGlobalCommandLine());
+    if (m_AudioMixer) m_AudioMixer->Start();
+    if (TraceCapture::Get().ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine())) {
+        TraceCapture::Get().Start();
+    }
     return true;
 }
 
+void Application::StartResourceSampler() {
+    CefRefPtr<CefCommandLine> cl = CefCommandLine::GetGlobalCommandLine();
+    m_ResourceSampler = new BrowserResourceSampler(BrowserResourceSampler::IntervalFromCommandLine(cl));
+    m_ResourceSampler->SetLimits(BrowserResourceSampler::LimitsFromCommandLine(cl));
+    m_ResourceSampler->SetLimitExceededCallback([this](int browserId) {
+        for (BrowserInstance* inst : GetPanels()) {
+            if (inst->browserId == browserId) RecreateBrowser(*inst);
+        }
+    });
+    m_ResourceSampler->Start();
+}
+
+void Application::StartWatchdog() {
+    CefRefPtr<CefCommandLine> cl = CefCommandLine::GetGlobalCommandLine();
+    if (!RendererWatchdog::EnabledFromCommandLine(cl)) return;
+    m_Watchdog = new RendererWatchdog();
+    m_Watchdog->ConfigureFromCommandLine(cl);
+    m_Watchdog->SetRecoverCallback([this](const std::string& label) {
+        for (BrowserInstance* inst : GetPanels()) {
+            if (inst->name == label && inst->client) RecreateBrowser(*inst);
+        }
+    });
+    m_Watchdog->Start();
+}
+
 bool Application::InitializeCEF(int argc, char* argv[]) {
 #ifdef _WIN32
     CefMainArgs args(GetModuleHandle(nullptr));
@@ -399,14 +640,26 @@ bool Application::InitializeCEF(int argc, char* argv[]) {
     int ec = CefExecuteProcess(args, m_CefApp, nullptr);
     if (ec >= 0) exit(ec);
     
+    CefRefPtr<CefCommandLine> launch = RequestContextPool::ParseLaunchCommandLine(argc, argv);
+    m_IdleRender = launch->HasSwitch("idle-render");
+    const SoftwareModeDecision software = ResolveSoftwareMode(
+        launch->HasSwitch("software-mode"), launch->GetSwitchValue("software-mode").ToString(),
+        VulkanRenderer::EffectiveDeviceOverride(launch->GetSwitchValue("vk-device").ToString()),
+        &VulkanRenderer::ProbePhysicalDevices);
+    if (!software.warning.empty()) std::cerr << software.warning << std::endl;
+    std::cout << "Software mode " << (software.enabled ? "on" : "off") << " (" << software.reason << ")" << std::endl;
+    m_SoftwareMode = software.enabled;
+    m_CefApp->SetSoftwareMode(m_SoftwareMode);
     CefSettings s; s.windowless_rendering_enabled = true; s.no_sandbox = true;
+    s.external_message_pump = m_IdleRender;
     auto exe_dir = GetExecutablePath().parent_path();
+    const std::filesystem::path cache_root = RequestContextPool::CacheRootFromCommandLine(launch, exe_dir / "cef_cache");
 #ifdef _WIN32
     const auto development_cef_dir = exe_dir / "cef";
     const auto cef_dir = std::filesystem::exists(development_cef_dir / "resources.pak")
         ? development_cef_dir
         : exe_dir;
-    SetCefPath(s.root_cache_path, exe_dir / "cef_cache");
+    SetCefPath(s.root_cache_path, cache_root);
     SetCefPath(s.resources_dir_path, cef_dir);
     SetCefPath(s.locales_dir_path, cef_dir / "locales");
 #else
@@ -414,28 +667,289 @@ bool Application::InitializeCEF(int argc, char* argv[]) {
     const auto cef_dir = std::filesystem::exists(development_cef_dir / "resources.pak")
         ? development_cef_dir
         : exe_dir;
-    CefString(&s.root_cache_path).FromASCII((exe_dir / "cef_cache").string().c_str());
+    CefString(&s.root_cache_path).FromASCII(cache_root.string().c_str());
     CefString(&s.locales_dir_path).FromASCII((cef_dir / "locales").string().c_str());
     CefString(&s.resources_dir_path).FromASCII(cef_dir.string().c_str());
 #endif
-    return CefInitialize(args, s, m_CefApp, nullptr);
+    if (!CefInitialize(args, s, m_CefApp, nullptr)) return false;
+
+    m_ContextPool = new RequestContextPool(cache_root);
+    m_ContextPool->ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine());
+    m_ContextPool->Start();
+    PageLoadLog::Get().ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine(), exe_dir / "page_loads.jsonl");
+    return true;
 }
 
 void Application::CreateBrowser(BrowserInstance& inst, const std::string& url, CefMessageRouterBrowserSide::Handler* handler) {
+    inst.url = url;
+    inst.handler = handler;
     inst.renderHandler = new CefRenderHandlerImpl(inst.width, inst.height);
     inst.client = new CefFormsClient(inst.renderHandler);
     if (handler) inst.client->AddMessageHandler(handler);
+    if (inst.usesSharedState && m_SharedState) inst.client->SetSharedStateName(m_SharedState->GetName());
+    if (m_AudioMixer) inst.client->SetAudioHandler(m_AudioMixer->CreateHandler(inst.name));
+    inst.client->GetLoadTracker()->SetPanel(inst.name);
+    inst.client->GetLoadTracker()->BeginNavigation(url);
+    if (m_Watchdog) m_Watchdog->Watch(inst.name, inst.client);
     CefWindowInfo win; win.SetAsWindowless(0);
     CefBrowserSettings bs; bs.windowless_frame_rate = 60;
-    CefBrowserHost::CreateBrowser(win, inst.client, url, bs, nullptr, nullptr);
+    if (m_FrameGovernor) {
+        // A recreated browser starts at the rate its panel was governed to.
+        const int governed = m_FrameGovernor->GetFrameRate(inst.name);
+        m_FrameGovernor->Attach(inst.name, inst.panelClass, inst.client, bs.windowless_frame_rate);
+        if (governed > 0) bs.windowless_frame_rate = governed;
+    }
+    CefRefPtr<CefRequestContext> context = m_ContextPool ? m_ContextPool->GetContext(inst.panelClass) : nullptr;
+    CefBrowserHost::CreateBrowser(win, inst.client, url, bs, nullptr, context);
+}
+
+void Application::RecreateBrowser(BrowserInstance& inst) {
+    std::string url = inst.url;
+    CefRefPtr<CefFormsClient> previous = inst.client;
+    if (inst.client && inst.client->GetBrowser()) {
+        auto browser = inst.client->GetBrowser();
+        std::string current = browser->GetMainFrame()->GetURL().ToString();
+        if (!current.empty()) url = current;
+        browser->GetHost()->CloseBrowser(true);
+    }
+    if (m_ResourceSampler && inst.browserId != 0) m_ResourceSampler->Untrack(inst.browserId);
+    if (m_ContextPool && inst.browserId != 0) m_ContextPool->DetachBrowser(inst.browserId);
+    if (inst.perfProbe) inst.perfProbe->Detach();
+    inst.browserId = 0;
+    // The old texture stays on screen until the new browser paints.
+    CreateBrowser(inst, url, inst.handler);
+    if (previous) inst.client->InheritState(*previous);
+}
+
+void Application::TrackBrowser(BrowserInstance& inst) {
+    if (!m_ResourceSampler || !inst.client || !inst.client->GetBrowser()) return;
+    int id = inst.client->GetBrowser()->GetIdentifier();
+    if (id == inst.browserId) return;
+    if (inst.browserId != 0) m_ResourceSampler->Untrack(inst.browserId);
+    if (m_ContextPool && inst.browserId != 0) m_ContextPool->DetachBrowser(inst.browserId);
+    inst.browserId = id;
+    m_ResourceSampler->Track(id, inst.name);
+    if (!inst.perfProbe) {
+        inst.perfProbe = new DevToolsPerfProbe(
+            inst.name, DevToolsPerfProbe::IntervalFromCommandLine(CefCommandLine::GetGlobalCommandLine()));
+    }
+    inst.perfProbe->Attach(inst.client->GetBrowser());
+    inst.client->SetPerfProbe(inst.perfProbe);
+    if (m_ContextPool) m_ContextPool->AttachBrowser(inst.panelClass, inst.client->GetBrowser());
+}
+
+void Application::StartPanelCompressor() {
+    CefRefPtr<CefCommandLine> commandLine = CefCommandLine::GetGlobalCommandLine();
+    if (!commandLine->HasSwitch("compress-static-panels")) return;
+    const std::string seconds = commandLine->GetSwitchValue("compress-static-panels").ToString();
+    if (!seconds.empty()) {
+        try {
+            m_CompressAfterSeconds = std::stod(seconds);
+        } catch (...) {
+            std::cerr << "Ignoring invalid --compress-static-panels value" << std::endl;
+        }
+    }
+    const std::string format = commandLine->GetSwitchValue("static-panel-format").ToString();
+    if (!format.empty() && !ParseBlockFormat(format, m_StaticPanelFormat)) {
+        std::cerr << "Ignoring unknown --static-panel-format " << format << std::endl;
+    }
+    // BC7 is the better fit for text; BC1 is the fallback on devices that
+    // only sample the older formats.
+    if (!m_Renderer->SupportsSampledFormat(ToVkFormat(m_StaticPanelFormat)) && m_StaticPanelFormat == BlockFormat::Bc7) {
+        m_StaticPanelFormat = BlockFormat::Bc1;
+    }
+    if (!m_Renderer->SupportsSampledFormat(ToVkFormat(m_StaticPanelFormat))) {
+        std::cerr << "Static panel compression disabled: device cannot sample BC textures" << std::endl;
+        return;
+    }
+    std::cout << "Compressing panels static for " << m_CompressAfterSeconds << "s to "
+              << BlockFormatName(m_StaticPanelFormat) << std::endl;
+    m_PanelCompressor = std::make_unique<BlockCompressionWorker>();
+    m_PanelCompressor->Start();
+}
+
+void Application::UpdatePanelCompression() {
+    if (!m_PanelCompressor) return;
+    for (BrowserInstance* inst : GetPanels()) {
+        inst->QueueCompression(*m_PanelCompressor, m_StaticPanelFormat, m_CompressAfterSeconds);
+    }
+    for (const CompressedTexture& result : m_PanelCompressor->TakeResults()) {
+        MetricsRegistry::Get().RecordHistogram("panel_compression.encode_ms", result.encodeMs);
+        for (BrowserInstance* inst : GetPanels()) {
+            if (inst->name != result.key) continue;
+            if (inst->ApplyCompressed(m_Renderer.get(), m_CefTextureSampler, result, ToVkFormat(result.format))) {
+                MetricsRegistry::Get().AddCounter("panel_compression.swaps", 1.0);
+                // The old image is released once a frame completes.
+                IdleScheduler::Get().RequestFrame();
+            }
+        }
+    }
+    double compressed = 0.0, savedBytes = 0.0;
+    for (BrowserInstance* inst : GetPanels()) {
+        if (!inst->IsCompressed()) continue;
+        compressed += 1.0;
+        const BlockFormat format = inst->texture.GetFormat() == VK_FORMAT_BC1_RGB_UNORM_BLOCK ? BlockFormat::Bc1 : BlockFormat::Bc7;
+        savedBytes += static_cast<double>(inst->width) * inst->height * 4 - CompressedSize(format, inst->width, inst->height);
+    }
+    MetricsRegistry::Get().SetGauge("panel_compression.compressed_panels", compressed);
+    MetricsRegistry::Get().SetGauge("panel_compression.saved_bytes", savedBytes);
+}
+
+std::vector<BrowserInstance*> Application::GetPanels() {
+    std::vector<BrowserInstance*> panels = { &m_DeliveryDashboard, &m_TodoApp };
+    for (auto& inst : m_BenchPanels) panels.push_back(inst.get());
+    return panels;
+}
+
+void Application::StartBench() {
+    CefRefPtr<CefCommandLine> commandLine = CefCommandLine::GetGlobalCommandLine();
+    if (!commandLine->HasSwitch("bench-panels")) return;
+    int panels = 30;
+    double warmup = 5.0, seconds = 30.0;
+    try {
+        const std::string count = commandLine->GetSwitchValue("bench-panels").ToString();
+        if (!count.empty()) panels = std::stoi(count);
+        if (commandLine->HasSwitch("bench-warmup")) warmup = std::stod(commandLine->GetSwitchValue("bench-warmup").ToString());
+        if (commandLine->HasSwitch("bench-seconds")) seconds = std::stod(commandLine->GetSwitchValue("bench-seconds").ToString());
+    } catch (...) {
+        std::cerr << "Ignoring invalid --bench-panels, --bench-warmup or --bench-seconds value" << std::endl;
+    }
+    panels = std::clamp(panels, 1, 256);
+    m_BenchUrl = commandLine->GetSwitchValue("bench-url").ToString();
+    for (int i = 0; i < panels; ++i) {
+        auto inst = std::make_unique<BrowserInstance>();
+        inst->name = "Bench " + std::to_string(i + 1);
+        inst->panelClass = "bench";
+        inst->width = 480; inst->height = 320;
+        m_BenchPanels.push_back(std::move(inst));
+    }
+    m_Bench = std::make_unique<PanelBench>(commandLine->GetSwitchValue("process-profile").ToString(), panels,
+                                           std::max(0.0, warmup), std::max(1.0, seconds));
+    m_Bench->SetSoftwareMode(m_SoftwareMode);
+    std::cout << "Bench: " << panels << " panels, " << warmup << " s warm-up, " << seconds << " s measured" << std::endl;
+}
+
+void Application::UpdateBench(double frameMs) {
+    if (!m_Bench || m_Bench->IsDone()) return;
+    bool ready = true;
+    for (auto& inst : m_BenchPanels) {
+        if (!inst->texture.IsValid()) ready = false;
+    }
+    m_Bench->OnFrame(frameMs, ready);
+    if (!m_Bench->IsDone()) return;
+    std::cout << m_Bench->FormatReport() << std::endl;
+    glfwSetWindowShouldClose(m_Window, true);
+}
+
+void Application::RenderBenchWindow() {
+    if (m_BenchPanels.empty()) return;
+    LayerCompositor* compositor = m_Renderer->GetCompositor();
+    ImGui::SetNextWindowSize(ImVec2(1000, 760), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Bench", nullptr, compositor ? ImGuiWindowFlags_NoBackground : 0)) {
+        // Every panel stays on screen so each one is uploaded and drawn.
+        constexpr float kTileWidth = 160.0f;
+        const int columns = std::max(1, (int)(ImGui::GetContentRegionAvail().x / (kTileWidth + 8.0f)));
+        int column = 0;
+        for (auto& inst : m_BenchPanels) {
+            if (!inst->texture.GetDescriptorSet() && inst->texture.GetLayerTexture() == LayerCompositor::kInvalidTexture) continue;
+            const float scale = kTileWidth / (float)inst->width;
+            const ImVec2 size(kTileWidth, (float)inst->height * scale);
+            inst->NoteDrawScale(scale);
+            if (compositor) ImGuiLayer::CompositeImage(*compositor, inst->texture.GetLayerTexture(), size.x, size.y);
+            else ImGui::Image((ImTextureID)inst->texture.GetDescriptorSet(), size);
+            if (++column < columns) ImGui::SameLine();
+            else column = 0;
+        }
+    }
+    ImGui::End();
+}
+
+void Application::RenderPerformanceWindow() {
+    if (!m_ShowPerformance) return;
+    if (ImGui::Begin("Performance", &m_ShowPerformance)) {
+        if (m_ResourceSampler && ImGui::CollapsingHeader("Renderer processes", ImGuiTreeNodeFlags_DefaultOpen)) {
+            ImGuiLayer::DrawResourceTable(m_ResourceSampler->GetSnapshot());
+        }
+        if (ImGui::CollapsingHeader("Page performance", ImGuiTreeNodeFlags_DefaultOpen)) {
+            std::vector<PagePerfSnapshot> pages;
+            for (BrowserInstance* inst : GetPanels()) {
+                if (inst->perfProbe) pages.push_back(inst->perfProbe->GetSnapshot());
+            }
+            ImGuiLayer::DrawPagePerfTable(pages);
+        }
+        if (m_FrameGovernor && ImGui::CollapsingHeader("Frame rate governor")) {
+            ImGuiLayer::DrawFrameRateTable(m_FrameGovernor->GetStats());
+        }
+        if (m_Watchdog && ImGui::CollapsingHeader("Renderer watchdog")) {
+            ImGuiLayer::DrawWatchdogTable(m_Watchdog->GetStats());
+        }
+        if (m_ContextPool && ImGui::CollapsingHeader("Request contexts")) {
+            ImGuiLayer::DrawRequestContextTable(m_ContextPool->GetStats());
+        }
+        if (ImGui::CollapsingHeader("Page loads")) {
+            ImGuiLayer::DrawPageLoadTable(PageLoadLog::Get().GetUrlStats());
+        }
+        if (m_AudioMixer && ImGui::CollapsingHeader("Audio", ImGuiTreeNodeFlags_DefaultOpen)) {
+            std::vector<AudioMeterSnapshot> meters = m_AudioMixer->GetMeters();
+            meters.push_back(m_AudioMixer->GetMixMeter());
+            ImGuiLayer::DrawAudioMeters(meters);
+        }
+        if (m_Renderer->GetCompositor() && ImGui::CollapsingHeader("Layer compositor")) {
+            ImGuiLayer::DrawCompositorStats(m_Renderer->GetCompositor()->GetStats());
+        }
+        if (ImGui::CollapsingHeader("Metrics")) {
+            ImGuiLayer::DrawMetricsTable();
+        }
+    }
+    ImGui::End();
+}
+
+void Application::RenderPanelsWindow() {
+    if (!m_ShowPanels) return;
+    LayerCompositor* compositor = m_Renderer->GetCompositor();
+    ImGui::SetNextWindowSize(ImVec2(540, 240), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Panels", &m_ShowPanels, compositor ? ImGuiWindowFlags_NoBackground : 0)) {
+        // Thumbnails sample the panels' mip chains, so they cost a few
+        // texels per pixel however large the panels are.
+        constexpr float kThumbnailWidth = 240.0f;
+        for (auto [inst, show] : { std::pair{ &m_DeliveryDashboard, &m_ShowDelivery }, std::pair{ &m_TodoApp, &m_ShowTodo } }) {
+            if (!inst->texture.GetDescriptorSet() && inst->texture.GetLayerTexture() == LayerCompositor::kInvalidTexture) continue;
+            const float scale = kThumbnailWidth / (float)inst->width;
+            const ImVec2 size(kThumbnailWidth, (float)inst->height * scale);
+            inst->NoteDrawScale(scale);
+            ImGui::BeginGroup();
+            ImGui::TextUnformatted(inst->name.c_str());
+            const ImVec2 cp = ImGui::GetCursorScreenPos();
+            if (compositor) ImGuiLayer::CompositeImage(*compositor, inst->texture.GetLayerTexture(), size.x, size.y);
+            else ImGui::Image((ImTextureID)inst->texture.GetDescriptorSet(), size);
+            ImGui::SetCursorScreenPos(cp);
+            if (ImGui::InvisibleButton((inst->name + "_thumb").c_str(), size)) {
+                *show = true;
+                ImGui::SetWindowFocus(inst->name.c_str());
+            }
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("%dx%d, %u mip level(s)", inst->width, inst->height, inst->texture.GetMipLevels());
+            ImGui::EndGroup();
+            ImGui::SameLine();
+        }
+    }
+    ImGui::End();
 }
 
 void Application::RenderBrowserWindow(BrowserInstance& inst, bool* p_open, const std::string& url, CefMessageRouterBrowserSide::Handler* handler) {
     ZoneScoped;
-    if (!*p_open) return;
+    if (!*p_open) {
+        if (m_FrameGovernor) m_FrameGovernor->SetFocused(inst.name, false);
+        return;
+    }
     if (!inst.client) CreateBrowser(inst, url, handler);
     ImGui::SetNextWindowSize(ImVec2((float)inst.width + 20, (float)inst.height + 40), ImGuiCond_FirstUseEver);
-    if (ImGui::Begin(inst.name.c_str(), p_open)) {
+    LayerCompositor* compositor = m_Renderer->GetCompositor();
+    // The page fills the content region, so in software mode the window
+    // background under it is pure overdraw.
+    const bool visible = ImGui::Begin(inst.name.c_str(), p_open,
+                                      (compositor || m_SoftwareMode) ? ImGuiWindowFlags_NoBackground : 0);
+    if (m_FrameGovernor) m_FrameGovernor->SetFocused(inst.name, ImGui::IsWindowFocused());
+    if (visible) {
         ImVec2 avail = ImGui::GetContentRegionAvail();
         int aw = std::max(64, (int)avail.x), ah = std::max(64, (int)avail.y);
         auto browser = inst.client->GetBrowser();
@@ -444,9 +958,10 @@ void Application::RenderBrowserWindow(BrowserInstance& inst, bool* p_open, const
             inst.renderHandler->Resize(aw, ah);
             browser->GetHost()->WasResized();
         }
-        if (inst.descriptorSet) {
+        if (inst.texture.GetDescriptorSet() || inst.texture.GetLayerTexture() != LayerCompositor::kInvalidTexture) {
             ImVec2 cp = ImGui::GetCursorScreenPos();
-            ImGui::Image((ImTextureID)inst.descriptorSet, ImVec2((float)inst.width, (float)inst.height));
+            if (compositor) ImGuiLayer::CompositeImage(*compositor, inst.texture.GetLayerTexture(), (float)inst.width, (float)inst.height);
+            else ImGui::Image((ImTextureID)inst.texture.GetDescriptorSet(), ImVec2((float)inst.width, (float)inst.height));
             ImGui::SetCursorScreenPos(cp);
             ImGui::InvisibleButton((inst.name + "_btn").c_str(), ImVec2((float)inst.width, (float)inst.height));
             if (ImGui::IsItemHovered() && browser && browser->GetHost()) {
@@ -478,13 +993,33 @@ void Application::Run() {
     std::replace(base_url.begin(), base_url.end(), '\\', '/');
 #endif
 
+    for (auto& inst : m_BenchPanels) {
+        CreateBrowser(*inst, m_BenchUrl.empty() ? base_url + "perf.html" : m_BenchUrl, nullptr);
+    }
+
+    // How long the loop waits for input before asking again when a frame
+    // was wanted but no window had a free image.
+    constexpr double kImageRetrySeconds = 0.002;
+    IdleScheduler& idle = IdleScheduler::Get();
+    bool awaitingImage = false;
     while (!glfwWindowShouldClose(m_Window)) {
-        FrameMark;
-        glfwPollEvents();
+        double wait = idle.GetWaitSeconds(false);
+        if (awaitingImage && wait <= 0.0) wait = kImageRetrySeconds;
+        if (wait > 0.0) glfwWaitEventsTimeout(wait);
+        else glfwPollEvents();
+        const auto frameStart = std::chrono::steady_clock::now();
+        TraceCapture::Get().Tick();
+        idle.OnPumpWork();
         CefDoMessageLoopWork();
+        for (BrowserInstance* inst : GetPanels()) TrackBrowser(*inst);
+        if (m_FrameGovernor) m_FrameGovernor->Update();
         
+        // With a shared segment the dashboard pulls on requestAnimationFrame;
+        // the push path stays as the fallback when the segment is unavailable.
         std::string latestState;
-        if (m_Simulator.ConsumeState(latestState)) {
+        if (m_Simulator.ConsumeState(latestState) && !m_SharedState) {
+            TraceScope pushTrace("state_push", "ipc");
+            if (m_DeliveryDashboard.client) m_DeliveryDashboard.client->PublishState("drivers", latestState);
             if (m_DeliveryDashboard.client && m_DeliveryDashboard.client->GetBrowser()) {
                 auto frame = m_DeliveryDashboard.client->GetBrowser()->GetMainFrame();
                 if (frame) {
@@ -495,21 +1030,45 @@ void Application::Run() {
         }
 
         if (m_Renderer) {
-            m_DeliveryDashboard.UpdateTexture(m_Renderer.get(), m_CefTextureSampler);
-            m_TodoApp.UpdateTexture(m_Renderer.get(), m_CefTextureSampler);
+            TraceScope uploadTrace("upload", "host");
+            for (BrowserInstance* inst : GetPanels()) {
+                inst->UpdateTexture(m_Renderer.get(), m_CefTextureSampler, m_MipThreshold);
+            }
+            UpdatePanelCompression();
         }
+
+        // Pump-only wakeups end here without drawing.
+        if (!idle.ShouldRender(ImGuiLayer::HasQueuedInput() || m_Renderer->GetPresenter()->NeedsRecreate())) continue;
+        FrameMark;
+        TraceScope frameTrace("frame", "host");
         
-        m_Renderer->BeginFrame();
+        // Each window is drawn when its own display has a free image. With
+        // platform windows open none of the acquires wait, and a main window
+        // without an image (busy display, minimized) does not hold up the
+        // others: its draw data is just not recorded.
+        const bool mainFrame = m_Renderer->BeginFrame();
+        const bool windowFrames = m_Renderer->AcquireWindowTargets() > 0;
+        awaitingImage = !mainFrame && !windowFrames;
+        if (awaitingImage) continue;
         ImGui_ImplVulkan_NewFrame(); ImGui_ImplGlfw_NewFrame(); ImGui::NewFrame();
+        if (ImGui::IsKeyPressed(ImGuiKey_F9, false)) TraceCapture::Get().Toggle();
         
         if (ImGui::BeginMainMenuBar()) {
             if (ImGui::BeginMenu("File")) {
                 if (ImGui::MenuItem("Quit", "Alt+F4")) glfwSetWindowShouldClose(m_Window, true);
                 ImGui::EndMenu();
             }
+            if (ImGui::BeginMenu("Tools")) {
+                const bool tracing = TraceCapture::Get().IsActive();
+                if (ImGui::MenuItem(tracing ? "Stop Trace Capture" : "Start Trace Capture", "F9")) TraceCapture::Get().Toggle();
+                ImGui::EndMenu();
+            }
             if (ImGui::BeginMenu("Window")) {
                 ImGui::MenuItem("Delivery Dashboard", nullptr, &m_ShowDelivery);
                 ImGui::MenuItem("ToDo Application", nullptr, &m_ShowTodo);
+                ImGui::MenuItem("Panels", nullptr, &m_ShowPanels);
+                ImGui::Separator();
+                ImGui::MenuItem("Performance", nullptr, &m_ShowPerformance);
                 ImGui::EndMenu();
             }
             ImGui::EndMainMenuBar();
@@ -525,24 +1084,51 @@ void Application::Run() {
         if (m_ShowTodo) {
             RenderBrowserWindow(m_TodoApp, &m_ShowTodo, base_url + "todo.html", new TodoHandler());
         }
+        RenderPanelsWindow();
+        RenderBenchWindow();
+        RenderPerformanceWindow();
         
         ImGui::Render();
-        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_Renderer->GetCommandBuffer());
-        m_Renderer->EndFrame();
+        if (mainFrame) {
+            m_Renderer->CompositeLayers();
+            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_Renderer->GetCommandBuffer());
+        }
+        {
+            TraceScope presentTrace("present", "host");
+            if (mainFrame) m_Renderer->EndFrame();
+            if (m_MultiViewport) ImGuiViewports::RenderPlatformWindows();
+        }
+        idle.OnFrameRendered();
+        for (BrowserInstance* inst : GetPanels()) {
+            if (inst->client) inst->client->GetLoadTracker()->OnPresent();
+        }
+
+        const std::chrono::duration<double, std::milli> frameMs = std::chrono::steady_clock::now() - frameStart;
+        MetricsRegistry::Get().RecordHistogram("frame.loop_ms", frameMs.count());
+        UpdateBench(frameMs.count());
     }
 }
 
 void Application::Cleanup() {
     m_Simulator.Stop();
+    m_Simulator.SetSharedState(nullptr);
+    m_SharedState.reset();
+    if (m_ResourceSampler) { m_ResourceSampler->Stop(); m_ResourceSampler = nullptr; }
+    if (m_Watchdog) { m_Watchdog->Stop(); m_Watchdog = nullptr; }
+    if (m_ContextPool) { m_ContextPool->Stop(); m_ContextPool = nullptr; }
+    if (m_AudioMixer) m_AudioMixer->Stop();
+    if (m_PanelCompressor) { m_PanelCompressor->Stop(); m_PanelCompressor.reset(); }
     if (m_Renderer) {
         vkDeviceWaitIdle(m_Renderer->GetDevice());
         if (m_CefTextureSampler != VK_NULL_HANDLE) vkDestroySampler(m_Renderer->GetDevice(), m_CefTextureSampler, nullptr);
-        m_DeliveryDashboard.Cleanup(m_Renderer->GetDevice());
-        m_TodoApp.Cleanup(m_Renderer->GetDevice());
+        for (BrowserInstance* inst : GetPanels()) inst->Cleanup(m_Renderer.get());
+        m_Renderer->FlushDeferredReleases();
+        if (m_MultiViewport) ImGuiViewports::Shutdown();
         ImGui_ImplVulkan_Shutdown(); ImGui_ImplGlfw_Shutdown(); ImGui::DestroyContext();
         m_Renderer->Cleanup(); 
     }
     if (m_Window) { glfwDestroyWindow(m_Window); glfwTerminate(); }
+    TraceCapture::Get().Shutdown();
     m_CefApp = nullptr; CefShutdown();
 }
 
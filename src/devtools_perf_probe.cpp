@@ -0,0 +1,317 @@
+#include "../include/devtools_perf_probe.h"
+#include "include/base/cef_callback.h"
+#include "include/cef_parser.h"
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+constexpr int kRequestTimeoutIntervals = 3;
+
+// The long task observer runs in an isolated world of its own: the page can
+// neither see nor overwrite its buffer, and nothing is evaluated in the page's
+// own context. Page.createIsolatedWorld returns the current document's context
+// in the world of that name, which is also where the new-document script ran.
+const char kProbeWorldName[] = "imguicef-perf-probe";
+
+// Installed on every new document, and evaluated once in a document that was
+// already loaded when the probe found its world. Long tasks are buffered in
+// the world's global object and drained by the probe on each poll.
+const char kLongTaskObserverScript[] =
+    "(() => {"
+    "  if (globalThis.hostLongTasks || typeof PerformanceObserver === 'undefined') return;"
+    "  globalThis.hostLongTasks = [];"
+    "  try {"
+    "    new PerformanceObserver((list) => {"
+    "      for (const entry of list.getEntries()) hostLongTasks.push(entry.duration);"
+    "    }).observe({ type: 'longtask', buffered: true });"
+    "  } catch (e) {}"
+    "})()";
+
+const char kDrainLongTasksScript[] =
+    "JSON.stringify(globalThis.hostLongTasks ? hostLongTasks.splice(0) : [])";
+
+CefRefPtr<CefDictionaryValue> ParseDictionary(const void* json, size_t size) {
+    if (!json || size == 0) return nullptr;
+    CefRefPtr<CefValue> value = CefParseJSON(json, size, JSON_PARSER_RFC);
+    if (!value || value->GetType() != VTYPE_DICTIONARY) return nullptr;
+    return value->GetDictionary();
+}
+
+double NumberOf(CefRefPtr<CefValue> value) {
+    if (!value) return 0.0;
+    if (value->GetType() == VTYPE_INT) return value->GetInt();
+    if (value->GetType() == VTYPE_DOUBLE) return value->GetDouble();
+    return 0.0;
+}
+}  // namespace
+
+DevToolsPerfProbe::DevToolsPerfProbe(const std::string& label, int intervalMs)
+    : m_Label(label),
+      m_MetricPrefix("page." + label + "."),
+      m_IntervalMs(intervalMs) {
+    m_Snapshot.label = label;
+}
+
+int DevToolsPerfProbe::IntervalFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    if (!commandLine || !commandLine->HasSwitch("page-metrics-ms")) return 2000;
+    try {
+        return std::max(0, std::stoi(commandLine->GetSwitchValue("page-metrics-ms").ToString()));
+    } catch (...) {
+        std::cerr << "Ignoring invalid --page-metrics-ms value" << std::endl;
+        return 2000;
+    }
+}
+
+void DevToolsPerfProbe::Attach(CefRefPtr<CefBrowser> browser) {
+    Detach();
+    if (!browser || m_IntervalMs <= 0) return;
+
+    m_Browser = browser;
+    m_Registration = browser->GetHost()->AddDevToolsMessageObserver(this);
+    ++m_Generation;
+
+    Execute("Performance.enable", nullptr);
+
+    CefRefPtr<CefListValue> eventTypes = CefListValue::Create();
+    eventTypes->SetString(0, "layout-shift");
+    CefRefPtr<CefDictionaryValue> timelineParams = CefDictionaryValue::Create();
+    timelineParams->SetList("eventTypes", eventTypes);
+    Execute("PerformanceTimeline.enable", timelineParams);
+
+    CefRefPtr<CefDictionaryValue> newDocumentParams = CefDictionaryValue::Create();
+    newDocumentParams->SetString("source", kLongTaskObserverScript);
+    newDocumentParams->SetString("worldName", kProbeWorldName);
+    Execute("Page.addScriptToEvaluateOnNewDocument", newDocumentParams);
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Snapshot = PagePerfSnapshot();
+        m_Snapshot.label = m_Label;
+        m_Snapshot.attached = true;
+    }
+    m_LastCumulative.clear();
+    m_LongTaskHistogram = MetricsRegistry::Histogram();
+    ScheduleNext();
+}
+
+void DevToolsPerfProbe::Detach() {
+    ++m_Generation;
+    m_Registration = nullptr;
+    m_Browser = nullptr;
+    m_MetricsRequestId = 0;
+    m_LongTaskRequestId = 0;
+    m_ProbeContextId = 0;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Snapshot.attached = false;
+}
+
+void DevToolsPerfProbe::OnRenderProcessTerminated() {
+    m_MetricsRequestId = 0;
+    m_LongTaskRequestId = 0;
+    m_ProbeContextId = 0;
+    // The next renderer's cumulative counters start again from zero.
+    m_LastCumulative.clear();
+}
+
+PagePerfSnapshot DevToolsPerfProbe::GetSnapshot() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Snapshot;
+}
+
+int DevToolsPerfProbe::Execute(const std::string& method, CefRefPtr<CefDictionaryValue> params) {
+    if (!m_Browser) return 0;
+    return m_Browser->GetHost()->ExecuteDevToolsMethod(0, method, params);
+}
+
+void DevToolsPerfProbe::ScheduleNext() {
+    CefPostDelayedTask(TID_UI, base::BindOnce(&DevToolsPerfProbe::Poll, this, m_Generation), m_IntervalMs);
+}
+
+void DevToolsPerfProbe::Poll(int generation) {
+    ZoneScoped;
+    if (generation != m_Generation || !m_Browser) return;
+
+    // Skip a round rather than queueing requests behind a busy renderer, but
+    // give up on a request whose result has not come back for several rounds.
+    const auto now = std::chrono::steady_clock::now();
+    const auto timeout = std::chrono::milliseconds(m_IntervalMs) * kRequestTimeoutIntervals;
+    if (m_MetricsRequestId != 0 && now - m_MetricsIssuedAt >= timeout) {
+        m_MetricsRequestId = 0;
+        MetricsRegistry::Get().AddCounter(m_MetricPrefix + "request_timeouts");
+    }
+    if (m_LongTaskRequestId != 0 && now - m_LongTaskIssuedAt >= timeout) {
+        m_LongTaskRequestId = 0;
+        MetricsRegistry::Get().AddCounter(m_MetricPrefix + "request_timeouts");
+    }
+    if (m_MetricsRequestId == 0) {
+        m_MetricsRequestId = Execute("Performance.getMetrics", nullptr);
+        m_MetricsIssuedAt = now;
+    }
+    if (m_LongTaskRequestId == 0) {
+        // Without the world's context (first poll, or the document it
+        // belonged to is gone) find the main frame first.
+        if (m_ProbeContextId == 0) {
+            m_LongTaskStep = LongTaskStep::FrameTree;
+            m_LongTaskRequestId = Execute("Page.getFrameTree", nullptr);
+        } else {
+            DrainLongTasks();
+        }
+        m_LongTaskIssuedAt = now;
+    }
+    ScheduleNext();
+}
+
+void DevToolsPerfProbe::DrainLongTasks() {
+    CefRefPtr<CefDictionaryValue> params = CefDictionaryValue::Create();
+    params->SetString("expression", kDrainLongTasksScript);
+    params->SetInt("contextId", m_ProbeContextId);
+    params->SetBool("returnByValue", true);
+    m_LongTaskStep = LongTaskStep::Drain;
+    m_LongTaskRequestId = Execute("Runtime.evaluate", params);
+}
+
+void DevToolsPerfProbe::HandleLongTaskStep(bool success, CefRefPtr<CefDictionaryValue> result) {
+    switch (m_LongTaskStep) {
+    case LongTaskStep::FrameTree: {
+        CefRefPtr<CefDictionaryValue> tree = result ? result->GetDictionary("frameTree") : nullptr;
+        CefRefPtr<CefDictionaryValue> frame = tree ? tree->GetDictionary("frame") : nullptr;
+        if (!success || !frame) return;
+        CefRefPtr<CefDictionaryValue> params = CefDictionaryValue::Create();
+        params->SetString("frameId", frame->GetString("id"));
+        params->SetString("worldName", kProbeWorldName);
+        m_LongTaskStep = LongTaskStep::IsolatedWorld;
+        m_LongTaskRequestId = Execute("Page.createIsolatedWorld", params);
+        return;
+    }
+    case LongTaskStep::IsolatedWorld: {
+        if (!success || !result || result->GetType("executionContextId") != VTYPE_INT) return;
+        m_ProbeContextId = result->GetInt("executionContextId");
+        // A no-op where the new-document script already ran. Evaluated ahead
+        // of the drain on the same session, so it installs first.
+        CefRefPtr<CefDictionaryValue> params = CefDictionaryValue::Create();
+        params->SetString("expression", kLongTaskObserverScript);
+        params->SetInt("contextId", m_ProbeContextId);
+        Execute("Runtime.evaluate", params);
+        DrainLongTasks();
+        return;
+    }
+    case LongTaskStep::Drain:
+        // The context dies with its document; look it up again next poll.
+        if (!success) m_ProbeContextId = 0;
+        else HandleLongTasks(result);
+        return;
+    }
+}
+
+void DevToolsPerfProbe::OnDevToolsMethodResult(CefRefPtr<CefBrowser> browser,
+                                               int message_id,
+                                               bool success,
+                                               const void* result,
+                                               size_t result_size) {
+    if (message_id == 0) return;
+    if (message_id == m_MetricsRequestId) {
+        m_MetricsRequestId = 0;
+        if (success) HandleMetrics(ParseDictionary(result, result_size));
+    } else if (message_id == m_LongTaskRequestId) {
+        m_LongTaskRequestId = 0;
+        HandleLongTaskStep(success, ParseDictionary(result, result_size));
+    }
+}
+
+void DevToolsPerfProbe::OnDevToolsEvent(CefRefPtr<CefBrowser> browser,
+                                        const CefString& method,
+                                        const void* params,
+                                        size_t params_size) {
+    if (method != "PerformanceTimeline.timelineEventAdded") return;
+    CefRefPtr<CefDictionaryValue> dict = ParseDictionary(params, params_size);
+    if (!dict || !dict->HasKey("event")) return;
+    CefRefPtr<CefDictionaryValue> event = dict->GetDictionary("event");
+    if (!event || !event->HasKey("layoutShiftDetails")) return;
+    CefRefPtr<CefDictionaryValue> details = event->GetDictionary("layoutShiftDetails");
+    if (!details || details->GetBool("hadRecentInput")) return;
+
+    double score = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Snapshot.layoutShiftScore += NumberOf(details->GetValue("value"));
+        score = m_Snapshot.layoutShiftScore;
+    }
+    MetricsRegistry::Get().SetGauge(m_MetricPrefix + "layout_shift_score", score);
+}
+
+void DevToolsPerfProbe::HandleMetrics(CefRefPtr<CefDictionaryValue> result) {
+    if (!result || !result->HasKey("metrics")) return;
+    CefRefPtr<CefListValue> metrics = result->GetList("metrics");
+    if (!metrics) return;
+
+    std::map<std::string, double> current;
+    for (size_t i = 0; i < metrics->GetSize(); ++i) {
+        CefRefPtr<CefDictionaryValue> metric = metrics->GetDictionary(i);
+        if (!metric) continue;
+        current[metric->GetString("name").ToString()] = NumberOf(metric->GetValue("value"));
+    }
+
+    // Durations and counts are cumulative; report them as per-second rates
+    // over the interval between two samples, measured on the page clock.
+    const double elapsed = m_LastCumulative.count("Timestamp")
+        ? current["Timestamp"] - m_LastCumulative["Timestamp"]
+        : 0.0;
+    auto rate = [&](const char* name, double scale) {
+        if (elapsed <= 0.0 || !m_LastCumulative.count(name)) return 0.0;
+        return std::max(0.0, current[name] - m_LastCumulative[name]) * scale / elapsed;
+    };
+
+    PagePerfSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Snapshot.jsHeapUsedMb = current["JSHeapUsedSize"] / (1024.0 * 1024.0);
+        m_Snapshot.jsHeapTotalMb = current["JSHeapTotalSize"] / (1024.0 * 1024.0);
+        m_Snapshot.nodes = current["Nodes"];
+        m_Snapshot.layoutsPerSecond = rate("LayoutCount", 1.0);
+        m_Snapshot.layoutMsPerSecond = rate("LayoutDuration", 1000.0);
+        m_Snapshot.styleMsPerSecond = rate("RecalcStyleDuration", 1000.0);
+        m_Snapshot.scriptMsPerSecond = rate("ScriptDuration", 1000.0);
+        m_Snapshot.taskMsPerSecond = rate("TaskDuration", 1000.0);
+        snapshot = m_Snapshot;
+    }
+    m_LastCumulative = std::move(current);
+
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.SetGauge(m_MetricPrefix + "js_heap_used_mb", snapshot.jsHeapUsedMb);
+    registry.SetGauge(m_MetricPrefix + "layouts_per_s", snapshot.layoutsPerSecond);
+    registry.SetGauge(m_MetricPrefix + "layout_ms_per_s", snapshot.layoutMsPerSecond);
+    registry.SetGauge(m_MetricPrefix + "style_ms_per_s", snapshot.styleMsPerSecond);
+    registry.SetGauge(m_MetricPrefix + "script_ms_per_s", snapshot.scriptMsPerSecond);
+    registry.SetGauge(m_MetricPrefix + "task_ms_per_s", snapshot.taskMsPerSecond);
+}
+
+void DevToolsPerfProbe::HandleLongTasks(CefRefPtr<CefDictionaryValue> result) {
+    if (!result || !result->HasKey("result")) return;
+    CefRefPtr<CefDictionaryValue> remoteObject = result->GetDictionary("result");
+    if (!remoteObject || remoteObject->GetType("value") != VTYPE_STRING) return;
+
+    CefRefPtr<CefValue> parsed = CefParseJSON(remoteObject->GetString("value"), JSON_PARSER_RFC);
+    if (!parsed || parsed->GetType() != VTYPE_LIST) return;
+    CefRefPtr<CefListValue> durations = parsed->GetList();
+    if (durations->GetSize() == 0) return;
+
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    for (size_t i = 0; i < durations->GetSize(); ++i) {
+        const double duration = NumberOf(durations->GetValue(i));
+        m_LongTaskHistogram.Record(duration);
+        registry.RecordHistogram(m_MetricPrefix + "long_task_ms", duration);
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Snapshot.longTasks = m_LongTaskHistogram.count;
+    m_Snapshot.longTaskP95Ms = m_LongTaskHistogram.Percentile(0.95);
+    m_Snapshot.longTaskMaxMs = m_LongTaskHistogram.max;
+}
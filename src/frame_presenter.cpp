@@ -0,0 +1,295 @@
+#include "../include/frame_presenter.h"
+#include "../include/metrics_registry.h"
+#include "../include/vulkan_renderer.h"
+#include <GLFW/glfw3.h>
+#include <cstring>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+std::vector<const char*> SwapchainPresenter::GetInstanceExtensions() const {
+    uint32_t count = 0;
+    const char** extensions = glfwGetRequiredInstanceExtensions(&count);
+    if (!extensions) return {};
+    return std::vector<const char*>(extensions, extensions + count);
+}
+
+std::vector<const char*> SwapchainPresenter::GetDeviceExtensions() const {
+    return { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+}
+
+bool SwapchainPresenter::AttachInstance(VkInstance instance) {
+    m_Instance = instance;
+    return glfwCreateWindowSurface(instance, m_Window, nullptr, &m_Surface) == VK_SUCCESS;
+}
+
+void SwapchainPresenter::DetachInstance(VkInstance instance) {
+    vkDestroySurfaceKHR(instance, m_Surface, nullptr);
+    m_Surface = VK_NULL_HANDLE;
+    m_Instance = VK_NULL_HANDLE;
+}
+
+bool SwapchainPresenter::SupportsQueueFamily(VkPhysicalDevice device, uint32_t family) const {
+    VkBool32 presentSupport = VK_FALSE;
+    vkGetPhysicalDeviceSurfaceSupportKHR(device, family, m_Surface, &presentSupport);
+    return presentSupport == VK_TRUE;
+}
+
+bool SwapchainPresenter::Create(VulkanRenderer& renderer) {
+    m_Device = renderer.GetDevice();
+    return CreateSwapchain(renderer);
+}
+
+void SwapchainPresenter::Destroy(VulkanRenderer&) {
+    if (m_Device == VK_NULL_HANDLE) return;
+    DestroyViews();
+    vkDestroySwapchainKHR(m_Device, m_Swapchain, nullptr);
+    m_Swapchain = VK_NULL_HANDLE;
+    m_Images.clear();
+}
+
+bool SwapchainPresenter::NeedsRecreate() const {
+    int width, height;
+    glfwGetFramebufferSize(m_Window, &width, &height);
+    return m_Dirty || static_cast<uint32_t>(width) != m_WindowExtent.width ||
+           static_cast<uint32_t>(height) != m_WindowExtent.height;
+}
+
+bool SwapchainPresenter::HasOutput() const {
+    int width, height;
+    glfwGetFramebufferSize(m_Window, &width, &height);
+    return width > 0 && height > 0;
+}
+
+bool SwapchainPresenter::Recreate(VulkanRenderer& renderer) {
+    DestroyViews();
+    return CreateSwapchain(renderer);
+}
+
+bool SwapchainPresenter::CreateSwapchain(VulkanRenderer& renderer) {
+    VkSurfaceCapabilitiesKHR capabilities;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(renderer.GetPhysicalDevice(), m_Surface, &capabilities);
+
+    int width, height;
+    glfwGetFramebufferSize(m_Window, &width, &height);
+    VkExtent2D extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    if (capabilities.currentExtent.width != UINT32_MAX) extent = capabilities.currentExtent;
+    // Minimized: keep the current swapchain until the window has a size.
+    if (extent.width == 0 || extent.height == 0) return m_Swapchain != VK_NULL_HANDLE;
+    VkSwapchainKHR oldSwapchain = m_Swapchain;
+
+    VkSwapchainCreateInfoKHR createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    createInfo.surface = m_Surface;
+    createInfo.minImageCount = capabilities.minImageCount + 1;
+    createInfo.imageFormat = m_Format;
+    createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    createInfo.imageExtent = extent;
+    createInfo.imageArrayLayers = 1;
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.preTransform = capabilities.currentTransform;
+    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = oldSwapchain;
+
+    if (vkCreateSwapchainKHR(m_Device, &createInfo, nullptr, &m_Swapchain) != VK_SUCCESS) {
+        m_Swapchain = oldSwapchain;
+        return false;
+    }
+    if (oldSwapchain != VK_NULL_HANDLE) vkDestroySwapchainKHR(m_Device, oldSwapchain, nullptr);
+    m_Extent = extent;
+    m_WindowExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    m_Dirty = false;
+
+    uint32_t imageCount;
+    vkGetSwapchainImagesKHR(m_Device, m_Swapchain, &imageCount, nullptr);
+    m_Images.resize(imageCount);
+    vkGetSwapchainImagesKHR(m_Device, m_Swapchain, &imageCount, m_Images.data());
+
+    m_ImageViews.reserve(imageCount);
+    for (VkImage image : m_Images) {
+        VkImageView view = renderer.CreateImageView(image, m_Format);
+        if (view == VK_NULL_HANDLE) return false;
+        m_ImageViews.push_back(view);
+    }
+    return true;
+}
+
+void SwapchainPresenter::DestroyViews() {
+    for (VkImageView view : m_ImageViews) {
+        vkDestroyImageView(m_Device, view, nullptr);
+    }
+    m_ImageViews.clear();
+}
+
+bool SwapchainPresenter::Acquire(VkSemaphore imageAvailable, uint32_t& imageIndex) {
+    return AcquireImage(UINT64_MAX, imageAvailable, imageIndex) == AcquireResult::Acquired;
+}
+
+SwapchainPresenter::AcquireResult SwapchainPresenter::TryAcquire(VkSemaphore imageAvailable, uint32_t& imageIndex) {
+    return AcquireImage(0, imageAvailable, imageIndex);
+}
+
+SwapchainPresenter::AcquireResult SwapchainPresenter::AcquireImage(uint64_t timeout, VkSemaphore imageAvailable,
+                                                                   uint32_t& imageIndex) {
+    const VkResult result = vkAcquireNextImageKHR(m_Device, m_Swapchain, timeout, imageAvailable,
+                                                  VK_NULL_HANDLE, &imageIndex);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) return AcquireResult::OutOfDate;
+    if (result == VK_NOT_READY || result == VK_TIMEOUT) return AcquireResult::NotReady;
+    if (result == VK_SUBOPTIMAL_KHR) m_Dirty = true;
+    return AcquireResult::Acquired;
+}
+
+void SwapchainPresenter::Present(VkQueue queue, VkSemaphore renderFinished, uint32_t imageIndex) {
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &renderFinished;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &m_Swapchain;
+    presentInfo.pImageIndices = &imageIndex;
+
+    const VkResult result = vkQueuePresentKHR(queue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) m_Dirty = true;
+}
+
+OffscreenPresenter::OffscreenPresenter(uint32_t width, uint32_t height, uint32_t ringSize)
+    : m_RequestedExtent{ width, height }, m_RingSize(ringSize > 0 ? ringSize : 1) {}
+
+void OffscreenPresenter::Resize(uint32_t width, uint32_t height) {
+    m_RequestedExtent = { width, height };
+}
+
+bool OffscreenPresenter::ReadPixels(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height) const {
+    if (m_CompletedSlot < 0) return false;
+    width = m_Extent.width;
+    height = m_Extent.height;
+    const size_t size = static_cast<size_t>(width) * height * 4;
+    rgba.resize(size);
+    std::memcpy(rgba.data(), m_Slots[m_CompletedSlot].mapped, size);
+    return true;
+}
+
+bool OffscreenPresenter::NeedsRecreate() const {
+    return m_RequestedExtent.width != m_Extent.width || m_RequestedExtent.height != m_Extent.height;
+}
+
+bool OffscreenPresenter::Create(VulkanRenderer& renderer) {
+    ZoneScoped;
+    m_Device = renderer.GetDevice();
+    if (!HasOutput()) return false;
+    m_Extent = m_RequestedExtent;
+    const VkDeviceSize frameBytes = static_cast<VkDeviceSize>(m_Extent.width) * m_Extent.height * 4;
+
+    m_Slots.resize(m_RingSize);
+    m_Images.resize(m_RingSize, VK_NULL_HANDLE);
+    m_ImageViews.reserve(m_RingSize);
+    for (uint32_t i = 0; i < m_RingSize; ++i) {
+        Slot& slot = m_Slots[i];
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { m_Extent.width, m_Extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = m_Format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        if (vkCreateImage(m_Device, &imageInfo, nullptr, &m_Images[i]) != VK_SUCCESS) return false;
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(m_Device, m_Images[i], &memRequirements);
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = renderer.FindMemoryType(memRequirements.memoryTypeBits,
+                                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &slot.imageMemory) != VK_SUCCESS) return false;
+        vkBindImageMemory(m_Device, m_Images[i], slot.imageMemory, 0);
+
+        VkImageView view = renderer.CreateImageView(m_Images[i], m_Format);
+        if (view == VK_NULL_HANDLE) return false;
+        m_ImageViews.push_back(view);
+
+        // Mapped for the presenter's lifetime; coherent, so a completed
+        // frame can be copied out without an invalidate.
+        renderer.CreateBuffer(frameBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                              slot.readback, slot.readbackMemory);
+        if (slot.readbackMemory == VK_NULL_HANDLE) return false;
+        void* mapped = nullptr;
+        if (vkMapMemory(m_Device, slot.readbackMemory, 0, frameBytes, 0, &mapped) != VK_SUCCESS) return false;
+        slot.mapped = static_cast<const uint8_t*>(mapped);
+    }
+    m_NextSlot = 0;
+    m_CompletedSlot = -1;
+    MetricsRegistry::Get().SetGauge("offscreen.readback_bytes", static_cast<double>(frameBytes * m_RingSize));
+    return true;
+}
+
+void OffscreenPresenter::Destroy(VulkanRenderer&) {
+    if (m_Device == VK_NULL_HANDLE) return;
+    for (VkImageView view : m_ImageViews) {
+        vkDestroyImageView(m_Device, view, nullptr);
+    }
+    for (VkImage image : m_Images) {
+        vkDestroyImage(m_Device, image, nullptr);
+    }
+    for (Slot& slot : m_Slots) {
+        if (slot.mapped) vkUnmapMemory(m_Device, slot.readbackMemory);
+        vkDestroyBuffer(m_Device, slot.readback, nullptr);
+        vkFreeMemory(m_Device, slot.readbackMemory, nullptr);
+        vkFreeMemory(m_Device, slot.imageMemory, nullptr);
+    }
+    m_ImageViews.clear();
+    m_Images.clear();
+    m_Slots.clear();
+    m_CompletedSlot = -1;
+}
+
+bool OffscreenPresenter::Recreate(VulkanRenderer& renderer) {
+    Destroy(renderer);
+    return Create(renderer);
+}
+
+bool OffscreenPresenter::Acquire(VkSemaphore, uint32_t& imageIndex) {
+    if (m_Images.empty()) return false;
+    // The previous user of this slot has completed: EndFrame waits for
+    // every frame before returning.
+    imageIndex = m_NextSlot;
+    m_NextSlot = (m_NextSlot + 1) % m_RingSize;
+    return true;
+}
+
+void OffscreenPresenter::RecordAfterRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { m_Extent.width, m_Extent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, m_Images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           m_Slots[imageIndex].readback, 1, &region);
+
+    // Completion alone does not make the copy visible to the host.
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void OffscreenPresenter::OnFrameComplete(uint32_t imageIndex) {
+    m_CompletedSlot = static_cast<int>(imageIndex);
+    ++m_CompletedFrames;
+    MetricsRegistry::Get().AddCounter("offscreen.frames_read");
+}
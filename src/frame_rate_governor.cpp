@@ -0,0 +1,220 @@
+#include "../include/frame_rate_governor.h"
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+const char kSwitchPrefix[] = "panel-fps-";
+constexpr int kFrameRateLadder[] = { 1, 2, 5, 10, 15, 20, 30, 45, 60, 90, 120, 144 };
+// A panel painting at this fraction of its rate wants more frames.
+constexpr double kSaturatedFraction = 0.8;
+// Below this fraction it counts towards stepping down.
+constexpr double kIdleFraction = 0.4;
+
+int LadderAtLeast(double fps) {
+    for (int rung : kFrameRateLadder) {
+        if (rung >= fps) return rung;
+    }
+    return kFrameRateLadder[std::size(kFrameRateLadder) - 1];
+}
+
+bool ParseFps(const std::string& value, int& fps) {
+    try {
+        fps = std::clamp(std::stoi(value), 1, 240);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+}  // namespace
+
+void FrameRateGovernor::ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    if (!commandLine) return;
+    CefCommandLine::SwitchMap switches;
+    commandLine->GetSwitches(switches);
+
+    for (const auto& [key, rawValue] : switches) {
+        const std::string name = key.ToString();
+        const std::string value = rawValue.ToString();
+        bool valid = true;
+        if (name == "panel-fps-min") valid = ParseFps(value, m_DefaultLimits.minFps);
+        else if (name == "panel-fps-max") valid = ParseFps(value, m_DefaultLimits.maxFps);
+        else if (name == "panel-fps-focus") valid = ParseFps(value, m_FocusFps);
+        else continue;
+        if (!valid) std::cerr << "Ignoring invalid --" << name << " value" << std::endl;
+    }
+
+    // Per-class overrides are applied on top of the defaults above.
+    for (const auto& [key, rawValue] : switches) {
+        const std::string name = key.ToString();
+        if (name.rfind(kSwitchPrefix, 0) != 0) continue;
+        std::string panelClass = name.substr(sizeof(kSwitchPrefix) - 1);
+        const bool isMin = panelClass.size() > 4 && panelClass.compare(panelClass.size() - 4, 4, "-min") == 0;
+        const bool isMax = panelClass.size() > 4 && panelClass.compare(panelClass.size() - 4, 4, "-max") == 0;
+        if (!isMin && !isMax) continue;
+        panelClass.resize(panelClass.size() - 4);
+
+        FrameRateLimits& limits = m_ClassLimits.try_emplace(panelClass, m_DefaultLimits).first->second;
+        if (!ParseFps(rawValue.ToString(), isMin ? limits.minFps : limits.maxFps)) {
+            std::cerr << "Ignoring invalid --" << name << " value" << std::endl;
+        }
+    }
+
+    m_DefaultLimits.maxFps = std::max(m_DefaultLimits.minFps, m_DefaultLimits.maxFps);
+    for (auto& [panelClass, limits] : m_ClassLimits) {
+        limits.maxFps = std::max(limits.minFps, limits.maxFps);
+    }
+}
+
+bool FrameRateGovernor::EnabledFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    return !commandLine || !commandLine->HasSwitch("disable-frame-governor");
+}
+
+FrameRateLimits FrameRateGovernor::GetLimits(const std::string& panelClass) const {
+    auto it = m_ClassLimits.find(panelClass);
+    return it == m_ClassLimits.end() ? m_DefaultLimits : it->second;
+}
+
+void FrameRateGovernor::Attach(const std::string& label, const std::string& panelClass,
+                               CefRefPtr<CefClientImpl> client, int baselineFps) {
+    auto [it, inserted] = m_Panels.try_emplace(label);
+    Panel& panel = it->second;
+    panel.client = client;
+    panel.baselineFps = baselineFps;
+    panel.appliedBrowserId = 0;
+    panel.lastPaintCount = 0;
+    panel.stats.label = label;
+    panel.stats.panelClass = panelClass;
+    panel.stats.limits = GetLimits(panelClass);
+    if (inserted) panel.stats.frameRate = ClampToLimits(panel, baselineFps);
+}
+
+void FrameRateGovernor::Detach(const std::string& label) {
+    m_Panels.erase(label);
+}
+
+void FrameRateGovernor::SetFocused(const std::string& label, bool focused) {
+    auto it = m_Panels.find(label);
+    if (it == m_Panels.end() || it->second.stats.focused == focused) return;
+    Panel& panel = it->second;
+    panel.stats.focused = focused;
+    // Focus changes apply immediately; losing focus lets the next samples
+    // step the rate down as usual.
+    const int target = ClampToLimits(panel, panel.stats.frameRate);
+    if (target != panel.stats.frameRate) {
+        panel.stats.frameRate = target;
+        ++panel.stats.changes;
+    }
+    Apply(panel);
+}
+
+void FrameRateGovernor::Update() {
+    ZoneScoped;
+    const Clock::time_point now = Clock::now();
+    const std::chrono::duration<double> elapsed = now - m_LastSample;
+    const bool sample = elapsed.count() * 1000.0 >= m_SampleMs;
+    if (sample) m_LastSample = now;
+
+    double savedPaints = 0.0;
+    double savedFrames = 0.0;
+    for (auto& [label, panel] : m_Panels) {
+        if (sample) SamplePanel(panel, elapsed.count());
+        Apply(panel);
+        savedPaints += panel.stats.savedPaintsPerSecond;
+        savedFrames += panel.stats.savedFramesPerSecond;
+    }
+    if (sample) {
+        MetricsRegistry::Get().SetGauge("frame_governor.saved_paints_per_s", savedPaints);
+        MetricsRegistry::Get().SetGauge("frame_governor.saved_frames_per_s", savedFrames);
+    }
+}
+
+int FrameRateGovernor::GetFrameRate(const std::string& label) const {
+    auto it = m_Panels.find(label);
+    return it == m_Panels.end() ? 0 : it->second.stats.frameRate;
+}
+
+double FrameRateGovernor::GetSavedPaintsPerSecond() const {
+    double saved = 0.0;
+    for (const auto& [label, panel] : m_Panels) saved += panel.stats.savedPaintsPerSecond;
+    return saved;
+}
+
+std::vector<FrameRateStats> FrameRateGovernor::GetStats() const {
+    std::vector<FrameRateStats> stats;
+    stats.reserve(m_Panels.size());
+    for (const auto& [label, panel] : m_Panels) stats.push_back(panel.stats);
+    return stats;
+}
+
+void FrameRateGovernor::SamplePanel(Panel& panel, double seconds) {
+    CefRefPtr<CefRenderHandlerImpl> renderHandler = panel.client->GetRenderHandlerImpl();
+    if (!renderHandler || seconds <= 0.0) return;
+    const uint64_t paints = renderHandler->GetPaintCount();
+    // A recreated browser comes with a fresh render handler and count.
+    const uint64_t delta = paints >= panel.lastPaintCount ? paints - panel.lastPaintCount : paints;
+    panel.lastPaintCount = paints;
+
+    // Smoothed so a page painting once a second does not alternate between
+    // "idle" and "saturated" half-second samples.
+    const double instant = static_cast<double>(delta) / seconds;
+    panel.stats.paintFps = 0.5 * panel.stats.paintFps + 0.5 * instant;
+
+    const int current = panel.stats.frameRate;
+    const bool saturated = panel.stats.paintFps >= kSaturatedFraction * current;
+    int target = current;
+    if (saturated) {
+        panel.downStreak = 0;
+        target = LadderAtLeast(current * 2.0);
+    } else if (panel.stats.paintFps < kIdleFraction * current) {
+        if (++panel.downStreak >= m_DownHoldSamples) {
+            panel.downStreak = 0;
+            target = LadderAtLeast(std::max(1.0, panel.stats.paintFps * 1.5));
+        }
+    } else {
+        panel.downStreak = 0;
+    }
+
+    target = ClampToLimits(panel, target);
+    if (target != current) {
+        panel.stats.frameRate = target;
+        ++panel.stats.changes;
+    }
+
+    // Against the fixed creation-time rate. Below its cap a panel paints the
+    // same either way, so paints are only saved while it saturates a lower
+    // rate; begin-frame slots (compositor ticks, rAF callbacks) are saved
+    // whenever the rate is lower.
+    const int below = std::max(0, panel.baselineFps - panel.stats.frameRate);
+    panel.stats.savedPaintsPerSecond = saturated ? below : 0.0;
+    panel.stats.savedFramesPerSecond = below;
+
+    const std::string prefix = "frame_governor." + panel.stats.label + ".";
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.SetGauge(prefix + "fps", panel.stats.frameRate);
+    registry.SetGauge(prefix + "paint_fps", panel.stats.paintFps);
+}
+
+void FrameRateGovernor::Apply(Panel& panel) {
+    CefRefPtr<CefBrowser> browser = panel.client->GetBrowser();
+    if (!browser) return;
+    const int browserId = browser->GetIdentifier();
+    if (browserId == panel.appliedBrowserId && panel.stats.frameRate == panel.appliedFps) return;
+    browser->GetHost()->SetWindowlessFrameRate(panel.stats.frameRate);
+    panel.appliedBrowserId = browserId;
+    panel.appliedFps = panel.stats.frameRate;
+}
+
+int FrameRateGovernor::ClampToLimits(const Panel& panel, int fps) const {
+    int minFps = panel.stats.limits.minFps;
+    if (panel.stats.focused) minFps = std::max(minFps, m_FocusFps);
+    const int maxFps = panel.stats.limits.maxFps;
+    return std::clamp(fps, std::min(minFps, maxFps), maxFps);
+}
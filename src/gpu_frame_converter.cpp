@@ -0,0 +1,405 @@
+#include "../include/gpu_frame_converter.h"
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+const uint32_t kConvertShader[] =
+#include "frame_convert.comp.inc"
+;
+
+struct PushConstants {
+    int32_t offset[2];
+    int32_t size[2];
+    uint32_t compare;
+};
+}  // namespace
+
+bool GpuFrameConverter::Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily) {
+    m_PhysicalDevice = physicalDevice;
+    m_Device = device;
+    m_Queue = queue;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+    if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS ||
+        !CreatePipeline() || !CreateSlots()) {
+        std::cerr << "GPU frame conversion unavailable, converting on the CPU" << std::endl;
+        Cleanup();
+        return false;
+    }
+    return true;
+}
+
+void GpuFrameConverter::Cleanup() {
+    if (m_Device == VK_NULL_HANDLE) return;
+    for (Slot& slot : m_Slots) {
+        if (slot.pending) vkWaitForFences(m_Device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        vkDestroyFence(m_Device, slot.fence, nullptr);
+        DestroyBuffer(slot.pixelBuffer, slot.pixelMemory, slot.pixelCapacity);
+        DestroyBuffer(slot.maskBuffer, slot.maskMemory, slot.maskCapacity);
+    }
+    vkDestroyPipeline(m_Device, m_Pipeline, nullptr);
+    vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+    vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_Device, m_SetLayout, nullptr);
+    vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+    *this = GpuFrameConverter();
+}
+
+VkImage GpuFrameConverter::CreateImage(uint32_t width, uint32_t height, VkDeviceMemory& memory) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { width, height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkImage image = VK_NULL_HANDLE;
+    if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS) return VK_NULL_HANDLE;
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_Device, image, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        vkDestroyImage(m_Device, image, nullptr);
+        return VK_NULL_HANDLE;
+    }
+    vkBindImageMemory(m_Device, image, memory, 0);
+    return image;
+}
+
+void GpuFrameConverter::DestroyImage(VkImage image, VkDeviceMemory memory) {
+    if (image == VK_NULL_HANDLE) return;
+    // A conversion still in flight may write the image.
+    for (Slot& slot : m_Slots) {
+        if (slot.pending) {
+            vkWaitForFences(m_Device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+            Harvest(slot);
+        }
+    }
+    m_Initialized.erase(image);
+    vkDestroyImage(m_Device, image, nullptr);
+    vkFreeMemory(m_Device, memory, nullptr);
+}
+
+bool GpuFrameConverter::Convert(VkImage image, VkImageView view, uint32_t width, uint32_t height,
+                                const void* bgra, const VkRect2D& damage) {
+    ZoneScoped;
+    if (m_Pipeline == VK_NULL_HANDLE || image == VK_NULL_HANDLE || width == 0 || height == 0) return false;
+
+    Slot& slot = m_Slots[m_NextSlot];
+    m_NextSlot = (m_NextSlot + 1) % kSlots;
+    if (slot.pending) {
+        vkWaitForFences(m_Device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        Harvest(slot);
+    }
+
+    // Widen the damage to whole tiles so each workgroup is one image tile.
+    // An image without contents is converted whole.
+    const bool compare = m_Initialized.count(image) != 0;
+    uint32_t x0 = 0, y0 = 0, x1 = width, y1 = height;
+    if (compare) {
+        x0 = std::min<uint32_t>(std::max(damage.offset.x, 0), width);
+        y0 = std::min<uint32_t>(std::max(damage.offset.y, 0), height);
+        x1 = std::min<uint32_t>(x0 + damage.extent.width, width);
+        y1 = std::min<uint32_t>(y0 + damage.extent.height, height);
+        if (x1 <= x0 || y1 <= y0) return false;
+        x0 -= x0 % kTileSize;
+        y0 -= y0 % kTileSize;
+        x1 = std::min(width, (x1 + kTileSize - 1) / kTileSize * kTileSize);
+        y1 = std::min(height, (y1 + kTileSize - 1) / kTileSize * kTileSize);
+    }
+    const uint32_t regionWidth = x1 - x0, regionHeight = y1 - y0;
+
+    slot.tileX = x0 / kTileSize;
+    slot.tileY = y0 / kTileSize;
+    slot.tilesX = (regionWidth + kTileSize - 1) / kTileSize;
+    slot.tilesY = (regionHeight + kTileSize - 1) / kTileSize;
+    slot.imageTilesX = (width + kTileSize - 1) / kTileSize;
+
+    const VkDeviceSize pixelBytes = static_cast<VkDeviceSize>(regionWidth) * regionHeight * 4;
+    const VkDeviceSize maskBytes = static_cast<VkDeviceSize>(slot.tilesX) * slot.tilesY * sizeof(uint32_t);
+    void* mask = slot.mask;
+    if (!EnsureBuffer(pixelBytes, slot.pixelBuffer, slot.pixelMemory, &slot.pixels, slot.pixelCapacity) ||
+        !EnsureBuffer(maskBytes, slot.maskBuffer, slot.maskMemory, &mask, slot.maskCapacity)) {
+        return false;
+    }
+    slot.mask = static_cast<uint32_t*>(mask);
+
+    const uint8_t* source = static_cast<const uint8_t*>(bgra) + (static_cast<size_t>(y0) * width + x0) * 4;
+    const size_t rowBytes = static_cast<size_t>(regionWidth) * 4;
+    for (uint32_t row = 0; row < regionHeight; ++row) {
+        std::memcpy(static_cast<uint8_t*>(slot.pixels) + row * rowBytes, source + static_cast<size_t>(row) * width * 4, rowBytes);
+    }
+
+    VkDescriptorBufferInfo pixelInfo{ slot.pixelBuffer, 0, pixelBytes };
+    VkDescriptorImageInfo imageInfo{ VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL };
+    VkDescriptorBufferInfo maskInfo{ slot.maskBuffer, 0, maskBytes };
+    VkWriteDescriptorSet writes[3]{};
+    for (uint32_t i = 0; i < 3; ++i) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = slot.descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[0].pBufferInfo = &pixelInfo;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = &imageInfo;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[2].pBufferInfo = &maskInfo;
+    vkUpdateDescriptorSets(m_Device, 3, writes, 0, nullptr);
+
+    vkResetFences(m_Device, 1, &slot.fence);
+    vkResetCommandBuffer(slot.commandBuffer, 0);
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(slot.commandBuffer, &beginInfo);
+
+    // Plain vkCmdPipelineBarrier so the converter works on both render paths.
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    barrier.oldLayout = compare ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(slot.commandBuffer,
+                         compare ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    PushConstants push{};
+    push.offset[0] = static_cast<int32_t>(x0);
+    push.offset[1] = static_cast<int32_t>(y0);
+    push.size[0] = static_cast<int32_t>(regionWidth);
+    push.size[1] = static_cast<int32_t>(regionHeight);
+    push.compare = compare ? 1u : 0u;
+    vkCmdBindPipeline(slot.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+    vkCmdBindDescriptorSets(slot.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout,
+                            0, 1, &slot.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(slot.commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(slot.commandBuffer, slot.tilesX, slot.tilesY, 1);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    VkMemoryBarrier maskBarrier{};
+    maskBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    maskBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    maskBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &maskBarrier, 0, nullptr, 1, &barrier);
+    vkEndCommandBuffer(slot.commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &slot.commandBuffer;
+    if (vkQueueSubmit(m_Queue, 1, &submitInfo, slot.fence) != VK_SUCCESS) return false;
+
+    slot.pending = true;
+    slot.sequence = ++m_Sequence;
+    m_Initialized.insert(image);
+    MetricsRegistry::Get().AddCounter("gpu_convert.bytes", static_cast<double>(pixelBytes));
+    return true;
+}
+
+bool GpuFrameConverter::PollResult(FrameConversionResult& result, bool wait) {
+    for (Slot& slot : m_Slots) {
+        if (!slot.pending) continue;
+        if (wait) vkWaitForFences(m_Device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        Harvest(slot);
+    }
+    if (!m_HasLatest) return false;
+    result = std::move(m_Latest);
+    m_Latest = FrameConversionResult();
+    m_HasLatest = false;
+    return true;
+}
+
+void GpuFrameConverter::Harvest(Slot& slot) {
+    if (!slot.pending || vkGetFenceStatus(m_Device, slot.fence) != VK_SUCCESS) return;
+    slot.pending = false;
+
+    FrameConversionResult result;
+    result.sequence = slot.sequence;
+    result.tilesChecked = slot.tilesX * slot.tilesY;
+    for (uint32_t y = 0; y < slot.tilesY; ++y) {
+        for (uint32_t x = 0; x < slot.tilesX; ++x) {
+            if (slot.mask[y * slot.tilesX + x] != 0) {
+                result.changedTiles.push_back((slot.tileY + y) * slot.imageTilesX + slot.tileX + x);
+            }
+        }
+    }
+
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.AddCounter("gpu_convert.tiles_checked", result.tilesChecked);
+    registry.AddCounter("gpu_convert.tiles_changed", static_cast<double>(result.changedTiles.size()));
+    registry.SetGauge("gpu_convert.last_changed_tiles", static_cast<double>(result.changedTiles.size()));
+
+    if (!m_HasLatest || result.sequence > m_Latest.sequence) {
+        m_Latest = std::move(result);
+        m_HasLatest = true;
+    }
+}
+
+bool GpuFrameConverter::CreatePipeline() {
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    for (uint32_t i = 0; i < 3; ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = 3;
+    setLayoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(m_Device, &setLayoutInfo, nullptr, &m_SetLayout) != VK_SUCCESS) return false;
+
+    VkPushConstantRange pushRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants) };
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_SetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_Device, &layoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) return false;
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = sizeof(kConvertShader);
+    moduleInfo.pCode = kConvertShader;
+    VkShaderModule module = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(m_Device, &moduleInfo, nullptr, &module) != VK_SUCCESS) return false;
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_PipelineLayout;
+    const bool created =
+        vkCreateComputePipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline) == VK_SUCCESS;
+    vkDestroyShaderModule(m_Device, module, nullptr);
+    return created;
+}
+
+bool GpuFrameConverter::CreateSlots() {
+    const VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * kSlots },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, kSlots },
+    };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = kSlots;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) return false;
+
+    for (Slot& slot : m_Slots) {
+        VkDescriptorSetAllocateInfo setInfo{};
+        setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        setInfo.descriptorPool = m_DescriptorPool;
+        setInfo.descriptorSetCount = 1;
+        setInfo.pSetLayouts = &m_SetLayout;
+        if (vkAllocateDescriptorSets(m_Device, &setInfo, &slot.descriptorSet) != VK_SUCCESS) return false;
+
+        VkCommandBufferAllocateInfo commandInfo{};
+        commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandInfo.commandPool = m_CommandPool;
+        commandInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(m_Device, &commandInfo, &slot.commandBuffer) != VK_SUCCESS) return false;
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_Device, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS) return false;
+    }
+    return true;
+}
+
+bool GpuFrameConverter::EnsureBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory,
+                                     void** mapped, VkDeviceSize& capacity) {
+    if (size <= capacity) return true;
+    // Grow geometrically so a panel that keeps growing does not reallocate
+    // on every frame.
+    const VkDeviceSize allocation = std::max(size, capacity * 2);
+    DestroyBuffer(buffer, memory, capacity);
+    *mapped = nullptr;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = allocation;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_Device, buffer, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        vkDestroyBuffer(m_Device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return false;
+    }
+    vkBindBufferMemory(m_Device, buffer, memory, 0);
+    if (vkMapMemory(m_Device, memory, 0, allocation, 0, mapped) != VK_SUCCESS) {
+        DestroyBuffer(buffer, memory, capacity);
+        return false;
+    }
+    capacity = allocation;
+    return true;
+}
+
+void GpuFrameConverter::DestroyBuffer(VkBuffer& buffer, VkDeviceMemory& memory, VkDeviceSize& capacity) {
+    // Freeing mapped memory implicitly unmaps it.
+    vkDestroyBuffer(m_Device, buffer, nullptr);
+    vkFreeMemory(m_Device, memory, nullptr);
+    buffer = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+    capacity = 0;
+}
+
+uint32_t GpuFrameConverter::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProperties);
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include "../include/gpu_readback.h"
+#include "../include/vulkan_renderer.h"
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+// Buffers are allocated in whole MiB so nearby sizes share them.
+constexpr VkDeviceSize kBufferGranularity = 1 << 20;
+
+bool IsFourBytesPerPixel(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+}  // namespace
+
+bool ReadbackPool::Initialize(VulkanRenderer& renderer) {
+    m_Renderer = &renderer;
+    m_Device = renderer.GetDevice();
+    vkGetPhysicalDeviceMemoryProperties(renderer.GetPhysicalDevice(), &m_MemoryProperties);
+    return m_Device != VK_NULL_HANDLE;
+}
+
+void ReadbackPool::Cleanup() {
+    if (m_Device == VK_NULL_HANDLE) return;
+    Resolve(UINT64_MAX);
+    for (Pending& pending : m_Queued) {
+        pending.promise.set_value(ReadbackResult{});
+    }
+    m_Queued.clear();
+    for (Buffer& buffer : m_Free) DestroyBuffer(buffer);
+    m_Free.clear();
+    PublishPoolMetrics();
+    m_Device = VK_NULL_HANDLE;
+}
+
+std::future<ReadbackResult> ReadbackPool::Request(VkImage image, VkImageLayout layout, VkFormat format,
+                                                  const VkRect2D& region) {
+    Pending pending;
+    pending.image = image;
+    pending.layout = layout;
+    pending.format = format;
+    pending.region = region;
+    pending.requested = std::chrono::steady_clock::now();
+    std::future<ReadbackResult> future = pending.promise.get_future();
+    if (image == VK_NULL_HANDLE || !IsFourBytesPerPixel(format) || region.extent.width == 0 ||
+        region.extent.height == 0) {
+        pending.promise.set_value(ReadbackResult{});
+        return future;
+    }
+    m_Queued.push_back(std::move(pending));
+    return future;
+}
+
+void ReadbackPool::Record(VkCommandBuffer commandBuffer, uint64_t frame) {
+    if (m_Queued.empty()) return;
+    ZoneScoped;
+    bool recorded = false;
+    for (Pending& pending : m_Queued) {
+        const VkDeviceSize bytes = static_cast<VkDeviceSize>(pending.region.extent.width) * pending.region.extent.height * 4;
+        if (!AcquireBuffer(bytes, pending.buffer)) {
+            pending.promise.set_value(ReadbackResult{});
+            continue;
+        }
+        if (pending.layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+            m_Renderer->RecordImageBarrier(commandBuffer, pending.image, pending.layout,
+                                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        }
+        VkBufferImageCopy copy{};
+        copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.imageSubresource.mipLevel = 0;
+        copy.imageSubresource.baseArrayLayer = 0;
+        copy.imageSubresource.layerCount = 1;
+        copy.imageOffset = { pending.region.offset.x, pending.region.offset.y, 0 };
+        copy.imageExtent = { pending.region.extent.width, pending.region.extent.height, 1 };
+        vkCmdCopyImageToBuffer(commandBuffer, pending.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               pending.buffer.buffer, 1, &copy);
+        if (pending.layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+            m_Renderer->RecordImageBarrier(commandBuffer, pending.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                           pending.layout);
+        }
+        pending.frame = frame;
+        m_InFlight.push_back(std::move(pending));
+        recorded = true;
+    }
+    m_Queued.clear();
+
+    if (recorded) {
+        // Completion alone does not make the copies visible to the host.
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    MetricsRegistry::Get().SetGauge("readback.in_flight", static_cast<double>(m_InFlight.size()));
+}
+
+void ReadbackPool::Resolve(uint64_t completedFrame) {
+    if (m_InFlight.empty()) return;
+    ZoneScoped;
+    auto done = std::stable_partition(m_InFlight.begin(), m_InFlight.end(),
+                                      [&](const Pending& pending) { return pending.frame > completedFrame; });
+    for (auto it = done; it != m_InFlight.end(); ++it) {
+        Pending& pending = *it;
+        if (!pending.buffer.coherent) {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = pending.buffer.memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+        }
+        ReadbackResult result;
+        result.ok = true;
+        result.width = pending.region.extent.width;
+        result.height = pending.region.extent.height;
+        result.format = pending.format;
+        const size_t bytes = static_cast<size_t>(result.width) * result.height * 4;
+        result.pixels.assign(pending.buffer.mapped, pending.buffer.mapped + bytes);
+        pending.promise.set_value(std::move(result));
+
+        RecycleBuffer(pending.buffer);
+        MetricsRegistry::Get().AddCounter("readback.bytes", static_cast<double>(bytes));
+        MetricsRegistry::Get().RecordHistogram(
+            "readback.latency_ms",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.requested).count());
+    }
+    m_InFlight.erase(done, m_InFlight.end());
+    MetricsRegistry::Get().SetGauge("readback.in_flight", static_cast<double>(m_InFlight.size()));
+}
+
+bool ReadbackPool::AcquireBuffer(VkDeviceSize size, Buffer& buffer) {
+    // Smallest free buffer that fits.
+    auto best = m_Free.end();
+    for (auto it = m_Free.begin(); it != m_Free.end(); ++it) {
+        if (it->size >= size && (best == m_Free.end() || it->size < best->size)) best = it;
+    }
+    if (best != m_Free.end()) {
+        buffer = *best;
+        m_Free.erase(best);
+        return true;
+    }
+
+    const VkDeviceSize allocation = (size + kBufferGranularity - 1) / kBufferGranularity * kBufferGranularity;
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = allocation;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    Buffer created;
+    created.size = allocation;
+    if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &created.buffer) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_Device, created.buffer, &requirements);
+    // Host-cached first; host-coherent (often write-combined) as a fallback.
+    const VkMemoryPropertyFlags preferences[] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+    uint32_t memoryType = UINT32_MAX;
+    for (VkMemoryPropertyFlags wanted : preferences) {
+        for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount && memoryType == UINT32_MAX; ++i) {
+            if ((requirements.memoryTypeBits & (1u << i)) &&
+                (m_MemoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted) {
+                memoryType = i;
+            }
+        }
+        if (memoryType != UINT32_MAX) break;
+    }
+    if (memoryType == UINT32_MAX) {
+        vkDestroyBuffer(m_Device, created.buffer, nullptr);
+        return false;
+    }
+    created.coherent = (m_MemoryProperties.memoryTypes[memoryType].propertyFlags &
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryType;
+    void* mapped = nullptr;
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &created.memory) != VK_SUCCESS ||
+        vkBindBufferMemory(m_Device, created.buffer, created.memory, 0) != VK_SUCCESS ||
+        vkMapMemory(m_Device, created.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        DestroyBuffer(created);
+        return false;
+    }
+    created.mapped = static_cast<uint8_t*>(mapped);
+    ++m_LiveBuffers;
+    m_LiveBytes += created.size;
+    PublishPoolMetrics();
+    buffer = created;
+    return true;
+}
+
+void ReadbackPool::RecycleBuffer(Buffer buffer) {
+    m_Free.push_back(buffer);
+    if (m_Free.size() > kMaxFreeBuffers) {
+        auto smallest = std::min_element(m_Free.begin(), m_Free.end(),
+                                         [](const Buffer& a, const Buffer& b) { return a.size < b.size; });
+        Buffer evicted = *smallest;
+        m_Free.erase(smallest);
+        --m_LiveBuffers;
+        m_LiveBytes -= evicted.size;
+        DestroyBuffer(evicted);
+        PublishPoolMetrics();
+    }
+}
+
+void ReadbackPool::DestroyBuffer(Buffer& buffer) {
+    if (buffer.mapped) vkUnmapMemory(m_Device, buffer.memory);
+    if (buffer.buffer != VK_NULL_HANDLE) vkDestroyBuffer(m_Device, buffer.buffer, nullptr);
+    if (buffer.memory != VK_NULL_HANDLE) vkFreeMemory(m_Device, buffer.memory, nullptr);
+    buffer = Buffer{};
+}
+
+void ReadbackPool::PublishPoolMetrics() {
+    MetricsRegistry::Get().SetGauge("readback.pool_buffers", static_cast<double>(m_LiveBuffers));
+    MetricsRegistry::Get().SetGauge("readback.pool_mb", static_cast<double>(m_LiveBytes) / (1024.0 * 1024.0));
+}
@@ -0,0 +1,77 @@
+#include "../include/idle_scheduler.h"
+#include "../include/metrics_registry.h"
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+IdleScheduler& IdleScheduler::Get() {
+    static IdleScheduler scheduler;
+    return scheduler;
+}
+
+int64_t IdleScheduler::Now() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void IdleScheduler::SetWakeCallback(std::function<void()> wake) {
+    std::lock_guard<std::mutex> lock(m_WakeMutex);
+    m_Wake = std::move(wake);
+}
+
+void IdleScheduler::Wake() {
+    std::lock_guard<std::mutex> lock(m_WakeMutex);
+    if (m_Wake) m_Wake();
+}
+
+void IdleScheduler::RequestFrame() {
+    // Paints arrive at the page's frame rate; one wake per drawn frame is
+    // enough.
+    if (!m_FrameRequested.exchange(true) && m_Enabled) Wake();
+}
+
+void IdleScheduler::SchedulePumpWork(int64_t delayMs) {
+    const int64_t deadline = Now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                         std::chrono::milliseconds(std::max<int64_t>(0, delayMs))).count();
+    int64_t current = m_PumpDeadline.load();
+    while (deadline < current && !m_PumpDeadline.compare_exchange_weak(current, deadline)) {
+    }
+    // A sleeping loop only needs waking when the work is due before it
+    // would wake anyway.
+    if (m_Enabled && deadline < m_SleepUntil.load()) Wake();
+}
+
+double IdleScheduler::GetWaitSeconds(bool busy) {
+    if (!m_Enabled || busy || m_SettleFrames > 0 || m_FrameRequested) return 0.0;
+    const int64_t now = Now();
+    const int64_t maxWait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(kMaxWaitSeconds)).count();
+    const int64_t deadline = m_PumpDeadline.load();
+    const int64_t wait = deadline == kNoDeadline ? maxWait : std::clamp<int64_t>(deadline - now, 0, maxWait);
+    m_SleepUntil = now + wait;
+    return std::chrono::duration<double>(std::chrono::steady_clock::duration(wait)).count();
+}
+
+void IdleScheduler::OnPumpWork() {
+    int64_t deadline = m_PumpDeadline.load();
+    const int64_t now = Now();
+    m_SleepUntil = 0;
+    while (deadline <= now && !m_PumpDeadline.compare_exchange_weak(deadline, kNoDeadline)) {
+    }
+}
+
+bool IdleScheduler::ShouldRender(bool activity) {
+    if (!m_Enabled) return true;
+    if (m_FrameRequested.exchange(false) || activity) m_SettleFrames = kSettleFrames;
+    if (m_SettleFrames > 0) return true;
+    ++m_Skipped;
+    MetricsRegistry::Get().AddCounter("idle.skipped_iterations");
+    return false;
+}
+
+void IdleScheduler::OnFrameRendered() {
+    if (m_SettleFrames > 0) --m_SettleFrames;
+}
@@ -0,0 +1,62 @@
+#include "../include/image_compare.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+// Squared YIQ distance between black and white, with the weights below.
+constexpr double kMaxYiqDelta = 35215.0;
+
+double Blend(uint8_t channel, double alpha) {
+    return 255.0 + (channel - 255.0) * alpha;
+}
+}  // namespace
+
+double PixelDelta(const uint8_t* a, const uint8_t* b) {
+    if (a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3]) return 0.0;
+    const double alphaA = a[3] / 255.0, alphaB = b[3] / 255.0;
+    const double r1 = Blend(a[0], alphaA), g1 = Blend(a[1], alphaA), b1 = Blend(a[2], alphaA);
+    const double r2 = Blend(b[0], alphaB), g2 = Blend(b[1], alphaB), b2 = Blend(b[2], alphaB);
+    const double y = (r1 - r2) * 0.29889531 + (g1 - g2) * 0.58662247 + (b1 - b2) * 0.11448223;
+    const double i = (r1 - r2) * 0.59597799 - (g1 - g2) * 0.27417610 - (b1 - b2) * 0.32180189;
+    const double q = (r1 - r2) * 0.21147017 - (g1 - g2) * 0.52261711 + (b1 - b2) * 0.31114694;
+    return (0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q) / kMaxYiqDelta;
+}
+
+ImageDiffResult CompareImages(const uint8_t* expected, const uint8_t* actual, uint32_t width, uint32_t height,
+                              const ImageDiffOptions& options, bool wantDiff) {
+    ZoneScoped;
+    ImageDiffResult result;
+    const size_t pixels = static_cast<size_t>(width) * height;
+    if (wantDiff) result.diff.resize(pixels * 4);
+    // The delta is squared, so compare against the squared threshold.
+    const double limit = options.threshold * options.threshold;
+    for (size_t p = 0; p < pixels; ++p) {
+        const uint8_t* a = expected + p * 4;
+        const uint8_t* b = actual + p * 4;
+        const double delta = PixelDelta(a, b);
+        result.maxDelta = std::max(result.maxDelta, std::sqrt(delta));
+        const bool differs = delta > limit;
+        if (differs) ++result.differentPixels;
+        if (!wantDiff) continue;
+        uint8_t* out = result.diff.data() + p * 4;
+        if (differs) {
+            out[0] = 255;
+            out[1] = 0;
+            out[2] = 0;
+        } else {
+            const double luma = Blend(a[0], a[3] / 255.0) * 0.29889531 + Blend(a[1], a[3] / 255.0) * 0.58662247 +
+                                Blend(a[2], a[3] / 255.0) * 0.11448223;
+            const uint8_t faded = static_cast<uint8_t>(std::lround(255.0 + (luma - 255.0) * 0.1));
+            out[0] = out[1] = out[2] = faded;
+        }
+        out[3] = 255;
+    }
+    result.matches = pixels == 0 || static_cast<double>(result.differentPixels) <= options.maxDiffRatio * pixels;
+    return result;
+}
@@ -1,6 +1,436 @@
-// Simple placeholder file for now - functionality is in main_simple.cpp
-#include <iostream>
+#include "../include/imgui_layer.h"
+#include "../include/metrics_registry.h"
+#include "imgui.h"
+#include "imgui_internal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 
-void placeholder() {
-    std::cout << "ImGui layer placeholder" << std::endl;
-}
\ No newline at end of file
+namespace {
+void MegabytesCell(int64_t bytes) {
+    if (bytes >= 0) {
+        ImGui::Text("%.1f", bytes / (1024.0 * 1024.0));
+    } else {
+        ImGui::TextDisabled("n/a");
+    }
+}
+
+void DrawSamples(const char* id, const std::vector<MetricsRegistry::Sample>& samples) {
+    if (samples.empty()) return;
+    if (ImGui::BeginTable(id, 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn("Metric");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableHeadersRow();
+        for (const auto& sample : samples) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(sample.name.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.2f", sample.value);
+        }
+        ImGui::EndTable();
+    }
+}
+
+// Layer orders per window: background, view, popup.
+constexpr int kLayersPerWindow = 3;
+
+// ImGui screen coordinates to framebuffer pixels.
+ImVec2 ToFramebuffer(const ImVec2& point) {
+    const ImGuiIO& io = ImGui::GetIO();
+    const ImVec2 origin = ImGui::GetMainViewport()->Pos;
+    return ImVec2((point.x - origin.x) * io.DisplayFramebufferScale.x,
+                  (point.y - origin.y) * io.DisplayFramebufferScale.y);
+}
+
+CompositorLayer MakeLayer(uint32_t texture, CompositorLayerKind kind, int slot,
+                          const ImVec2& min, const ImVec2& max, const ImVec2& clipMin, const ImVec2& clipMax) {
+    CompositorLayer layer;
+    layer.texture = texture;
+    layer.kind = kind;
+    layer.order = ImGui::FindWindowDisplayIndex(ImGui::GetCurrentWindowRead()) * kLayersPerWindow + slot;
+    const ImVec2 p0 = ToFramebuffer(min), p1 = ToFramebuffer(max);
+    const ImVec2 c0 = ToFramebuffer(clipMin), c1 = ToFramebuffer(clipMax);
+    layer.x = p0.x;
+    layer.y = p0.y;
+    layer.width = p1.x - p0.x;
+    layer.height = p1.y - p0.y;
+    layer.clipMinX = c0.x;
+    layer.clipMinY = c0.y;
+    layer.clipMaxX = c1.x;
+    layer.clipMaxY = c1.y;
+    return layer;
+}
+
+void DrawHistograms(const std::vector<MetricsRegistry::HistogramSample>& histograms) {
+    if (histograms.empty()) return;
+    if (ImGui::BeginTable("metrics_histograms", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn("Histogram");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("Mean");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("Max");
+        ImGui::TableHeadersRow();
+        for (const auto& sample : histograms) {
+            const MetricsRegistry::Histogram& h = sample.histogram;
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(sample.name.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%llu", static_cast<unsigned long long>(h.count));
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.2f", h.Mean());
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.2f", h.Percentile(0.95));
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.2f", h.max);
+        }
+        ImGui::EndTable();
+    }
+}
+}  // namespace
+
+namespace ImGuiLayer {
+
+void DrawResourceTable(const std::vector<BrowserResourceUsage>& usage) {
+    if (usage.empty()) {
+        ImGui::TextDisabled("No renderer processes sampled yet");
+        return;
+    }
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("renderer_processes", 6, flags)) {
+        ImGui::TableSetupColumn("Panel");
+        ImGui::TableSetupColumn("Task");
+        ImGui::TableSetupColumn("CPU %");
+        ImGui::TableSetupColumn("Memory MB");
+        ImGui::TableSetupColumn("GPU MB");
+        ImGui::TableSetupColumn("Over limit");
+        ImGui::TableHeadersRow();
+        for (const auto& row : usage) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(row.label.c_str());
+            ImGui::TableSetColumnIndex(1);
+            if (row.taskId >= 0) {
+                ImGui::Text("%lld", static_cast<long long>(row.taskId));
+            } else {
+                ImGui::TextDisabled("none");
+            }
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", row.cpuPercent);
+            ImGui::TableSetColumnIndex(3);
+            MegabytesCell(row.memoryBytes);
+            ImGui::TableSetColumnIndex(4);
+            MegabytesCell(row.gpuMemoryBytes);
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%d", row.overLimitSamples);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawPagePerfTable(const std::vector<PagePerfSnapshot>& pages) {
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("page_performance", 9, flags)) {
+        ImGui::TableSetupColumn("Panel");
+        ImGui::TableSetupColumn("JS heap MB");
+        ImGui::TableSetupColumn("Layouts/s");
+        ImGui::TableSetupColumn("Layout ms/s");
+        ImGui::TableSetupColumn("Style ms/s");
+        ImGui::TableSetupColumn("Script ms/s");
+        ImGui::TableSetupColumn("Long tasks");
+        ImGui::TableSetupColumn("Long p95 ms");
+        ImGui::TableSetupColumn("CLS");
+        ImGui::TableHeadersRow();
+        for (const auto& page : pages) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(page.label.c_str());
+            if (!page.attached) {
+                ImGui::TableSetColumnIndex(1);
+                ImGui::TextDisabled("not attached");
+                continue;
+            }
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.1f / %.1f", page.jsHeapUsedMb, page.jsHeapTotalMb);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", page.layoutsPerSecond);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.2f", page.layoutMsPerSecond);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.2f", page.styleMsPerSecond);
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%.2f", page.scriptMsPerSecond);
+            ImGui::TableSetColumnIndex(6);
+            ImGui::Text("%llu", static_cast<unsigned long long>(page.longTasks));
+            ImGui::TableSetColumnIndex(7);
+            ImGui::Text("%.1f", page.longTaskP95Ms);
+            ImGui::TableSetColumnIndex(8);
+            ImGui::Text("%.3f", page.layoutShiftScore);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawRequestContextTable(const std::vector<RequestContextStats>& contexts) {
+    if (contexts.empty()) {
+        ImGui::TextDisabled("No request contexts created yet");
+        return;
+    }
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("request_contexts", 7, flags)) {
+        ImGui::TableSetupColumn("Class");
+        ImGui::TableSetupColumn("Cache");
+        ImGui::TableSetupColumn("Responses");
+        ImGui::TableSetupColumn("Hit %");
+        ImGui::TableSetupColumn("Disk MB");
+        ImGui::TableSetupColumn("Written MB");
+        ImGui::TableSetupColumn("Cap MB");
+        ImGui::TableHeadersRow();
+        for (const auto& row : contexts) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(row.panelClass.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextUnformatted(row.cachePath.c_str());
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", row.cachePath.c_str());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%llu", static_cast<unsigned long long>(row.responses));
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.1f", row.hitRate * 100.0);
+            ImGui::TableSetColumnIndex(4);
+            MegabytesCell(row.mode == PanelCacheMode::Memory ? -1 : static_cast<int64_t>(row.diskBytes));
+            ImGui::TableSetColumnIndex(5);
+            MegabytesCell(row.mode == PanelCacheMode::Memory ? -1 : static_cast<int64_t>(row.diskBytesWritten));
+            ImGui::TableSetColumnIndex(6);
+            MegabytesCell(row.capBytes > 0 ? static_cast<int64_t>(row.capBytes) : -1);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawFrameRateTable(const std::vector<FrameRateStats>& panels) {
+    if (panels.empty()) {
+        ImGui::TextDisabled("No governed panels");
+        return;
+    }
+
+    double savedPaints = 0.0;
+    double savedFrames = 0.0;
+    for (const auto& row : panels) {
+        savedPaints += row.savedPaintsPerSecond;
+        savedFrames += row.savedFramesPerSecond;
+    }
+    ImGui::Text("Saved: %.0f paints/s, %.0f begin frames/s", savedPaints, savedFrames);
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("frame_rate_governor", 6, flags)) {
+        ImGui::TableSetupColumn("Panel");
+        ImGui::TableSetupColumn("Rate");
+        ImGui::TableSetupColumn("Paint FPS");
+        ImGui::TableSetupColumn("Limits");
+        ImGui::TableSetupColumn("Changes");
+        ImGui::TableSetupColumn("Saved paints/s");
+        ImGui::TableHeadersRow();
+        for (const auto& row : panels) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s%s", row.label.c_str(), row.focused ? " (focused)" : "");
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%d Hz", row.frameRate);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", row.paintFps);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%d-%d", row.limits.minFps, row.limits.maxFps);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%llu", static_cast<unsigned long long>(row.changes));
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%.0f", row.savedPaintsPerSecond);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawWatchdogTable(const std::vector<RendererWatchdogStats>& renderers) {
+    if (renderers.empty()) {
+        ImGui::TextDisabled("No watched renderers");
+        return;
+    }
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("renderer_watchdog", 7, flags)) {
+        ImGui::TableSetupColumn("Panel");
+        ImGui::TableSetupColumn("State");
+        ImGui::TableSetupColumn("Idle ms");
+        ImGui::TableSetupColumn("Pings / pongs");
+        ImGui::TableSetupColumn("Crashes");
+        ImGui::TableSetupColumn("Hangs");
+        ImGui::TableSetupColumn("Last recover ms");
+        ImGui::TableHeadersRow();
+        for (const auto& row : renderers) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(row.label.c_str());
+            ImGui::TableSetColumnIndex(1);
+            if (row.recovering) {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "recovering (%s, attempt %d)", row.lastReason.c_str(), row.recoveryAttempts);
+            } else if (row.recoveryFailed) {
+                ImGui::TextColored(ImVec4(1.0f, 0.2f, 0.2f, 1.0f), "failed (%s)", row.lastReason.c_str());
+            } else if (row.pingOutstanding) {
+                ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "pinging");
+            } else {
+                ImGui::TextUnformatted("alive");
+            }
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.0f", row.idleMs);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%llu / %llu", static_cast<unsigned long long>(row.pings), static_cast<unsigned long long>(row.pongs));
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%llu", static_cast<unsigned long long>(row.crashes));
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%llu", static_cast<unsigned long long>(row.hangs));
+            ImGui::TableSetColumnIndex(6);
+            if (row.lastRecoverMs >= 0.0) {
+                ImGui::Text("%.0f", row.lastRecoverMs);
+            } else {
+                ImGui::TextDisabled("n/a");
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawPageLoadTable(const std::vector<PageLoadUrlStats>& urls) {
+    if (urls.empty()) {
+        ImGui::TextDisabled("No page loads recorded yet");
+        return;
+    }
+
+    auto durationCell = [](const MetricsRegistry::Histogram& histogram, double fraction) {
+        if (histogram.count > 0) {
+            ImGui::Text("%.0f", histogram.Percentile(fraction));
+        } else {
+            ImGui::TextDisabled("n/a");
+        }
+    };
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("page_loads", 7, flags)) {
+        ImGui::TableSetupColumn("URL");
+        ImGui::TableSetupColumn("Loads");
+        ImGui::TableSetupColumn("Errors");
+        ImGui::TableSetupColumn("Status");
+        ImGui::TableSetupColumn("Load p50 ms");
+        ImGui::TableSetupColumn("Load p95 ms");
+        ImGui::TableSetupColumn("Present p95 ms");
+        ImGui::TableHeadersRow();
+        for (const auto& row : urls) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(row.url.c_str());
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", row.url.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%llu", static_cast<unsigned long long>(row.loads));
+            ImGui::TableSetColumnIndex(2);
+            if (row.errors > 0) {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%llu", static_cast<unsigned long long>(row.errors));
+            } else {
+                ImGui::TextUnformatted("0");
+            }
+            ImGui::TableSetColumnIndex(3);
+            if (row.lastStatus != 0) {
+                ImGui::Text("%d", row.lastStatus);
+            } else {
+                ImGui::TextDisabled("n/a");
+            }
+            ImGui::TableSetColumnIndex(4);
+            durationCell(row.loadEndMs, 0.5);
+            ImGui::TableSetColumnIndex(5);
+            durationCell(row.loadEndMs, 0.95);
+            ImGui::TableSetColumnIndex(6);
+            durationCell(row.firstPresentMs, 0.95);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void DrawAudioMeters(const std::vector<AudioMeterSnapshot>& meters) {
+    if (meters.empty()) {
+        ImGui::TextDisabled("No audio streams");
+        return;
+    }
+
+    // Bars span -60 dBFS to 0 dBFS; the bar shows RMS and the label the peak.
+    auto toFraction = [](float value) {
+        if (value <= 0.0f) return 0.0f;
+        return std::clamp((20.0f * std::log10(value) + 60.0f) / 60.0f, 0.0f, 1.0f);
+    };
+    for (const auto& meter : meters) {
+        char overlay[64];
+        if (meter.peak > 0.0f) {
+            std::snprintf(overlay, sizeof(overlay), "peak %.1f dB", 20.0f * std::log10(meter.peak));
+        } else {
+            std::snprintf(overlay, sizeof(overlay), "%s", meter.active ? "silent" : "idle");
+        }
+        ImGui::TextUnformatted(meter.label.c_str());
+        ImGui::SameLine(140.0f);
+        ImGui::ProgressBar(toFraction(meter.rms), ImVec2(-1.0f, 0.0f), overlay);
+        if ((meter.overruns > 0 || meter.underruns > 0) && ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("overruns %llu, underruns %llu",
+                              static_cast<unsigned long long>(meter.overruns),
+                              static_cast<unsigned long long>(meter.underruns));
+        }
+    }
+}
+
+void DrawMetricsTable() {
+    const MetricsRegistry& metrics = MetricsRegistry::Get();
+    DrawSamples("metrics_gauges", metrics.GetGauges());
+    DrawSamples("metrics_counters", metrics.GetCounters());
+    DrawHistograms(metrics.GetHistograms());
+}
+
+void DrawCompositorStats(const CompositorStats& stats) {
+    ImGui::Text("Layers: %u  textures: %u", stats.layers, stats.textures);
+    ImGui::Text("Per frame: %u pipeline bind, %u descriptor bind, %u draw%s",
+                stats.pipelineBinds, stats.descriptorBinds, stats.drawCalls, stats.drawCalls == 1 ? "" : "s");
+    ImGui::TextDisabled(stats.descriptorIndexing ? "Descriptor indexing: one instanced draw"
+                                                 : "No descriptor indexing: one draw per layer");
+}
+
+void CompositeImage(LayerCompositor& compositor, uint32_t texture, float width, float height) {
+    const ImVec2 windowMin = ImGui::GetWindowPos();
+    const ImVec2 windowMax(windowMin.x + ImGui::GetWindowWidth(), windowMin.y + ImGui::GetWindowHeight());
+    CompositorLayer background = MakeLayer(LayerCompositor::kSolidTexture, CompositorLayerKind::Background, 0,
+                                           windowMin, windowMax, windowMin, windowMax);
+    const ImVec4 color = ImGui::GetStyleColorVec4(ImGuiCol_WindowBg);
+    background.tint[0] = color.x;
+    background.tint[1] = color.y;
+    background.tint[2] = color.z;
+    background.tint[3] = color.w;
+    compositor.Submit(background);
+
+    const ImVec2 min = ImGui::GetCursorScreenPos();
+    const ImVec2 max(min.x + width, min.y + height);
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    compositor.Submit(MakeLayer(texture, CompositorLayerKind::View, 1, min, max,
+                                drawList->GetClipRectMin(), drawList->GetClipRectMax()));
+    ImGui::Dummy(ImVec2(width, height));
+}
+
+void CompositePopup(LayerCompositor& compositor, uint32_t texture, float x, float y, float width, float height) {
+    const ImVec2 min(x, y);
+    const ImVec2 max(x + width, y + height);
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    compositor.Submit(MakeLayer(texture, CompositorLayerKind::Popup, 2, min, max,
+                                drawList->GetClipRectMin(), drawList->GetClipRectMax()));
+}
+
+bool HasQueuedInput() {
+    ImGuiContext* context = ImGui::GetCurrentContext();
+    return context && context->InputEventsQueue.Size > 0;
+}
+
+}  // namespace ImGuiLayer
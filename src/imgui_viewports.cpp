@@ -0,0 +1,405 @@
+#include "../include/imgui_viewports.h"
+#include "../include/vulkan_renderer.h"
+#include "imgui.h"
+#include "imgui_impl_vulkan.h"
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+#ifdef IMGUI_HAS_VIEWPORT
+namespace {
+const uint32_t kVertexShader[] =
+#include "imgui_viewport.vert.inc"
+;
+const uint32_t kFragmentShader[] =
+#include "imgui_viewport.frag.inc"
+;
+
+struct PushConstants {
+    float scale[2];
+    float translate[2];
+};
+
+// Host-visible, coherent and persistently mapped.
+struct HostBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;
+};
+
+// A platform window: the renderer's target and the vertex and index buffers
+// its draw data is copied into. The buffers are rewritten every frame, which
+// is safe because FinishWindowFrames waits for the window's previous frame.
+struct ViewportWindow {
+    VulkanRenderer::WindowTarget* target = nullptr;
+    HostBuffer vertices;
+    HostBuffer indices;
+};
+
+VulkanRenderer* g_Renderer = nullptr;
+VkDescriptorSetLayout g_SetLayout = VK_NULL_HANDLE;
+VkPipelineLayout g_PipelineLayout = VK_NULL_HANDLE;
+VkPipeline g_Pipeline = VK_NULL_HANDLE;
+
+ViewportWindow* WindowOf(ImGuiViewport* viewport) {
+    return static_cast<ViewportWindow*>(viewport->RendererUserData);
+}
+
+void DestroyBuffer(HostBuffer& buffer) {
+    VkDevice device = g_Renderer->GetDevice();
+    if (buffer.mapped) vkUnmapMemory(device, buffer.memory);
+    vkDestroyBuffer(device, buffer.buffer, nullptr);
+    vkFreeMemory(device, buffer.memory, nullptr);
+    buffer = HostBuffer{};
+}
+
+bool ReserveBuffer(HostBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage) {
+    if (buffer.size >= size) return true;
+    DestroyBuffer(buffer);
+    // Grown with headroom, so a window whose contents change a little does
+    // not reallocate every frame.
+    const VkDeviceSize capacity = size + size / 2;
+    g_Renderer->CreateBuffer(capacity, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             buffer.buffer, buffer.memory);
+    if (buffer.buffer == VK_NULL_HANDLE || buffer.memory == VK_NULL_HANDLE ||
+        vkMapMemory(g_Renderer->GetDevice(), buffer.memory, 0, capacity, 0, &buffer.mapped) != VK_SUCCESS) {
+        DestroyBuffer(buffer);
+        return false;
+    }
+    buffer.size = capacity;
+    return true;
+}
+
+VkShaderModule CreateShaderModule(const uint32_t* code, size_t size) {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = size;
+    createInfo.pCode = code;
+    VkShaderModule module = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(g_Renderer->GetDevice(), &createInfo, nullptr, &module) != VK_SUCCESS) return VK_NULL_HANDLE;
+    return module;
+}
+
+void DestroyPipeline() {
+    VkDevice device = g_Renderer->GetDevice();
+    vkDestroyPipeline(device, g_Pipeline, nullptr);
+    vkDestroyPipelineLayout(device, g_PipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, g_SetLayout, nullptr);
+    g_Pipeline = VK_NULL_HANDLE;
+    g_PipelineLayout = VK_NULL_HANDLE;
+    g_SetLayout = VK_NULL_HANDLE;
+}
+
+// ImGui's pipeline, rebuilt here because imgui_impl_vulkan keeps its own
+// private. The set layout is defined exactly as the backend's, so the
+// descriptor sets of ImGui_ImplVulkan_AddTexture are compatible with it.
+bool CreatePipeline() {
+    VkDevice device = g_Renderer->GetDevice();
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = 1;
+    setLayoutInfo.pBindings = &binding;
+    if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &g_SetLayout) != VK_SUCCESS) return false;
+
+    VkPushConstantRange pushRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants) };
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &g_SetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &g_PipelineLayout) != VK_SUCCESS) return false;
+
+    VkShaderModule vertex = CreateShaderModule(kVertexShader, sizeof(kVertexShader));
+    VkShaderModule fragment = CreateShaderModule(kFragmentShader, sizeof(kFragmentShader));
+
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertex;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragment;
+    stages[1].pName = "main";
+
+    VkVertexInputBindingDescription vertexBinding{ 0, sizeof(ImDrawVert), VK_VERTEX_INPUT_RATE_VERTEX };
+    VkVertexInputAttributeDescription attributes[3]{};
+    attributes[0] = { 0, 0, VK_FORMAT_R32G32_SFLOAT, static_cast<uint32_t>(offsetof(ImDrawVert, pos)) };
+    attributes[1] = { 1, 0, VK_FORMAT_R32G32_SFLOAT, static_cast<uint32_t>(offsetof(ImDrawVert, uv)) };
+    attributes[2] = { 2, 0, VK_FORMAT_R8G8B8A8_UNORM, static_cast<uint32_t>(offsetof(ImDrawVert, col)) };
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount = 1;
+    vertexInput.pVertexBindingDescriptions = &vertexBinding;
+    vertexInput.vertexAttributeDescriptionCount = 3;
+    vertexInput.pVertexAttributeDescriptions = attributes;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample{};
+    multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    blendAttachment.blendEnable = VK_TRUE;
+    blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                     VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlend{};
+    colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlend.attachmentCount = 1;
+    colorBlend.pAttachments = &blendAttachment;
+
+    const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = g_Renderer->GetColorAttachmentFormat();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = g_Renderer->UsesDynamicRendering() ? &renderingInfo : nullptr;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisample;
+    pipelineInfo.pColorBlendState = &colorBlend;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = g_PipelineLayout;
+    pipelineInfo.renderPass = g_Renderer->GetRenderPass();
+    pipelineInfo.subpass = 0;
+
+    const bool created = vertex != VK_NULL_HANDLE && fragment != VK_NULL_HANDLE &&
+        vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &g_Pipeline) == VK_SUCCESS;
+    vkDestroyShaderModule(device, vertex, nullptr);
+    vkDestroyShaderModule(device, fragment, nullptr);
+    return created;
+}
+
+void SetupRenderState(ImDrawData* drawData, ViewportWindow& window, VkCommandBuffer commandBuffer,
+                      float framebufferWidth, float framebufferHeight) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g_Pipeline);
+    if (drawData->TotalVtxCount > 0) {
+        const VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &window.vertices.buffer, &offset);
+        vkCmdBindIndexBuffer(commandBuffer, window.indices.buffer, 0,
+                             sizeof(ImDrawIdx) == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+    }
+
+    VkViewport viewport{};
+    viewport.width = framebufferWidth;
+    viewport.height = framebufferHeight;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    PushConstants constants{};
+    constants.scale[0] = 2.0f / drawData->DisplaySize.x;
+    constants.scale[1] = 2.0f / drawData->DisplaySize.y;
+    constants.translate[0] = -1.0f - drawData->DisplayPos.x * constants.scale[0];
+    constants.translate[1] = -1.0f - drawData->DisplayPos.y * constants.scale[1];
+    vkCmdPushConstants(commandBuffer, g_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+}
+
+// The draw loop of ImGui_ImplVulkan_RenderDrawData, writing into the
+// window's own buffers.
+void RecordDrawData(ImDrawData* drawData, ViewportWindow& window, VkCommandBuffer commandBuffer) {
+    if (!drawData) return;
+    const float framebufferWidth = drawData->DisplaySize.x * drawData->FramebufferScale.x;
+    const float framebufferHeight = drawData->DisplaySize.y * drawData->FramebufferScale.y;
+    if (framebufferWidth <= 0.0f || framebufferHeight <= 0.0f) return;
+
+#if IMGUI_VERSION_NUM >= 19200
+    // Normally done by the main window's RenderDrawData, which is skipped
+    // while the main display has no free image.
+    if (drawData->Textures) {
+        for (ImTextureData* texture : *drawData->Textures) {
+            if (texture->Status != ImTextureStatus_OK) ImGui_ImplVulkan_UpdateTexture(texture);
+        }
+    }
+#endif
+
+    if (drawData->TotalVtxCount > 0) {
+        const VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(drawData->TotalVtxCount) * sizeof(ImDrawVert);
+        const VkDeviceSize indexBytes = static_cast<VkDeviceSize>(drawData->TotalIdxCount) * sizeof(ImDrawIdx);
+        if (!ReserveBuffer(window.vertices, vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) ||
+            !ReserveBuffer(window.indices, indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+            return;
+        }
+        auto* vertexOut = static_cast<ImDrawVert*>(window.vertices.mapped);
+        auto* indexOut = static_cast<ImDrawIdx*>(window.indices.mapped);
+        for (const ImDrawList* list : drawData->CmdLists) {
+            std::memcpy(vertexOut, list->VtxBuffer.Data, list->VtxBuffer.Size * sizeof(ImDrawVert));
+            std::memcpy(indexOut, list->IdxBuffer.Data, list->IdxBuffer.Size * sizeof(ImDrawIdx));
+            vertexOut += list->VtxBuffer.Size;
+            indexOut += list->IdxBuffer.Size;
+        }
+    }
+
+    SetupRenderState(drawData, window, commandBuffer, framebufferWidth, framebufferHeight);
+
+    const ImVec2 clipOffset = drawData->DisplayPos;
+    const ImVec2 clipScale = drawData->FramebufferScale;
+    uint32_t globalVertexOffset = 0;
+    uint32_t globalIndexOffset = 0;
+    for (const ImDrawList* list : drawData->CmdLists) {
+        for (const ImDrawCmd& command : list->CmdBuffer) {
+            if (command.UserCallback) {
+                if (command.UserCallback == ImDrawCallback_ResetRenderState) {
+                    SetupRenderState(drawData, window, commandBuffer, framebufferWidth, framebufferHeight);
+                } else {
+                    command.UserCallback(list, &command);
+                }
+                continue;
+            }
+
+            ImVec2 clipMin((command.ClipRect.x - clipOffset.x) * clipScale.x, (command.ClipRect.y - clipOffset.y) * clipScale.y);
+            ImVec2 clipMax((command.ClipRect.z - clipOffset.x) * clipScale.x, (command.ClipRect.w - clipOffset.y) * clipScale.y);
+            if (clipMin.x < 0.0f) clipMin.x = 0.0f;
+            if (clipMin.y < 0.0f) clipMin.y = 0.0f;
+            if (clipMax.x > framebufferWidth) clipMax.x = framebufferWidth;
+            if (clipMax.y > framebufferHeight) clipMax.y = framebufferHeight;
+            if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y) continue;
+
+            VkRect2D scissor{};
+            scissor.offset = { static_cast<int32_t>(clipMin.x), static_cast<int32_t>(clipMin.y) };
+            scissor.extent = { static_cast<uint32_t>(clipMax.x - clipMin.x), static_cast<uint32_t>(clipMax.y - clipMin.y) };
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+            // ImTextureIDs are the backend's descriptor sets (browser
+            // textures included, see TextureHandle).
+            const VkDescriptorSet descriptorSet = (VkDescriptorSet)command.GetTexID();
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g_PipelineLayout, 0, 1, &descriptorSet,
+                                    0, nullptr);
+            vkCmdDrawIndexed(commandBuffer, command.ElemCount, 1, command.IdxOffset + globalIndexOffset,
+                             static_cast<int32_t>(command.VtxOffset + globalVertexOffset), 0);
+        }
+        globalIndexOffset += list->IdxBuffer.Size;
+        globalVertexOffset += list->VtxBuffer.Size;
+    }
+}
+
+void CreateViewportWindow(ImGuiViewport* viewport) {
+    auto* window = new ViewportWindow();
+    window->target = g_Renderer->CreateWindowTarget(static_cast<GLFWwindow*>(viewport->PlatformHandle));
+    if (!window->target) std::cerr << "Could not create a swapchain for a platform window" << std::endl;
+    viewport->RendererUserData = window;
+}
+
+void DestroyViewportWindow(ImGuiViewport* viewport) {
+    // The main viewport's data belongs to imgui_impl_vulkan.
+    if (viewport == ImGui::GetMainViewport()) return;
+    if (ViewportWindow* window = WindowOf(viewport)) {
+        // Waits for the device, so the buffers are no longer in use either.
+        if (window->target) g_Renderer->DestroyWindowTarget(window->target);
+        DestroyBuffer(window->vertices);
+        DestroyBuffer(window->indices);
+        delete window;
+    }
+    viewport->RendererUserData = nullptr;
+}
+
+void RenderViewportWindow(ImGuiViewport* viewport, void*) {
+    ZoneScoped;
+    ViewportWindow* window = WindowOf(viewport);
+    if (!window || !window->target) return;
+    g_Renderer->RenderWindowTarget(window->target, [viewport, window](VkCommandBuffer commandBuffer) {
+        RecordDrawData(viewport->DrawData, *window, commandBuffer);
+    });
+}
+}  // namespace
+
+bool ImGuiViewports::Enable() {
+    ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+    return true;
+}
+
+bool ImGuiViewports::Install(VulkanRenderer& renderer) {
+    g_Renderer = &renderer;
+    if (!CreatePipeline()) {
+        std::cerr << "Could not create the platform window pipeline; multi-viewport disabled" << std::endl;
+        DestroyPipeline();
+        g_Renderer = nullptr;
+        ImGui::GetIO().ConfigFlags &= ~ImGuiConfigFlags_ViewportsEnable;
+        return false;
+    }
+    renderer.EnableWindowTargets();
+    ImGuiPlatformIO& platformIO = ImGui::GetPlatformIO();
+    platformIO.Renderer_CreateWindow = CreateViewportWindow;
+    platformIO.Renderer_DestroyWindow = DestroyViewportWindow;
+    // The presenter notices size changes itself, and RenderWindow presents.
+    platformIO.Renderer_SetWindowSize = nullptr;
+    platformIO.Renderer_RenderWindow = RenderViewportWindow;
+    platformIO.Renderer_SwapBuffers = nullptr;
+    return true;
+}
+
+void ImGuiViewports::RenderPlatformWindows() {
+    ZoneScoped;
+    if (!g_Renderer) return;
+    if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+        ImGui::UpdatePlatformWindows();
+        ImGui::RenderPlatformWindowsDefault();
+    }
+    g_Renderer->FinishWindowFrames();
+}
+
+void ImGuiViewports::Shutdown() {
+    if (!g_Renderer) return;
+    ImGuiPlatformIO& platformIO = ImGui::GetPlatformIO();
+    for (ImGuiViewport* viewport : platformIO.Viewports) DestroyViewportWindow(viewport);
+    DestroyPipeline();
+    g_Renderer = nullptr;
+}
+#else
+bool ImGuiViewports::Enable() {
+    return false;
+}
+
+bool ImGuiViewports::Install(VulkanRenderer&) {
+    return false;
+}
+void ImGuiViewports::RenderPlatformWindows() {}
+void ImGuiViewports::Shutdown() {}
+#endif
@@ -0,0 +1,372 @@
+#include "../include/layer_compositor.h"
+#include "../include/metrics_registry.h"
+#include "../include/vulkan_renderer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+const uint32_t kVertexShader[] =
+#include "layer_compositor.vert.inc"
+;
+const uint32_t kFragmentShader[] =
+#include "layer_compositor.frag.inc"
+;
+const uint32_t kFragmentShaderNonUniform[] =
+#include "layer_compositor_nonuniform.frag.inc"
+;
+
+struct PushConstants {
+    float scale[2];
+    float translate[2];
+};
+}  // namespace
+
+bool LayerCompositor::Initialize(VulkanRenderer& renderer, bool descriptorIndexing) {
+    m_Renderer = &renderer;
+    m_Device = renderer.GetDevice();
+    m_DescriptorIndexing = descriptorIndexing;
+    m_Textures.assign(kMaxTextures, VK_NULL_HANDLE);
+    m_Layers.reserve(kMaxLayers);
+
+    if (!CreateSolidTexture() || !CreateDescriptors() || !CreatePipeline()) {
+        std::cerr << "Layer compositor unavailable, falling back to ImGui images" << std::endl;
+        Cleanup();
+        return false;
+    }
+    m_Stats.descriptorIndexing = m_DescriptorIndexing;
+    return true;
+}
+
+void LayerCompositor::Cleanup() {
+    if (m_Device == VK_NULL_HANDLE) return;
+    if (m_MappedLayers) vkUnmapMemory(m_Device, m_LayerMemory);
+    vkDestroyPipeline(m_Device, m_Pipeline, nullptr);
+    vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+    vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_Device, m_SetLayout, nullptr);
+    vkDestroySampler(m_Device, m_Sampler, nullptr);
+    vkDestroyBuffer(m_Device, m_LayerBuffer, nullptr);
+    vkFreeMemory(m_Device, m_LayerMemory, nullptr);
+    vkDestroyImageView(m_Device, m_SolidView, nullptr);
+    vkDestroyImage(m_Device, m_SolidImage, nullptr);
+    vkFreeMemory(m_Device, m_SolidMemory, nullptr);
+    *this = LayerCompositor();
+}
+
+uint32_t LayerCompositor::RegisterTexture(VkImageView view) {
+    for (uint32_t i = kSolidTexture + 1; i < kMaxTextures; ++i) {
+        if (m_Textures[i] != VK_NULL_HANDLE) continue;
+        WriteTexture(i, view);
+        ++m_Stats.textures;
+        return i;
+    }
+    std::cerr << "Layer compositor is out of texture slots" << std::endl;
+    return kInvalidTexture;
+}
+
+void LayerCompositor::UpdateTexture(uint32_t texture, VkImageView view) {
+    if (texture == kSolidTexture || texture >= kMaxTextures || m_Textures[texture] == VK_NULL_HANDLE) return;
+    WriteTexture(texture, view);
+}
+
+void LayerCompositor::ReleaseTexture(uint32_t texture) {
+    if (texture == kSolidTexture || texture >= kMaxTextures || m_Textures[texture] == VK_NULL_HANDLE) return;
+    m_Textures[texture] = VK_NULL_HANDLE;
+    --m_Stats.textures;
+    // A partially bound array may keep a stale descriptor in an unused slot;
+    // without descriptor indexing every slot must stay valid.
+    if (!m_DescriptorIndexing) {
+        WriteTexture(texture, m_SolidView);
+        m_Textures[texture] = VK_NULL_HANDLE;
+    }
+}
+
+void LayerCompositor::Submit(const CompositorLayer& layer) {
+    if (m_Pipeline == VK_NULL_HANDLE || m_Layers.size() >= kMaxLayers) return;
+    if (layer.texture >= kMaxTextures || (layer.texture != kSolidTexture && m_Textures[layer.texture] == VK_NULL_HANDLE)) return;
+    if (layer.width <= 0.0f || layer.height <= 0.0f) return;
+    m_Layers.push_back(layer);
+}
+
+void LayerCompositor::Record(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+    ZoneScoped;
+    m_Stats.layers = static_cast<uint32_t>(m_Layers.size());
+    m_Stats.drawCalls = 0;
+    m_Stats.descriptorBinds = 0;
+    m_Stats.pipelineBinds = 0;
+    if (m_Layers.empty() || extent.width == 0 || extent.height == 0) {
+        m_Layers.clear();
+        return;
+    }
+
+    std::stable_sort(m_Layers.begin(), m_Layers.end(),
+                     [](const CompositorLayer& a, const CompositorLayer& b) { return a.order < b.order; });
+    for (size_t i = 0; i < m_Layers.size(); ++i) {
+        const CompositorLayer& layer = m_Layers[i];
+        GpuLayer& gpu = m_MappedLayers[i];
+        gpu = GpuLayer{};
+        gpu.rect[0] = layer.x; gpu.rect[1] = layer.y; gpu.rect[2] = layer.width; gpu.rect[3] = layer.height;
+        gpu.uv[0] = layer.u0; gpu.uv[1] = layer.v0; gpu.uv[2] = layer.u1; gpu.uv[3] = layer.v1;
+        gpu.clip[0] = layer.clipMinX; gpu.clip[1] = layer.clipMinY;
+        gpu.clip[2] = layer.clipMaxX; gpu.clip[3] = layer.clipMaxY;
+        std::memcpy(gpu.tint, layer.tint, sizeof(gpu.tint));
+        gpu.texture = layer.texture;
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+    m_Stats.pipelineBinds = 1;
+    m_Stats.descriptorBinds = 1;
+
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    VkRect2D scissor{ {0, 0}, extent };
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    PushConstants constants{};
+    constants.scale[0] = 2.0f / static_cast<float>(extent.width);
+    constants.scale[1] = 2.0f / static_cast<float>(extent.height);
+    constants.translate[0] = -1.0f;
+    constants.translate[1] = -1.0f;
+    vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+
+    const uint32_t count = static_cast<uint32_t>(m_Layers.size());
+    if (m_DescriptorIndexing) {
+        vkCmdDraw(commandBuffer, 4, count, 0, 0);
+        m_Stats.drawCalls = 1;
+    } else {
+        for (uint32_t i = 0; i < count; ++i) vkCmdDraw(commandBuffer, 4, 1, 0, i);
+        m_Stats.drawCalls = count;
+    }
+    m_Layers.clear();
+
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.SetGauge("compositor.layers", m_Stats.layers);
+    registry.SetGauge("compositor.draw_calls", m_Stats.drawCalls);
+    registry.SetGauge("compositor.descriptor_binds", m_Stats.descriptorBinds);
+}
+
+bool LayerCompositor::CreateSolidTexture() {
+    const uint32_t white = 0xffffffffu;
+    m_SolidImage = m_Renderer->CreateTextureImage(1, 1, &white, m_SolidMemory);
+    if (m_SolidImage == VK_NULL_HANDLE) return false;
+    m_SolidView = m_Renderer->CreateImageView(m_SolidImage, VK_FORMAT_R8G8B8A8_UNORM);
+    return m_SolidView != VK_NULL_HANDLE;
+}
+
+bool LayerCompositor::CreateDescriptors() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(m_Device, &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS) return false;
+
+    const std::vector<VkSampler> samplers(kMaxTextures, m_Sampler);
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = kMaxTextures;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[0].pImmutableSamplers = samplers.data();
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    const VkDescriptorBindingFlags bindingFlags[2] = { VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT, 0 };
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 2;
+    flagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = m_DescriptorIndexing ? &flagsInfo : nullptr;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &m_SetLayout) != VK_SUCCESS) return false;
+
+    VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, kMaxTextures },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 },
+    };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) return false;
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_SetLayout;
+    if (vkAllocateDescriptorSets(m_Device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS) return false;
+
+    const VkDeviceSize bufferSize = sizeof(GpuLayer) * kMaxLayers;
+    m_Renderer->CreateBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             m_LayerBuffer, m_LayerMemory);
+    if (m_LayerBuffer == VK_NULL_HANDLE || m_LayerMemory == VK_NULL_HANDLE) return false;
+    void* mapped = nullptr;
+    if (vkMapMemory(m_Device, m_LayerMemory, 0, bufferSize, 0, &mapped) != VK_SUCCESS) return false;
+    m_MappedLayers = static_cast<GpuLayer*>(mapped);
+
+    VkDescriptorBufferInfo bufferInfo{ m_LayerBuffer, 0, bufferSize };
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_DescriptorSet;
+    write.dstBinding = 1;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+
+    // Slot 0 is the solid texture. Without partially bound descriptors every
+    // other slot starts out pointing at it too.
+    const uint32_t initialized = m_DescriptorIndexing ? 1 : kMaxTextures;
+    for (uint32_t i = 0; i < initialized; ++i) WriteTexture(i, m_SolidView);
+    std::fill(m_Textures.begin() + 1, m_Textures.end(), VK_NULL_HANDLE);
+    return true;
+}
+
+bool LayerCompositor::CreatePipeline() {
+    VkPushConstantRange pushRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants) };
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_SetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    if (vkCreatePipelineLayout(m_Device, &layoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) return false;
+
+    VkShaderModule vertex = CreateShaderModule(kVertexShader, sizeof(kVertexShader));
+    VkShaderModule fragment = m_DescriptorIndexing
+        ? CreateShaderModule(kFragmentShaderNonUniform, sizeof(kFragmentShaderNonUniform))
+        : CreateShaderModule(kFragmentShader, sizeof(kFragmentShader));
+
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertex;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragment;
+    stages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample{};
+    multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Same blending as ImGui's pipeline, so layers look as ImGui::Image did.
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    blendAttachment.blendEnable = VK_TRUE;
+    blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                     VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlend{};
+    colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlend.attachmentCount = 1;
+    colorBlend.pAttachments = &blendAttachment;
+
+    const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = m_Renderer->GetColorAttachmentFormat();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = m_Renderer->UsesDynamicRendering() ? &renderingInfo : nullptr;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisample;
+    pipelineInfo.pColorBlendState = &colorBlend;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_PipelineLayout;
+    pipelineInfo.renderPass = m_Renderer->GetRenderPass();
+    pipelineInfo.subpass = 0;
+
+    const bool created = vertex != VK_NULL_HANDLE && fragment != VK_NULL_HANDLE &&
+        vkCreateGraphicsPipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline) == VK_SUCCESS;
+    vkDestroyShaderModule(m_Device, vertex, nullptr);
+    vkDestroyShaderModule(m_Device, fragment, nullptr);
+    return created;
+}
+
+VkShaderModule LayerCompositor::CreateShaderModule(const uint32_t* code, size_t size) {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = size;
+    createInfo.pCode = code;
+    VkShaderModule module = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(m_Device, &createInfo, nullptr, &module) != VK_SUCCESS) return VK_NULL_HANDLE;
+    return module;
+}
+
+void LayerCompositor::WriteTexture(uint32_t texture, VkImageView view) {
+    m_Textures[texture] = view;
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_DescriptorSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = texture;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+}
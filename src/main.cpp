@@ -4,8 +4,11 @@
 #include <string>
 #include <cstring>
 #include <thread>
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
 #include <optional>
 
 #ifdef _WIN32
@@ -26,8 +29,23 @@
 #include "include/internal/cef_types.h"
 
 #include "../include/vulkan_renderer.h"
+#include "../include/frame_presenter.h"
+#include "../include/audio_capture.h"
 #include "../include/cef_app_impl.h"
 #include "../include/cef_client_impl.h"
+#include "../include/browser_resource_sampler.h"
+#include "../include/devtools_perf_probe.h"
+#include "../include/frame_rate_governor.h"
+#include "../include/gpu_frame_converter.h"
+#include "../include/idle_scheduler.h"
+#include "../include/metrics_registry.h"
+#include "../include/page_load_telemetry.h"
+#include "../include/renderer_watchdog.h"
+#include "../include/request_context_pool.h"
+#include "../include/software_mode.h"
+#include "../include/texture_handle.h"
+#include "../include/trace_capture.h"
+#include "../include/imgui_layer.h"
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
@@ -74,6 +92,21 @@ void SetCefPath(cef_string_t& target, const std::filesystem::path& path) {
 }  // namespace
 #endif
 
+namespace {
+// Binary PPM: the offscreen result can be checked without an image library.
+bool WritePpm(const std::string& path, const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    for (size_t i = 0; i + 3 < rgba.size(); i += 4) {
+        out.write(reinterpret_cast<const char*>(&rgba[i]), 3);
+    }
+    return static_cast<bool>(out);
+}
+}  // namespace
+
 class Application {
 public:
     bool Initialize(int argc, char* argv[]);
@@ -83,17 +116,44 @@ public:
 private:
     GLFWwindow* m_Window = nullptr;
     std::unique_ptr<VulkanRenderer> m_Renderer;
+    // Set with --offscreen: no GLFW window, frames go to an OffscreenPresenter
+    // owned by the renderer.
+    OffscreenPresenter* m_OffscreenPresenter = nullptr;
+    bool m_Offscreen = false;
+    uint32_t m_OffscreenWidth = 1280;
+    uint32_t m_OffscreenHeight = 720;
+    int m_OffscreenFrameLimit = 0;
+    int m_FramesRendered = 0;
+    std::string m_OffscreenOutput;
+    // Set with --idle-render (ignored offscreen): the loop blocks in
+    // glfwWaitEventsTimeout while nothing changes, CEF's pump is driven by
+    // OnScheduleMessagePumpWork and Chromium paces its own begin frames.
+    bool m_IdleRender = false;
+    // --software-mode, detected before CEF starts: CPU raster and
+    // compositing in Chromium and the renderer's minimal pipeline.
+    bool m_SoftwareMode = false;
+    std::chrono::steady_clock::time_point m_LastImGuiFrame = std::chrono::steady_clock::now();
+    // Set with --gpu-convert: swizzles frames and detects changed tiles in a
+    // compute shader instead of on the CPU.
+    std::unique_ptr<GpuFrameConverter> m_FrameConverter;
     CefRefPtr<CefAppImpl> m_CefApp;
     CefRefPtr<CefRenderHandlerImpl> m_RenderHandler;
     CefRefPtr<CefClientImpl> m_Client;
     CefRefPtr<CefBrowser> m_Browser;
+    CefRefPtr<BrowserResourceSampler> m_ResourceSampler;
+    CefRefPtr<DevToolsPerfProbe> m_PerfProbe;
+    CefRefPtr<RequestContextPool> m_ContextPool;
+    CefRefPtr<RendererWatchdog> m_Watchdog;
+    std::unique_ptr<FrameRateGovernor> m_FrameGovernor;
+    std::unique_ptr<AudioMixer> m_AudioMixer;
+    int m_TrackedBrowserId = 0;
     
     // Vulkan resources for CEF texture
-    VkImage m_CefTextureImage = VK_NULL_HANDLE;
-    VkDeviceMemory m_CefTextureMemory = VK_NULL_HANDLE;
-    VkImageView m_CefTextureView = VK_NULL_HANDLE;
+    TextureHandle m_CefTexture;
     VkSampler m_CefTextureSampler = VK_NULL_HANDLE;
-    VkDescriptorSet m_CefDescriptorSet = VK_NULL_HANDLE;
+    
+    // Popup widget (open <select> etc.), painted separately by CEF.
+    TextureHandle m_PopupTexture;
     
     int m_BrowserWidth = 800;
     int m_BrowserHeight = 600;
@@ -104,15 +164,25 @@ private:
     double m_BeginFrameFps = 0.0;
     int m_BeginFrameSamples = 0;
     std::chrono::steady_clock::time_point m_LastBeginFrameSample = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point m_LastBeginFrame;
     
     bool InitializeCEF(int argc, char* argv[]);
+    void ConfigureOffscreen();
     bool InitializeWindow();
     bool InitializeVulkan();
     bool InitializeImGui();
     void CreateBrowser();
+    void UpdatePopupTexture();
+    void RecreateBrowser();
+    void TrackBrowser();
+    void StartResourceSampler();
+    void StartWatchdog();
     void UpdateCefTexture();
     void RenderUI();
     void HandleInputEvents();
+    bool ShouldClose() const;
+    void NewPlatformFrame();
+    void WriteOffscreenOutput();
 };
 
 bool Application::Initialize(int argc, char* argv[]) {
@@ -134,6 +204,7 @@ bool Application::Initialize(int argc, char* argv[]) {
         std::cerr << "Failed to initialize CEF" << std::endl;
         return false;
     }
+    ConfigureOffscreen();
     
     if (!InitializeWindow()) {
         std::cerr << "Failed to initialize window" << std::endl;
@@ -150,7 +221,23 @@ bool Application::Initialize(int argc, char* argv[]) {
         return false;
     }
     
+    m_AudioMixer = AudioMixer::FromCommandLine(CefCommandLine::GetGlobalCommandLine());
+    if (m_AudioMixer) {
+        m_AudioMixer->Start();
+    }
+
+    StartWatchdog();
+    if (FrameRateGovernor::EnabledFromCommandLine(CefCommandLine::GetGlobalCommandLine())) {
+        m_FrameGovernor = std::make_unique<FrameRateGovernor>();
+        m_FrameGovernor->ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine());
+    }
     CreateBrowser();
+    StartResourceSampler();
+    m_PerfProbe = new DevToolsPerfProbe(
+        "Browser", DevToolsPerfProbe::IntervalFromCommandLine(CefCommandLine::GetGlobalCommandLine()));
+    if (TraceCapture::Get().ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine())) {
+        TraceCapture::Get().Start();
+    }
     
     return true;
 }
@@ -169,15 +256,29 @@ bool Application::InitializeCEF(int argc, char* argv[]) {
         exit(exit_code);
     }
     
+    CefRefPtr<CefCommandLine> launch_command_line = RequestContextPool::ParseLaunchCommandLine(argc, argv);
+    m_IdleRender = launch_command_line->HasSwitch("idle-render") && !launch_command_line->HasSwitch("offscreen");
+    const SoftwareModeDecision software = ResolveSoftwareMode(
+        launch_command_line->HasSwitch("software-mode"), launch_command_line->GetSwitchValue("software-mode").ToString(),
+        VulkanRenderer::EffectiveDeviceOverride(launch_command_line->GetSwitchValue("vk-device").ToString()),
+        &VulkanRenderer::ProbePhysicalDevices);
+    if (!software.warning.empty()) std::cerr << software.warning << std::endl;
+    std::cout << "Software mode " << (software.enabled ? "on" : "off") << " (" << software.reason << ")" << std::endl;
+    m_SoftwareMode = software.enabled;
+    m_CefApp->SetSoftwareMode(m_SoftwareMode);
+
     // Configure CEF settings
     CefSettings settings;
     settings.windowless_rendering_enabled = true;
     settings.no_sandbox = true;
+    settings.external_message_pump = m_IdleRender;
 
     settings.log_severity = LOGSEVERITY_INFO;
     settings.command_line_args_disabled = false;
 
     auto root_dir = std::filesystem::current_path();
+    std::filesystem::path cache_root;
+    std::filesystem::path log_dir;
 
 #ifdef _WIN32
     const std::filesystem::path exe_dir = GetExecutablePath().parent_path();
@@ -195,14 +296,13 @@ bool Application::InitializeCEF(int argc, char* argv[]) {
     // Keep DLLs in the build root while letting the executable live in Debug/Release.
     SetDllDirectoryW(build_dir.c_str());
 
-    SetCefPath(settings.root_cache_path, exe_dir / "cef_cache");
+    cache_root = RequestContextPool::CacheRootFromCommandLine(launch_command_line, exe_dir / "cef_cache");
+    SetCefPath(settings.root_cache_path, cache_root);
     SetCefPath(settings.log_file, exe_dir / "debug.log");
+    log_dir = exe_dir;
     SetCefPath(settings.resources_dir_path, cef_dir);
     SetCefPath(settings.locales_dir_path, locales_dir);
 #else
-    CefRefPtr<CefCommandLine> command_line = CefCommandLine::CreateCommandLine();
-    command_line->InitFromArgv(argc, argv);
-
     std::error_code executable_path_error;
     const std::filesystem::path executable_path =
         std::filesystem::read_symlink("/proc/self/exe", executable_path_error);
@@ -216,9 +316,9 @@ bool Application::InitializeCEF(int argc, char* argv[]) {
             : executable_dir;
 
     const std::string resources_arg =
-        command_line->GetSwitchValue("resources-dir-path").ToString();
+        launch_command_line->GetSwitchValue("resources-dir-path").ToString();
     const std::string locales_arg =
-        command_line->GetSwitchValue("locales-dir-path").ToString();
+        launch_command_line->GetSwitchValue("locales-dir-path").ToString();
     const std::filesystem::path resources_dir = resources_arg.empty()
         ? default_resources_dir
         : std::filesystem::absolute(resources_arg);
@@ -226,8 +326,11 @@ bool Application::InitializeCEF(int argc, char* argv[]) {
         ? resources_dir / "locales"
         : std::filesystem::absolute(locales_arg);
 
-    CefString(&settings.root_cache_path).FromASCII(std::filesystem::absolute(root_dir / "cef_cache").string().c_str());
+    cache_root = RequestContextPool::CacheRootFromCommandLine(
+        launch_command_line, std::filesystem::absolute(root_dir / "cef_cache"));
+    CefString(&settings.root_cache_path).FromASCII(cache_root.string().c_str());
     CefString(&settings.log_file).FromASCII(std::filesystem::absolute(root_dir / "debug.log").string().c_str());
+    log_dir = std::filesystem::absolute(root_dir);
     CefString(&settings.locales_dir_path).FromASCII(locales_dir.string().c_str());
     CefString(&settings.resources_dir_path).FromASCII(resources_dir.string().c_str());
 #endif
@@ -236,24 +339,83 @@ bool Application::InitializeCEF(int argc, char* argv[]) {
     if (!CefInitialize(main_args, settings, m_CefApp, nullptr)) {
         return false;
     }
+
+    m_ContextPool = new RequestContextPool(cache_root);
+    m_ContextPool->ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine());
+    m_ContextPool->Start();
+    PageLoadLog::Get().ConfigureFromCommandLine(CefCommandLine::GetGlobalCommandLine(), log_dir / "page_loads.jsonl");
     
     return true;
 }
 
+void Application::ConfigureOffscreen() {
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    m_Offscreen = command_line->HasSwitch("offscreen");
+    if (!m_Offscreen) {
+        return;
+    }
+    const std::string size = command_line->GetSwitchValue("offscreen").ToString();
+    unsigned width = 0, height = 0;
+    if (!size.empty()) {
+        if (std::sscanf(size.c_str(), "%ux%u", &width, &height) == 2 && width > 0 && height > 0) {
+            m_OffscreenWidth = width;
+            m_OffscreenHeight = height;
+        } else {
+            std::cerr << "Ignoring --offscreen=" << size << ", expected WIDTHxHEIGHT" << std::endl;
+        }
+    }
+    try {
+        m_OffscreenFrameLimit = std::max(0, std::stoi(command_line->GetSwitchValue("offscreen-frames").ToString()));
+    } catch (...) {
+    }
+    m_OffscreenOutput = command_line->GetSwitchValue("offscreen-output").ToString();
+    std::cout << "Rendering offscreen at " << m_OffscreenWidth << "x" << m_OffscreenHeight << std::endl;
+}
+
 bool Application::InitializeWindow() {
+    if (m_Offscreen) {
+        return true;
+    }
     if (!glfwInit()) {
         return false;
     }
     
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     m_Window = glfwCreateWindow(1280, 720, "ImGui + CEF + Vulkan Browser", nullptr, nullptr);
+    if (m_Window && m_IdleRender) {
+        IdleScheduler::Get().SetWakeCallback([] { glfwPostEmptyEvent(); });
+        // Exposed or restored windows need redrawing even with nothing new.
+        glfwSetWindowRefreshCallback(m_Window, [](GLFWwindow*) { IdleScheduler::Get().RequestFrame(); });
+        IdleScheduler::Get().SetEnabled(true);
+    }
     
     return m_Window != nullptr;
 }
 
 bool Application::InitializeVulkan() {
     m_Renderer = std::make_unique<VulkanRenderer>();
-    return m_Renderer->Initialize(m_Window);
+    m_Renderer->SetDeviceOverride(CefCommandLine::GetGlobalCommandLine()->GetSwitchValue("vk-device").ToString());
+    m_Renderer->SetAllowVulkan13(!CefCommandLine::GetGlobalCommandLine()->HasSwitch("disable-vulkan13"));
+    m_Renderer->SetCompositorEnabled(CefCommandLine::GetGlobalCommandLine()->HasSwitch("layer-compositor"));
+    m_Renderer->SetSoftwareMode(m_SoftwareMode);
+    if (m_Offscreen) {
+        auto presenter = std::make_unique<OffscreenPresenter>(m_OffscreenWidth, m_OffscreenHeight);
+        m_OffscreenPresenter = presenter.get();
+        if (!m_Renderer->Initialize(std::move(presenter))) {
+            return false;
+        }
+    } else if (!m_Renderer->Initialize(m_Window)) {
+        return false;
+    }
+    
+    if (CefCommandLine::GetGlobalCommandLine()->HasSwitch("gpu-convert")) {
+        m_FrameConverter = std::make_unique<GpuFrameConverter>();
+        if (!m_FrameConverter->Initialize(m_Renderer->GetPhysicalDevice(), m_Renderer->GetDevice(),
+                                          m_Renderer->GetGraphicsQueue(), m_Renderer->GetQueueFamily())) {
+            m_FrameConverter.reset();
+        }
+    }
+    return true;
 }
 
 bool Application::InitializeImGui() {
@@ -263,8 +425,22 @@ bool Application::InitializeImGui() {
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
     
     ImGui::StyleColorsDark();
+    if (m_SoftwareMode) {
+        // Anti-aliased edges add a blended fringe of triangles around every
+        // shape, each one rasterized and blended on the CPU.
+        ImGuiStyle& style = ImGui::GetStyle();
+        style.AntiAliasedLines = false;
+        style.AntiAliasedLinesUseTex = false;
+        style.AntiAliasedFill = false;
+    }
     
-    ImGui_ImplGlfw_InitForVulkan(m_Window, true);
+    if (m_Window) {
+        ImGui_ImplGlfw_InitForVulkan(m_Window, true);
+    } else {
+        // No platform backend: NewPlatformFrame feeds the size and time.
+        io.DisplaySize = ImVec2((float)m_OffscreenWidth, (float)m_OffscreenHeight);
+        io.IniFilename = nullptr;
+    }
     
     ImGui_ImplVulkan_InitInfo init_info = {};
     init_info.Instance = m_Renderer->GetInstance();
@@ -274,6 +450,11 @@ bool Application::InitializeImGui() {
     init_info.Queue = m_Renderer->GetGraphicsQueue();
     init_info.DescriptorPool = m_Renderer->GetDescriptorPool();
     init_info.RenderPass = m_Renderer->GetRenderPass();
+    init_info.ApiVersion = m_Renderer->GetApiVersion();
+    init_info.UseDynamicRendering = m_Renderer->UsesDynamicRendering();
+    init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = m_Renderer->GetColorAttachmentFormat();
     init_info.MinImageCount = 2;
     init_info.ImageCount = 2;
     init_info.Allocator = nullptr;
@@ -288,18 +469,98 @@ void Application::CreateBrowser() {
     // Create render handler and client
     m_RenderHandler = new CefRenderHandlerImpl(m_BrowserWidth, m_BrowserHeight);
     m_Client = new CefClientImpl(m_RenderHandler);
+    if (m_AudioMixer) {
+        m_Client->SetAudioHandler(m_AudioMixer->CreateHandler("Browser"));
+    }
+    m_Client->GetLoadTracker()->BeginNavigation(m_UrlBuffer);
+    if (m_Watchdog) {
+        m_Watchdog->Watch("Browser", m_Client);
+    }
     
     // Configure browser window info
     CefWindowInfo window_info;
     window_info.SetAsWindowless(0);
-    window_info.external_begin_frame_enabled = true;
+    // Idle rendering cannot know when Chromium wants a frame, so it lets
+    // Chromium drive its own at the governed windowless rate instead.
+    window_info.external_begin_frame_enabled = !m_IdleRender;
     
     // Configure browser settings
     CefBrowserSettings browser_settings;
     browser_settings.windowless_frame_rate = 60;
+    if (m_FrameGovernor) {
+        m_FrameGovernor->Attach("Browser", "browser", m_Client, browser_settings.windowless_frame_rate);
+    }
     
     // Create the browser
-    CefBrowserHost::CreateBrowser(window_info, m_Client, m_UrlBuffer, browser_settings, nullptr, nullptr);
+    CefRefPtr<CefRequestContext> request_context = m_ContextPool ? m_ContextPool->GetContext("browser") : nullptr;
+    CefBrowserHost::CreateBrowser(window_info, m_Client, m_UrlBuffer, browser_settings, nullptr, request_context);
+}
+
+void Application::RecreateBrowser() {
+    if (m_Client && m_Client->GetBrowser()) {
+        CefRefPtr<CefBrowser> browser = m_Client->GetBrowser();
+        const std::string url = browser->GetMainFrame()->GetURL().ToString();
+        if (!url.empty()) {
+            std::strncpy(m_UrlBuffer, url.c_str(), sizeof(m_UrlBuffer) - 1);
+            m_UrlBuffer[sizeof(m_UrlBuffer) - 1] = '\0';
+        }
+        browser->GetHost()->CloseBrowser(true);
+    }
+    if (m_PerfProbe) {
+        m_PerfProbe->Detach();
+    }
+    if (m_ContextPool && m_TrackedBrowserId != 0) {
+        m_ContextPool->DetachBrowser(m_TrackedBrowserId);
+    }
+    if (m_ResourceSampler && m_TrackedBrowserId != 0) {
+        m_ResourceSampler->Untrack(m_TrackedBrowserId);
+        m_TrackedBrowserId = 0;
+    }
+    CreateBrowser();
+}
+
+void Application::TrackBrowser() {
+    if (!m_ResourceSampler || !m_Client || !m_Client->GetBrowser()) {
+        return;
+    }
+
+    const int browser_id = m_Client->GetBrowser()->GetIdentifier();
+    if (browser_id != m_TrackedBrowserId) {
+        m_TrackedBrowserId = browser_id;
+        m_ResourceSampler->Track(browser_id, "Browser");
+        if (m_PerfProbe) {
+            m_PerfProbe->Attach(m_Client->GetBrowser());
+            m_Client->SetPerfProbe(m_PerfProbe);
+        }
+        if (m_ContextPool) {
+            m_ContextPool->AttachBrowser("browser", m_Client->GetBrowser());
+        }
+    }
+}
+
+void Application::StartResourceSampler() {
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    m_ResourceSampler = new BrowserResourceSampler(BrowserResourceSampler::IntervalFromCommandLine(command_line));
+    m_ResourceSampler->SetLimits(BrowserResourceSampler::LimitsFromCommandLine(command_line));
+    m_ResourceSampler->SetLimitExceededCallback([this](int browser_id) {
+        if (browser_id == m_TrackedBrowserId) {
+            RecreateBrowser();
+        }
+    });
+    m_ResourceSampler->Start();
+}
+
+void Application::StartWatchdog() {
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    if (!RendererWatchdog::EnabledFromCommandLine(command_line)) {
+        return;
+    }
+    m_Watchdog = new RendererWatchdog();
+    m_Watchdog->ConfigureFromCommandLine(command_line);
+    m_Watchdog->SetRecoverCallback([this](const std::string&) {
+        RecreateBrowser();
+    });
+    m_Watchdog->Start();
 }
 
 void Application::UpdateCefTexture() {
@@ -307,47 +568,99 @@ void Application::UpdateCefTexture() {
     if (!m_RenderHandler->IsDirty()) {
         return;
     }
+    TraceScope trace("upload", "host");
     
     std::vector<uint8_t> textureData;
     int width, height;
-    m_RenderHandler->GetTextureData(textureData, width, height);
+    CefRect damage;
+    if (m_FrameConverter) {
+        m_RenderHandler->GetRawTextureData(textureData, width, height, &damage);
+    } else {
+        m_RenderHandler->GetTextureData(textureData, width, height, &damage);
+    }
+    const VkRect2D region = { { damage.x, damage.y }, { (uint32_t)damage.width, (uint32_t)damage.height } };
     
     // Create or recreate texture if size changed
-    if (m_CefTextureImage == VK_NULL_HANDLE || width != m_BrowserWidth || height != m_BrowserHeight) {
+    const bool recreate = !m_CefTexture.IsValid() || width != m_BrowserWidth || height != m_BrowserHeight;
+    if (recreate) {
         m_BrowserWidth = width;
         m_BrowserHeight = height;
         
-        // Clean up old resources
-        if (m_CefTextureView != VK_NULL_HANDLE) {
-            vkDestroyImageView(m_Renderer->GetDevice(), m_CefTextureView, nullptr);
-        }
-        if (m_CefTextureImage != VK_NULL_HANDLE) {
-            vkDestroyImage(m_Renderer->GetDevice(), m_CefTextureImage, nullptr);
-            vkFreeMemory(m_Renderer->GetDevice(), m_CefTextureMemory, nullptr);
-        }
-        
-        // Create new texture
-        m_CefTextureImage = m_Renderer->CreateTextureImage(width, height, textureData.data(), m_CefTextureMemory);
-        m_CefTextureView = m_Renderer->CreateImageView(m_CefTextureImage, VK_FORMAT_R8G8B8A8_UNORM);
-        
         if (m_CefTextureSampler == VK_NULL_HANDLE) {
             m_CefTextureSampler = m_Renderer->CreateTextureSampler();
         }
         
-        // Update descriptor set for ImGui
-        m_CefDescriptorSet = ImGui_ImplVulkan_AddTexture(m_CefTextureSampler, m_CefTextureView, 
-                                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    } else {
+        // Create new texture; the converter fills its images below. The
+        // handle repoints its descriptor and retires the old image.
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        if (m_FrameConverter) {
+            GpuFrameConverter* converter = m_FrameConverter.get();
+            VkImage image = converter->CreateImage(width, height, memory);
+            m_CefTexture.Attach(m_Renderer.get(), m_CefTextureSampler, image, memory, VK_FORMAT_R8G8B8A8_UNORM,
+                                width, height, 1, [converter](VkImage oldImage, VkDeviceMemory oldMemory) {
+                                    converter->DestroyImage(oldImage, oldMemory);
+                                });
+        } else {
+            VkImage image = m_Renderer->CreateTextureImage(width, height, textureData.data(), memory);
+            m_CefTexture.Attach(m_Renderer.get(), m_CefTextureSampler, image, memory, VK_FORMAT_R8G8B8A8_UNORM,
+                                width, height);
+        }
+        if (!m_CefTexture.IsValid()) {
+            return;
+        }
+    }
+    
+    if (m_FrameConverter) {
+        m_FrameConverter->Convert(m_CefTexture.GetImage(), m_CefTexture.GetView(), width, height, textureData.data(), region);
+        // Tile masks are read back frames later; polling publishes their metrics.
+        FrameConversionResult result;
+        m_FrameConverter->PollResult(result);
+    } else if (!recreate) {
         // Update existing texture
-        m_Renderer->UpdateTextureImage(m_CefTextureImage, width, height, textureData.data());
+        m_Renderer->UpdateTextureImage(m_CefTexture.GetImage(), width, height, textureData.data(), 1, &region);
     }
     
     m_RenderHandler->ClearDirty();
+    m_Client->GetLoadTracker()->OnUpload();
+}
+
+void Application::UpdatePopupTexture() {
+    ZoneScoped;
+    if (!m_RenderHandler || !m_RenderHandler->IsPopupDirty()) {
+        return;
+    }
+    std::vector<uint8_t> textureData;
+    int width, height;
+    m_RenderHandler->GetPopupData(textureData, width, height);
+    m_RenderHandler->ClearPopupDirty();
+    if (width <= 0 || height <= 0 || textureData.empty()) {
+        return;
+    }
+    
+    if (m_PopupTexture.IsValid() && (uint32_t)width == m_PopupTexture.GetWidth() &&
+        (uint32_t)height == m_PopupTexture.GetHeight()) {
+        m_Renderer->UpdateTextureImage(m_PopupTexture.GetImage(), width, height, textureData.data());
+        return;
+    }
+    
+    // Popups change size as their contents change; the handle keeps its
+    // descriptor and retires the old image.
+    if (m_CefTextureSampler == VK_NULL_HANDLE) {
+        m_CefTextureSampler = m_Renderer->CreateTextureSampler();
+    }
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImage image = m_Renderer->CreateTextureImage(width, height, textureData.data(), memory);
+    m_PopupTexture.Attach(m_Renderer.get(), m_CefTextureSampler, image, memory, VK_FORMAT_R8G8B8A8_UNORM, width, height);
 }
 
 void Application::RenderUI() {
     // Single browser window with controls at the top
-    ImGui::Begin("Browser", nullptr, ImGuiWindowFlags_NoCollapse);
+    LayerCompositor* compositor = m_Renderer->GetCompositor();
+    // The compositor draws this window's background under the browser layer.
+    ImGui::Begin("Browser", nullptr, ImGuiWindowFlags_NoCollapse | (compositor ? ImGuiWindowFlags_NoBackground : 0));
+    if (m_FrameGovernor) {
+        m_FrameGovernor->SetFocused("Browser", ImGui::IsWindowFocused());
+    }
 
     if (m_VulkanFps > 0.0) {
         ImGui::Text("Vulkan loop: %.1f FPS (%.2f ms/frame)", m_VulkanFps, 1000.0 / m_VulkanFps);
@@ -361,6 +674,10 @@ void Application::RenderUI() {
         ImGui::Text("CEF begin frame: measuring...");
     }
 
+    if (TraceCapture::Get().IsActive()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Tracing... (F9 to stop)");
+    }
+
     if (m_RenderHandler) {
         const double paint_fps = m_RenderHandler->GetPaintFps();
         if (paint_fps > 0.0) {
@@ -370,6 +687,36 @@ void Application::RenderUI() {
         }
     }
     
+    if (m_ResourceSampler && ImGui::CollapsingHeader("Renderer processes")) {
+        ImGuiLayer::DrawResourceTable(m_ResourceSampler->GetSnapshot());
+    }
+    if (m_PerfProbe && ImGui::CollapsingHeader("Page performance")) {
+        ImGuiLayer::DrawPagePerfTable({ m_PerfProbe->GetSnapshot() });
+    }
+    if (m_FrameGovernor && ImGui::CollapsingHeader("Frame rate governor")) {
+        ImGuiLayer::DrawFrameRateTable(m_FrameGovernor->GetStats());
+    }
+    if (m_Watchdog && ImGui::CollapsingHeader("Renderer watchdog")) {
+        ImGuiLayer::DrawWatchdogTable(m_Watchdog->GetStats());
+    }
+    if (m_ContextPool && ImGui::CollapsingHeader("Request contexts")) {
+        ImGuiLayer::DrawRequestContextTable(m_ContextPool->GetStats());
+    }
+    if (ImGui::CollapsingHeader("Page loads")) {
+        ImGuiLayer::DrawPageLoadTable(PageLoadLog::Get().GetUrlStats());
+    }
+    if (m_AudioMixer && ImGui::CollapsingHeader("Audio")) {
+        std::vector<AudioMeterSnapshot> meters = m_AudioMixer->GetMeters();
+        meters.push_back(m_AudioMixer->GetMixMeter());
+        ImGuiLayer::DrawAudioMeters(meters);
+    }
+    if (compositor && ImGui::CollapsingHeader("Layer compositor")) {
+        ImGuiLayer::DrawCompositorStats(compositor->GetStats());
+    }
+    if (ImGui::CollapsingHeader("Metrics")) {
+        ImGuiLayer::DrawMetricsTable();
+    }
+    
     // URL controls at the top
     ImGui::Text("URL:");
     ImGui::SetNextItemWidth(-120); // Leave space for buttons
@@ -377,6 +724,7 @@ void Application::RenderUI() {
     ImGui::SameLine();
     
     if (ImGui::Button("Go") && m_Client->GetBrowser()) {
+        m_Client->GetLoadTracker()->BeginNavigation(m_UrlBuffer);
         m_Client->GetBrowser()->GetMainFrame()->LoadURL(m_UrlBuffer);
     }
     
@@ -399,13 +747,30 @@ void Application::RenderUI() {
     ImGui::Separator();
     
     // Browser view below the controls
-    if (m_CefDescriptorSet) {
+    if (m_CefTexture.GetDescriptorSet() || m_CefTexture.GetLayerTexture() != LayerCompositor::kInvalidTexture) {
         // Use fixed size for consistent layout
         ImVec2 browser_size = ImVec2((float)m_BrowserWidth, (float)m_BrowserHeight);
         ImVec2 pos = ImGui::GetCursorScreenPos();
         
         // Display the browser image
-        ImGui::Image((ImTextureID)m_CefDescriptorSet, browser_size);
+        if (compositor) {
+            ImGuiLayer::CompositeImage(*compositor, m_CefTexture.GetLayerTexture(), browser_size.x, browser_size.y);
+        } else {
+            ImGui::Image((ImTextureID)m_CefTexture.GetDescriptorSet(), browser_size);
+        }
+        
+        // The popup (e.g. an open <select>) is positioned in view coordinates.
+        if (m_RenderHandler->IsPopupVisible()) {
+            const CefRect popup = m_RenderHandler->GetPopupRect();
+            const ImVec2 popup_min(pos.x + popup.x, pos.y + popup.y);
+            if (compositor && m_PopupTexture.GetLayerTexture() != LayerCompositor::kInvalidTexture) {
+                ImGuiLayer::CompositePopup(*compositor, m_PopupTexture.GetLayerTexture(), popup_min.x, popup_min.y,
+                                           (float)popup.width, (float)popup.height);
+            } else if (m_PopupTexture.GetDescriptorSet()) {
+                ImGui::GetWindowDrawList()->AddImage((ImTextureID)m_PopupTexture.GetDescriptorSet(), popup_min,
+                    ImVec2(popup_min.x + popup.width, popup_min.y + popup.height));
+            }
+        }
         
         // Create an invisible button over the browser area to capture input
         ImGui::SetCursorScreenPos(pos);
@@ -475,15 +840,69 @@ void Application::RenderUI() {
     ImGui::End();
 }
 
+bool Application::ShouldClose() const {
+    if (m_Window) {
+        return glfwWindowShouldClose(m_Window);
+    }
+    return m_OffscreenFrameLimit > 0 && m_FramesRendered >= m_OffscreenFrameLimit;
+}
+
+void Application::NewPlatformFrame() {
+    if (m_Window) {
+        ImGui_ImplGlfw_NewFrame();
+        return;
+    }
+    ImGuiIO& io = ImGui::GetIO();
+    const VkExtent2D extent = m_Renderer->GetPresenter()->GetExtent();
+    io.DisplaySize = ImVec2((float)extent.width, (float)extent.height);
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<float> delta = now - m_LastImGuiFrame;
+    io.DeltaTime = delta.count() > 0.0f ? delta.count() : 1.0f / 60.0f;
+    m_LastImGuiFrame = now;
+}
+
+void Application::WriteOffscreenOutput() {
+    if (!m_OffscreenPresenter || m_OffscreenOutput.empty()) {
+        return;
+    }
+    std::vector<uint8_t> rgba;
+    uint32_t width = 0, height = 0;
+    if (!m_OffscreenPresenter->ReadPixels(rgba, width, height)) {
+        std::cerr << "No offscreen frame to write" << std::endl;
+        return;
+    }
+    if (WritePpm(m_OffscreenOutput, rgba, width, height)) {
+        std::cout << "Wrote " << width << "x" << height << " frame to " << m_OffscreenOutput << std::endl;
+    } else {
+        std::cerr << "Failed to write " << m_OffscreenOutput << std::endl;
+    }
+}
+
 void Application::Run() {
     ZoneScoped;
-    while (!glfwWindowShouldClose(m_Window)) {
+    IdleScheduler& idle = IdleScheduler::Get();
+    while (!ShouldClose()) {
+        if (m_Window) {
+            const bool busy = m_RenderHandler && (m_RenderHandler->IsDirty() || m_RenderHandler->IsPopupDirty());
+            const double wait = idle.GetWaitSeconds(busy);
+            if (wait > 0.0) {
+                glfwWaitEventsTimeout(wait);
+            } else {
+                glfwPollEvents();
+            }
+        }
         const auto frame_start = std::chrono::steady_clock::now();
-        FrameMark;
-        glfwPollEvents();
+        TraceCapture::Get().Tick();
 
-        if (m_Client && m_Client->GetBrowser()) {
+        // With external begin frames the windowless rate is not used, so the
+        // governed rate paces the begin frames instead. The 0.75 factor keeps
+        // a rate equal to the loop rate from skipping frames on jitter.
+        const int governed_fps = m_FrameGovernor ? m_FrameGovernor->GetFrameRate("Browser") : 0;
+        const bool begin_frame_due = governed_fps <= 0 ||
+            frame_start - m_LastBeginFrame >= std::chrono::duration<double>(0.75 / governed_fps);
+        if (m_Client && m_Client->GetBrowser() && begin_frame_due && !m_IdleRender) {
             m_Client->GetBrowser()->GetHost()->SendExternalBeginFrame();
+            m_LastBeginFrame = frame_start;
             ++m_BeginFrameSamples;
             const std::chrono::duration<double> begin_elapsed = frame_start - m_LastBeginFrameSample;
             if (begin_elapsed.count() >= 0.5) {
@@ -494,59 +913,119 @@ void Application::Run() {
         }
 
         // Process CEF events
+        idle.OnPumpWork();
         CefDoMessageLoopWork();
+        TrackBrowser();
+        if (m_FrameGovernor) {
+            m_FrameGovernor->Update();
+        }
         // Update CEF texture
         UpdateCefTexture();
+        UpdatePopupTexture();
+
+        // Pump-only wakeups end here without drawing.
+        const bool resized = m_Renderer->GetPresenter()->NeedsRecreate();
+        if (!idle.ShouldRender(ImGuiLayer::HasQueuedInput() || resized)) {
+            continue;
+        }
+        FrameMark;
+        TraceScope frame_trace("frame", "host");
         
-        // Begin frame
-        m_Renderer->BeginFrame();
+        // Begin frame; nothing to draw into while the window is minimized
+        // or the swapchain cannot be recreated yet.
+        if (!m_Renderer->BeginFrame()) {
+            continue;
+        }
         
         // Start ImGui frame
         ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
+        NewPlatformFrame();
         ImGui::NewFrame();
+
+        if (ImGui::IsKeyPressed(ImGuiKey_F9, false)) {
+            TraceCapture::Get().Toggle();
+        }
         
         // Render UI
         RenderUI();
         
-        // Render ImGui
+        // Render ImGui on top of the browser layers
         ImGui::Render();
+        m_Renderer->CompositeLayers();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_Renderer->GetCommandBuffer());
         
         // End frame
-        m_Renderer->EndFrame();
+        {
+            TraceScope present_trace("present", "host");
+            m_Renderer->EndFrame();
+        }
+        ++m_FramesRendered;
+        idle.OnFrameRendered();
+        if (m_Client) {
+            m_Client->GetLoadTracker()->OnPresent();
+        }
+
+        const std::chrono::duration<double, std::milli> frame_ms = std::chrono::steady_clock::now() - frame_start;
+        MetricsRegistry::Get().RecordHistogram("frame.loop_ms", frame_ms.count());
 
         ++m_FrameSamples;
         const std::chrono::duration<double> elapsed = frame_start - m_LastFpsSample;
         if (elapsed.count() >= 0.5) {
             m_VulkanFps = static_cast<double>(m_FrameSamples) / elapsed.count();
+            MetricsRegistry::Get().SetGauge("frame.vulkan_fps", m_VulkanFps);
             m_FrameSamples = 0;
             m_LastFpsSample = frame_start;
         }
     }
+    WriteOffscreenOutput();
 }
 
 void Application::Cleanup() {
+    if (m_ResourceSampler) {
+        m_ResourceSampler->Stop();
+        m_ResourceSampler = nullptr;
+    }
+    if (m_PerfProbe) {
+        m_PerfProbe->Detach();
+        m_PerfProbe = nullptr;
+    }
+    if (m_Watchdog) {
+        m_Watchdog->Stop();
+        m_Watchdog = nullptr;
+    }
+    if (m_ContextPool) {
+        m_ContextPool->Stop();
+        m_ContextPool = nullptr;
+    }
+    if (m_AudioMixer) {
+        m_AudioMixer->Stop();
+    }
+
     // Wait for device to be idle
     if (m_Renderer) {
         vkDeviceWaitIdle(m_Renderer->GetDevice());
     }
     
-    // Clean up Vulkan resources
+    // Clean up Vulkan resources. The handles' releases run in the flush,
+    // while ImGui and the converter are still alive.
+    if (m_Renderer) {
+        m_CefTexture.Release(m_Renderer.get());
+        m_PopupTexture.Release(m_Renderer.get());
+        m_Renderer->FlushDeferredReleases();
+    }
     if (m_CefTextureSampler != VK_NULL_HANDLE) {
         vkDestroySampler(m_Renderer->GetDevice(), m_CefTextureSampler, nullptr);
     }
-    if (m_CefTextureView != VK_NULL_HANDLE) {
-        vkDestroyImageView(m_Renderer->GetDevice(), m_CefTextureView, nullptr);
-    }
-    if (m_CefTextureImage != VK_NULL_HANDLE) {
-        vkDestroyImage(m_Renderer->GetDevice(), m_CefTextureImage, nullptr);
-        vkFreeMemory(m_Renderer->GetDevice(), m_CefTextureMemory, nullptr);
+    if (m_FrameConverter) {
+        m_FrameConverter->Cleanup();
+        m_FrameConverter.reset();
     }
     
     // Clean up ImGui
     ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if (m_Window) {
+        ImGui_ImplGlfw_Shutdown();
+    }
     ImGui::DestroyContext();
     
     // Clean up renderer
@@ -561,6 +1040,7 @@ void Application::Cleanup() {
     }
     
     // Shut down CEF
+    TraceCapture::Get().Shutdown();
     m_Client = nullptr;
     m_RenderHandler = nullptr;
     m_CefApp = nullptr;
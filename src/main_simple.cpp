@@ -84,6 +84,11 @@ bool Application::InitializeImGui() {
     init_info.Queue = m_Renderer->GetGraphicsQueue();
     init_info.DescriptorPool = m_Renderer->GetDescriptorPool();
     init_info.RenderPass = m_Renderer->GetRenderPass();
+    init_info.ApiVersion = m_Renderer->GetApiVersion();
+    init_info.UseDynamicRendering = m_Renderer->UsesDynamicRendering();
+    init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = m_Renderer->GetColorAttachmentFormat();
     init_info.MinImageCount = 2;
     init_info.ImageCount = 2;
     init_info.Allocator = nullptr;
@@ -161,7 +166,9 @@ void Application::Run() {
         glfwPollEvents();
         
         // Begin frame
-        m_Renderer->BeginFrame();
+        if (!m_Renderer->BeginFrame()) {
+            continue;
+        }
         
         // Start ImGui frame
         ImGui_ImplVulkan_NewFrame();
@@ -0,0 +1,100 @@
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+std::vector<MetricsRegistry::Sample> ToSamples(const std::map<std::string, double>& values) {
+    std::vector<MetricsRegistry::Sample> samples;
+    samples.reserve(values.size());
+    for (const auto& [name, value] : values) {
+        samples.push_back({ name, value });
+    }
+    return samples;
+}
+
+template <typename T>
+void ErasePrefix(std::map<std::string, T>& values, const std::string& prefix) {
+    auto it = values.lower_bound(prefix);
+    while (it != values.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        it = values.erase(it);
+    }
+}
+
+size_t BucketIndex(double value) {
+    if (value < 1.0) return 0;
+    const size_t index = static_cast<size_t>(std::log2(value)) + 1;
+    return std::min(index, MetricsRegistry::kHistogramBuckets - 1);
+}
+
+double BucketUpperBound(size_t index) {
+    return std::ldexp(1.0, static_cast<int>(index));
+}
+}  // namespace
+
+void MetricsRegistry::Histogram::Record(double value) {
+    value = std::max(0.0, value);
+    ++count;
+    sum += value;
+    max = std::max(max, value);
+    ++buckets[BucketIndex(value)];
+}
+
+double MetricsRegistry::Histogram::Percentile(double fraction) const {
+    if (count == 0) return 0.0;
+    const double target = fraction * static_cast<double>(count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (static_cast<double>(seen) >= target) {
+            return std::min(BucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+MetricsRegistry& MetricsRegistry::Get() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void MetricsRegistry::SetGauge(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Gauges[name] = value;
+}
+
+void MetricsRegistry::AddCounter(const std::string& name, double delta) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Counters[name] += delta;
+}
+
+void MetricsRegistry::RecordHistogram(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Histograms[name].Record(value);
+}
+
+void MetricsRegistry::RemovePrefix(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ErasePrefix(m_Gauges, prefix);
+    ErasePrefix(m_Counters, prefix);
+    ErasePrefix(m_Histograms, prefix);
+}
+
+std::vector<MetricsRegistry::Sample> MetricsRegistry::GetGauges() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return ToSamples(m_Gauges);
+}
+
+std::vector<MetricsRegistry::Sample> MetricsRegistry::GetCounters() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return ToSamples(m_Counters);
+}
+
+std::vector<MetricsRegistry::HistogramSample> MetricsRegistry::GetHistograms() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<HistogramSample> samples;
+    samples.reserve(m_Histograms.size());
+    for (const auto& [name, histogram] : m_Histograms) {
+        samples.push_back({ name, histogram });
+    }
+    return samples;
+}
@@ -0,0 +1,224 @@
+#include "../include/page_load_telemetry.h"
+#include "include/cef_parser.h"
+#include "include/cef_values.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+constexpr uint64_t kDefaultLogKb = 256;
+
+int64_t WallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+}  // namespace
+
+PageLoadLog& PageLoadLog::Get() {
+    static PageLoadLog log;
+    return log;
+}
+
+void PageLoadLog::ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine,
+                                           const std::filesystem::path& defaultPath) {
+    std::filesystem::path path = defaultPath;
+    uint64_t maxKb = kDefaultLogKb;
+    if (commandLine) {
+        const std::string value = commandLine->GetSwitchValue("load-log").ToString();
+        if (!value.empty()) path = value;
+        if (commandLine->HasSwitch("load-log-kb")) {
+            try {
+                maxKb = static_cast<uint64_t>(std::max(0LL, std::stoll(commandLine->GetSwitchValue("load-log-kb").ToString())));
+            } catch (...) {
+                std::cerr << "Ignoring invalid --load-log-kb value" << std::endl;
+            }
+        }
+    }
+    SetLogFile(path, maxKb * 1024);
+}
+
+void PageLoadLog::SetLogFile(const std::filesystem::path& path, uint64_t maxBytes) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_File.is_open()) m_File.close();
+    m_Path = path;
+    m_MaxBytes = maxBytes;
+    m_FileBytes = 0;
+    if (m_Path.empty() || m_MaxBytes == 0) return;
+
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(m_Path, error);
+    if (!error) m_FileBytes = size;
+    m_File.open(m_Path, std::ios::binary | std::ios::app);
+    if (!m_File) std::cerr << "Failed to open page load log " << m_Path.string() << std::endl;
+}
+
+void PageLoadLog::Record(const PageLoadRecord& record) {
+    ZoneScoped;
+    const std::string key = UrlKey(record.url);
+    const bool failed = record.errorCode != 0 || record.httpStatus >= 400;
+    bool logging = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        logging = m_File.is_open();
+        PageLoadUrlStats& stats = m_Urls[key];
+        stats.url = key;
+        ++stats.loads;
+        if (failed) ++stats.errors;
+        if (record.httpStatus != 0) stats.lastStatus = record.httpStatus;
+        if (record.loadEndMs >= 0.0) stats.loadEndMs.Record(record.loadEndMs);
+        if (record.firstPresentMs >= 0.0) stats.firstPresentMs.Record(record.firstPresentMs);
+
+        m_Recent.push_back(record);
+        if (m_Recent.size() > kRecentLimit) m_Recent.pop_front();
+    }
+
+    const std::string prefix = "load." + key + ".";
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.AddCounter(prefix + "count");
+    if (failed) registry.AddCounter(prefix + "errors");
+    if (record.loadEndMs >= 0.0) registry.RecordHistogram(prefix + "load_end_ms", record.loadEndMs);
+    if (record.firstPaintMs >= 0.0) registry.RecordHistogram(prefix + "first_paint_ms", record.firstPaintMs);
+    if (record.firstPresentMs >= 0.0) registry.RecordHistogram(prefix + "first_present_ms", record.firstPresentMs);
+
+    if (logging) AppendLine(ToJson(record));
+}
+
+void PageLoadLog::AppendLine(const std::string& line) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_File.is_open()) return;
+
+    if (m_FileBytes > 0 && m_FileBytes + line.size() + 1 > m_MaxBytes) {
+        m_File.close();
+        std::filesystem::path rolled = m_Path;
+        rolled += ".1";
+        std::error_code error;
+        std::filesystem::rename(m_Path, rolled, error);
+        if (error) std::filesystem::remove(m_Path, error);
+        m_File.open(m_Path, std::ios::binary | std::ios::trunc);
+        m_FileBytes = 0;
+        if (!m_File) return;
+    }
+    m_File << line << '\n';
+    m_File.flush();
+    m_FileBytes += line.size() + 1;
+}
+
+std::vector<PageLoadUrlStats> PageLoadLog::GetUrlStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<PageLoadUrlStats> stats;
+    stats.reserve(m_Urls.size());
+    for (const auto& [url, entry] : m_Urls) stats.push_back(entry);
+    return stats;
+}
+
+std::vector<PageLoadRecord> PageLoadLog::GetRecent() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return std::vector<PageLoadRecord>(m_Recent.begin(), m_Recent.end());
+}
+
+std::string PageLoadLog::UrlKey(const std::string& url) {
+    const size_t end = url.find_first_of("?#");
+    return end == std::string::npos ? url : url.substr(0, end);
+}
+
+std::string PageLoadLog::ToJson(const PageLoadRecord& record) {
+    CefRefPtr<CefDictionaryValue> dict = CefDictionaryValue::Create();
+    dict->SetString("panel", record.panel);
+    dict->SetString("url", record.url);
+    dict->SetDouble("started_at_ms", static_cast<double>(record.startedAtMs));
+    dict->SetInt("http_status", record.httpStatus);
+    dict->SetInt("error_code", record.errorCode);
+    if (!record.errorText.empty()) dict->SetString("error_text", record.errorText);
+    dict->SetBool("completed", record.completed);
+    auto setStage = [&](const char* name, double value) {
+        if (value >= 0.0) dict->SetDouble(name, value);
+    };
+    setStage("load_start_ms", record.loadStartMs);
+    setStage("load_end_ms", record.loadEndMs);
+    setStage("first_paint_ms", record.firstPaintMs);
+    setStage("first_upload_ms", record.firstUploadMs);
+    setStage("first_present_ms", record.firstPresentMs);
+
+    CefRefPtr<CefValue> value = CefValue::Create();
+    value->SetDictionary(dict);
+    return CefWriteJSON(value, JSON_WRITER_DEFAULT).ToString();
+}
+
+PageLoadTracker::PageLoadTracker(std::string panel)
+    : m_Panel(std::move(panel)) {}
+
+void PageLoadTracker::BeginNavigation(const std::string& url) {
+    if (m_Active) Finish();
+    m_Active = true;
+    m_Start = std::chrono::steady_clock::now();
+    m_Record = PageLoadRecord();
+    m_Record.panel = m_Panel;
+    m_Record.url = url;
+    m_Record.startedAtMs = WallClockMs();
+}
+
+void PageLoadTracker::OnLoadingStateChange(bool isLoading) {
+    // A renderer-initiated navigation; app-initiated ones are already active
+    // and have not committed yet.
+    if (isLoading && (!m_Active || m_Record.loadStartMs >= 0.0)) BeginNavigation(m_Record.url);
+}
+
+void PageLoadTracker::OnAddressChange(const std::string& url) {
+    if (m_Active) m_Record.url = url;
+}
+
+void PageLoadTracker::OnLoadStart() {
+    if (m_Active && m_Record.loadStartMs < 0.0) m_Record.loadStartMs = Elapsed();
+}
+
+void PageLoadTracker::OnLoadEnd(int httpStatus) {
+    if (!m_Active) return;
+    if (m_Record.loadEndMs < 0.0) m_Record.loadEndMs = Elapsed();
+    m_Record.httpStatus = httpStatus;
+    if (m_Record.completed) Finish();
+}
+
+void PageLoadTracker::OnLoadError(int errorCode, const std::string& errorText, const std::string& failedUrl) {
+    if (!m_Active) BeginNavigation(failedUrl);
+    m_Record.errorCode = errorCode;
+    m_Record.errorText = errorText;
+    if (!failedUrl.empty()) m_Record.url = failedUrl;
+    if (m_Record.completed) Finish();
+}
+
+void PageLoadTracker::OnPaint() {
+    if (m_Active && m_Record.loadStartMs >= 0.0 && m_Record.firstPaintMs < 0.0) m_Record.firstPaintMs = Elapsed();
+}
+
+void PageLoadTracker::OnUpload() {
+    if (m_Active && m_Record.firstPaintMs >= 0.0 && m_Record.firstUploadMs < 0.0) m_Record.firstUploadMs = Elapsed();
+}
+
+void PageLoadTracker::OnPresent() {
+    if (!m_Active || m_Record.firstUploadMs < 0.0 || m_Record.completed) return;
+    m_Record.firstPresentMs = Elapsed();
+    m_Record.completed = true;
+    // The first present usually comes before OnLoadEnd; keep the record open
+    // for the load end time and HTTP status.
+    if (m_Record.loadEndMs >= 0.0 || m_Record.errorCode != 0) Finish();
+}
+
+void PageLoadTracker::OnClose() {
+    if (m_Active) Finish();
+}
+
+double PageLoadTracker::Elapsed() const {
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_Start;
+    return elapsed.count();
+}
+
+void PageLoadTracker::Finish() {
+    m_Active = false;
+    if (m_Record.url.empty()) return;
+    PageLoadLog::Get().Record(m_Record);
+}
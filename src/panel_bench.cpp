@@ -0,0 +1,221 @@
+#include "../include/panel_bench.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+#if defined(__linux__)
+// Parent pid from /proc/<pid>/stat; the command name in parentheses may
+// itself contain spaces or parentheses, so parse after the last ')'.
+bool ReadParentPid(const std::string& pid, long& parent) {
+    std::ifstream in("/proc/" + pid + "/stat");
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    const size_t close = line.rfind(')');
+    if (close == std::string::npos) return false;
+    std::istringstream fields(line.substr(close + 1));
+    char state = 0;
+    return static_cast<bool>(fields >> state >> parent);
+}
+
+// This process and its descendants, from the parent pids in /proc.
+std::vector<long> ProcessTree() {
+    std::multimap<long, long> children;
+    if (DIR* proc = opendir("/proc")) {
+        while (dirent* entry = readdir(proc)) {
+            const std::string name = entry->d_name;
+            if (name.empty() || !std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                continue;
+            }
+            long parent = 0;
+            if (ReadParentPid(name, parent)) children.emplace(parent, std::stol(name));
+        }
+        closedir(proc);
+    }
+    std::vector<long> tree;
+    std::vector<long> pending = { static_cast<long>(getpid()) };
+    while (!pending.empty()) {
+        const long pid = pending.back();
+        pending.pop_back();
+        tree.push_back(pid);
+        const auto range = children.equal_range(pid);
+        for (auto it = range.first; it != range.second; ++it) pending.push_back(it->second);
+    }
+    return tree;
+}
+
+// utime plus stime from /proc/<pid>/stat, in clock ticks.
+uint64_t ReadCpuTicks(long pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(in, line)) return 0;
+    const size_t close = line.rfind(')');
+    if (close == std::string::npos) return 0;
+    std::istringstream fields(line.substr(close + 1));
+    // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt
+    std::string skipped;
+    for (int i = 0; i < 11; ++i) fields >> skipped;
+    uint64_t user = 0, system = 0;
+    if (!(fields >> user >> system)) return 0;
+    return user + system;
+}
+
+void AddProcessMemory(long pid, ProcessTreeMemory& memory) {
+    const std::string dir = "/proc/" + std::to_string(pid);
+    std::ifstream rollup(dir + "/smaps_rollup");
+    std::string key;
+    uint64_t kilobytes = 0;
+    bool found = false;
+    while (rollup >> key) {
+        if (key == "Rss:" && rollup >> kilobytes) {
+            memory.rssBytes += kilobytes * 1024;
+            found = true;
+        } else if (key == "Pss:" && rollup >> kilobytes) {
+            memory.pssBytes += kilobytes * 1024;
+        }
+        rollup.ignore(1 << 16, '\n');
+    }
+    if (!found) {
+        // Kernels before 4.14, or a process we may not inspect.
+        std::ifstream statm(dir + "/statm");
+        uint64_t size = 0, resident = 0;
+        if (statm >> size >> resident) {
+            memory.rssBytes += resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        }
+    }
+    ++memory.processes;
+}
+#endif
+}  // namespace
+
+ProcessTreeMemory SampleProcessTreeMemory() {
+    ZoneScoped;
+    ProcessTreeMemory memory;
+#if defined(__linux__)
+    for (long pid : ProcessTree()) AddProcessMemory(pid, memory);
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        memory.processes = 1;
+        memory.rssBytes = counters.WorkingSetSize;
+    }
+#endif
+    return memory;
+}
+
+double SampleProcessTreeCpuSeconds() {
+    ZoneScoped;
+#if defined(__linux__)
+    uint64_t ticks = 0;
+    for (long pid : ProcessTree()) ticks += ReadCpuTicks(pid);
+    return static_cast<double>(ticks) / static_cast<double>(sysconf(_SC_CLK_TCK));
+#elif defined(_WIN32)
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0.0;
+    auto seconds = [](const FILETIME& time) {
+        return ((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 1e7;
+    };
+    return seconds(kernel) + seconds(user);
+#else
+    return 0.0;
+#endif
+}
+
+PanelBench::PanelBench(std::string profile, int panels, double warmupSeconds, double seconds)
+    : m_Profile(std::move(profile)),
+      m_Panels(panels),
+      m_Warmup(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(warmupSeconds))),
+      m_Duration(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds))) {
+}
+
+void PanelBench::OnFrame(double frameMs, bool ready) {
+    if (m_Done) return;
+    const Clock::time_point now = Clock::now();
+    if (!m_Ready) {
+        if (!ready) return;
+        m_Ready = true;
+        m_ReadyAt = now;
+        m_NextSample = now + m_Warmup;
+    }
+    if (now < m_ReadyAt + m_Warmup) return;
+    if (m_FrameMs.empty()) AddCpuSample(SampleProcessTreeCpuSeconds(), 0);
+    m_FrameMs.push_back(frameMs);
+    if (now >= m_ReadyAt + m_Warmup + m_Duration) m_Done = true;
+    if (now >= m_NextSample || m_Done) {
+        AddMemorySample(SampleProcessTreeMemory());
+        AddCpuSample(SampleProcessTreeCpuSeconds(), m_FrameMs.size());
+        m_NextSample = now + std::chrono::seconds(1);
+    }
+}
+
+void PanelBench::AddMemorySample(const ProcessTreeMemory& memory) {
+    m_Memory.push_back(memory);
+}
+
+void PanelBench::AddCpuSample(double cpuSeconds, size_t frames) {
+    if (!m_HasCpuSample) {
+        m_HasCpuSample = true;
+        m_CpuFirst = cpuSeconds;
+        m_CpuFirstFrames = frames;
+    }
+    m_CpuLast = cpuSeconds;
+    m_CpuLastFrames = frames;
+}
+
+double PanelBench::Percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) return 0.0;
+    const size_t rank = static_cast<size_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * values.size()));
+    const size_t index = rank == 0 ? 0 : rank - 1;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+std::string PanelBench::FormatReport() const {
+    double rssMean = 0.0, pssMean = 0.0, rssPeak = 0.0;
+    int processes = 0;
+    for (const ProcessTreeMemory& memory : m_Memory) {
+        const double rss = memory.rssBytes / (1024.0 * 1024.0);
+        rssMean += rss;
+        pssMean += memory.pssBytes / (1024.0 * 1024.0);
+        rssPeak = std::max(rssPeak, rss);
+        processes = std::max(processes, memory.processes);
+    }
+    if (!m_Memory.empty()) {
+        rssMean /= m_Memory.size();
+        pssMean /= m_Memory.size();
+    }
+    double mean = 0.0;
+    for (double frame : m_FrameMs) mean += frame;
+    if (!m_FrameMs.empty()) mean /= m_FrameMs.size();
+
+    const double cpuMsPerFrame = m_CpuLastFrames > m_CpuFirstFrames
+        ? (m_CpuLast - m_CpuFirst) * 1000.0 / static_cast<double>(m_CpuLastFrames - m_CpuFirstFrames)
+        : 0.0;
+
+    char buffer[512];
+    std::snprintf(buffer, sizeof(buffer),
+                  "Bench result: profile=%s panels=%d frames=%zu frame_ms_mean=%.2f frame_ms_p50=%.2f "
+                  "frame_ms_p95=%.2f frame_ms_p99=%.2f processes=%d rss_mb=%.1f rss_peak_mb=%.1f pss_mb=%.1f "
+                  "cpu_ms_per_frame=%.2f software=%s",
+                  m_Profile.empty() ? "none" : m_Profile.c_str(), m_Panels, m_FrameMs.size(), mean,
+                  Percentile(m_FrameMs, 0.50), Percentile(m_FrameMs, 0.95), Percentile(m_FrameMs, 0.99), processes,
+                  rssMean, rssPeak, pssMean, cpuMsPerFrame, m_SoftwareMode ? "on" : "off");
+    return buffer;
+}
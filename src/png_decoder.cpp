@@ -0,0 +1,393 @@
+#include "../include/png_decoder.h"
+#include "../include/png_encoder.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+// Canonical Huffman decoding table, as in RFC 1951 3.2.2: code lengths
+// count[len] and symbols sorted by code.
+struct Huffman {
+    uint16_t count[16] = {};
+    std::vector<uint16_t> symbols;
+
+    // False for an over-subscribed code. Incomplete codes are allowed (a
+    // single distance code is legal).
+    bool Build(const uint8_t* lengths, size_t n) {
+        std::fill(std::begin(count), std::end(count), 0);
+        for (size_t i = 0; i < n; ++i) ++count[lengths[i]];
+        count[0] = 0;
+        int left = 1;
+        for (int len = 1; len < 16; ++len) {
+            left = (left << 1) - count[len];
+            if (left < 0) return false;
+        }
+        uint16_t offsets[16] = {};
+        for (int len = 1; len < 15; ++len) offsets[len + 1] = offsets[len] + count[len];
+        symbols.assign(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            if (lengths[i] != 0) symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+        }
+        return true;
+    }
+};
+
+class Inflater {
+public:
+    Inflater(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+    bool Run(std::vector<uint8_t>& out) {
+        bool last = false;
+        while (!last) {
+            int bits = 0;
+            if (!Bits(1, bits)) return false;
+            last = bits != 0;
+            int type = 0;
+            if (!Bits(2, type)) return false;
+            bool ok = false;
+            if (type == 0) ok = Stored(out);
+            else if (type == 1) ok = Fixed(out);
+            else if (type == 2) ok = Dynamic(out);
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    // Bytes consumed so far, rounded up to the byte.
+    size_t GetPosition() const { return m_Position; }
+
+private:
+    const uint8_t* m_Data;
+    size_t m_Size;
+    size_t m_Position = 0;
+    uint32_t m_BitBuffer = 0;
+    int m_BitCount = 0;
+
+    bool Bits(int need, int& value) {
+        uint32_t buffer = m_BitBuffer;
+        while (m_BitCount < need) {
+            if (m_Position >= m_Size) return false;
+            buffer |= static_cast<uint32_t>(m_Data[m_Position++]) << m_BitCount;
+            m_BitCount += 8;
+        }
+        value = static_cast<int>(buffer & ((1u << need) - 1));
+        m_BitBuffer = buffer >> need;
+        m_BitCount -= need;
+        return true;
+    }
+
+    bool Decode(const Huffman& huffman, int& symbol) {
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len < 16; ++len) {
+            int bit = 0;
+            if (!Bits(1, bit)) return false;
+            code |= bit;
+            const int count = huffman.count[len];
+            if (code - count < first) {
+                symbol = huffman.symbols[index + (code - first)];
+                return true;
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return false;
+    }
+
+    bool Stored(std::vector<uint8_t>& out) {
+        m_BitBuffer = 0;
+        m_BitCount = 0;
+        if (m_Position + 4 > m_Size) return false;
+        const uint16_t length = static_cast<uint16_t>(m_Data[m_Position] | m_Data[m_Position + 1] << 8);
+        const uint16_t complement = static_cast<uint16_t>(m_Data[m_Position + 2] | m_Data[m_Position + 3] << 8);
+        m_Position += 4;
+        if (length != static_cast<uint16_t>(~complement) || m_Position + length > m_Size) return false;
+        out.insert(out.end(), m_Data + m_Position, m_Data + m_Position + length);
+        m_Position += length;
+        return true;
+    }
+
+    bool Codes(std::vector<uint8_t>& out, const Huffman& lengths, const Huffman& distances) {
+        static const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                                    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                                    6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        for (;;) {
+            int symbol = 0;
+            if (!Decode(lengths, symbol)) return false;
+            if (symbol < 256) {
+                out.push_back(static_cast<uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == 256) return true;
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            int extra = 0;
+            if (!Bits(kLengthExtra[symbol], extra)) return false;
+            const size_t length = kLengthBase[symbol] + extra;
+            if (!Decode(distances, symbol) || symbol >= 30) return false;
+            if (!Bits(kDistanceExtra[symbol], extra)) return false;
+            const size_t distance = kDistanceBase[symbol] + extra;
+            if (distance > out.size()) return false;
+            const size_t from = out.size() - distance;
+            for (size_t i = 0; i < length; ++i) out.push_back(out[from + i]);
+        }
+    }
+
+    bool Fixed(std::vector<uint8_t>& out) {
+        static Huffman lengths, distances;
+        static const bool built = [] {
+            uint8_t lengthBits[288];
+            std::fill(lengthBits, lengthBits + 144, 8);
+            std::fill(lengthBits + 144, lengthBits + 256, 9);
+            std::fill(lengthBits + 256, lengthBits + 280, 7);
+            std::fill(lengthBits + 280, lengthBits + 288, 8);
+            uint8_t distanceBits[30];
+            std::fill(distanceBits, distanceBits + 30, 5);
+            return lengths.Build(lengthBits, 288) && distances.Build(distanceBits, 30);
+        }();
+        return built && Codes(out, lengths, distances);
+    }
+
+    bool Dynamic(std::vector<uint8_t>& out) {
+        static const uint8_t kOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        int literalCount = 0, distanceCount = 0, codeCount = 0;
+        if (!Bits(5, literalCount) || !Bits(5, distanceCount) || !Bits(4, codeCount)) return false;
+        literalCount += 257;
+        distanceCount += 1;
+        codeCount += 4;
+        if (literalCount > 286 || distanceCount > 30) return false;
+
+        uint8_t codeLengths[19] = {};
+        for (int i = 0; i < codeCount; ++i) {
+            int value = 0;
+            if (!Bits(3, value)) return false;
+            codeLengths[kOrder[i]] = static_cast<uint8_t>(value);
+        }
+        Huffman codes;
+        if (!codes.Build(codeLengths, 19)) return false;
+
+        uint8_t bitLengths[286 + 30] = {};
+        int index = 0;
+        while (index < literalCount + distanceCount) {
+            int symbol = 0;
+            if (!Decode(codes, symbol)) return false;
+            if (symbol < 16) {
+                bitLengths[index++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            uint8_t repeat = 0;
+            int times = 0;
+            if (symbol == 16) {
+                if (index == 0 || !Bits(2, times)) return false;
+                repeat = bitLengths[index - 1];
+                times += 3;
+            } else if (symbol == 17) {
+                if (!Bits(3, times)) return false;
+                times += 3;
+            } else {
+                if (!Bits(7, times)) return false;
+                times += 11;
+            }
+            if (index + times > literalCount + distanceCount) return false;
+            while (times-- > 0) bitLengths[index++] = repeat;
+        }
+        // A block without an end-of-block code cannot terminate.
+        if (bitLengths[256] == 0) return false;
+        Huffman lengths, distances;
+        if (!lengths.Build(bitLengths, literalCount)) return false;
+        if (!distances.Build(bitLengths + literalCount, distanceCount)) return false;
+        return Codes(out, lengths, distances);
+    }
+};
+
+uint32_t ReadBigEndian(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+bool Fail(std::string* error, const char* message) {
+    if (error) *error = message;
+    return false;
+}
+
+uint8_t Paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+}  // namespace
+
+bool InflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    if (size < 6) return false;
+    const uint8_t cmf = data[0], flg = data[1];
+    // Deflate with a window of at most 32 KiB, no preset dictionary.
+    if ((cmf & 0x0f) != 8 || (cmf >> 4) > 7 || (flg & 0x20) || ((cmf << 8) | flg) % 31 != 0) return false;
+    out.clear();
+    Inflater inflater(data + 2, size - 2);
+    if (!inflater.Run(out)) return false;
+    const size_t end = 2 + inflater.GetPosition();
+    if (end + 4 > size) return false;
+    return ReadBigEndian(data + end) == Adler32(out.data(), out.size());
+}
+
+bool DecodePng(const uint8_t* data, size_t size, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height,
+               std::string* error) {
+    ZoneScoped;
+    static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if (size < 8 || std::memcmp(data, kSignature, 8) != 0) return Fail(error, "not a PNG file");
+
+    int bitDepth = 0, colorType = -1, interlace = 0;
+    std::vector<uint8_t> idat;
+    std::vector<uint8_t> palette;
+    std::vector<uint8_t> paletteAlpha;
+    std::vector<uint8_t> transparent;
+    bool ended = false;
+    for (size_t pos = 8; pos + 12 <= size && !ended;) {
+        const uint32_t length = ReadBigEndian(data + pos);
+        if (length > size - pos - 12) return Fail(error, "truncated chunk");
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = data + pos + 8;
+        if (ReadBigEndian(body + length) != Crc32(type, length + 4)) return Fail(error, "chunk CRC mismatch");
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13) return Fail(error, "bad IHDR");
+            width = ReadBigEndian(body);
+            height = ReadBigEndian(body + 4);
+            bitDepth = body[8];
+            colorType = body[9];
+            interlace = body[12];
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(body, body + length);
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (colorType == 3) paletteAlpha.assign(body, body + length);
+            else transparent.assign(body, body + length);
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            idat.insert(idat.end(), body, body + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        } else if (!(type[0] & 0x20)) {
+            return Fail(error, "unknown critical chunk");
+        }
+        pos += 12 + length;
+    }
+    if (colorType < 0 || width == 0 || height == 0) return Fail(error, "missing IHDR");
+    if (!ended) return Fail(error, "missing IEND");
+    if (interlace != 0) return Fail(error, "interlaced PNGs are not supported");
+
+    int channels = 0;
+    switch (colorType) {
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default: return Fail(error, "bad color type");
+    }
+    const bool depthOk = bitDepth == 8 || bitDepth == 16 ||
+                         ((colorType == 0 || colorType == 3) && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4));
+    if (!depthOk || (colorType == 3 && bitDepth == 16)) return Fail(error, "bad bit depth");
+    if (colorType == 3 && (palette.empty() || palette.size() % 3 != 0)) return Fail(error, "missing palette");
+    if (width > (1u << 16) || height > (1u << 16)) return Fail(error, "image too large");
+
+    const size_t bitsPerPixel = static_cast<size_t>(channels) * bitDepth;
+    const size_t stride = (width * bitsPerPixel + 7) / 8;
+    const size_t filterBytes = std::max<size_t>(1, bitsPerPixel / 8);
+    std::vector<uint8_t> filtered;
+    if (!InflateZlib(idat.data(), idat.size(), filtered)) return Fail(error, "corrupt zlib stream");
+    if (filtered.size() < (stride + 1) * height) return Fail(error, "not enough image data");
+
+    std::vector<uint8_t> previous(stride, 0), row(stride);
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* in = filtered.data() + y * (stride + 1);
+        const uint8_t filter = in[0];
+        for (size_t i = 0; i < stride; ++i) {
+            const int a = i >= filterBytes ? row[i - filterBytes] : 0;
+            const int b = previous[i];
+            const int c = i >= filterBytes ? previous[i - filterBytes] : 0;
+            uint8_t predictor = 0;
+            switch (filter) {
+                case 0: break;
+                case 1: predictor = static_cast<uint8_t>(a); break;
+                case 2: predictor = static_cast<uint8_t>(b); break;
+                case 3: predictor = static_cast<uint8_t>((a + b) / 2); break;
+                case 4: predictor = Paeth(a, b, c); break;
+                default: return Fail(error, "bad row filter");
+            }
+            row[i] = static_cast<uint8_t>(in[1 + i] + predictor);
+        }
+
+        uint8_t* out = rgba.data() + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; ++x, out += 4) {
+            // Sample |channel| of pixel x, reduced to 8 bits.
+            auto sample = [&](int channel) -> int {
+                const size_t index = static_cast<size_t>(x) * channels + channel;
+                if (bitDepth == 8) return row[index];
+                if (bitDepth == 16) return row[index * 2];
+                const size_t bit = index * bitDepth;
+                const int shift = 8 - bitDepth - static_cast<int>(bit % 8);
+                return (row[bit / 8] >> shift) & ((1 << bitDepth) - 1);
+            };
+            // Raw sample value, for matching tRNS colors at the file's depth.
+            auto raw = [&](int channel) -> int {
+                const size_t index = static_cast<size_t>(x) * channels + channel;
+                if (bitDepth == 16) return row[index * 2] << 8 | row[index * 2 + 1];
+                return bitDepth == 8 ? row[index] : sample(channel);
+            };
+            auto scale = [&](int value) -> uint8_t {
+                return static_cast<uint8_t>(bitDepth >= 8 ? value : value * 255 / ((1 << bitDepth) - 1));
+            };
+            auto matches = [&](int channel, size_t offset) {
+                return transparent.size() >= offset + 2 &&
+                       raw(channel) == (transparent[offset] << 8 | transparent[offset + 1]);
+            };
+            switch (colorType) {
+                case 0: {
+                    out[0] = out[1] = out[2] = scale(sample(0));
+                    out[3] = matches(0, 0) ? 0 : 255;
+                    break;
+                }
+                case 2: {
+                    out[0] = static_cast<uint8_t>(sample(0));
+                    out[1] = static_cast<uint8_t>(sample(1));
+                    out[2] = static_cast<uint8_t>(sample(2));
+                    out[3] = matches(0, 0) && matches(1, 2) && matches(2, 4) ? 0 : 255;
+                    break;
+                }
+                case 3: {
+                    const size_t entry = static_cast<size_t>(sample(0));
+                    if (entry * 3 + 2 >= palette.size()) return Fail(error, "palette index out of range");
+                    out[0] = palette[entry * 3];
+                    out[1] = palette[entry * 3 + 1];
+                    out[2] = palette[entry * 3 + 2];
+                    out[3] = entry < paletteAlpha.size() ? paletteAlpha[entry] : 255;
+                    break;
+                }
+                case 4: {
+                    out[0] = out[1] = out[2] = static_cast<uint8_t>(sample(0));
+                    out[3] = static_cast<uint8_t>(sample(1));
+                    break;
+                }
+                default: {
+                    for (int c = 0; c < 4; ++c) out[c] = static_cast<uint8_t>(sample(c));
+                    break;
+                }
+            }
+        }
+        previous.swap(row);
+    }
+    return true;
+}
@@ -0,0 +1,345 @@
+#include "../include/png_encoder.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define IMGUICEF_PACK_SSSE3
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define IMGUICEF_TARGET_SSSE3
+#else
+#define IMGUICEF_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define IMGUICEF_PACK_NEON
+#endif
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+#ifdef IMGUICEF_PACK_SSSE3
+bool HasSsse3() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+// Four pixels per shuffle. Each store writes 16 bytes of which 12 are
+// pixels, so the loop stops while at least 6 pixels remain and the scalar
+// tail finishes.
+IMGUICEF_TARGET_SSSE3 size_t PackRgbSsse3(const uint8_t* src, uint8_t* dst, size_t pixels, PixelOrder order) {
+    const __m128i mask = order == PixelOrder::Rgba
+        ? _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1)
+        : _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 6 <= pixels; i += 4) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(in, mask));
+    }
+    return i;
+}
+#endif
+
+#ifdef IMGUICEF_PACK_NEON
+size_t PackRgbNeon(const uint8_t* src, uint8_t* dst, size_t pixels, PixelOrder order) {
+    size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        const uint8x16x4_t in = vld4q_u8(src + i * 4);
+        uint8x16x3_t out;
+        out.val[0] = order == PixelOrder::Rgba ? in.val[0] : in.val[2];
+        out.val[1] = in.val[1];
+        out.val[2] = order == PixelOrder::Rgba ? in.val[2] : in.val[0];
+        vst3q_u8(dst + i * 3, out);
+    }
+    return i;
+}
+#endif
+
+const std::array<uint32_t, 256>& CrcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+        return entries;
+    }();
+    return table;
+}
+
+// Deflate writes bits LSB first; Huffman codes go in MSB first.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_Out(out) {}
+
+    void PutBits(uint32_t value, int count) {
+        m_Buffer |= static_cast<uint64_t>(value) << m_Count;
+        m_Count += count;
+        while (m_Count >= 8) {
+            m_Out.push_back(static_cast<uint8_t>(m_Buffer));
+            m_Buffer >>= 8;
+            m_Count -= 8;
+        }
+    }
+    void PutCode(uint32_t code, int count) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < count; ++i) reversed |= ((code >> i) & 1u) << (count - 1 - i);
+        PutBits(reversed, count);
+    }
+    void Flush() {
+        if (m_Count > 0) m_Out.push_back(static_cast<uint8_t>(m_Buffer));
+        m_Buffer = 0;
+        m_Count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& m_Out;
+    uint64_t m_Buffer = 0;
+    int m_Count = 0;
+};
+
+const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                     257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                     8193, 12289, 16385, 24577 };
+const uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                     7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Fixed literal/length code (RFC 1951, 3.2.6).
+void PutLiteralLength(BitWriter& bits, uint32_t symbol) {
+    if (symbol < 144) bits.PutCode(0x30 + symbol, 8);
+    else if (symbol < 256) bits.PutCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280) bits.PutCode(symbol - 256, 7);
+    else bits.PutCode(0xC0 + symbol - 280, 8);
+}
+
+void PutMatch(BitWriter& bits, uint32_t length, uint32_t distance) {
+    int code = 28;
+    while (kLengthBase[code] > length) --code;
+    PutLiteralLength(bits, 257 + code);
+    bits.PutBits(length - kLengthBase[code], kLengthExtra[code]);
+    code = 29;
+    while (kDistanceBase[code] > distance) --code;
+    bits.PutCode(static_cast<uint32_t>(code), 5);
+    bits.PutBits(distance - kDistanceBase[code], kDistanceExtra[code]);
+}
+
+// One final fixed-Huffman block. Matches come from a hash of the next three
+// bytes and a bounded walk down the chain of earlier positions.
+void Deflate(const std::vector<uint8_t>& data, std::vector<uint8_t>& out) {
+    constexpr size_t kWindow = 32768;
+    constexpr int kHashBits = 15;
+    constexpr int kMaxChain = 24;
+    constexpr size_t kMaxMatch = 258;
+    const size_t size = data.size();
+    std::vector<int32_t> head(size_t(1) << kHashBits, -1);
+    std::vector<int32_t> previous(kWindow, -1);
+    auto hash = [&](size_t position) {
+        const uint32_t v = data[position] | data[position + 1] << 8 | data[position + 2] << 16;
+        return (v * 2654435761u) >> (32 - kHashBits);
+    };
+    auto insert = [&](size_t position) {
+        if (position + 3 > size) return;
+        const uint32_t h = hash(position);
+        previous[position & (kWindow - 1)] = head[h];
+        head[h] = static_cast<int32_t>(position);
+    };
+
+    BitWriter bits(out);
+    bits.PutBits(1, 1);  // BFINAL
+    bits.PutBits(1, 2);  // BTYPE = fixed Huffman
+    size_t i = 0;
+    while (i < size) {
+        size_t bestLength = 0, bestDistance = 0;
+        if (i + 3 <= size) {
+            const size_t limit = std::min(kMaxMatch, size - i);
+            int32_t candidate = head[hash(i)];
+            for (int chain = 0; candidate >= 0 && chain < kMaxChain; ++chain) {
+                const size_t distance = i - static_cast<size_t>(candidate);
+                if (distance > kWindow) break;
+                size_t length = 0;
+                const uint8_t* a = &data[candidate];
+                const uint8_t* b = &data[i];
+                while (length < limit && a[length] == b[length]) ++length;
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = distance;
+                    if (length == limit) break;
+                }
+                const int32_t next = previous[candidate & (kWindow - 1)];
+                // The ring slot may have been reused by a newer position.
+                if (next >= candidate) break;
+                candidate = next;
+            }
+        }
+        if (bestLength >= 3) {
+            PutMatch(bits, static_cast<uint32_t>(bestLength), static_cast<uint32_t>(bestDistance));
+            for (size_t j = 0; j < bestLength; ++j) insert(i + j);
+            i += bestLength;
+        } else {
+            PutLiteralLength(bits, data[i]);
+            insert(i);
+            ++i;
+        }
+    }
+    PutLiteralLength(bits, 256);
+    bits.Flush();
+}
+
+uint8_t Paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+// Filter byte plus filtered row for each row, choosing the filter with the
+// smallest sum of absolute (signed) residuals.
+std::vector<uint8_t> FilterRows(const uint8_t* rgb, uint32_t width, uint32_t height) {
+    const size_t stride = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> out;
+    out.reserve((stride + 1) * height);
+    std::vector<uint8_t> candidates[4];
+    for (auto& candidate : candidates) candidate.resize(stride);
+    const uint8_t filters[4] = { 0, 1, 2, 4 };
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* row = rgb + y * stride;
+        const uint8_t* up = y > 0 ? row - stride : nullptr;
+        for (size_t x = 0; x < stride; ++x) {
+            const int left = x >= 3 ? row[x - 3] : 0;
+            const int above = up ? up[x] : 0;
+            const int upperLeft = (up && x >= 3) ? up[x - 3] : 0;
+            candidates[0][x] = row[x];
+            candidates[1][x] = static_cast<uint8_t>(row[x] - left);
+            candidates[2][x] = static_cast<uint8_t>(row[x] - above);
+            candidates[3][x] = static_cast<uint8_t>(row[x] - Paeth(left, above, upperLeft));
+        }
+        int best = 0;
+        uint64_t bestCost = UINT64_MAX;
+        for (int f = 0; f < 4; ++f) {
+            uint64_t cost = 0;
+            for (uint8_t v : candidates[f]) cost += static_cast<uint64_t>(std::abs(static_cast<int8_t>(v)));
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = f;
+            }
+        }
+        out.push_back(filters[best]);
+        out.insert(out.end(), candidates[best].begin(), candidates[best].end());
+    }
+    return out;
+}
+
+void PutBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void PutChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data) {
+    PutBigEndian(out, static_cast<uint32_t>(data.size()));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    PutBigEndian(out, Crc32(&out[start], out.size() - start));
+}
+}  // namespace
+
+void PackRgbScalar(const uint8_t* src, uint8_t* dst, size_t pixels, PixelOrder order) {
+    const int r = order == PixelOrder::Rgba ? 0 : 2;
+    const int b = 2 - r;
+    for (size_t i = 0; i < pixels; ++i) {
+        dst[i * 3 + 0] = src[i * 4 + r];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4 + b];
+    }
+}
+
+void PackRgb(const uint8_t* src, uint8_t* dst, size_t pixels, PixelOrder order) {
+    size_t done = 0;
+#if defined(IMGUICEF_PACK_SSSE3)
+    static const bool ssse3 = HasSsse3();
+    if (ssse3) done = PackRgbSsse3(src, dst, pixels, order);
+#elif defined(IMGUICEF_PACK_NEON)
+    done = PackRgbNeon(src, dst, pixels, order);
+#endif
+    PackRgbScalar(src + done * 4, dst + done * 3, pixels - done, order);
+}
+
+const char* PackRgbPath() {
+#if defined(IMGUICEF_PACK_SSSE3)
+    return HasSsse3() ? "ssse3" : "scalar";
+#elif defined(IMGUICEF_PACK_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    const auto& table = CrcTable();
+    uint32_t c = crc ^ 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+uint32_t Adler32(const uint8_t* data, size_t size, uint32_t adler) {
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (size > 0) {
+        // Largest run that cannot overflow 32 bits before the modulo.
+        const size_t run = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += run;
+        size -= run;
+    }
+    return b << 16 | a;
+}
+
+std::vector<uint8_t> EncodePngRgb(const uint8_t* rgb, uint32_t width, uint32_t height) {
+    ZoneScoped;
+    const std::vector<uint8_t> filtered = FilterRows(rgb, width, height);
+
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    zlib.reserve(filtered.size() / 4 + 64);
+    Deflate(filtered, zlib);
+    PutBigEndian(zlib, Adler32(filtered.data(), filtered.size()));
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<uint8_t> header;
+    PutBigEndian(header, width);
+    PutBigEndian(header, height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });  // 8-bit truecolor, deflate, adaptive filters, no interlace
+    PutChunk(png, "IHDR", header);
+    PutChunk(png, "IDAT", zlib);
+    PutChunk(png, "IEND", {});
+    return png;
+}
+
+std::vector<uint8_t> EncodePng(const uint8_t* pixels, uint32_t width, uint32_t height, PixelOrder order) {
+    std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+    PackRgb(pixels, rgb.data(), static_cast<size_t>(width) * height, order);
+    return EncodePngRgb(rgb.data(), width, height);
+}
@@ -0,0 +1,217 @@
+#include "../include/process_profile.h"
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+std::vector<ProcessProfile> BuildProfiles() {
+    std::vector<ProcessProfile> profiles;
+
+    // Many panels from a handful of trusted sites on a small machine: share
+    // renderers per site, cap their count and heap, and keep the GPU
+    // process out of it.
+    ProcessProfile kiosk;
+    kiosk.name = "kiosk-lowmem";
+    kiosk.summary = "shared renderers per site, capped heaps, software compositing";
+    kiosk.rendererProcessLimit = 4;
+    kiosk.siteIsolation = SiteIsolation::Relaxed;
+    kiosk.rasterThreads = 1;
+    kiosk.v8HeapMb = 256;
+    kiosk.compositing = CompositingMode::Software;
+    kiosk.diskCacheMb = 64;
+    profiles.push_back(kiosk);
+
+    // Operator consoles: every site isolated so one busy panel cannot stall
+    // the rest, GPU raster with all raster threads, nothing deprioritised.
+    ProcessProfile operatorProfile;
+    operatorProfile.name = "operator-lowlatency";
+    operatorProfile.summary = "strict site isolation, GPU compositing, foreground renderers";
+    operatorProfile.siteIsolation = SiteIsolation::Strict;
+    operatorProfile.rasterThreads = 4;
+    operatorProfile.diskCacheMb = 256;
+    operatorProfile.keepRenderersForeground = true;
+    profiles.push_back(operatorProfile);
+
+    // Chromium's process model untouched, frames unthrottled: the baseline
+    // the other profiles are measured against.
+    ProcessProfile bench;
+    bench.name = "bench";
+    bench.summary = "default process model, unthrottled frames";
+    bench.keepRenderersForeground = true;
+    bench.unthrottledFrames = true;
+    profiles.push_back(bench);
+
+    return profiles;
+}
+
+bool ParseInt(const std::string& text, long long& value) {
+    try {
+        size_t used = 0;
+        value = std::stoll(text, &used);
+        return used == text.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+// Value of --max-old-space-size inside a --js-flags string, or -1.
+long long HeapLimitInJsFlags(const std::string& flags) {
+    static const std::string kFlag = "--max-old-space-size=";
+    const size_t at = flags.find(kFlag);
+    if (at == std::string::npos) return -1;
+    const size_t start = at + kFlag.size();
+    const size_t end = flags.find(' ', start);
+    long long value = 0;
+    return ParseInt(flags.substr(start, end == std::string::npos ? std::string::npos : end - start), value) ? value
+                                                                                                            : 0;
+}
+}  // namespace
+
+const std::vector<ProcessProfile>& GetProcessProfiles() {
+    static const std::vector<ProcessProfile> profiles = BuildProfiles();
+    return profiles;
+}
+
+const ProcessProfile* FindProcessProfile(const std::string& name) {
+    for (const ProcessProfile& profile : GetProcessProfiles()) {
+        if (profile.name == name) return &profile;
+    }
+    return nullptr;
+}
+
+std::string ProcessProfileNames() {
+    std::string names;
+    for (const ProcessProfile& profile : GetProcessProfiles()) {
+        if (!names.empty()) names += ", ";
+        names += profile.name;
+    }
+    return names;
+}
+
+std::vector<ProfileSwitch> GetProfileSwitches(const ProcessProfile& profile) {
+    std::vector<ProfileSwitch> switches;
+    if (profile.rendererProcessLimit > 0) {
+        switches.push_back({ "renderer-process-limit", std::to_string(profile.rendererProcessLimit) });
+    }
+    if (profile.siteIsolation == SiteIsolation::Strict) {
+        switches.push_back({ "site-per-process", "" });
+    } else if (profile.siteIsolation == SiteIsolation::Relaxed) {
+        switches.push_back({ "disable-site-isolation-trials", "" });
+        switches.push_back({ "process-per-site", "" });
+    }
+    if (profile.rasterThreads > 0) {
+        switches.push_back({ "num-raster-threads", std::to_string(profile.rasterThreads) });
+    }
+    if (profile.v8HeapMb > 0) {
+        switches.push_back({ "js-flags", "--max-old-space-size=" + std::to_string(profile.v8HeapMb) });
+    }
+    if (profile.compositing == CompositingMode::Software) {
+        switches.push_back({ "disable-gpu", "" });
+        switches.push_back({ "disable-gpu-compositing", "" });
+    }
+    if (profile.diskCacheMb > 0) {
+        switches.push_back({ "disk-cache-size", std::to_string(profile.diskCacheMb * 1024 * 1024) });
+    }
+    if (profile.keepRenderersForeground) {
+        switches.push_back({ "disable-renderer-backgrounding", "" });
+    }
+    if (profile.unthrottledFrames) {
+        switches.push_back({ "disable-frame-rate-limit", "" });
+        switches.push_back({ "disable-gpu-vsync", "" });
+    }
+    return switches;
+}
+
+ProfileResolution ResolveProcessProfile(const ProcessProfile& profile,
+                                        const std::map<std::string, std::string>& existing) {
+    ZoneScoped;
+    ProfileResolution resolution;
+    auto has = [&](const std::string& name) { return existing.count(name) != 0; };
+    auto keep = [&](const std::string& name) {
+        const std::string& value = existing.at(name);
+        resolution.kept.push_back("--" + name + (value.empty() ? "" : "=" + value));
+    };
+
+    // Site isolation switches only make sense as a set; an explicit choice
+    // on the command line replaces the profile's whole policy.
+    const bool explicitIsolation = has("site-per-process") || has("disable-site-isolation-trials") ||
+                                   has("process-per-site");
+    for (const ProfileSwitch& entry : GetProfileSwitches(profile)) {
+        const bool isolationSwitch = entry.name == "site-per-process" ||
+                                     entry.name == "disable-site-isolation-trials" ||
+                                     entry.name == "process-per-site";
+        if (isolationSwitch && explicitIsolation) continue;
+        if (entry.name == "js-flags" && has("js-flags")) {
+            const std::string& flags = existing.at("js-flags");
+            if (HeapLimitInJsFlags(flags) >= 0) {
+                keep("js-flags");
+            } else {
+                resolution.apply.push_back({ "js-flags", flags.empty() ? entry.value : flags + " " + entry.value });
+            }
+            continue;
+        }
+        if (has(entry.name)) {
+            keep(entry.name);
+            continue;
+        }
+        resolution.apply.push_back(entry);
+    }
+    if (explicitIsolation && profile.siteIsolation != SiteIsolation::Default) {
+        for (const char* name : { "site-per-process", "disable-site-isolation-trials", "process-per-site" }) {
+            if (has(name)) keep(name);
+        }
+    }
+
+    // Effective values, whichever side they came from.
+    std::map<std::string, std::string> effective = existing;
+    for (const ProfileSwitch& entry : resolution.apply) effective[entry.name] = entry.value;
+    auto effectiveHas = [&](const char* name) { return effective.count(name) != 0; };
+
+    if (effectiveHas("site-per-process") && effectiveHas("disable-site-isolation-trials")) {
+        resolution.warnings.push_back("--site-per-process and --disable-site-isolation-trials are both set; "
+                                      "Chromium isolates every site");
+    }
+    if (effectiveHas("renderer-process-limit")) {
+        long long limit = 0;
+        if (!ParseInt(effective["renderer-process-limit"], limit) || limit < 1) {
+            resolution.warnings.push_back("--renderer-process-limit=" + effective["renderer-process-limit"] +
+                                          " is not a positive count; Chromium ignores it");
+        } else if (!effectiveHas("disable-site-isolation-trials") || effectiveHas("site-per-process")) {
+            resolution.warnings.push_back("--renderer-process-limit is a soft cap while sites are isolated; "
+                                          "panels from different sites still get their own renderers");
+        }
+    }
+    if (effectiveHas("num-raster-threads")) {
+        long long threads = 0;
+        if (!ParseInt(effective["num-raster-threads"], threads) || threads < 1 || threads > 4) {
+            resolution.warnings.push_back("--num-raster-threads=" + effective["num-raster-threads"] +
+                                          " is outside 1-4; Chromium clamps or ignores it");
+        }
+    }
+    if (effectiveHas("js-flags")) {
+        const long long heap = HeapLimitInJsFlags(effective["js-flags"]);
+        if (heap == 0 || (heap > 0 && heap < 64)) {
+            resolution.warnings.push_back("--js-flags heap limit below 64 MB; renderers will run out of memory");
+        }
+    }
+    if (profile.compositing == CompositingMode::Gpu &&
+        (effectiveHas("disable-gpu") || effectiveHas("disable-gpu-compositing"))) {
+        resolution.warnings.push_back("profile " + profile.name +
+                                      " expects GPU compositing, but the command line disables it");
+    }
+    return resolution;
+}
+
+std::string FormatProfileSwitches(const std::vector<ProfileSwitch>& switches) {
+    std::string text;
+    for (const ProfileSwitch& entry : switches) {
+        if (!text.empty()) text += ' ';
+        text += "--" + entry.name;
+        if (!entry.value.empty()) text += "=" + entry.value;
+    }
+    return text;
+}
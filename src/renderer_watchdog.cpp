@@ -0,0 +1,246 @@
+#include "../include/renderer_watchdog.h"
+#include "../include/cef_client_impl.h"
+#include "../include/metrics_registry.h"
+#include "include/base/cef_callback.h"
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+constexpr int64_t kMaxRecoveryBackoffMs = 30000;
+
+int SwitchAsMs(CefRefPtr<CefCommandLine> commandLine, const char* name, int fallback) {
+    if (!commandLine || !commandLine->HasSwitch(name)) return fallback;
+    try {
+        return std::max(1, std::stoi(commandLine->GetSwitchValue(name).ToString()));
+    } catch (...) {
+        std::cerr << "Ignoring invalid --" << name << " value" << std::endl;
+        return fallback;
+    }
+}
+
+double MillisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+}  // namespace
+
+RendererWatchdog::~RendererWatchdog() = default;
+
+void RendererWatchdog::ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    m_IntervalMs = SwitchAsMs(commandLine, "watchdog-interval-ms", m_IntervalMs);
+    m_PingMs = SwitchAsMs(commandLine, "watchdog-ping-ms", m_PingMs);
+    m_HangMs = SwitchAsMs(commandLine, "watchdog-hang-ms", m_HangMs);
+    m_MaxRetries = SwitchAsMs(commandLine, "watchdog-max-retries", m_MaxRetries);
+}
+
+bool RendererWatchdog::EnabledFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    return commandLine && commandLine->HasSwitch("renderer-watchdog");
+}
+
+void RendererWatchdog::Watch(const std::string& label, CefRefPtr<CefClientImpl> client) {
+    if (!client) return;
+    Entry& entry = m_Entries[label];
+    if (entry.client && entry.client != client) entry.client->SetRendererWatchdog(nullptr);
+    entry.client = client;
+    entry.stats.label = label;
+    entry.stats.browserId = 0;
+    entry.stats.pingOutstanding = false;
+    entry.lastActivity = Clock::now();
+    client->SetRendererWatchdog(this);
+}
+
+void RendererWatchdog::Unwatch(const std::string& label) {
+    auto it = m_Entries.find(label);
+    if (it == m_Entries.end()) return;
+    if (it->second.client) it->second.client->SetRendererWatchdog(nullptr);
+    m_Entries.erase(it);
+}
+
+void RendererWatchdog::Start() {
+    ++m_Generation;
+    CefPostDelayedTask(TID_UI, base::BindOnce(&RendererWatchdog::Tick, this, m_Generation), m_IntervalMs);
+}
+
+void RendererWatchdog::Stop() {
+    ++m_Generation;
+    for (auto& [label, entry] : m_Entries) {
+        if (entry.client) entry.client->SetRendererWatchdog(nullptr);
+    }
+    m_Entries.clear();
+}
+
+void RendererWatchdog::OnPong(CefClientImpl* client) {
+    Entry* entry = FindEntry(client);
+    if (!entry) return;
+    ++entry->stats.pongs;
+    entry->stats.pingOutstanding = false;
+    entry->lastActivity = Clock::now();
+}
+
+void RendererWatchdog::OnTerminated(CefClientImpl* client, int status) {
+    Entry* entry = FindEntry(client);
+    if (!entry || !CanRestartRecovery(*entry)) return;
+    ++entry->stats.crashes;
+    MetricsRegistry::Get().AddCounter("watchdog." + entry->stats.label + ".crashes");
+    std::cerr << "Renderer for " << entry->stats.label << " terminated (status " << status << "), recovering" << std::endl;
+    BeginRecovery(*entry, "terminated");
+}
+
+void RendererWatchdog::OnUnresponsive(CefClientImpl* client) {
+    Entry* entry = FindEntry(client);
+    if (!entry || !CanRestartRecovery(*entry)) return;
+    ++entry->stats.hangs;
+    MetricsRegistry::Get().AddCounter("watchdog." + entry->stats.label + ".hangs");
+    std::cerr << "Renderer for " << entry->stats.label << " reported unresponsive, recovering" << std::endl;
+    BeginRecovery(*entry, "unresponsive");
+}
+
+std::vector<RendererWatchdogStats> RendererWatchdog::GetStats() const {
+    std::vector<RendererWatchdogStats> stats;
+    stats.reserve(m_Entries.size());
+    for (const auto& [label, entry] : m_Entries) stats.push_back(entry.stats);
+    return stats;
+}
+
+bool RendererWatchdog::HandleRendererMessage(CefRefPtr<CefFrame> frame, CefRefPtr<CefProcessMessage> message) {
+    if (message->GetName() != kWatchdogPingMessage) return false;
+    CefRefPtr<CefProcessMessage> pong = CefProcessMessage::Create(kWatchdogPongMessage);
+    pong->GetArgumentList()->SetInt(0, message->GetArgumentList()->GetInt(0));
+    frame->SendProcessMessage(PID_BROWSER, pong);
+    return true;
+}
+
+RendererWatchdog::Entry* RendererWatchdog::FindEntry(CefClientImpl* client) {
+    for (auto& [label, entry] : m_Entries) {
+        if (entry.client.get() == client) return &entry;
+    }
+    return nullptr;
+}
+
+void RendererWatchdog::Tick(int generation) {
+    ZoneScoped;
+    if (generation != m_Generation) return;
+    const Clock::time_point now = Clock::now();
+    for (auto& [label, entry] : m_Entries) {
+        CheckEntry(entry, now);
+    }
+    CefPostDelayedTask(TID_UI, base::BindOnce(&RendererWatchdog::Tick, this, m_Generation), m_IntervalMs);
+}
+
+void RendererWatchdog::CheckEntry(Entry& entry, Clock::time_point now) {
+    CefRefPtr<CefBrowser> browser = entry.client->GetBrowser();
+    CefRefPtr<CefRenderHandlerImpl> renderHandler = entry.client->GetRenderHandlerImpl();
+
+    if (entry.stats.recovering || entry.stats.recoveryFailed) {
+        // Waiting for the replacement browser's first frame. The deadline is
+        // checked even before the replacement has a browser: one whose
+        // renderer dies during creation never gets that far.
+        const Clock::time_point firstPaint = renderHandler ? renderHandler->GetFirstPaintTime() : Clock::time_point();
+        if (firstPaint > entry.detectedAt) {
+            entry.stats.recovering = false;
+            entry.stats.recoveryFailed = false;
+            entry.stats.lastRecoverMs = MillisecondsBetween(entry.recoveryStartedAt, firstPaint);
+            ++entry.stats.recoveries;
+            MetricsRegistry::Get().RecordHistogram("watchdog." + entry.stats.label + ".recover_ms", entry.stats.lastRecoverMs);
+            entry.lastActivity = now;
+        } else if (entry.stats.recovering && !entry.recreatePending && now >= entry.recoveryDeadline) {
+            std::cerr << "Replacement renderer for " << entry.stats.label << " did not paint within " << m_HangMs
+                      << " ms, recovering again" << std::endl;
+            BeginRecovery(entry, "no first paint");
+        }
+        return;
+    }
+
+    if (!browser || !renderHandler) return;
+    entry.stats.browserId = browser->GetIdentifier();
+
+    const Clock::time_point lastPaint = renderHandler->GetLastPaintTime();
+    if (lastPaint > entry.lastActivity) {
+        entry.lastActivity = lastPaint;
+        entry.stats.pingOutstanding = false;
+    }
+
+    entry.stats.idleMs = MillisecondsBetween(entry.lastActivity, now);
+    if (entry.stats.idleMs < m_PingMs) return;
+
+    if (!entry.stats.pingOutstanding) {
+        entry.stats.pingOutstanding = true;
+        entry.firstPingSent = now;
+    } else if (MillisecondsBetween(entry.firstPingSent, now) >= m_HangMs) {
+        ++entry.stats.hangs;
+        MetricsRegistry::Get().AddCounter("watchdog." + entry.stats.label + ".hangs");
+        std::cerr << "Renderer for " << entry.stats.label << " missed pings for " << m_HangMs << " ms, recovering" << std::endl;
+        BeginRecovery(entry, "hang");
+        return;
+    } else if (MillisecondsBetween(entry.lastPingSent, now) < m_PingMs) {
+        return;
+    }
+
+    // Pings are re-sent every interval while outstanding: a ping sent during a
+    // cross-process navigation can be dropped with the old frame.
+    CefRefPtr<CefProcessMessage> ping = CefProcessMessage::Create(kWatchdogPingMessage);
+    ping->GetArgumentList()->SetInt(0, ++entry.pingSequence);
+    browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, ping);
+    entry.lastPingSent = now;
+    ++entry.stats.pings;
+}
+
+void RendererWatchdog::BeginRecovery(Entry& entry, const char* reason) {
+    const Clock::time_point now = Clock::now();
+    entry.stats.pingOutstanding = false;
+    entry.stats.lastReason = reason;
+    if (!entry.stats.recovering) {
+        entry.stats.recoveryAttempts = 0;
+        entry.recoveryStartedAt = now;
+    }
+    if (entry.stats.recoveryAttempts > m_MaxRetries) {
+        entry.stats.recovering = false;
+        entry.stats.recoveryFailed = true;
+        MetricsRegistry::Get().AddCounter("watchdog." + entry.stats.label + ".recovery_failures");
+        std::cerr << "Giving up on " << entry.stats.label << " after " << entry.stats.recoveryAttempts
+                  << " recovery attempts" << std::endl;
+        return;
+    }
+
+    ++entry.stats.recoveryAttempts;
+    entry.stats.recovering = true;
+    entry.stats.recoveryFailed = false;
+    entry.detectedAt = now;
+    entry.recreatePending = true;
+    entry.recoveryDeadline = Clock::time_point::max();
+
+    // The first attempt runs at once; retries back off from the ping interval
+    // so a page that kills its renderer on load is not recreated in a loop.
+    int64_t delayMs = 0;
+    if (entry.stats.recoveryAttempts > 1) {
+        const int shift = std::min(entry.stats.recoveryAttempts - 2, 16);
+        delayMs = std::min(static_cast<int64_t>(m_PingMs) << shift, kMaxRecoveryBackoffMs);
+        MetricsRegistry::Get().AddCounter("watchdog." + entry.stats.label + ".recovery_retries");
+    }
+    CefPostDelayedTask(TID_UI, base::BindOnce(&RendererWatchdog::Recover, this, m_Generation, entry.stats.label), delayMs);
+}
+
+bool RendererWatchdog::CanRestartRecovery(const Entry& entry) const {
+    // While the recreation task is still queued the reporting client is the
+    // one being replaced; the queued task already covers it. A failed panel
+    // waits for a paint rather than starting over.
+    if (entry.stats.recoveryFailed) return false;
+    return !entry.stats.recovering || !entry.recreatePending;
+}
+
+void RendererWatchdog::Recover(int generation, std::string label) {
+    ZoneScoped;
+    if (generation != m_Generation || !m_RecoverCallback) return;
+    auto it = m_Entries.find(label);
+    if (it == m_Entries.end()) return;
+    it->second.recreatePending = false;
+    it->second.recoveryDeadline = Clock::now() + std::chrono::milliseconds(m_HangMs);
+    m_RecoverCallback(label);
+}
@@ -0,0 +1,292 @@
+#include "../include/request_context_pool.h"
+#include "../include/metrics_registry.h"
+#include "include/base/cef_callback.h"
+#include "include/cef_parser.h"
+#include "include/cef_request_context_handler.h"
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+const char kModeSwitchPrefix[] = "panel-cache-";
+const char kCapSwitchSuffix[] = "-mb";
+constexpr uint64_t kBytesPerMb = 1024ull * 1024ull;
+
+bool ParseMode(const std::string& value, PanelCacheMode& mode) {
+    if (value == "memory") mode = PanelCacheMode::Memory;
+    else if (value == "disk") mode = PanelCacheMode::Disk;
+    else if (value == "global") mode = PanelCacheMode::Global;
+    else return false;
+    return true;
+}
+
+bool ParseMegabytes(const std::string& value, uint64_t& bytes) {
+    try {
+        bytes = static_cast<uint64_t>(std::max(0LL, std::stoll(value))) * kBytesPerMb;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+uint64_t DirectorySize(const std::filesystem::path& path) {
+    std::error_code error;
+    uint64_t total = 0;
+    for (std::filesystem::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_regular_file(error)) total += it->file_size(error);
+    }
+    return total;
+}
+}  // namespace
+
+// Counts responses per browser from DevTools Network events. Memory-cache hits
+// arrive as requestServedFromCache ahead of responseReceived; disk-cache hits
+// are flagged on the response itself.
+class RequestContextPool::NetworkObserver : public CefDevToolsMessageObserver {
+public:
+    NetworkObserver(RequestContextPool* pool, std::string panelClass)
+        : m_Pool(pool),
+          m_PanelClass(std::move(panelClass)) {}
+
+    virtual void OnDevToolsEvent(CefRefPtr<CefBrowser> browser,
+                                 const CefString& method,
+                                 const void* params,
+                                 size_t params_size) override {
+        const std::string name = method.ToString();
+        if (name != "Network.requestServedFromCache" && name != "Network.responseReceived") return;
+        CefRefPtr<CefValue> value = CefParseJSON(params, params_size, JSON_PARSER_RFC);
+        if (!value || value->GetType() != VTYPE_DICTIONARY) return;
+        CefRefPtr<CefDictionaryValue> dict = value->GetDictionary();
+        const std::string requestId = dict->GetString("requestId").ToString();
+
+        if (name == "Network.requestServedFromCache") {
+            m_ServedFromCache.insert(requestId);
+            return;
+        }
+        bool fromCache = m_ServedFromCache.erase(requestId) > 0;
+        CefRefPtr<CefDictionaryValue> response = dict->GetDictionary("response");
+        if (response) {
+            fromCache = fromCache || response->GetBool("fromDiskCache") || response->GetBool("fromPrefetchCache");
+        }
+        m_Pool->RecordResponse(m_PanelClass, fromCache);
+    }
+
+private:
+    RequestContextPool* m_Pool;
+    std::string m_PanelClass;
+    std::set<std::string> m_ServedFromCache;
+
+    IMPLEMENT_REFCOUNTING(NetworkObserver);
+};
+
+RequestContextPool::RequestContextPool(std::filesystem::path cacheRoot)
+    : m_CacheRoot(std::move(cacheRoot)) {}
+
+CefRefPtr<CefCommandLine> RequestContextPool::ParseLaunchCommandLine(int argc, char* argv[]) {
+    CefRefPtr<CefCommandLine> commandLine = CefCommandLine::CreateCommandLine();
+#ifdef _WIN32
+    commandLine->InitFromString(::GetCommandLineW());
+#else
+    commandLine->InitFromArgv(argc, argv);
+#endif
+    return commandLine;
+}
+
+std::filesystem::path RequestContextPool::CacheRootFromCommandLine(CefRefPtr<CefCommandLine> commandLine,
+                                                                   const std::filesystem::path& fallback) {
+    if (!commandLine || !commandLine->HasSwitch("cache-root")) return fallback;
+    const std::string value = commandLine->GetSwitchValue("cache-root").ToString();
+    if (value.empty()) return fallback;
+    return std::filesystem::absolute(value);
+}
+
+void RequestContextPool::ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    if (!commandLine) return;
+    CefCommandLine::SwitchMap switches;
+    commandLine->GetSwitches(switches);
+
+    const std::string modeSwitch = "panel-cache";
+    const std::string capSwitch = "panel-cache-mb";
+    for (const auto& [key, rawValue] : switches) {
+        const std::string name = key.ToString();
+        const std::string value = rawValue.ToString();
+        if (name == modeSwitch) {
+            if (!ParseMode(value, m_DefaultOptions.mode)) std::cerr << "Ignoring invalid --panel-cache value" << std::endl;
+        } else if (name == capSwitch) {
+            if (!ParseMegabytes(value, m_DefaultOptions.capBytes)) std::cerr << "Ignoring invalid --panel-cache-mb value" << std::endl;
+        } else if (name == "cache-sample-ms") {
+            try {
+                m_SampleIntervalMs = std::max(0, std::stoi(value));
+            } catch (...) {
+                std::cerr << "Ignoring invalid --cache-sample-ms value" << std::endl;
+            }
+        }
+    }
+
+    // Per-class overrides are applied on top of the defaults above.
+    for (const auto& [key, rawValue] : switches) {
+        const std::string name = key.ToString();
+        if (name == capSwitch || name.rfind(kModeSwitchPrefix, 0) != 0) continue;
+        std::string panelClass = name.substr(sizeof(kModeSwitchPrefix) - 1);
+        const bool isCap = panelClass.size() > 3 &&
+            panelClass.compare(panelClass.size() - 3, 3, kCapSwitchSuffix) == 0;
+        if (isCap) panelClass.resize(panelClass.size() - 3);
+        if (panelClass.empty()) continue;
+
+        PanelCacheOptions& options = m_ClassOptions.try_emplace(panelClass, m_DefaultOptions).first->second;
+        const std::string value = rawValue.ToString();
+        const bool valid = isCap ? ParseMegabytes(value, options.capBytes) : ParseMode(value, options.mode);
+        if (!valid) std::cerr << "Ignoring invalid --" << name << " value" << std::endl;
+    }
+}
+
+PanelCacheOptions RequestContextPool::GetOptions(const std::string& panelClass) const {
+    auto it = m_ClassOptions.find(panelClass);
+    return it == m_ClassOptions.end() ? m_DefaultOptions : it->second;
+}
+
+RequestContextPool::ContextState& RequestContextPool::GetState(const std::string& panelClass) {
+    auto it = m_Contexts.find(panelClass);
+    if (it != m_Contexts.end()) return it->second;
+
+    ContextState& state = m_Contexts[panelClass];
+    state.options = GetOptions(panelClass);
+    state.stats.panelClass = panelClass;
+    state.stats.mode = state.options.mode;
+    state.stats.capBytes = state.options.capBytes;
+
+    if (state.options.mode == PanelCacheMode::Global) {
+        state.cachePath = m_CacheRoot;
+    } else {
+        CefRequestContextSettings settings;
+        if (state.options.mode == PanelCacheMode::Disk) {
+            // cache_path must sit under CefSettings.root_cache_path.
+            state.cachePath = m_CacheRoot / panelClass;
+            std::error_code error;
+            std::filesystem::create_directories(state.cachePath, error);
+            CefString(&settings.cache_path).FromString(state.cachePath.string());
+        }
+        state.context = CefRequestContext::CreateContext(settings, nullptr);
+    }
+    state.stats.cachePath = state.options.mode == PanelCacheMode::Memory ? "(memory)" : state.cachePath.string();
+    return state;
+}
+
+CefRefPtr<CefRequestContext> RequestContextPool::GetContext(const std::string& panelClass) {
+    return GetState(panelClass).context;
+}
+
+void RequestContextPool::AttachBrowser(const std::string& panelClass, CefRefPtr<CefBrowser> browser) {
+    if (!browser) return;
+    const int browserId = browser->GetIdentifier();
+    DetachBrowser(browserId);
+    GetState(panelClass);
+
+    Attachment& attachment = m_Attachments[browserId];
+    attachment.panelClass = panelClass;
+    attachment.browser = browser;
+    attachment.registration = browser->GetHost()->AddDevToolsMessageObserver(new NetworkObserver(this, panelClass));
+    browser->GetHost()->ExecuteDevToolsMethod(0, "Network.enable", nullptr);
+}
+
+void RequestContextPool::DetachBrowser(int browserId) {
+    m_Attachments.erase(browserId);
+}
+
+void RequestContextPool::Start() {
+    ++m_Generation;
+    if (m_SampleIntervalMs <= 0) return;
+    CefPostDelayedTask(TID_UI, base::BindOnce(&RequestContextPool::Sample, this, m_Generation), m_SampleIntervalMs);
+}
+
+void RequestContextPool::Stop() {
+    ++m_Generation;
+    m_Attachments.clear();
+}
+
+std::vector<RequestContextStats> RequestContextPool::GetStats() const {
+    std::vector<RequestContextStats> stats;
+    stats.reserve(m_Contexts.size());
+    for (const auto& [panelClass, state] : m_Contexts) {
+        stats.push_back(state.stats);
+    }
+    return stats;
+}
+
+void RequestContextPool::RecordResponse(const std::string& panelClass, bool fromCache) {
+    ContextState& state = GetState(panelClass);
+    ++state.stats.responses;
+    if (fromCache) ++state.stats.cacheHits;
+    state.stats.hitRate = static_cast<double>(state.stats.cacheHits) / static_cast<double>(state.stats.responses);
+
+    const std::string prefix = "cache." + panelClass + ".";
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.AddCounter(prefix + "responses");
+    if (fromCache) registry.AddCounter(prefix + "hits");
+    registry.SetGauge(prefix + "hit_rate", state.stats.hitRate);
+}
+
+void RequestContextPool::Sample(int generation) {
+    ZoneScoped;
+    if (generation != m_Generation) return;
+    for (auto& [panelClass, state] : m_Contexts) {
+        SampleContext(panelClass, state);
+    }
+    CefPostDelayedTask(TID_UI, base::BindOnce(&RequestContextPool::Sample, this, m_Generation), m_SampleIntervalMs);
+}
+
+void RequestContextPool::SampleContext(const std::string& panelClass, ContextState& state) {
+    if (state.options.mode == PanelCacheMode::Memory) return;
+
+    // Only the HTTP cache: the rest of the profile is not evicted by
+    // clearBrowserCache, and in Global mode the root also holds the class
+    // directories of Disk-mode panels.
+    const uint64_t size = DirectorySize(state.cachePath / "Cache");
+    // Growth between samples approximates bytes written; eviction and
+    // compaction make the cache shrink, which is not counted.
+    if (state.sampled && size > state.stats.diskBytes) {
+        state.stats.diskBytesWritten += size - state.stats.diskBytes;
+    }
+    state.stats.diskBytes = size;
+    state.sampled = true;
+
+    // Chromium only supports one global --disk-cache-size, so per-class caps
+    // are enforced here by clearing the class cache once it grows past its cap.
+    const bool overCap = state.options.capBytes > 0 && size > state.options.capBytes;
+    if (state.clearPending) {
+        state.clearPending = false;
+        if (overCap) {
+            state.capUnreachable = true;
+            std::cerr << "Cache for '" << panelClass << "' is still " << size / kBytesPerMb
+                      << " MB after clearing; not enforcing its cap until it shrinks" << std::endl;
+        }
+    } else if (!overCap) {
+        state.capUnreachable = false;
+    }
+    if (overCap && !state.capUnreachable && !state.clearPending) {
+        for (const auto& [browserId, attachment] : m_Attachments) {
+            if (attachment.panelClass != panelClass) continue;
+            attachment.browser->GetHost()->ExecuteDevToolsMethod(0, "Network.clearBrowserCache", nullptr);
+            state.clearPending = true;
+            ++state.stats.evictions;
+            MetricsRegistry::Get().AddCounter("cache." + panelClass + ".evictions");
+            break;
+        }
+    }
+
+    const std::string prefix = "cache." + panelClass + ".";
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.SetGauge(prefix + "disk_mb", static_cast<double>(state.stats.diskBytes) / kBytesPerMb);
+    registry.SetGauge(prefix + "disk_written_mb", static_cast<double>(state.stats.diskBytesWritten) / kBytesPerMb);
+}
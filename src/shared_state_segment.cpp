@@ -0,0 +1,194 @@
+#include "../include/shared_state_segment.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+static_assert(std::is_trivially_copyable_v<SharedStateColumns>, "columns are copied as raw bytes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock counter must work across processes");
+
+namespace {
+constexpr uint32_t kMagic = 0x53534731;  // "SSG1"
+constexpr uint32_t kLayoutVersion = 1;
+// A write is a single memcpy of a few KB; readers give up after this many
+// torn reads and try again on the next frame.
+constexpr int kMaxReadAttempts = 64;
+}  // namespace
+
+// Odd sequence values mark a write in progress; version = sequence / 2.
+struct SharedStateSegment::Layout {
+    uint32_t magic;
+    uint32_t layoutVersion;
+    std::atomic<uint64_t> sequence;
+    SharedStateColumns columns;
+};
+
+void SharedStateColumns::SetText(char (&target)[kSharedStateTextLength], const std::string& value) {
+    std::memset(target, 0, kSharedStateTextLength);
+    std::memcpy(target, value.data(), std::min(value.size(), kSharedStateTextLength - 1));
+}
+
+std::string SharedStateColumns::GetText(const char (&source)[kSharedStateTextLength]) {
+    return std::string(source, strnlen(source, kSharedStateTextLength));
+}
+
+std::string SharedStateSegment::DefaultName() {
+#ifdef _WIN32
+    return "Local\\imguicef_state_" + std::to_string(GetCurrentProcessId());
+#else
+    return "/imguicef_state_" + std::to_string(getpid());
+#endif
+}
+
+SharedStateSegment::SharedStateSegment(std::string name, void* mapping, bool owner)
+    : m_Name(std::move(name)),
+      m_Mapping(mapping),
+      m_Owner(owner) {}
+
+std::unique_ptr<SharedStateSegment> SharedStateSegment::Create(const std::string& name) {
+    ZoneScoped;
+    const size_t size = sizeof(Layout);
+#ifdef _WIN32
+    HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                       static_cast<DWORD>(size), name.c_str());
+    if (!handle) {
+        std::cerr << "CreateFileMapping failed for " << name << std::endl;
+        return nullptr;
+    }
+    void* mapping = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!mapping) {
+        CloseHandle(handle);
+        return nullptr;
+    }
+#else
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        std::cerr << "shm_open failed for " << name << std::endl;
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+#endif
+
+    std::unique_ptr<SharedStateSegment> segment(new SharedStateSegment(name, mapping, true));
+#ifdef _WIN32
+    segment->m_Handle = handle;
+#endif
+    Layout* layout = new (mapping) Layout();
+    layout->magic = kMagic;
+    layout->layoutVersion = kLayoutVersion;
+    layout->sequence.store(0, std::memory_order_release);
+    segment->m_LastWritten = std::make_unique<SharedStateColumns>();
+    return segment;
+}
+
+std::unique_ptr<SharedStateSegment> SharedStateSegment::Open(const std::string& name) {
+    ZoneScoped;
+    const size_t size = sizeof(Layout);
+#ifdef _WIN32
+    HANDLE handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!handle) return nullptr;
+    void* mapping = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, size);
+    if (!mapping) {
+        CloseHandle(handle);
+        return nullptr;
+    }
+#else
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    struct stat info = {};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < size) {
+        close(fd);
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return nullptr;
+#endif
+
+    std::unique_ptr<SharedStateSegment> segment(new SharedStateSegment(name, mapping, false));
+#ifdef _WIN32
+    segment->m_Handle = handle;
+#endif
+    if (segment->GetLayout()->magic != kMagic || segment->GetLayout()->layoutVersion != kLayoutVersion) {
+        std::cerr << "Shared state segment " << name << " has an unexpected layout" << std::endl;
+        return nullptr;
+    }
+    return segment;
+}
+
+SharedStateSegment::~SharedStateSegment() {
+    if (!m_Mapping) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_Mapping);
+    if (m_Handle) CloseHandle(m_Handle);
+#else
+    munmap(m_Mapping, sizeof(Layout));
+    // Renderers keep their existing mappings; unlinking only stops new opens.
+    if (m_Owner) shm_unlink(m_Name.c_str());
+#endif
+}
+
+bool SharedStateSegment::Write(const SharedStateColumns& columns) {
+    ZoneScoped;
+    if (!m_Owner) return false;
+    if (std::memcmp(m_LastWritten.get(), &columns, sizeof(SharedStateColumns)) == 0) return false;
+    *m_LastWritten = columns;
+
+    Layout* layout = GetLayout();
+    const uint64_t sequence = layout->sequence.load(std::memory_order_relaxed);
+    layout->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&layout->columns, &columns, sizeof(SharedStateColumns));
+    layout->sequence.store(sequence + 2, std::memory_order_release);
+    return true;
+}
+
+uint64_t SharedStateSegment::GetVersion() const {
+    return GetLayout()->sequence.load(std::memory_order_acquire) / 2;
+}
+
+bool SharedStateSegment::Read(SharedStateColumns& columns, uint64_t& version) const {
+    ZoneScoped;
+    const Layout* layout = GetLayout();
+    for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+        const uint64_t before = layout->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::memcpy(&columns, &layout->columns, sizeof(SharedStateColumns));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (layout->sequence.load(std::memory_order_relaxed) == before) {
+            version = before / 2;
+            return version != 0 && columns.rows <= kSharedStateMaxRows;
+        }
+    }
+    return false;
+}
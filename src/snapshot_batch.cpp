@@ -0,0 +1,190 @@
+#include "../include/snapshot_batch.h"
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+bool HasScheme(const std::string& target) {
+    const size_t colon = target.find(':');
+    // "C:\pages\a.html" is a path, not a URL with scheme "c".
+    if (colon == std::string::npos || colon < 2) return false;
+    return std::all_of(target.begin(), target.begin() + colon, [](unsigned char c) {
+        return std::isalnum(c) || c == '+' || c == '-' || c == '.';
+    });
+}
+}  // namespace
+
+bool ParseSnapshotSize(const std::string& value, uint32_t& width, uint32_t& height) {
+    unsigned w = 0, h = 0;
+    char trailing = 0;
+    if (std::sscanf(value.c_str(), "%ux%u%c", &w, &h, &trailing) != 2 || w == 0 || h == 0) {
+        return false;
+    }
+    width = w;
+    height = h;
+    return true;
+}
+
+std::string ToSnapshotUrl(const std::string& target) {
+    if (HasScheme(target)) return target;
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::absolute(target, error);
+    if (error) path = target;
+    std::string generic = path.generic_string();
+    if (generic.empty() || generic.front() != '/') generic.insert(generic.begin(), '/');
+    std::string url = "file://";
+    for (char c : generic) {
+        switch (c) {
+            case ' ': url += "%20"; break;
+            case '#': url += "%23"; break;
+            case '%': url += "%25"; break;
+            case '?': url += "%3F"; break;
+            default: url += c; break;
+        }
+    }
+    return url;
+}
+
+std::string SnapshotFileName(const std::string& url, size_t index) {
+    constexpr size_t kMaxStem = 80;
+    const size_t scheme = url.find("://");
+    const std::string rest = scheme == std::string::npos ? url : url.substr(scheme + 3);
+    std::string stem;
+    for (unsigned char c : rest) {
+        const char out = (std::isalnum(c) || c == '.' || c == '-') ? static_cast<char>(c) : '_';
+        if (out == '_' && !stem.empty() && stem.back() == '_') continue;
+        stem += out;
+        if (stem.size() == kMaxStem) break;
+    }
+    while (!stem.empty() && (stem.back() == '_' || stem.back() == '.')) stem.pop_back();
+    if (stem.empty()) stem = "page";
+    char prefix[16];
+    std::snprintf(prefix, sizeof(prefix), "%03zu-", index);
+    return prefix + stem + ".png";
+}
+
+std::vector<SnapshotJob> ParseSnapshotList(std::istream& in, uint32_t defaultWidth, uint32_t defaultHeight,
+                                           std::vector<std::string>* errors) {
+    std::vector<SnapshotJob> jobs;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string target;
+        if (!(fields >> target) || target[0] == '#') continue;
+
+        SnapshotJob job;
+        job.url = ToSnapshotUrl(target);
+        job.width = defaultWidth;
+        job.height = defaultHeight;
+        std::string field;
+        bool valid = true;
+        while (valid && fields >> field) {
+            if (std::isdigit(static_cast<unsigned char>(field[0])) && field.find('x') != std::string::npos &&
+                job.output.empty()) {
+                valid = ParseSnapshotSize(field, job.width, job.height);
+            } else if (job.output.empty()) {
+                job.output = field;
+            } else {
+                valid = false;
+            }
+        }
+        if (!valid) {
+            if (errors) errors->push_back("line " + std::to_string(lineNumber) + ": " + line);
+            continue;
+        }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    Stop();
+}
+
+void SnapshotWriter::Start(size_t threads) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Running) return;
+    m_Running = true;
+    for (size_t i = 0; i < std::max<size_t>(1, threads); ++i) {
+        m_Threads.emplace_back(&SnapshotWriter::Run, this);
+    }
+}
+
+void SnapshotWriter::Stop() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Running = false;
+    }
+    m_Wake.notify_all();
+    for (std::thread& thread : m_Threads) {
+        if (thread.joinable()) thread.join();
+    }
+    m_Threads.clear();
+}
+
+void SnapshotWriter::Submit(const std::string& path, std::vector<uint8_t> pixels, uint32_t width, uint32_t height,
+                            PixelOrder order) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.push_back({ path, std::move(pixels), width, height, order });
+    }
+    m_Wake.notify_one();
+}
+
+size_t SnapshotWriter::Wait() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this] { return !m_Running || (m_Jobs.empty() && m_Busy == 0); });
+    return m_Failed;
+}
+
+size_t SnapshotWriter::GetWritten() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Written;
+}
+
+void SnapshotWriter::Run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Wake.wait(lock, [this] { return !m_Running || !m_Jobs.empty(); });
+        if (m_Jobs.empty()) return;
+        Job job = std::move(m_Jobs.front());
+        m_Jobs.pop_front();
+        ++m_Busy;
+        lock.unlock();
+
+        ZoneScoped;
+        const auto start = std::chrono::steady_clock::now();
+        const std::vector<uint8_t> png = EncodePng(job.pixels.data(), job.width, job.height, job.order);
+        MetricsRegistry::Get().RecordHistogram(
+            "snapshot.encode_ms",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        std::error_code error;
+        const std::filesystem::path parent = std::filesystem::path(job.path).parent_path();
+        if (!parent.empty()) std::filesystem::create_directories(parent, error);
+        std::ofstream out(job.path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+        const bool written = static_cast<bool>(out);
+        if (written) MetricsRegistry::Get().AddCounter("snapshot.png_bytes", static_cast<double>(png.size()));
+
+        lock.lock();
+        --m_Busy;
+        if (written) ++m_Written;
+        else ++m_Failed;
+        if (m_Jobs.empty() && m_Busy == 0) m_Idle.notify_all();
+    }
+}
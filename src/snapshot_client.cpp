@@ -0,0 +1,129 @@
+#include "../include/snapshot_client.h"
+#include "../include/metrics_registry.h"
+#include <cctype>
+#include <iostream>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+const char kSnapshotReadyMarker[] = "imguicef-snapshot-ready";
+
+namespace {
+std::string ToLower(std::string value) {
+    for (char& c : value) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return value;
+}
+}  // namespace
+
+bool NetworkIdleTracker::IsLoopbackOrLocal(const std::string& url) {
+    const std::string lower = ToLower(url);
+    const size_t scheme = lower.find("://");
+    if (scheme == std::string::npos) return true;
+    const std::string name = lower.substr(0, scheme);
+    if (name != "http" && name != "https" && name != "ws" && name != "wss") return true;
+    const size_t hostStart = scheme + 3;
+    const size_t hostEnd = lower.find_first_of(":/?#", hostStart);
+    const std::string host = lower.substr(hostStart, hostEnd == std::string::npos ? std::string::npos : hostEnd - hostStart);
+    return host == "localhost" || host == "127.0.0.1" || host == "[::1]";
+}
+
+CefResourceRequestHandler::ReturnValue NetworkIdleTracker::OnBeforeResourceLoad(CefRefPtr<CefBrowser> browser,
+                                                                                CefRefPtr<CefFrame> frame,
+                                                                                CefRefPtr<CefRequest> request,
+                                                                                CefRefPtr<CefCallback> callback) {
+    if (m_Offline && !IsLoopbackOrLocal(request->GetURL().ToString())) {
+        ++m_Blocked;
+        MetricsRegistry::Get().AddCounter("snapshot.blocked_requests");
+        return RV_CANCEL;
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_InFlight.insert(request->GetIdentifier());
+    m_LastActivity = std::chrono::steady_clock::now();
+    return RV_CONTINUE;
+}
+
+void NetworkIdleTracker::OnResourceLoadComplete(CefRefPtr<CefBrowser> browser,
+                                                CefRefPtr<CefFrame> frame,
+                                                CefRefPtr<CefRequest> request,
+                                                CefRefPtr<CefResponse> response,
+                                                URLRequestStatus status,
+                                                int64_t received_content_length) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // Also called for the requests cancelled above, which were never counted.
+    if (m_InFlight.erase(request->GetIdentifier()) > 0) {
+        m_LastActivity = std::chrono::steady_clock::now();
+    }
+}
+
+bool NetworkIdleTracker::IsIdle(std::chrono::milliseconds quiet) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_InFlight.empty() && std::chrono::steady_clock::now() - m_LastActivity >= quiet;
+}
+
+size_t NetworkIdleTracker::GetInFlight() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_InFlight.size();
+}
+
+SnapshotClient::SnapshotClient(CefRefPtr<CefRenderHandlerImpl> renderHandler, bool offline)
+    : CefClientImpl(renderHandler),
+      m_Network(new NetworkIdleTracker(offline)) {
+}
+
+void SnapshotClient::OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                          bool isLoading,
+                                          bool canGoBack,
+                                          bool canGoForward) {
+    CefClientImpl::OnLoadingStateChange(browser, isLoading, canGoBack, canGoForward);
+    m_Loading = isLoading;
+    if (!isLoading) m_Loaded = true;
+}
+
+void SnapshotClient::OnLoadEnd(CefRefPtr<CefBrowser> browser,
+                               CefRefPtr<CefFrame> frame,
+                               int httpStatusCode) {
+    CefClientImpl::OnLoadEnd(browser, frame, httpStatusCode);
+    if (!frame->IsMain() || m_ReadyExpression.empty()) return;
+    const std::string script =
+        "(function poll() {"
+        "  var ready = false;"
+        "  try { ready = !!(" + m_ReadyExpression + "); } catch (e) {}"
+        "  if (ready) { console.log('" + std::string(kSnapshotReadyMarker) + "'); return; }"
+        "  setTimeout(poll, 50);"
+        "})();";
+    frame->ExecuteJavaScript(script, frame->GetURL(), 0);
+}
+
+void SnapshotClient::OnLoadError(CefRefPtr<CefBrowser> browser,
+                                 CefRefPtr<CefFrame> frame,
+                                 ErrorCode errorCode,
+                                 const CefString& errorText,
+                                 const CefString& failedUrl) {
+    CefClientImpl::OnLoadError(browser, frame, errorCode, errorText, failedUrl);
+    // Aborted loads are navigations replaced by another one (redirects done
+    // in script, downloads); the page that replaced it is what gets captured.
+    if (!frame->IsMain() || errorCode == ERR_ABORTED) return;
+    std::lock_guard<std::mutex> lock(m_ErrorMutex);
+    m_Error = errorText.ToString() + " (" + std::to_string(errorCode) + ") loading " + failedUrl.ToString();
+    m_Failed = true;
+}
+
+bool SnapshotClient::OnConsoleMessage(CefRefPtr<CefBrowser> browser,
+                                      cef_log_severity_t level,
+                                      const CefString& message,
+                                      const CefString& source,
+                                      int line) {
+    if (message.ToString() == kSnapshotReadyMarker) {
+        m_ReadySignalled = true;
+        return true;
+    }
+    return false;
+}
+
+std::string SnapshotClient::GetError() const {
+    std::lock_guard<std::mutex> lock(m_ErrorMutex);
+    return m_Error;
+}
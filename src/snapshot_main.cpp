@@ -0,0 +1,524 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <limits.h>
+#include <unistd.h>
+#endif
+
+#include "imgui.h"
+#include "imgui_impl_vulkan.h"
+
+#include "include/cef_app.h"
+#include "include/cef_browser.h"
+#include "include/cef_command_line.h"
+#include "include/internal/cef_types.h"
+
+#include "../include/vulkan_renderer.h"
+#include "../include/frame_presenter.h"
+#include "../include/cef_app_impl.h"
+#include "../include/cef_client_impl.h"
+#include "../include/metrics_registry.h"
+#include "../include/png_encoder.h"
+#include "../include/request_context_pool.h"
+#include "../include/snapshot_batch.h"
+#include "../include/snapshot_client.h"
+#include "../include/texture_handle.h"
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+// Batch page capture: loads each URL in a windowless browser, waits until
+// it is ready, draws the frame through the offscreen Vulkan renderer and
+// writes it as a PNG. Needs no window or display server.
+//
+//   snapshot [--snapshot-list=FILE] [URL|PATH ...] [--snapshot-dir=DIR]
+//
+// Exits with 0 when every page was written, 1 when some failed, 2 on bad
+// arguments, and 77 (CTest's skip code) when CEF or Vulkan cannot be
+// initialized, so a machine without the CEF runtime or a Vulkan device
+// skips the golden image tests instead of failing them.
+namespace {
+constexpr int kRuntimeUnavailable = 77;
+
+std::filesystem::path GetExecutablePath() {
+#ifdef _WIN32
+    std::wstring buffer(MAX_PATH, L'\0');
+    DWORD length = GetModuleFileNameW(nullptr, buffer.data(), static_cast<DWORD>(buffer.size()));
+    buffer.resize(length);
+    return std::filesystem::path(buffer);
+#else
+    char result[PATH_MAX];
+    const ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
+    return count > 0 ? std::filesystem::path(std::string(result, count)) : std::filesystem::current_path();
+#endif
+}
+
+int IntSwitch(CefRefPtr<CefCommandLine> commandLine, const char* name, int fallback) {
+    try {
+        return std::stoi(commandLine->GetSwitchValue(name).ToString());
+    } catch (...) {
+        return fallback;
+    }
+}
+
+// One page in flight: created -> loaded -> settled (ready signal or network
+// idle, then a repaint is requested) -> captured.
+struct ActivePage {
+    SnapshotJob job;
+    size_t index = 0;
+    CefRefPtr<CefRenderHandlerImpl> renderHandler;
+    CefRefPtr<SnapshotClient> client;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point settledAt;
+    bool settled = false;
+    uint64_t paintsAtSettle = 0;
+};
+
+// A page whose browser is closing; kept until OnBeforeClose.
+struct ClosingPage {
+    CefRefPtr<SnapshotClient> client;
+    bool closeRequested = false;
+};
+}  // namespace
+
+class SnapshotApp {
+public:
+    bool Initialize(int argc, char* argv[]);
+    // After a failed Initialize: no CEF runtime or no Vulkan device, as
+    // opposed to bad arguments.
+    bool IsRuntimeUnavailable() const { return m_RuntimeUnavailable; }
+    int Run();
+    void Cleanup();
+
+private:
+    bool InitializeCEF(int argc, char* argv[]);
+    bool ReadJobs();
+    bool InitializeVulkan();
+    bool InitializeImGui();
+    void StartPage(size_t index);
+    // True once the page is captured or has failed.
+    bool Poll(ActivePage& page);
+    bool Capture(ActivePage& page);
+    // Draws |rgba| fullscreen into an offscreen frame and reads it back.
+    bool RenderPage(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& out);
+    void ClosePage(ActivePage& page);
+    void PumpClosing();
+
+    CefRefPtr<CefAppImpl> m_CefApp;
+    bool m_CefInitialized = false;
+    std::unique_ptr<VulkanRenderer> m_Renderer;
+    OffscreenPresenter* m_Presenter = nullptr;
+    TextureHandle m_Texture;
+    VkSampler m_Sampler = VK_NULL_HANDLE;
+    SnapshotWriter m_Writer;
+
+    std::vector<SnapshotJob> m_Jobs;
+    std::vector<ActivePage> m_Active;
+    std::vector<ClosingPage> m_Closing;
+    std::filesystem::path m_OutputDir;
+    std::string m_ReadyExpression;
+    size_t m_Concurrency = 4;
+    size_t m_WriterThreads = 2;
+    std::chrono::milliseconds m_IdleTime{500};
+    std::chrono::milliseconds m_Timeout{30000};
+    bool m_Offline = false;
+    size_t m_Captured = 0;
+    size_t m_Failed = 0;
+    size_t m_TimedOut = 0;
+    bool m_RuntimeUnavailable = false;
+};
+
+bool SnapshotApp::Initialize(int argc, char* argv[]) {
+    if (!InitializeCEF(argc, argv)) {
+        std::cerr << "Failed to initialize CEF" << std::endl;
+        m_RuntimeUnavailable = true;
+        return false;
+    }
+    if (!ReadJobs()) {
+        return false;
+    }
+    if (!InitializeVulkan()) {
+        std::cerr << "Failed to initialize Vulkan" << std::endl;
+        m_RuntimeUnavailable = true;
+        return false;
+    }
+    if (!InitializeImGui()) {
+        std::cerr << "Failed to initialize ImGui" << std::endl;
+        return false;
+    }
+    // Created up front, even if every page then fails: its presence tells
+    // the golden image test that the runtime was there.
+    std::error_code error;
+    std::filesystem::create_directories(m_OutputDir, error);
+    m_Writer.Start(m_WriterThreads);
+    return true;
+}
+
+bool SnapshotApp::InitializeCEF(int argc, char* argv[]) {
+#ifdef _WIN32
+    CefMainArgs args(GetModuleHandle(nullptr));
+#else
+    CefMainArgs args(argc, argv);
+#endif
+    m_CefApp = new CefAppImpl();
+    m_CefApp->SetHeadless(true);
+    int ec = CefExecuteProcess(args, m_CefApp, nullptr);
+    if (ec >= 0) exit(ec);
+
+    CefSettings s;
+    s.windowless_rendering_enabled = true;
+    s.no_sandbox = true;
+    s.command_line_args_disabled = false;
+    const std::filesystem::path exe_dir = GetExecutablePath().parent_path();
+    // Separate from the browser apps' cache so a snapshot run does not
+    // contend for their profile lock.
+    const std::filesystem::path cache_root = RequestContextPool::CacheRootFromCommandLine(
+        RequestContextPool::ParseLaunchCommandLine(argc, argv), exe_dir / "snapshot_cache");
+    const std::filesystem::path development_cef_dir = exe_dir / "cef";
+    const std::filesystem::path cef_dir = std::filesystem::exists(development_cef_dir / "resources.pak")
+        ? development_cef_dir
+        : exe_dir;
+#ifdef _WIN32
+    SetDllDirectoryW(exe_dir.parent_path().c_str());
+    CefString(&s.root_cache_path).FromWString(cache_root.wstring());
+    CefString(&s.resources_dir_path).FromWString(cef_dir.wstring());
+    CefString(&s.locales_dir_path).FromWString((cef_dir / "locales").wstring());
+#else
+    CefString(&s.root_cache_path).FromASCII(cache_root.string().c_str());
+    CefString(&s.resources_dir_path).FromASCII(cef_dir.string().c_str());
+    CefString(&s.locales_dir_path).FromASCII((cef_dir / "locales").string().c_str());
+#endif
+    m_CefInitialized = CefInitialize(args, s, m_CefApp, nullptr);
+    return m_CefInitialized;
+}
+
+bool SnapshotApp::ReadJobs() {
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    uint32_t width = 1280, height = 720;
+    const std::string size = command_line->GetSwitchValue("snapshot-size").ToString();
+    if (!size.empty() && !ParseSnapshotSize(size, width, height)) {
+        std::cerr << "Ignoring --snapshot-size=" << size << ", expected WIDTHxHEIGHT" << std::endl;
+    }
+
+    const std::string list = command_line->GetSwitchValue("snapshot-list").ToString();
+    if (!list.empty()) {
+        std::ifstream in(list);
+        if (!in) {
+            std::cerr << "Cannot read --snapshot-list=" << list << std::endl;
+            return false;
+        }
+        std::vector<std::string> errors;
+        m_Jobs = ParseSnapshotList(in, width, height, &errors);
+        for (const std::string& error : errors) {
+            std::cerr << list << ": skipping malformed " << error << std::endl;
+        }
+    }
+    CefCommandLine::ArgumentList arguments;
+    command_line->GetArguments(arguments);
+    for (const CefString& argument : arguments) {
+        m_Jobs.push_back({ ToSnapshotUrl(argument.ToString()), width, height, "" });
+    }
+    if (m_Jobs.empty()) {
+        std::cerr << "Nothing to capture. Usage: snapshot [--snapshot-list=FILE] [URL|PATH ...]" << std::endl;
+        return false;
+    }
+
+    const std::string dir = command_line->GetSwitchValue("snapshot-dir").ToString();
+    m_OutputDir = dir.empty() ? std::filesystem::current_path() / "snapshots" : std::filesystem::path(dir);
+    for (size_t i = 0; i < m_Jobs.size(); ++i) {
+        SnapshotJob& job = m_Jobs[i];
+        if (job.output.empty()) {
+            job.output = (m_OutputDir / SnapshotFileName(job.url, i)).string();
+        } else if (std::filesystem::path(job.output).is_relative()) {
+            job.output = (m_OutputDir / job.output).string();
+        }
+    }
+
+    m_ReadyExpression = command_line->GetSwitchValue("snapshot-ready").ToString();
+    m_Concurrency = static_cast<size_t>(std::max(1, IntSwitch(command_line, "snapshot-concurrency", 4)));
+    const int hardware = static_cast<int>(std::thread::hardware_concurrency());
+    m_WriterThreads = static_cast<size_t>(std::max(1, IntSwitch(command_line, "snapshot-writers",
+                                                                std::max(2, hardware / 2))));
+    m_IdleTime = std::chrono::milliseconds(std::max(0, IntSwitch(command_line, "snapshot-idle-ms", 500)));
+    m_Timeout = std::chrono::milliseconds(std::max(1000, IntSwitch(command_line, "snapshot-timeout-ms", 30000)));
+    m_Offline = command_line->HasSwitch("snapshot-offline");
+    std::cout << "Capturing " << m_Jobs.size() << " page(s), " << m_Concurrency << " at a time, into "
+              << m_OutputDir.string() << " (PNG swizzle: " << PackRgbPath() << ")" << std::endl;
+    return true;
+}
+
+bool SnapshotApp::InitializeVulkan() {
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    m_Renderer = std::make_unique<VulkanRenderer>();
+    m_Renderer->SetDeviceOverride(command_line->GetSwitchValue("vk-device").ToString());
+    m_Renderer->SetAllowVulkan13(!command_line->HasSwitch("disable-vulkan13"));
+    auto presenter = std::make_unique<OffscreenPresenter>(m_Jobs.front().width, m_Jobs.front().height);
+    m_Presenter = presenter.get();
+    return m_Renderer->Initialize(std::move(presenter));
+}
+
+bool SnapshotApp::InitializeImGui() {
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+
+    ImGui_ImplVulkan_InitInfo init_info = {};
+    init_info.Instance = m_Renderer->GetInstance();
+    init_info.PhysicalDevice = m_Renderer->GetPhysicalDevice();
+    init_info.Device = m_Renderer->GetDevice();
+    init_info.QueueFamily = m_Renderer->GetQueueFamily();
+    init_info.Queue = m_Renderer->GetGraphicsQueue();
+    init_info.DescriptorPool = m_Renderer->GetDescriptorPool();
+    init_info.RenderPass = m_Renderer->GetRenderPass();
+    init_info.ApiVersion = m_Renderer->GetApiVersion();
+    init_info.UseDynamicRendering = m_Renderer->UsesDynamicRendering();
+    init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = m_Renderer->GetColorAttachmentFormat();
+    init_info.MinImageCount = 2;
+    init_info.ImageCount = 2;
+    return ImGui_ImplVulkan_Init(&init_info);
+}
+
+void SnapshotApp::StartPage(size_t index) {
+    ActivePage page;
+    page.job = m_Jobs[index];
+    page.index = index;
+    page.renderHandler = new CefRenderHandlerImpl(static_cast<int>(page.job.width), static_cast<int>(page.job.height));
+    page.client = new SnapshotClient(page.renderHandler, m_Offline);
+    page.client->SetReadyExpression(m_ReadyExpression);
+    page.client->GetLoadTracker()->SetPanel("Snapshot");
+    page.client->GetLoadTracker()->BeginNavigation(page.job.url);
+    page.started = std::chrono::steady_clock::now();
+
+    CefWindowInfo window_info;
+    window_info.SetAsWindowless(0);
+    CefBrowserSettings browser_settings;
+    browser_settings.windowless_frame_rate = 30;
+    CefBrowserHost::CreateBrowser(window_info, page.client, page.job.url, browser_settings, nullptr, nullptr);
+    m_Active.push_back(std::move(page));
+}
+
+bool SnapshotApp::Poll(ActivePage& page) {
+    const auto now = std::chrono::steady_clock::now();
+    if (page.client->HasFailed()) {
+        std::cerr << "[" << page.index << "] " << page.client->GetError() << std::endl;
+        ++m_Failed;
+        return true;
+    }
+    if (now - page.started > m_Timeout) {
+        // A page that never settles (long polling, a ready expression that
+        // stays false) is still captured if it painted.
+        if (page.renderHandler->GetPaintCount() == 0) {
+            std::cerr << "[" << page.index << "] timed out before the first paint: " << page.job.url << std::endl;
+            ++m_Failed;
+            return true;
+        }
+        std::cerr << "[" << page.index << "] timed out waiting for "
+                  << (m_ReadyExpression.empty() ? "network idle" : "the ready signal") << ", capturing anyway: "
+                  << page.job.url << std::endl;
+        ++m_TimedOut;
+        return Capture(page);
+    }
+
+    CefRefPtr<CefBrowser> browser = page.client->GetBrowser();
+    if (!page.settled) {
+        const bool ready = m_ReadyExpression.empty() ? page.client->GetNetwork()->IsIdle(m_IdleTime)
+                                                     : page.client->IsReadySignalled();
+        if (!browser || !page.client->IsLoaded() || !ready) {
+            return false;
+        }
+        // Paints can lag the state the page settled in; ask for a fresh one.
+        page.settled = true;
+        page.settledAt = now;
+        page.paintsAtSettle = page.renderHandler->GetPaintCount();
+        browser->GetHost()->Invalidate(PET_VIEW);
+        return false;
+    }
+    const bool repainted = page.renderHandler->GetPaintCount() > page.paintsAtSettle;
+    const bool waitedLongEnough = now - page.settledAt > std::chrono::seconds(1) &&
+                                  page.renderHandler->GetPaintCount() > 0;
+    if (!repainted && !waitedLongEnough) {
+        return false;
+    }
+    return Capture(page);
+}
+
+bool SnapshotApp::Capture(ActivePage& page) {
+    ZoneScoped;
+    std::vector<uint8_t> rgba;
+    int width = 0, height = 0;
+    page.renderHandler->GetTextureData(rgba, width, height);
+    std::vector<uint8_t> pixels;
+    if (width <= 0 || height <= 0 ||
+        !RenderPage(rgba, static_cast<uint32_t>(width), static_cast<uint32_t>(height), pixels)) {
+        std::cerr << "[" << page.index << "] could not render " << page.job.url << std::endl;
+        ++m_Failed;
+        return true;
+    }
+    m_Writer.Submit(page.job.output, std::move(pixels), static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+                    PixelOrder::Rgba);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - page.started;
+    MetricsRegistry::Get().RecordHistogram("snapshot.page_ms", elapsed.count());
+    std::cout << "[" << page.index << "] " << page.job.url << " -> " << page.job.output << " ("
+              << static_cast<int>(elapsed.count()) << " ms)" << std::endl;
+    ++m_Captured;
+    return true;
+}
+
+bool SnapshotApp::RenderPage(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height,
+                             std::vector<uint8_t>& out) {
+    if (m_Texture.IsValid() && m_Texture.GetWidth() == width && m_Texture.GetHeight() == height) {
+        m_Renderer->UpdateTextureImage(m_Texture.GetImage(), width, height, rgba.data());
+    } else {
+        if (m_Sampler == VK_NULL_HANDLE) {
+            m_Sampler = m_Renderer->CreateTextureSampler();
+        }
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImage image = m_Renderer->CreateTextureImage(width, height, rgba.data(), memory);
+        if (!m_Texture.Attach(m_Renderer.get(), m_Sampler, image, memory, VK_FORMAT_R8G8B8A8_UNORM, width, height)) {
+            return false;
+        }
+    }
+
+    // The page covers the whole frame at 1:1, so sampling returns the
+    // uploaded texels unchanged.
+    m_Presenter->Resize(width, height);
+    if (!m_Renderer->BeginFrame()) return false;
+    ImGui_ImplVulkan_NewFrame();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)width, (float)height);
+    io.DeltaTime = 1.0f / 60.0f;
+    ImGui::NewFrame();
+    ImGui::GetBackgroundDrawList()->AddImage((ImTextureID)m_Texture.GetDescriptorSet(), ImVec2(0.0f, 0.0f),
+                                             ImVec2((float)width, (float)height));
+    ImGui::Render();
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_Renderer->GetCommandBuffer());
+    m_Renderer->EndFrame();
+
+    uint32_t read_width = 0, read_height = 0;
+    return m_Presenter->ReadPixels(out, read_width, read_height) && read_width == width && read_height == height;
+}
+
+void SnapshotApp::ClosePage(ActivePage& page) {
+    m_Closing.push_back({ page.client, false });
+}
+
+void SnapshotApp::PumpClosing() {
+    for (ClosingPage& closing : m_Closing) {
+        CefRefPtr<CefBrowser> browser = closing.client->GetBrowser();
+        if (browser && !closing.closeRequested) {
+            browser->GetHost()->CloseBrowser(true);
+            closing.closeRequested = true;
+        }
+    }
+    m_Closing.erase(std::remove_if(m_Closing.begin(), m_Closing.end(),
+                                   [](const ClosingPage& closing) {
+                                       return closing.closeRequested && !closing.client->GetBrowser();
+                                   }),
+                    m_Closing.end());
+}
+
+int SnapshotApp::Run() {
+    ZoneScoped;
+    const auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    while (next < m_Jobs.size() || !m_Active.empty()) {
+        while (m_Active.size() < m_Concurrency && next < m_Jobs.size()) {
+            StartPage(next++);
+        }
+        CefDoMessageLoopWork();
+        const size_t before = m_Active.size();
+        for (ActivePage& page : m_Active) {
+            if (Poll(page)) {
+                ClosePage(page);
+                page.client = nullptr;
+            }
+        }
+        m_Active.erase(std::remove_if(m_Active.begin(), m_Active.end(),
+                                      [](const ActivePage& page) { return !page.client; }),
+                       m_Active.end());
+        PumpClosing();
+        if (m_Active.size() == before) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    const size_t write_failures = m_Writer.Wait();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t written = m_Writer.GetWritten();
+    const double pages_per_minute = seconds > 0.0 ? written * 60.0 / seconds : 0.0;
+    MetricsRegistry::Get().SetGauge("snapshot.pages_per_minute", pages_per_minute);
+    char summary[160];
+    std::snprintf(summary, sizeof(summary), "%.1f s, %.1f pages/min", seconds, pages_per_minute);
+    std::cout << "Wrote " << written << " of " << m_Jobs.size() << " page(s) in " << summary;
+    if (m_TimedOut > 0) std::cout << ", " << m_TimedOut << " captured after timeout";
+    if (m_Failed + write_failures > 0) std::cout << ", " << (m_Failed + write_failures) << " failed";
+    std::cout << std::endl;
+    return m_Failed + write_failures == 0 ? 0 : 1;
+}
+
+void SnapshotApp::Cleanup() {
+    m_Writer.Stop();
+
+    // Let every browser close before CefShutdown.
+    for (ActivePage& page : m_Active) {
+        ClosePage(page);
+    }
+    m_Active.clear();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (m_CefInitialized && !m_Closing.empty() && std::chrono::steady_clock::now() < deadline) {
+        CefDoMessageLoopWork();
+        PumpClosing();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    m_Closing.clear();
+
+    if (m_Renderer) {
+        vkDeviceWaitIdle(m_Renderer->GetDevice());
+        m_Texture.Release(m_Renderer.get());
+        m_Renderer->FlushDeferredReleases();
+        if (m_Sampler != VK_NULL_HANDLE) {
+            vkDestroySampler(m_Renderer->GetDevice(), m_Sampler, nullptr);
+        }
+        if (ImGui::GetCurrentContext()) {
+            if (ImGui::GetIO().BackendRendererUserData) {
+                ImGui_ImplVulkan_Shutdown();
+            }
+            ImGui::DestroyContext();
+        }
+        m_Renderer->Cleanup();
+    }
+
+    m_CefApp = nullptr;
+    if (m_CefInitialized) {
+        CefShutdown();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    SnapshotApp app;
+    if (!app.Initialize(argc, argv)) {
+        const int code = app.IsRuntimeUnavailable() ? kRuntimeUnavailable : 2;
+        app.Cleanup();
+        return code;
+    }
+    const int result = app.Run();
+    app.Cleanup();
+    return result;
+}
@@ -0,0 +1,56 @@
+#include "../include/software_mode.h"
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+bool ParseSoftwareModeSetting(const std::string& value, SoftwareModeSetting& setting) {
+    if (value.empty() || value == "on") {
+        setting = SoftwareModeSetting::On;
+    } else if (value == "off") {
+        setting = SoftwareModeSetting::Off;
+    } else if (value == "auto") {
+        setting = SoftwareModeSetting::Auto;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+SoftwareModeDecision DecideSoftwareMode(SoftwareModeSetting setting, const std::vector<PhysicalDeviceInfo>& devices,
+                                        const std::string& deviceOverride) {
+    ZoneScoped;
+    SoftwareModeDecision decision;
+    if (setting != SoftwareModeSetting::Auto) {
+        decision.enabled = setting == SoftwareModeSetting::On;
+        decision.reason = decision.enabled ? "--software-mode=on" : "--software-mode=off";
+        return decision;
+    }
+    const PhysicalDeviceSelection selection = SelectPhysicalDevice(devices, deviceOverride);
+    if (selection.index < 0) {
+        decision.enabled = true;
+        decision.reason = devices.empty() ? "no Vulkan device" : "no usable Vulkan device";
+        return decision;
+    }
+    const PhysicalDeviceInfo& device = devices[selection.index];
+    decision.enabled = device.kind == PhysicalDeviceKind::Cpu;
+    decision.reason = device.name + " is a " + PhysicalDeviceKindName(device.kind) +
+                      (decision.enabled ? " implementation" : " GPU");
+    return decision;
+}
+
+SoftwareModeDecision ResolveSoftwareMode(bool present, const std::string& value, const std::string& deviceOverride,
+                                         const std::function<std::vector<PhysicalDeviceInfo>()>& probe) {
+    SoftwareModeSetting setting = SoftwareModeSetting::Auto;
+    std::string warning;
+    if (present && !ParseSoftwareModeSetting(value, setting)) {
+        setting = SoftwareModeSetting::Auto;
+        warning = "--software-mode=" + value + " is not auto, on or off; using auto";
+    }
+    SoftwareModeDecision decision = DecideSoftwareMode(
+        setting, setting == SoftwareModeSetting::Auto ? probe() : std::vector<PhysicalDeviceInfo>{}, deviceOverride);
+    decision.warning = warning;
+    return decision;
+}
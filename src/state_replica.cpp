@@ -0,0 +1,51 @@
+#include "../include/state_replica.h"
+#include <utility>
+
+uint64_t StateReplica::Publish(const std::string& key, std::string json) {
+    Entry& entry = m_Entries[key];
+    ++entry.version;
+    entry.json = std::move(json);
+    return entry.version;
+}
+
+bool StateReplica::Apply(const std::string& key, uint64_t version, std::string json) {
+    auto it = m_Entries.find(key);
+    if (version == 0 || (it != m_Entries.end() && version <= it->second.version)) {
+        return false;
+    }
+    Entry& entry = it != m_Entries.end() ? it->second : m_Entries[key];
+    entry.version = version;
+    entry.json = std::move(json);
+    return true;
+}
+
+const StateReplica::Entry* StateReplica::Find(const std::string& key) const {
+    auto it = m_Entries.find(key);
+    return it == m_Entries.end() ? nullptr : &it->second;
+}
+
+void StatePublisher::Publish(const std::string& key, std::string json, const SendUpdate& send) {
+    const uint64_t version = m_State.Publish(key, std::move(json));
+    send({ key, version, m_State.Find(key)->json });
+}
+
+void StatePublisher::Resync(const SendUpdate& send) const {
+    for (const auto& [key, entry] : m_State.GetEntries()) {
+        send({ key, entry.version, entry.json });
+    }
+}
+
+bool StateReplicaSet::OnContextCreated(int browserId, bool isMainFrame) {
+    if (!isMainFrame) return false;
+    m_Replicas.try_emplace(browserId);
+    return true;
+}
+
+bool StateReplicaSet::OnUpdate(int browserId, const StateUpdate& update) {
+    return m_Replicas[browserId].Apply(update.key, update.version, update.json);
+}
+
+const StateReplica::Entry* StateReplicaSet::Find(int browserId, const std::string& key) const {
+    auto it = m_Replicas.find(browserId);
+    return it == m_Replicas.end() ? nullptr : it->second.Find(key);
+}
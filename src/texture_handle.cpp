@@ -0,0 +1,120 @@
+#include "../include/texture_handle.h"
+#include "../include/metrics_registry.h"
+#include "../include/vulkan_renderer.h"
+#include "imgui_impl_vulkan.h"
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#endif
+
+namespace {
+// Handles are only touched from the frame loop, so plain counters will do.
+int g_LiveImages = 0;
+int g_LiveDescriptorSets = 0;
+
+void PublishCounts() {
+    MetricsRegistry::Get().SetGauge("textures.live_images", static_cast<double>(g_LiveImages));
+    MetricsRegistry::Get().SetGauge("textures.live_descriptor_sets", static_cast<double>(g_LiveDescriptorSets));
+}
+}  // namespace
+
+bool TextureHandle::Attach(VulkanRenderer* renderer, VkSampler sampler, VkImage image, VkDeviceMemory memory,
+                           VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels,
+                           ImageDeleter deleter) {
+    ZoneScoped;
+    if (!renderer || image == VK_NULL_HANDLE) return false;
+    if (!deleter) {
+        VkDevice device = renderer->GetDevice();
+        deleter = [device](VkImage oldImage, VkDeviceMemory oldMemory) {
+            vkDestroyImage(device, oldImage, nullptr);
+            vkFreeMemory(device, oldMemory, nullptr);
+        };
+    }
+    VkImageView view = renderer->CreateImageView(image, format, mipLevels);
+    if (view == VK_NULL_HANDLE) {
+        deleter(image, memory);
+        return false;
+    }
+
+    LayerCompositor* compositor = renderer->GetCompositor();
+    if (compositor && m_LayerTexture == LayerCompositor::kInvalidTexture) {
+        m_LayerTexture = compositor->RegisterTexture(view);
+    } else if (compositor) {
+        compositor->UpdateTexture(m_LayerTexture, view);
+    } else if (m_DescriptorSet == VK_NULL_HANDLE) {
+        m_DescriptorSet = ImGui_ImplVulkan_AddTexture(sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        if (m_DescriptorSet != VK_NULL_HANDLE) ++g_LiveDescriptorSets;
+    } else {
+        // Same layout as ImGui_ImplVulkan_AddTexture: one combined image
+        // sampler at binding 0.
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+        imageInfo.imageView = view;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_DescriptorSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(renderer->GetDevice(), 1, &write, 0, nullptr);
+        MetricsRegistry::Get().AddCounter("textures.descriptor_updates", 1.0);
+    }
+
+    RetireImage(renderer);
+    m_Image = image;
+    m_Memory = memory;
+    m_View = view;
+    m_Deleter = std::move(deleter);
+    m_Format = format;
+    m_Width = width;
+    m_Height = height;
+    m_MipLevels = mipLevels;
+    ++g_LiveImages;
+    PublishCounts();
+    return true;
+}
+
+void TextureHandle::Release(VulkanRenderer* renderer) {
+    if (!renderer) return;
+    // Bindings first, so nothing points at the view once it is destroyed.
+    if (m_LayerTexture != LayerCompositor::kInvalidTexture) {
+        const uint32_t layerTexture = m_LayerTexture;
+        renderer->DeferUntilFrameComplete([renderer, layerTexture] {
+            if (LayerCompositor* compositor = renderer->GetCompositor()) compositor->ReleaseTexture(layerTexture);
+        });
+        m_LayerTexture = LayerCompositor::kInvalidTexture;
+    }
+    if (m_DescriptorSet != VK_NULL_HANDLE) {
+        const VkDescriptorSet descriptorSet = m_DescriptorSet;
+        renderer->DeferUntilFrameComplete([descriptorSet] {
+            ImGui_ImplVulkan_RemoveTexture(descriptorSet);
+            --g_LiveDescriptorSets;
+            PublishCounts();
+        });
+        m_DescriptorSet = VK_NULL_HANDLE;
+    }
+    RetireImage(renderer);
+    m_Format = VK_FORMAT_UNDEFINED;
+    m_Width = m_Height = 0;
+    m_MipLevels = 1;
+}
+
+void TextureHandle::RetireImage(VulkanRenderer* renderer) {
+    if (m_Image == VK_NULL_HANDLE) return;
+    VkDevice device = renderer->GetDevice();
+    renderer->DeferUntilFrameComplete([device, image = m_Image, memory = m_Memory, view = m_View,
+                                       deleter = std::move(m_Deleter)] {
+        vkDestroyImageView(device, view, nullptr);
+        deleter(image, memory);
+        --g_LiveImages;
+        PublishCounts();
+    });
+    m_Image = VK_NULL_HANDLE;
+    m_Memory = VK_NULL_HANDLE;
+    m_View = VK_NULL_HANDLE;
+    m_Deleter = {};
+}
@@ -0,0 +1,245 @@
+#include "../include/trace_capture.h"
+#include "include/cef_app.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Bounds memory if a capture is left running; roughly 40 bytes per event.
+constexpr size_t kMaxEvents = 2 * 1000 * 1000;
+// How long Shutdown waits for Chromium to flush a running capture.
+constexpr std::chrono::seconds kShutdownFlushTimeout{5};
+
+int64_t CurrentThreadId() {
+#ifdef _WIN32
+    return static_cast<int64_t>(GetCurrentThreadId());
+#else
+    return static_cast<int64_t>(syscall(SYS_gettid));
+#endif
+}
+
+int64_t CurrentProcessId() {
+#ifdef _WIN32
+    return static_cast<int64_t>(GetCurrentProcessId());
+#else
+    return static_cast<int64_t>(getpid());
+#endif
+}
+
+int64_t SteadyMicros(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+}  // namespace
+
+TraceCapture& TraceCapture::Get() {
+    // Leaked on purpose: CEF may hold the end-tracing callback past static
+    // destruction, and trace scopes can run on any thread during shutdown.
+    static TraceCapture* instance = [] {
+        TraceCapture* capture = new TraceCapture();
+        capture->AddRef();
+        return capture;
+    }();
+    return *instance;
+}
+
+bool TraceCapture::ConfigureFromCommandLine(CefRefPtr<CefCommandLine> commandLine) {
+    if (!commandLine) return false;
+    if (commandLine->HasSwitch("trace-categories")) {
+        m_Categories = commandLine->GetSwitchValue("trace-categories").ToString();
+    }
+    if (commandLine->HasSwitch("trace-file")) {
+        m_OutputPath = commandLine->GetSwitchValue("trace-file").ToString();
+    }
+    if (commandLine->HasSwitch("trace")) {
+        try {
+            m_StartupSeconds = std::stoi(commandLine->GetSwitchValue("trace").ToString());
+        } catch (...) {
+            std::cerr << "Ignoring invalid --trace value" << std::endl;
+            m_StartupSeconds = 0;
+        }
+    }
+    return m_StartupSeconds > 0;
+}
+
+bool TraceCapture::Start() {
+    if (IsActive() || m_EndPending || m_ShutDown) return false;
+    if (!CefBeginTracing(m_Categories, nullptr)) {
+        std::cerr << "CefBeginTracing failed" << std::endl;
+        return false;
+    }
+
+    // Chromium stamps events with its own trace clock; remember how far it is
+    // from steady_clock so native events can be shifted onto the same axis.
+    m_ClockOffsetUs = CefNowFromSystemTraceTime() - SteadyMicros(std::chrono::steady_clock::now());
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Events.clear();
+    }
+    if (m_StartupSeconds > 0) {
+        m_StopAt = std::chrono::steady_clock::now() + std::chrono::seconds(m_StartupSeconds);
+        m_StartupSeconds = 0;
+    } else {
+        m_StopAt = {};
+    }
+    m_Active = true;
+    std::cout << "Trace capture started"
+              << (m_Categories.empty() ? std::string() : " (" + m_Categories + ")") << std::endl;
+    return true;
+}
+
+bool TraceCapture::Stop() {
+    if (!IsActive()) return false;
+    m_Active = false;
+    m_StopAt = {};
+
+    const std::filesystem::path chromiumFile =
+        std::filesystem::temp_directory_path() / ("imguicef_chromium_" + std::to_string(CurrentProcessId()) + ".json");
+    if (!CefEndTracing(chromiumFile.string(), this)) {
+        std::cerr << "CefEndTracing failed" << std::endl;
+        return false;
+    }
+    m_EndPending = true;
+    return true;
+}
+
+void TraceCapture::Toggle() {
+    if (IsActive()) {
+        Stop();
+    } else {
+        Start();
+    }
+}
+
+void TraceCapture::Tick() {
+    if (IsActive() && m_StopAt != std::chrono::steady_clock::time_point{} &&
+        std::chrono::steady_clock::now() >= m_StopAt) {
+        Stop();
+    }
+}
+
+void TraceCapture::Shutdown() {
+    Stop();
+    const auto deadline = std::chrono::steady_clock::now() + kShutdownFlushTimeout;
+    while (m_EndPending && std::chrono::steady_clock::now() < deadline) {
+        CefDoMessageLoopWork();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    if (m_EndPending) std::cerr << "Trace capture did not finish before shutdown" << std::endl;
+    m_ShutDown = true;
+    if (m_Writer.joinable()) {
+        m_Writer.join();
+    }
+}
+
+void TraceCapture::RecordComplete(const char* name, const char* category,
+                                  std::chrono::steady_clock::time_point start,
+                                  std::chrono::steady_clock::time_point end) {
+    if (!IsActive()) return;
+    const int64_t durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    Append({ name, category, 'X', ToTraceMicros(start), durationUs, CurrentThreadId() });
+}
+
+void TraceCapture::RecordInstant(const char* name, const char* category) {
+    if (!IsActive()) return;
+    Append({ name, category, 'i', ToTraceMicros(std::chrono::steady_clock::now()), 0, CurrentThreadId() });
+}
+
+int64_t TraceCapture::ToTraceMicros(std::chrono::steady_clock::time_point time) const {
+    return SteadyMicros(time) + m_ClockOffsetUs.load(std::memory_order_relaxed);
+}
+
+void TraceCapture::Append(const Event& event) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Events.size() < kMaxEvents) {
+        m_Events.push_back(event);
+    }
+}
+
+void TraceCapture::OnEndTracingComplete(const CefString& tracing_file) {
+    m_EndPending = false;
+    if (m_ShutDown) {
+        // Too late: Shutdown already joined the writer.
+        std::remove(tracing_file.ToString().c_str());
+        return;
+    }
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        events.swap(m_Events);
+    }
+
+    // Chromium traces are often tens of megabytes; merge off the UI thread.
+    if (m_Writer.joinable()) {
+        m_Writer.join();
+    }
+    m_Writer = std::thread(&TraceCapture::WriteMerged, tracing_file.ToString(), m_OutputPath,
+                           std::move(events), CurrentProcessId());
+}
+
+void TraceCapture::WriteMerged(const std::string& chromiumFile, const std::string& outputPath,
+                               std::vector<Event> events, int64_t processId) {
+    std::string chromium;
+    {
+        std::ifstream input(chromiumFile, std::ios::binary);
+        std::stringstream buffer;
+        buffer << input.rdbuf();
+        chromium = buffer.str();
+    }
+    std::remove(chromiumFile.c_str());
+
+    // Native events share the browser process id, and the UI thread id, so
+    // they land on the same tracks as Chromium's own browser-process events.
+    std::string native;
+    native.reserve(events.size() * 128);
+    char line[512];
+    for (const Event& event : events) {
+        int written = 0;
+        if (event.phase == 'X') {
+            written = std::snprintf(line, sizeof(line),
+                "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%lld,\"tid\":%lld},",
+                event.name, event.category, static_cast<long long>(event.timestampUs),
+                static_cast<long long>(event.durationUs), static_cast<long long>(processId),
+                static_cast<long long>(event.threadId));
+        } else {
+            written = std::snprintf(line, sizeof(line),
+                "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":%lld,\"tid\":%lld},",
+                event.name, event.category, static_cast<long long>(event.timestampUs),
+                static_cast<long long>(processId), static_cast<long long>(event.threadId));
+        }
+        if (written > 0 && written < static_cast<int>(sizeof(line))) {
+            native.append(line, static_cast<size_t>(written));
+        }
+    }
+
+    std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        std::cerr << "Failed to open trace output " << outputPath << std::endl;
+        return;
+    }
+
+    const size_t key = chromium.find("\"traceEvents\"");
+    const size_t arrayStart = key == std::string::npos ? std::string::npos : chromium.find('[', key);
+    if (arrayStart == std::string::npos) {
+        // No usable Chromium data; still emit our own events.
+        if (!native.empty()) native.pop_back();
+        output << "{\"traceEvents\":[" << native << "]}";
+    } else {
+        const size_t firstEvent = chromium.find_first_not_of(" \t\r\n", arrayStart + 1);
+        const bool chromiumEmpty = firstEvent == std::string::npos || chromium[firstEvent] == ']';
+        if (chromiumEmpty && !native.empty()) native.pop_back();
+        output.write(chromium.data(), static_cast<std::streamsize>(arrayStart + 1));
+        output << native;
+        output.write(chromium.data() + arrayStart + 1,
+                     static_cast<std::streamsize>(chromium.size() - arrayStart - 1));
+    }
+    std::cout << "Trace written to " << outputPath << " (" << events.size() << " native events)" << std::endl;
+}
@@ -0,0 +1,132 @@
+#include "../include/vulkan_device_selection.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+int64_t KindScore(PhysicalDeviceKind kind) {
+    switch (kind) {
+        case PhysicalDeviceKind::Discrete: return 4;
+        case PhysicalDeviceKind::Integrated: return 3;
+        case PhysicalDeviceKind::Virtual: return 2;
+        case PhysicalDeviceKind::Cpu: return 1;
+        default: return 0;
+    }
+}
+
+std::string Normalize(const std::string& value, bool dropDashes) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (dropDashes && c == '-') continue;
+        result.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    return result;
+}
+
+bool IsDecimal(const std::string& value) {
+    return !value.empty() && std::all_of(value.begin(), value.end(),
+        [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; });
+}
+
+int FindOverride(const std::vector<PhysicalDeviceInfo>& devices, const std::string& override) {
+    const std::string uuid = Normalize(override, true);
+    for (size_t i = 0; i < devices.size(); ++i) {
+        if (!devices[i].uuid.empty() && Normalize(devices[i].uuid, true) == uuid) return static_cast<int>(i);
+    }
+    // Out-of-range numbers fall through to the name match, e.g. "3060".
+    if (IsDecimal(override) && override.size() < 4) {
+        const size_t index = static_cast<size_t>(std::stoul(override));
+        if (index < devices.size()) return static_cast<int>(index);
+    }
+    const std::string name = Normalize(override, false);
+    for (size_t i = 0; i < devices.size(); ++i) {
+        if (Normalize(devices[i].name, false).find(name) != std::string::npos) return static_cast<int>(i);
+    }
+    return -1;
+}
+}  // namespace
+
+int64_t ScorePhysicalDevice(const PhysicalDeviceInfo& device) {
+    if (!device.missingExtensions.empty() || !device.missingFeatures.empty() || device.queueFamily < 0) {
+        return -1;
+    }
+    // Kind dominates; memory in MiB (capped well below the kind step) breaks ties.
+    constexpr int64_t kKindStep = int64_t(1) << 40;
+    const int64_t memoryMb = static_cast<int64_t>(std::min<uint64_t>(device.deviceLocalBytes >> 20, kKindStep - 1));
+    return KindScore(device.kind) * kKindStep + memoryMb;
+}
+
+std::string FormatDeviceUuid(const uint8_t (&uuid)[16]) {
+    char buffer[37];
+    std::snprintf(buffer, sizeof(buffer),
+                  "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                  uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7],
+                  uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+    return buffer;
+}
+
+PhysicalDeviceSelection SelectPhysicalDevice(const std::vector<PhysicalDeviceInfo>& devices,
+                                             const std::string& override) {
+    PhysicalDeviceSelection selection;
+    selection.scores.reserve(devices.size());
+    for (const auto& device : devices) selection.scores.push_back(ScorePhysicalDevice(device));
+
+    if (!override.empty()) {
+        const int match = FindOverride(devices, override);
+        if (match >= 0 && selection.scores[match] >= 0) {
+            selection.index = match;
+            selection.reason = "override '" + override + "'";
+            return selection;
+        }
+        selection.reason = match >= 0
+            ? "override '" + override + "' matched an unsuitable device; "
+            : "override '" + override + "' matched no device; ";
+    }
+
+    // Ties keep enumeration order.
+    int64_t best = -1;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        if (selection.scores[i] > best) {
+            best = selection.scores[i];
+            selection.index = static_cast<int>(i);
+        }
+    }
+    selection.reason += selection.index >= 0 ? "highest score" : "no suitable device";
+    return selection;
+}
+
+std::string FormatDeviceReport(const std::vector<PhysicalDeviceInfo>& devices,
+                               const PhysicalDeviceSelection& selection) {
+    std::ostringstream report;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const PhysicalDeviceInfo& device = devices[i];
+        report << (static_cast<int>(i) == selection.index ? "* " : "  ")
+               << "[" << i << "] " << device.name
+               << " (" << PhysicalDeviceKindName(device.kind)
+               << ", Vulkan " << (device.apiVersion >> 22) << "." << ((device.apiVersion >> 12) & 0x3ff)
+               << ", " << (device.deviceLocalBytes >> 20) << " MiB local"
+               << ", uuid " << device.uuid << ")";
+        if (device.queueFamily < 0) report << " no graphics+present queue;";
+        for (const auto& extension : device.missingExtensions) report << " missing " << extension << ";";
+        for (const auto& feature : device.missingFeatures) report << " missing feature " << feature << ";";
+        if (i < selection.scores.size()) report << " score " << selection.scores[i];
+        report << "\n";
+    }
+    report << "Selected: ";
+    if (selection.index >= 0) report << devices[selection.index].name;
+    else report << "none";
+    report << " (" << selection.reason << ")";
+    return report.str();
+}
+
+const char* PhysicalDeviceKindName(PhysicalDeviceKind kind) {
+    switch (kind) {
+        case PhysicalDeviceKind::Discrete: return "discrete";
+        case PhysicalDeviceKind::Integrated: return "integrated";
+        case PhysicalDeviceKind::Virtual: return "virtual";
+        case PhysicalDeviceKind::Cpu: return "cpu";
+        default: return "other";
+    }
+}
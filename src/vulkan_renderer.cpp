@@ -1,6 +1,13 @@
 #include "../include/vulkan_renderer.h"
+#include "../include/vulkan_device_selection.h"
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <iterator>
+#include <cstdlib>
 #include <cstring>
+#include <set>
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
@@ -9,118 +16,569 @@
 #define ZoneScoped
 #endif
 
+namespace {
+// Stage and access masks for each layout transition the renderer records,
+// precise (synchronization2) and legacy.
+struct LayoutTransition {
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkPipelineStageFlags2 srcStage2;
+    VkAccessFlags2 srcAccess2;
+    VkPipelineStageFlags2 dstStage2;
+    VkAccessFlags2 dstAccess2;
+    VkPipelineStageFlags srcStage;
+    VkAccessFlags srcAccess;
+    VkPipelineStageFlags dstStage;
+    VkAccessFlags dstAccess;
+};
+
+const LayoutTransition kLayoutTransitions[] = {
+    // New texture: nothing to wait for before the copy.
+    { VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT },
+    // Re-upload: write-after-read only needs the fragment reads to finish.
+    { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_NONE,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT },
+    // Mip chain: each level is blitted from the one above once that level
+    // has been written by the copy or the previous blit.
+    { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT },
+    // Texture readback: the copy only has to wait for earlier sampling.
+    { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_NONE,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT },
+    { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_NONE,
+      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT },
+    { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT },
+    // Presenter image, 1.3 path only. The source stage matches the acquire
+    // semaphore's wait stage so the transition waits for the image.
+    { VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+      VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE,
+      VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT },
+    { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+      VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+      VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 },
+    // Offscreen image, copied out for readback after rendering.
+    { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+      VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT },
+};
+
+const LayoutTransition* FindLayoutTransition(VkImageLayout oldLayout, VkImageLayout newLayout) {
+    for (const auto& transition : kLayoutTransitions) {
+        if (transition.oldLayout == oldLayout && transition.newLayout == newLayout) return &transition;
+    }
+    return nullptr;
+}
+
+// Level |level| of a chain whose base is |extent|, never smaller than 1x1.
+uint32_t MipExtent(uint32_t extent, uint32_t level) {
+    return std::max(1u, extent >> level);
+}
+
+// The part of |level| covered by |damage| on level 0, rounded outwards.
+VkRect2D MipDamage(const VkRect2D& damage, uint32_t width, uint32_t height, uint32_t level) {
+    const uint32_t x0 = static_cast<uint32_t>(damage.offset.x) >> level;
+    const uint32_t y0 = static_cast<uint32_t>(damage.offset.y) >> level;
+    const uint32_t scale = 1u << level;
+    const uint32_t x1 = std::min(MipExtent(width, level), (damage.offset.x + damage.extent.width + scale - 1) >> level);
+    const uint32_t y1 = std::min(MipExtent(height, level), (damage.offset.y + damage.extent.height + scale - 1) >> level);
+    VkRect2D rect{};
+    rect.offset = { static_cast<int32_t>(x0), static_cast<int32_t>(y0) };
+    rect.extent = { std::max(x1, x0 + 1) - x0, std::max(y1, y0 + 1) - y0 };
+    return rect;
+}
+}  // namespace
+
 bool VulkanRenderer::Initialize(GLFWwindow* window) {
-    m_Window = window;
+    return Initialize(std::make_unique<SwapchainPresenter>(window));
+}
+
+bool VulkanRenderer::Initialize(std::unique_ptr<FramePresenter> presenter) {
+    m_Presenter = std::move(presenter);
+    if (!m_Presenter) return false;
     
     if (!CreateInstance()) return false;
-    
-    if (glfwCreateWindowSurface(m_Instance, m_Window, nullptr, &m_Surface) != VK_SUCCESS) {
-        return false;
-    }
+    if (!m_Presenter->AttachInstance(m_Instance)) return false;
     
     if (!SelectPhysicalDevice()) return false;
     if (!CreateLogicalDevice()) return false;
-    if (!CreateSwapchain()) return false;
-    if (!CreateRenderPass()) return false;
-    if (!CreateFramebuffers()) return false;
+    if (!m_Presenter->Create(*this)) return false;
+    m_ColorFormat = m_Presenter->GetFormat();
+    if (!m_DynamicRendering) {
+        if (!CreateRenderPass()) return false;
+        if (!CreateFramebuffers(*m_Presenter, m_Framebuffers)) return false;
+    }
     if (!CreateCommandPool()) return false;
     if (!CreateSyncObjects()) return false;
+    if (!m_Readback.Initialize(*this)) return false;
     if (!CreateDescriptorPool()) return false;
     
+    if (m_CompositorEnabled && (m_DescriptorIndexing || m_SampledImageDynamicIndexing)) {
+        m_Compositor = std::make_unique<LayerCompositor>();
+        if (!m_Compositor->Initialize(*this, m_DescriptorIndexing)) m_Compositor.reset();
+    }
+    
     return true;
 }
 
 void VulkanRenderer::Cleanup() {
     if (m_Device != VK_NULL_HANDLE) {
+        for (auto& target : m_WindowTargets) DrainAcquiredImage(*target);
         vkDeviceWaitIdle(m_Device);
-        
-        for (auto framebuffer : m_Framebuffers) {
-            vkDestroyFramebuffer(m_Device, framebuffer, nullptr);
+        RunDeferredReleases(UINT64_MAX);
+        m_Readback.Cleanup();
+        if (m_Compositor) {
+            m_Compositor->Cleanup();
+            m_Compositor.reset();
         }
+        ReclaimUploads();
+        DestroyStagingPool();
         
-        for (auto imageView : m_SwapchainImageViews) {
-            vkDestroyImageView(m_Device, imageView, nullptr);
-        }
+        for (auto& target : m_WindowTargets) ReleaseWindowTarget(*target);
+        m_WindowTargets.clear();
+        DestroyFramebuffers(m_Framebuffers);
+        if (m_Presenter) m_Presenter->Destroy(*this);
         
         vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
         vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
         vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
-        vkDestroySwapchainKHR(m_Device, m_Swapchain, nullptr);
         
         vkDestroySemaphore(m_Device, m_ImageAvailableSemaphore, nullptr);
         vkDestroySemaphore(m_Device, m_RenderFinishedSemaphore, nullptr);
+        vkDestroySemaphore(m_Device, m_Timeline, nullptr);
         vkDestroyFence(m_Device, m_InFlightFence, nullptr);
         
         vkDestroyDevice(m_Device, nullptr);
     }
     
     if (m_Instance != VK_NULL_HANDLE) {
-        vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+        if (m_Presenter) m_Presenter->DetachInstance(m_Instance);
         vkDestroyInstance(m_Instance, nullptr);
     }
 }
 
-void VulkanRenderer::BeginFrame() {
-    vkWaitForFences(m_Device, 1, &m_InFlightFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(m_Device, 1, &m_InFlightFence);
-    
-    vkAcquireNextImageKHR(m_Device, m_Swapchain, UINT64_MAX, m_ImageAvailableSemaphore, VK_NULL_HANDLE, &m_ImageIndex);
+bool VulkanRenderer::BeginFrame() {
+    if (m_DynamicRendering) {
+        WaitForTimeline(m_LastFrameValue);
+        ReclaimUploads();
+    } else {
+        // Reset only once an image is acquired, so a skipped frame leaves it
+        // signaled for the next wait.
+        vkWaitForFences(m_Device, 1, &m_InFlightFence, VK_TRUE, UINT64_MAX);
+    }
+    m_CompletedFrames = m_FramesSubmitted;
+    m_Readback.Resolve(m_CompletedFrames);
+    RunDeferredReleases(m_FramesSubmitted);
+    
+    if (m_Presenter->NeedsRecreate()) RecreatePresenter(*m_Presenter, m_Framebuffers);
+    // Alone, the main window's FIFO acquire paces the loop. Next to window
+    // targets it must not: every window is acquired without waiting, and
+    // each is drawn when its own display has a free image.
+    const bool wait = m_WindowTargets.empty();
+    auto acquire = [&] {
+        if (!wait) return m_Presenter->TryAcquire(m_ImageAvailableSemaphore, m_ImageIndex);
+        return m_Presenter->Acquire(m_ImageAvailableSemaphore, m_ImageIndex) ? FramePresenter::AcquireResult::Acquired
+                                                                             : FramePresenter::AcquireResult::OutOfDate;
+    };
+    const auto acquireStart = std::chrono::steady_clock::now();
+    FramePresenter::AcquireResult acquired = acquire();
+    if (acquired == FramePresenter::AcquireResult::OutOfDate && RecreatePresenter(*m_Presenter, m_Framebuffers)) {
+        acquired = acquire();
+    }
+    const std::chrono::duration<double, std::milli> acquireWait = std::chrono::steady_clock::now() - acquireStart;
+    MetricsRegistry::Get().RecordHistogram("vulkan.acquire_wait_ms", acquireWait.count());
+    if (acquired != FramePresenter::AcquireResult::Acquired) {
+        // m_ImageAvailableSemaphore was not signaled; submitting now would
+        // wait on it forever.
+        MetricsRegistry::Get().AddCounter("vulkan.frames_skipped");
+        return false;
+    }
+    if (!m_DynamicRendering) vkResetFences(m_Device, 1, &m_InFlightFence);
+    BeginRendering(m_CommandBuffer, *m_Presenter, m_ImageIndex, m_Framebuffers);
+    return true;
+}
+
+void VulkanRenderer::BeginRendering(VkCommandBuffer commandBuffer, FramePresenter& presenter, uint32_t imageIndex,
+                                    const std::vector<VkFramebuffer>& framebuffers) {
+    const VkExtent2D extent = presenter.GetExtent();
     
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    vkBeginCommandBuffer(m_CommandBuffer, &beginInfo);
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    
+    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+    
+    if (m_DynamicRendering) {
+        // No render pass or framebuffer: the presenter's view is bound directly.
+        RecordImageBarrier(commandBuffer, presenter.GetImages()[imageIndex],
+                           VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        
+        VkRenderingAttachmentInfo colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        colorAttachment.imageView = presenter.GetImageViews()[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearColor;
+        
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.renderArea.offset = {0, 0};
+        renderingInfo.renderArea.extent = extent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+        return;
+    }
     
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = m_RenderPass;
-    renderPassInfo.framebuffer = m_Framebuffers[m_ImageIndex];
+    renderPassInfo.framebuffer = framebuffers[imageIndex];
     renderPassInfo.renderArea.offset = {0, 0};
-    
-    int width, height;
-    glfwGetFramebufferSize(m_Window, &width, &height);
-    renderPassInfo.renderArea.extent.width = static_cast<uint32_t>(width);
-    renderPassInfo.renderArea.extent.height = static_cast<uint32_t>(height);
-    
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+    renderPassInfo.renderArea.extent = extent;
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues = &clearColor;
     
-    vkCmdBeginRenderPass(m_CommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void VulkanRenderer::CompositeLayers() {
+    if (m_Compositor) m_Compositor->Record(m_CommandBuffer, m_Presenter->GetExtent());
 }
 
 void VulkanRenderer::EndFrame() {
     ZoneScoped;
-    vkCmdEndRenderPass(m_CommandBuffer);
+    EndRendering(m_CommandBuffer, *m_Presenter, m_ImageIndex);
+    // Outside any render pass, and before the presenter's own copies.
+    m_Readback.Record(m_CommandBuffer, m_FramesSubmitted + 1);
+    m_Presenter->RecordAfterRendering(m_CommandBuffer, m_ImageIndex);
     vkEndCommandBuffer(m_CommandBuffer);
     
+    // Offscreen images have no acquire or present to hand over with
+    // semaphores; the binary pair is left unsignaled.
+    m_LastFrameValue = SubmitFrame(m_CommandBuffer, m_Presenter->UsesSemaphores(), m_ImageAvailableSemaphore,
+                                   m_RenderFinishedSemaphore, m_InFlightFence);
+    ++m_FramesSubmitted;
+    
+    m_Presenter->Present(m_GraphicsQueue, m_RenderFinishedSemaphore, m_ImageIndex);
+    
+    // Callers destroy and recreate textures between frames, so the frame
+    // still completes before returning; on the 1.3 path that is a wait on
+    // this frame's timeline value rather than the whole device.
+    if (m_DynamicRendering) {
+        WaitForTimeline(m_LastFrameValue);
+        ReclaimUploads();
+    } else {
+        vkDeviceWaitIdle(m_Device);
+    }
+    m_Presenter->OnFrameComplete(m_ImageIndex);
+    m_CompletedFrames = m_FramesSubmitted;
+    m_Readback.Resolve(m_CompletedFrames);
+    if (!m_WindowTargetsEnabled) RunDeferredReleases(m_FramesSubmitted);
+}
+
+void VulkanRenderer::EndRendering(VkCommandBuffer commandBuffer, FramePresenter& presenter, uint32_t imageIndex) {
+    if (m_DynamicRendering) {
+        vkCmdEndRendering(commandBuffer);
+        RecordImageBarrier(commandBuffer, presenter.GetImages()[imageIndex],
+                           VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, presenter.GetFinalLayout());
+    } else {
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
+
+uint64_t VulkanRenderer::SubmitFrame(VkCommandBuffer commandBuffer, bool semaphores, VkSemaphore imageAvailable,
+                                     VkSemaphore renderFinished, VkFence fence) {
+    VkSemaphore signalSemaphores[] = {renderFinished};
+    
+    if (m_DynamicRendering) {
+        // The frame waits for the image and for this frame's uploads, and
+        // signals the timeline so BeginFrame and ReclaimUploads know when it
+        // is done. Uploaded textures are sampled while rendering and copied
+        // by the readbacks recorded after it.
+        VkSemaphoreSubmitInfo waits[2]{};
+        waits[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        waits[0].semaphore = m_Timeline;
+        waits[0].value = m_LastUploadValue;
+        waits[0].stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        waits[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        waits[1].semaphore = imageAvailable;
+        waits[1].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        
+        const uint64_t frameValue = ++m_TimelineValue;
+        VkSemaphoreSubmitInfo signals[2]{};
+        signals[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        signals[0].semaphore = m_Timeline;
+        signals[0].value = frameValue;
+        signals[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        signals[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        signals[1].semaphore = renderFinished;
+        signals[1].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        
+        VkCommandBufferSubmitInfo commandBufferInfo{};
+        commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        commandBufferInfo.commandBuffer = commandBuffer;
+        
+        VkSubmitInfo2 submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submitInfo.waitSemaphoreInfoCount = semaphores ? 2 : 1;
+        submitInfo.pWaitSemaphoreInfos = waits;
+        submitInfo.commandBufferInfoCount = 1;
+        submitInfo.pCommandBufferInfos = &commandBufferInfo;
+        submitInfo.signalSemaphoreInfoCount = semaphores ? 2 : 1;
+        submitInfo.pSignalSemaphoreInfos = signals;
+        
+        vkQueueSubmit2(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        return frameValue;
+    }
+    
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     
-    VkSemaphore waitSemaphores[] = {m_ImageAvailableSemaphore};
+    VkSemaphore waitSemaphores[] = {imageAvailable};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = semaphores ? 1 : 0;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_CommandBuffer;
-    
-    VkSemaphore signalSemaphores[] = {m_RenderFinishedSemaphore};
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = semaphores ? 1 : 0;
     submitInfo.pSignalSemaphores = signalSemaphores;
     
-    vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_InFlightFence);
+    vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, fence);
+    return 0;
+}
+
+VulkanRenderer::WindowTarget* VulkanRenderer::CreateWindowTarget(GLFWwindow* window) {
+    ZoneScoped;
+    auto target = std::make_unique<WindowTarget>();
+    target->presenter = std::make_unique<SwapchainPresenter>(window);
+    
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_CommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
     
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &m_Swapchain;
-    presentInfo.pImageIndices = &m_ImageIndex;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     
-    vkQueuePresentKHR(m_GraphicsQueue, &presentInfo);
+    // Every window shares the render pass and the pipelines built for it, so
+    // its swapchain must come out in the main window's format.
+    const bool created =
+        target->presenter->AttachInstance(m_Instance) &&
+        target->presenter->SupportsQueueFamily(m_PhysicalDevice, m_QueueFamily) &&
+        target->presenter->Create(*this) && target->presenter->GetFormat() == m_ColorFormat &&
+        (m_DynamicRendering || CreateFramebuffers(*target->presenter, target->framebuffers)) &&
+        vkAllocateCommandBuffers(m_Device, &allocInfo, &target->commandBuffer) == VK_SUCCESS &&
+        vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &target->imageAvailable) == VK_SUCCESS &&
+        vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &target->renderFinished) == VK_SUCCESS &&
+        (m_DynamicRendering || vkCreateFence(m_Device, &fenceInfo, nullptr, &target->inFlight) == VK_SUCCESS);
+    if (!created) {
+        ReleaseWindowTarget(*target);
+        return nullptr;
+    }
     
+    m_WindowTargets.push_back(std::move(target));
+    MetricsRegistry::Get().SetGauge("vulkan.window_targets", static_cast<double>(m_WindowTargets.size()));
+    return m_WindowTargets.back().get();
+}
+
+void VulkanRenderer::DestroyWindowTarget(WindowTarget* target) {
+    auto it = std::find_if(m_WindowTargets.begin(), m_WindowTargets.end(),
+                           [&](const std::unique_ptr<WindowTarget>& entry) { return entry.get() == target; });
+    if (it == m_WindowTargets.end()) return;
+    // Its frames have completed, but presents may still be queued.
+    DrainAcquiredImage(**it);
     vkDeviceWaitIdle(m_Device);
+    ReleaseWindowTarget(**it);
+    m_WindowTargets.erase(it);
+    MetricsRegistry::Get().SetGauge("vulkan.window_targets", static_cast<double>(m_WindowTargets.size()));
+}
+
+void VulkanRenderer::ReleaseWindowTarget(WindowTarget& target) {
+    DestroyFramebuffers(target.framebuffers);
+    if (target.presenter) {
+        target.presenter->Destroy(*this);
+        target.presenter->DetachInstance(m_Instance);
+    }
+    if (target.commandBuffer != VK_NULL_HANDLE) vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &target.commandBuffer);
+    vkDestroySemaphore(m_Device, target.imageAvailable, nullptr);
+    vkDestroySemaphore(m_Device, target.renderFinished, nullptr);
+    vkDestroyFence(m_Device, target.inFlight, nullptr);
+    target = WindowTarget{};
+}
+
+uint32_t VulkanRenderer::AcquireWindowTargets() {
+    ZoneScoped;
+    uint32_t ready = 0;
+    for (auto& target : m_WindowTargets) {
+        if (AcquireWindowTarget(*target)) ++ready;
+    }
+    return ready;
+}
+
+bool VulkanRenderer::AcquireWindowTarget(WindowTarget& target) {
+    if (target.acquired) return true;
+    SwapchainPresenter& presenter = *target.presenter;
+    if (!presenter.HasOutput()) return false;
+    if (presenter.NeedsRecreate() && !RecreatePresenter(presenter, target.framebuffers)) return false;
+    
+    FramePresenter::AcquireResult acquired = presenter.TryAcquire(target.imageAvailable, target.imageIndex);
+    if (acquired == FramePresenter::AcquireResult::OutOfDate && RecreatePresenter(presenter, target.framebuffers)) {
+        acquired = presenter.TryAcquire(target.imageAvailable, target.imageIndex);
+    }
+    if (acquired != FramePresenter::AcquireResult::Acquired) {
+        // Every image is still queued for this window's display; it catches
+        // up when the display frees one.
+        MetricsRegistry::Get().AddCounter("vulkan.window_frames_skipped");
+        return false;
+    }
+    target.acquired = true;
+    return true;
+}
+
+bool VulkanRenderer::RenderWindowTarget(WindowTarget* target, const std::function<void(VkCommandBuffer)>& record) {
+    ZoneScoped;
+    if (!target || !target->acquired) return false;
+    SwapchainPresenter& presenter = *target->presenter;
+    const uint32_t imageIndex = target->imageIndex;
+    
+    // The command buffer's previous frame completed in FinishWindowFrames.
+    BeginRendering(target->commandBuffer, presenter, imageIndex, target->framebuffers);
+    record(target->commandBuffer);
+    EndRendering(target->commandBuffer, presenter, imageIndex);
+    vkEndCommandBuffer(target->commandBuffer);
+    const uint64_t frameValue = SubmitFrame(target->commandBuffer, true, target->imageAvailable,
+                                            target->renderFinished, target->inFlight);
+    if (m_DynamicRendering) m_LastWindowFrameValue = frameValue;
+    presenter.Present(m_GraphicsQueue, target->renderFinished, imageIndex);
+    target->acquired = false;
+    target->submitted = true;
+    MetricsRegistry::Get().AddCounter("vulkan.window_frames");
+    return true;
+}
+
+void VulkanRenderer::FinishWindowFrames() {
+    ZoneScoped;
+    // One wait for every window, after all of them are submitted.
+    bool submitted = false;
+    if (m_DynamicRendering) {
+        for (auto& target : m_WindowTargets) {
+            submitted = submitted || target->submitted;
+            target->submitted = false;
+        }
+        if (submitted) {
+            WaitForTimeline(m_LastWindowFrameValue);
+            ReclaimUploads();
+        }
+    } else {
+        std::vector<VkFence> fences;
+        for (auto& target : m_WindowTargets) {
+            if (target->submitted) fences.push_back(target->inFlight);
+            target->submitted = false;
+        }
+        submitted = !fences.empty();
+        if (submitted) {
+            vkWaitForFences(m_Device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+            vkResetFences(m_Device, static_cast<uint32_t>(fences.size()), fences.data());
+        }
+    }
+    // Window frames count as frames for deferred releases, so a release
+    // made while the main window is skipped still runs.
+    if (submitted) ++m_FramesSubmitted;
+    m_CompletedFrames = m_FramesSubmitted;
+    m_Readback.Resolve(m_CompletedFrames);
+    RunDeferredReleases(m_FramesSubmitted);
+}
+
+void VulkanRenderer::DrainAcquiredImage(WindowTarget& target) {
+    if (!target.acquired) return;
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &target.imageAvailable;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    target.acquired = false;
+}
+
+std::future<ReadbackResult> VulkanRenderer::ReadbackImage(VkImage image, VkImageLayout layout, VkFormat format,
+                                                          const VkRect2D& region) {
+    return m_Readback.Request(image, layout, format, region);
+}
+
+void VulkanRenderer::PollReadbacks() {
+    if (m_Readback.GetPendingCount() == 0) return;
+    m_Readback.Resolve(PollCompletedFrames());
+}
+
+uint64_t VulkanRenderer::PollCompletedFrames() {
+    if (m_CompletedFrames == m_FramesSubmitted) return m_CompletedFrames;
+    if (m_DynamicRendering) {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(m_Device, m_Timeline, &value);
+        if (value >= m_LastFrameValue) m_CompletedFrames = m_FramesSubmitted;
+    } else if (vkGetFenceStatus(m_Device, m_InFlightFence) == VK_SUCCESS) {
+        // Only one frame is in flight, so a signaled fence covers them all.
+        m_CompletedFrames = m_FramesSubmitted;
+    }
+    return m_CompletedFrames;
+}
+
+void VulkanRenderer::DeferUntilFrameComplete(std::function<void()> release) {
+    if (!release) return;
+    m_DeferredReleases.push_back({ m_FramesSubmitted + 1, std::move(release) });
+    MetricsRegistry::Get().SetGauge("vulkan.deferred_releases", static_cast<double>(m_DeferredReleases.size()));
+}
+
+void VulkanRenderer::FlushDeferredReleases() {
+    if (m_Device == VK_NULL_HANDLE) return;
+    vkDeviceWaitIdle(m_Device);
+    RunDeferredReleases(UINT64_MAX);
+}
+
+void VulkanRenderer::RunDeferredReleases(uint64_t completedFrame) {
+    if (m_DeferredReleases.empty()) return;
+    // Ready entries are moved out first so a release may defer more work.
+    std::vector<DeferredRelease> ready;
+    auto pending = std::stable_partition(m_DeferredReleases.begin(), m_DeferredReleases.end(),
+                                         [&](const DeferredRelease& entry) { return entry.frame > completedFrame; });
+    std::move(pending, m_DeferredReleases.end(), std::back_inserter(ready));
+    m_DeferredReleases.erase(pending, m_DeferredReleases.end());
+    for (DeferredRelease& entry : ready) entry.release();
+    MetricsRegistry::Get().SetGauge("vulkan.deferred_releases", static_cast<double>(m_DeferredReleases.size()));
 }
 
 bool VulkanRenderer::CreateInstance() {
@@ -130,18 +588,28 @@ bool VulkanRenderer::CreateInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Ask for 1.1 when the loader has it so deviceUUID can be queried for
+    // device overrides, and 1.3 for the dynamic rendering path.
+    auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+        vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion) enumerateInstanceVersion(&loaderVersion);
+    if (m_AllowVulkan13 && loaderVersion >= VK_API_VERSION_1_3) {
+        m_InstanceApiVersion = VK_API_VERSION_1_3;
+    } else {
+        m_InstanceApiVersion = loaderVersion >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+    }
+    appInfo.apiVersion = m_InstanceApiVersion;
     
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
     
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    
-    createInfo.enabledExtensionCount = glfwExtensionCount;
-    createInfo.ppEnabledExtensionNames = glfwExtensions;
+    // No presenter when probing devices: a bare instance is enough.
+    const std::vector<const char*> extensions =
+        m_Presenter ? m_Presenter->GetInstanceExtensions() : std::vector<const char*>{};
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
     createInfo.enabledLayerCount = 0;
     
     if (vkCreateInstance(&createInfo, nullptr, &m_Instance) != VK_SUCCESS) {
@@ -158,26 +626,193 @@ bool VulkanRenderer::SelectPhysicalDevice() {
     
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(m_Instance, &deviceCount, devices.data());
-    
-    m_PhysicalDevice = devices[0];
+
+    std::vector<PhysicalDeviceInfo> infos;
+    infos.reserve(devices.size());
+    for (VkPhysicalDevice device : devices) {
+        infos.push_back(QueryPhysicalDevice(device));
+    }
+
+    const PhysicalDeviceSelection selection = ::SelectPhysicalDevice(infos, EffectiveDeviceOverride(m_DeviceOverride));
+    m_DeviceReport = FormatDeviceReport(infos, selection);
+    std::cout << "Vulkan devices:\n" << m_DeviceReport << std::endl;
+    if (selection.index < 0) return false;
+
+    m_PhysicalDevice = devices[selection.index];
+    m_QueueFamily = static_cast<uint32_t>(infos[selection.index].queueFamily);
+    m_DynamicRendering = SupportsVulkan13Path();
+    m_DeviceApiVersion = m_DynamicRendering ? VK_API_VERSION_1_3 : VK_API_VERSION_1_0;
+    m_DescriptorIndexing = SupportsDescriptorIndexing();
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &features);
+    m_SampledImageDynamicIndexing = features.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+    m_TextureCompressionBC = features.textureCompressionBC == VK_TRUE;
+    m_SamplerAnisotropy = features.samplerAnisotropy == VK_TRUE && !m_SoftwareMode;
+    VkFormatProperties formatProperties{};
+    vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                              VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    m_LinearBlit = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+    const char* path = m_DynamicRendering
+        ? "Vulkan 1.3 (dynamic rendering, synchronization2, timeline semaphores)"
+        : "Vulkan 1.0 (render pass, framebuffers, fences)";
+    m_DeviceReport += std::string("\nRender path: ") + path;
+    std::cout << "Vulkan render path: " << path << std::endl;
+    if (m_SoftwareMode) {
+        m_DeviceReport += "\nSoftware mode: nearest sampling at 1:1, no anisotropy or mips, pooled staging";
+        std::cout << "Vulkan software mode: nearest sampling at 1:1, no anisotropy or mips, pooled staging" << std::endl;
+    }
     return true;
 }
 
-bool VulkanRenderer::CreateLogicalDevice() {
+std::vector<PhysicalDeviceInfo> VulkanRenderer::ProbePhysicalDevices() {
+    ZoneScoped;
+    std::vector<PhysicalDeviceInfo> infos;
+    VulkanRenderer probe;
+    if (!probe.CreateInstance()) return infos;
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(probe.m_Instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(probe.m_Instance, &deviceCount, devices.data());
+    for (VkPhysicalDevice device : devices) {
+        infos.push_back(probe.QueryPhysicalDevice(device));
+    }
+    probe.Cleanup();
+    return infos;
+}
+
+std::string VulkanRenderer::EffectiveDeviceOverride(const std::string& value) {
+    if (!value.empty()) return value;
+    const char* environment = std::getenv("IMGUICEF_VK_DEVICE");
+    return environment ? environment : "";
+}
+
+bool VulkanRenderer::SupportsVulkan13Path() {
+    if (!m_AllowVulkan13 || m_InstanceApiVersion < VK_API_VERSION_1_3) return false;
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_3) return false;
+    
+    VkPhysicalDeviceVulkan13Features features13{};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext = &features13;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &features2);
+    if (!features13.dynamicRendering || !features13.synchronization2 || !features12.timelineSemaphore) return false;
+    
+    // Promoted to core, but some ImGui backends still load the KHR entry
+    // points, which only resolve when the extension is enabled.
+    m_EnableDynamicRenderingExtension = HasDeviceExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    return true;
+}
+
+bool VulkanRenderer::SupportsDescriptorIndexing() {
+    // Core in 1.2 (enabled through the 1.3 path's Vulkan12Features);
+    // otherwise VK_EXT_descriptor_indexing on a 1.1 device.
+    if (m_InstanceApiVersion < VK_API_VERSION_1_1) return false;
+    if (!m_DynamicRendering) {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1 ||
+            !HasDeviceExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+            return false;
+        }
+    }
+    VkPhysicalDeviceDescriptorIndexingFeatures indexing{};
+    indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &indexing;
+    vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &features2);
+    return indexing.shaderSampledImageArrayNonUniformIndexing && indexing.descriptorBindingPartiallyBound;
+}
+
+bool VulkanRenderer::HasDeviceExtension(const char* name) {
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, extensions.data());
+    for (const auto& extension : extensions) {
+        if (std::strcmp(extension.extensionName, name) == 0) return true;
+    }
+    return false;
+}
+
+PhysicalDeviceInfo VulkanRenderer::QueryPhysicalDevice(VkPhysicalDevice device) {
+    PhysicalDeviceInfo info;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(device, &properties);
+    info.name = properties.deviceName;
+    info.apiVersion = properties.apiVersion;
+    info.vendorId = properties.vendorID;
+    info.deviceId = properties.deviceID;
+    switch (properties.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: info.kind = PhysicalDeviceKind::Discrete; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: info.kind = PhysicalDeviceKind::Integrated; break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: info.kind = PhysicalDeviceKind::Virtual; break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: info.kind = PhysicalDeviceKind::Cpu; break;
+        default: info.kind = PhysicalDeviceKind::Other; break;
+    }
+
+    if (m_InstanceApiVersion >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1) {
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(device, &properties2);
+        info.uuid = FormatDeviceUuid(idProperties.deviceUUID);
+    } else {
+        info.uuid = FormatDeviceUuid(properties.pipelineCacheUUID);
+    }
+
+    VkPhysicalDeviceMemoryProperties memory{};
+    vkGetPhysicalDeviceMemoryProperties(device, &memory);
+    for (uint32_t i = 0; i < memory.memoryHeapCount; ++i) {
+        if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            info.deviceLocalBytes += memory.memoryHeaps[i].size;
+        }
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+    std::set<std::string> available;
+    for (const auto& extension : extensions) available.insert(extension.extensionName);
+    const std::vector<const char*> required =
+        m_Presenter ? m_Presenter->GetDeviceExtensions() : std::vector<const char*>{};
+    for (const char* extension : required) {
+        if (!available.count(extension)) info.missingExtensions.push_back(extension);
+    }
+
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(device, &features);
+    // Software mode samples without anisotropy.
+    if (!features.samplerAnisotropy && !m_SoftwareMode) info.missingFeatures.push_back("samplerAnisotropy");
+
     uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, nullptr);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, queueFamilies.data());
-    
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            m_QueueFamily = i;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    for (uint32_t i = 0; i < queueFamilyCount; ++i) {
+        if ((queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+            (!m_Presenter || m_Presenter->SupportsQueueFamily(device, i))) {
+            info.queueFamily = static_cast<int>(i);
             break;
         }
-        i++;
     }
-    
+    return info;
+}
+
+bool VulkanRenderer::CreateLogicalDevice() {
+    // m_QueueFamily was chosen by SelectPhysicalDevice to support both
+    // graphics and the presenter.
     VkDeviceQueueCreateInfo queueCreateInfo{};
     queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queueCreateInfo.queueFamilyIndex = m_QueueFamily;
@@ -186,17 +821,43 @@ bool VulkanRenderer::CreateLogicalDevice() {
     queueCreateInfo.pQueuePriorities = &queuePriority;
     
     VkPhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.samplerAnisotropy = m_SamplerAnisotropy ? VK_TRUE : VK_FALSE;
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = m_SampledImageDynamicIndexing ? VK_TRUE : VK_FALSE;
+    deviceFeatures.textureCompressionBC = m_TextureCompressionBC ? VK_TRUE : VK_FALSE;
+    
+    VkPhysicalDeviceVulkan13Features features13{};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features13.dynamicRendering = VK_TRUE;
+    features13.synchronization2 = VK_TRUE;
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext = &features13;
+    features12.timelineSemaphore = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing = m_DescriptorIndexing ? VK_TRUE : VK_FALSE;
+    features12.descriptorBindingPartiallyBound = m_DescriptorIndexing ? VK_TRUE : VK_FALSE;
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
     
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    if (m_DynamicRendering) {
+        createInfo.pNext = &features12;
+    } else if (m_DescriptorIndexing) {
+        createInfo.pNext = &indexingFeatures;
+    }
     createInfo.queueCreateInfoCount = 1;
     createInfo.pQueueCreateInfos = &queueCreateInfo;
     createInfo.pEnabledFeatures = &deviceFeatures;
     
-    const std::vector<const char*> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    std::vector<const char*> deviceExtensions = m_Presenter->GetDeviceExtensions();
+    if (m_DynamicRendering && m_EnableDynamicRenderingExtension) {
+        deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+    if (!m_DynamicRendering && m_DescriptorIndexing) {
+        deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
     
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -209,74 +870,41 @@ bool VulkanRenderer::CreateLogicalDevice() {
     return true;
 }
 
-bool VulkanRenderer::CreateSwapchain() {
-    VkSurfaceCapabilitiesKHR capabilities;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_PhysicalDevice, m_Surface, &capabilities);
-    
-    int width, height;
-    glfwGetFramebufferSize(m_Window, &width, &height);
-    VkExtent2D extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
-
-    VkSwapchainCreateInfoKHR createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-    createInfo.surface = m_Surface;
-    createInfo.minImageCount = capabilities.minImageCount + 1;
-    createInfo.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
-    createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-    createInfo.imageExtent = extent;
-    createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.preTransform = capabilities.currentTransform;
-    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
-    createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
-    
-    if (vkCreateSwapchainKHR(m_Device, &createInfo, nullptr, &m_Swapchain) != VK_SUCCESS) {
-        return false;
-    }
-    
-    uint32_t imageCount;
-    vkGetSwapchainImagesKHR(m_Device, m_Swapchain, &imageCount, nullptr);
-    m_SwapchainImages.resize(imageCount);
-    vkGetSwapchainImagesKHR(m_Device, m_Swapchain, &imageCount, m_SwapchainImages.data());
-    
-    m_SwapchainImageViews.resize(imageCount);
-    for (size_t i = 0; i < m_SwapchainImages.size(); i++) {
-        VkImageViewCreateInfo viewInfo{};
-        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        viewInfo.image = m_SwapchainImages[i];
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = VK_FORMAT_B8G8R8A8_UNORM;
-        viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
-        
-        if (vkCreateImageView(m_Device, &viewInfo, nullptr, &m_SwapchainImageViews[i]) != VK_SUCCESS) {
-            return false;
-        }
-    }
+bool VulkanRenderer::RecreatePresenter(FramePresenter& presenter, std::vector<VkFramebuffer>& framebuffers) {
+    ZoneScoped;
+    if (!presenter.HasOutput()) return false;
     
+    vkDeviceWaitIdle(m_Device);
+    DestroyFramebuffers(framebuffers);
+    if (!presenter.Recreate(*this)) return false;
+    // The 1.3 path has nothing else to rebuild: no framebuffers reference
+    // the presenter's views.
+    if (!m_DynamicRendering && !CreateFramebuffers(presenter, framebuffers)) return false;
+    
+    ++m_SwapchainRecreations;
+    MetricsRegistry& registry = MetricsRegistry::Get();
+    registry.AddCounter("vulkan.swapchain_recreations");
+    if (!m_DynamicRendering) registry.AddCounter("vulkan.framebuffers_created", static_cast<double>(framebuffers.size()));
     return true;
 }
 
+void VulkanRenderer::DestroyFramebuffers(std::vector<VkFramebuffer>& framebuffers) {
+    for (auto framebuffer : framebuffers) {
+        vkDestroyFramebuffer(m_Device, framebuffer, nullptr);
+    }
+    framebuffers.clear();
+}
+
 bool VulkanRenderer::CreateRenderPass() {
     VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = VK_FORMAT_B8G8R8A8_UNORM;
+    colorAttachment.format = m_ColorFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = m_Presenter->GetFinalLayout();
     
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -294,6 +922,20 @@ bool VulkanRenderer::CreateRenderPass() {
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
     
+    // Readback copies the attachment right after the pass; make the
+    // writes (and the final transition) visible to that copy.
+    VkSubpassDependency readback{};
+    readback.srcSubpass = 0;
+    readback.dstSubpass = VK_SUBPASS_EXTERNAL;
+    readback.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    readback.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    readback.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    readback.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    if (colorAttachment.finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &readback;
+    }
+    
     if (vkCreateRenderPass(m_Device, &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS) {
         return false;
     }
@@ -301,25 +943,24 @@ bool VulkanRenderer::CreateRenderPass() {
     return true;
 }
 
-bool VulkanRenderer::CreateFramebuffers() {
-    m_Framebuffers.resize(m_SwapchainImageViews.size());
+bool VulkanRenderer::CreateFramebuffers(FramePresenter& presenter, std::vector<VkFramebuffer>& framebuffers) {
+    const std::vector<VkImageView>& views = presenter.GetImageViews();
+    const VkExtent2D extent = presenter.GetExtent();
+    framebuffers.resize(views.size());
     
-    int width, height;
-    glfwGetFramebufferSize(m_Window, &width, &height);
-
-    for (size_t i = 0; i < m_SwapchainImageViews.size(); i++) {
-        VkImageView attachments[] = { m_SwapchainImageViews[i] };
+    for (size_t i = 0; i < views.size(); i++) {
+        VkImageView attachments[] = { views[i] };
         
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = m_RenderPass;
         framebufferInfo.attachmentCount = 1;
         framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = static_cast<uint32_t>(width);
-        framebufferInfo.height = static_cast<uint32_t>(height);
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
         framebufferInfo.layers = 1;
         
-        if (vkCreateFramebuffer(m_Device, &framebufferInfo, nullptr, &m_Framebuffers[i]) != VK_SUCCESS) {
+        if (vkCreateFramebuffer(m_Device, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
             return false;
         }
     }
@@ -394,6 +1035,17 @@ bool VulkanRenderer::CreateSyncObjects() {
         return false;
     }
     
+    if (m_DynamicRendering) {
+        VkSemaphoreTypeCreateInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        timelineInfo.initialValue = 0;
+        semaphoreInfo.pNext = &timelineInfo;
+        if (vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_Timeline) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    
     return true;
 }
 
@@ -419,6 +1071,12 @@ VkCommandBuffer VulkanRenderer::BeginSingleTimeCommands() {
 void VulkanRenderer::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
     vkEndCommandBuffer(commandBuffer);
 
+    if (m_DynamicRendering) {
+        WaitForTimeline(SubmitOnTimeline(commandBuffer));
+        vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
+        return;
+    }
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
@@ -430,7 +1088,202 @@ void VulkanRenderer::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
     vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
 }
 
-VkImage VulkanRenderer::CreateTextureImage(uint32_t width, uint32_t height, const void* data, VkDeviceMemory& textureImageMemory) {
+void VulkanRenderer::SubmitUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, VkDeviceMemory stagingMemory) {
+    if (!m_DynamicRendering) {
+        EndSingleTimeCommands(commandBuffer);
+        ReleaseStagingBuffer(stagingBuffer, stagingMemory);
+        return;
+    }
+
+    // No CPU wait: the next frame waits for m_LastUploadValue on the GPU and
+    // the staging buffer is released once the timeline passes it.
+    vkEndCommandBuffer(commandBuffer);
+    PendingUpload upload;
+    upload.value = SubmitOnTimeline(commandBuffer);
+    upload.commandBuffer = commandBuffer;
+    upload.stagingBuffer = stagingBuffer;
+    upload.stagingMemory = stagingMemory;
+    m_PendingUploads.push_back(upload);
+    m_LastUploadValue = upload.value;
+}
+
+uint64_t VulkanRenderer::SubmitOnTimeline(VkCommandBuffer commandBuffer) {
+    VkCommandBufferSubmitInfo commandBufferInfo{};
+    commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    commandBufferInfo.commandBuffer = commandBuffer;
+
+    VkSemaphoreSubmitInfo signal{};
+    signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal.semaphore = m_Timeline;
+    signal.value = ++m_TimelineValue;
+    signal.stageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+
+    VkSubmitInfo2 submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos = &commandBufferInfo;
+    submitInfo.signalSemaphoreInfoCount = 1;
+    submitInfo.pSignalSemaphoreInfos = &signal;
+
+    vkQueueSubmit2(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    return m_TimelineValue;
+}
+
+void VulkanRenderer::WaitForTimeline(uint64_t value) {
+    if (m_Timeline == VK_NULL_HANDLE || value == 0) return;
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_Timeline;
+    waitInfo.pValues = &value;
+    vkWaitSemaphores(m_Device, &waitInfo, UINT64_MAX);
+}
+
+void VulkanRenderer::ReclaimUploads() {
+    if (m_PendingUploads.empty()) return;
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(m_Device, m_Timeline, &completed);
+    auto done = std::remove_if(m_PendingUploads.begin(), m_PendingUploads.end(), [&](const PendingUpload& upload) {
+        if (upload.value > completed) return false;
+        vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &upload.commandBuffer);
+        ReleaseStagingBuffer(upload.stagingBuffer, upload.stagingMemory);
+        return true;
+    });
+    m_PendingUploads.erase(done, m_PendingUploads.end());
+}
+
+bool VulkanRenderer::AcquireStagingBuffer(VkDeviceSize size, VkBuffer& buffer, VkDeviceMemory& memory, void*& mapped) {
+    if (m_SoftwareMode) {
+        StagingBuffer* best = nullptr;
+        for (StagingBuffer& staging : m_StagingPool) {
+            if (!staging.inUse && staging.size >= size && (!best || staging.size < best->size)) best = &staging;
+        }
+        if (best) {
+            best->inUse = true;
+            buffer = best->buffer;
+            memory = best->memory;
+            mapped = best->mapped;
+            return true;
+        }
+        // Power-of-two sizes so damage rectangles of varying size still find
+        // a buffer to reuse.
+        VkDeviceSize rounded = 256 * 1024;
+        while (rounded < size) rounded *= 2;
+        size = rounded;
+    }
+
+    buffer = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+    CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 buffer, memory);
+    if (buffer == VK_NULL_HANDLE || memory == VK_NULL_HANDLE ||
+        vkMapMemory(m_Device, memory, 0, size, 0, &mapped) != VK_SUCCESS) {
+        if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(m_Device, buffer, nullptr);
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(m_Device, memory, nullptr);
+        return false;
+    }
+    if (m_SoftwareMode) {
+        StagingBuffer staging;
+        staging.buffer = buffer;
+        staging.memory = memory;
+        staging.size = size;
+        staging.mapped = mapped;
+        staging.inUse = true;
+        m_StagingPool.push_back(staging);
+    }
+    return true;
+}
+
+void VulkanRenderer::ReleaseStagingBuffer(VkBuffer buffer, VkDeviceMemory memory) {
+    // Enough for a few full-HD panels in flight; a burst beyond that is freed
+    // again rather than kept for the rest of the run.
+    constexpr VkDeviceSize kMaxPooledBytes = 64ull * 1024 * 1024;
+    VkDeviceSize pooledBytes = 0;
+    for (const StagingBuffer& staging : m_StagingPool) {
+        if (!staging.inUse) pooledBytes += staging.size;
+    }
+    for (auto it = m_StagingPool.begin(); it != m_StagingPool.end(); ++it) {
+        if (it->buffer != buffer) continue;
+        if (pooledBytes + it->size <= kMaxPooledBytes) {
+            it->inUse = false;
+            return;
+        }
+        m_StagingPool.erase(it);
+        break;
+    }
+    vkDestroyBuffer(m_Device, buffer, nullptr);
+    vkFreeMemory(m_Device, memory, nullptr);
+}
+
+void VulkanRenderer::DestroyStagingPool() {
+    for (const StagingBuffer& staging : m_StagingPool) {
+        vkDestroyBuffer(m_Device, staging.buffer, nullptr);
+        vkFreeMemory(m_Device, staging.memory, nullptr);
+    }
+    m_StagingPool.clear();
+}
+
+void VulkanRenderer::RecordImageBarrier(VkCommandBuffer commandBuffer, VkImage image,
+                                        VkImageLayout oldLayout, VkImageLayout newLayout,
+                                        uint32_t baseMipLevel, uint32_t levelCount) {
+    const LayoutTransition* transition = FindLayoutTransition(oldLayout, newLayout);
+    if (!transition) return;
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = baseMipLevel;
+    range.levelCount = levelCount;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+
+    if (m_DynamicRendering) {
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = transition->srcStage2;
+        barrier.srcAccessMask = transition->srcAccess2;
+        barrier.dstStageMask = transition->dstStage2;
+        barrier.dstAccessMask = transition->dstAccess2;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = range;
+
+        VkDependencyInfo dependency{};
+        dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency.imageMemoryBarrierCount = 1;
+        dependency.pImageMemoryBarriers = &barrier;
+        vkCmdPipelineBarrier2(commandBuffer, &dependency);
+        return;
+    }
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = range;
+    barrier.srcAccessMask = transition->srcAccess;
+    barrier.dstAccessMask = transition->dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, transition->srcStage, transition->dstStage,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+uint32_t VulkanRenderer::GetMipLevelCount(uint32_t width, uint32_t height) const {
+    // On a CPU device every blit down the chain costs as much as the
+    // upload; thumbnails minify level 0 instead.
+    if (!m_LinearBlit || m_SoftwareMode) return 1;
+    uint32_t levels = 1;
+    while ((std::max(width, height) >> levels) > 0) ++levels;
+    return levels;
+}
+
+VkImage VulkanRenderer::CreateTextureImage(uint32_t width, uint32_t height, const void* data, VkDeviceMemory& textureImageMemory,
+                                           uint32_t mipLevels) {
     VkDeviceSize imageSize = (VkDeviceSize)width * height * 4;
     
     VkBuffer stagingBuffer;
@@ -450,12 +1303,13 @@ VkImage VulkanRenderer::CreateTextureImage(uint32_t width, uint32_t height, cons
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    // TRANSFER_SRC for the mip blits and for ReadbackImage.
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     
@@ -485,23 +1339,7 @@ VkImage VulkanRenderer::CreateTextureImage(uint32_t width, uint32_t height, cons
     
     VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
     
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = textureImage;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    RecordImageBarrier(commandBuffer, textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels);
     
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
@@ -516,57 +1354,163 @@ VkImage VulkanRenderer::CreateTextureImage(uint32_t width, uint32_t height, cons
     
     vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
     
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                         0, 0, nullptr, 0, nullptr, 1, &barrier);
-    
-    EndSingleTimeCommands(commandBuffer);
+    RecordMipChain(commandBuffer, textureImage, width, height, mipLevels, VkRect2D{ {0, 0}, {width, height} });
     
-    vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-    vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+    SubmitUpload(commandBuffer, stagingBuffer, stagingBufferMemory);
     
     return textureImage;
 }
 
-void VulkanRenderer::UpdateTextureImage(VkImage image, uint32_t width, uint32_t height, const void* data) {
+void VulkanRenderer::UpdateTextureImage(VkImage image, uint32_t width, uint32_t height, const void* data,
+                                        uint32_t mipLevels, const VkRect2D* damage) {
     ZoneScoped;
     if (image == VK_NULL_HANDLE) return;
-    VkDeviceSize imageSize = (VkDeviceSize)width * height * 4;
+    
+    // Only the damaged rows and columns are staged and copied.
+    VkRect2D region2D{ {0, 0}, {width, height} };
+    if (damage) {
+        const uint32_t x0 = std::min<uint32_t>(std::max(damage->offset.x, 0), width);
+        const uint32_t y0 = std::min<uint32_t>(std::max(damage->offset.y, 0), height);
+        const uint32_t x1 = std::min<uint32_t>(x0 + damage->extent.width, width);
+        const uint32_t y1 = std::min<uint32_t>(y0 + damage->extent.height, height);
+        if (x1 <= x0 || y1 <= y0) return;
+        region2D = VkRect2D{ { static_cast<int32_t>(x0), static_cast<int32_t>(y0) }, { x1 - x0, y1 - y0 } };
+    }
+    const size_t rowBytes = static_cast<size_t>(region2D.extent.width) * 4;
+    VkDeviceSize imageSize = (VkDeviceSize)rowBytes * region2D.extent.height;
+    MetricsRegistry::Get().AddCounter("vulkan.upload_bytes", static_cast<double>(imageSize));
     
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
-    CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+    void* mappedData;
+    if (!AcquireStagingBuffer(imageSize, stagingBuffer, stagingBufferMemory, mappedData)) return;
+    const uint8_t* source = static_cast<const uint8_t*>(data) +
+        (static_cast<size_t>(region2D.offset.y) * width + region2D.offset.x) * 4;
+    for (uint32_t row = 0; row < region2D.extent.height; ++row) {
+        memcpy(static_cast<uint8_t*>(mappedData) + row * rowBytes, source + static_cast<size_t>(row) * width * 4, rowBytes);
+    }
+    
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    
+    RecordImageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels);
+    
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {region2D.offset.x, region2D.offset.y, 0};
+    region.imageExtent = {region2D.extent.width, region2D.extent.height, 1};
+    
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    
+    RecordMipChain(commandBuffer, image, width, height, mipLevels, region2D);
+    
+    SubmitUpload(commandBuffer, stagingBuffer, stagingBufferMemory);
+}
+
+void VulkanRenderer::RecordMipChain(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height,
+                                    uint32_t mipLevels, const VkRect2D& damage) {
+    // Every level is in TRANSFER_DST on entry and SHADER_READ_ONLY on exit.
+    // Each level is only blitted where |damage| reaches it.
+    for (uint32_t level = 1; level < mipLevels; ++level) {
+        RecordImageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, level - 1, 1);
+        
+        const VkRect2D dst = MipDamage(damage, width, height, level);
+        // Twice the destination, except that a region reaching the edge of
+        // an odd-sized level takes the last source texel too.
+        const uint32_t srcWidth = MipExtent(width, level - 1), srcHeight = MipExtent(height, level - 1);
+        const bool reachesRight = dst.offset.x + dst.extent.width == MipExtent(width, level);
+        const bool reachesBottom = dst.offset.y + dst.extent.height == MipExtent(height, level);
+        const int32_t srcX1 = reachesRight ? srcWidth : std::min<int32_t>(2 * (dst.offset.x + dst.extent.width), srcWidth);
+        const int32_t srcY1 = reachesBottom ? srcHeight : std::min<int32_t>(2 * (dst.offset.y + dst.extent.height), srcHeight);
+        
+        VkImageBlit blit{};
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+        blit.srcOffsets[0] = { std::min<int32_t>(2 * dst.offset.x, srcWidth - 1), std::min<int32_t>(2 * dst.offset.y, srcHeight - 1), 0 };
+        blit.srcOffsets[1] = { srcX1, srcY1, 1 };
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+        blit.dstOffsets[0] = { dst.offset.x, dst.offset.y, 0 };
+        blit.dstOffsets[1] = { dst.offset.x + static_cast<int32_t>(dst.extent.width),
+                               dst.offset.y + static_cast<int32_t>(dst.extent.height), 1 };
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        
+        RecordImageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, level - 1, 1);
+    }
+    if (mipLevels > 1) MetricsRegistry::Get().AddCounter("vulkan.mip_blits", static_cast<double>(mipLevels - 1));
+    RecordImageBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels - 1, 1);
+}
+
+bool VulkanRenderer::SupportsSampledFormat(VkFormat format) const {
+    if (m_PhysicalDevice == VK_NULL_HANDLE) return false;
+    if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !m_TextureCompressionBC) {
+        return false;
+    }
+    VkFormatProperties formatProperties{};
+    vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, format, &formatProperties);
+    return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+VkImage VulkanRenderer::CreateCompressedTextureImage(VkFormat format, uint32_t width, uint32_t height, const void* blocks,
+                                                     VkDeviceSize size, VkDeviceMemory& textureImageMemory) {
+    ZoneScoped;
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                  stagingBuffer, stagingBufferMemory);
     
     void* mappedData;
-    vkMapMemory(m_Device, stagingBufferMemory, 0, imageSize, 0, &mappedData);
-    memcpy(mappedData, data, (size_t)imageSize);
+    vkMapMemory(m_Device, stagingBufferMemory, 0, size, 0, &mappedData);
+    memcpy(mappedData, blocks, (size_t)size);
     vkUnmapMemory(m_Device, stagingBufferMemory);
     
+    // Extents are in texels. At the right and bottom edges the copy may end
+    // mid-block; the buffer still holds whole blocks there.
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {width, height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    
+    VkImage textureImage;
+    if (vkCreateImage(m_Device, &imageInfo, nullptr, &textureImage) != VK_SUCCESS) {
+        vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
+        vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+        return VK_NULL_HANDLE;
+    }
+    
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_Device, textureImage, &memRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &textureImageMemory) != VK_SUCCESS) {
+        vkDestroyImage(m_Device, textureImage, nullptr);
+        vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
+        vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+        return VK_NULL_HANDLE;
+    }
+    
+    vkBindImageMemory(m_Device, textureImage, textureImageMemory, 0);
+    
     VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
     
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    RecordImageBarrier(commandBuffer, textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
     
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
@@ -579,23 +1523,16 @@ void VulkanRenderer::UpdateTextureImage(VkImage image, uint32_t width, uint32_t
     region.imageOffset = {0, 0, 0};
     region.imageExtent = {width, height, 1};
     
-    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
     
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    RecordImageBarrier(commandBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     
-    EndSingleTimeCommands(commandBuffer);
+    SubmitUpload(commandBuffer, stagingBuffer, stagingBufferMemory);
     
-    vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-    vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+    return textureImage;
 }
 
-VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format) {
+VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, uint32_t mipLevels) {
     if (image == VK_NULL_HANDLE) return VK_NULL_HANDLE;
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -604,7 +1541,7 @@ VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format) {
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
     
@@ -620,18 +1557,24 @@ VkSampler VulkanRenderer::CreateTextureSampler() {
     if (m_Device == VK_NULL_HANDLE) return VK_NULL_HANDLE;
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    // Pages are drawn at 1:1, which samples with the magnification filter;
+    // in software mode that is a single texel fetch instead of four.
+    // Minified thumbnails keep linear filtering either way.
+    samplerInfo.magFilter = m_SoftwareMode ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
     samplerInfo.minFilter = VK_FILTER_LINEAR;
     samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = 16.0f;
+    samplerInfo.anisotropyEnable = m_SamplerAnisotropy ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = m_SamplerAnisotropy ? 16.0f : 1.0f;
     samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    // Single-level textures are unaffected; mipmapped ones use the chain.
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
     
     VkSampler sampler;
     if (vkCreateSampler(m_Device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
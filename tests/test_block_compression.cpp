@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "block_compression.h"
+#include "test_check.h"
+
+namespace {
+// Reference decoders, written from the format specs rather than sharing
+// anything with the encoder.
+void DecodeBc1Block(const uint8_t* in, uint8_t out[64]) {
+    auto expand = [](uint16_t v, int color[3]) {
+        const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    };
+    const uint16_t c0 = static_cast<uint16_t>(in[0] | in[1] << 8);
+    const uint16_t c1 = static_cast<uint16_t>(in[2] | in[3] << 8);
+    int palette[4][4];
+    expand(c0, palette[0]);
+    expand(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        if (c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    const uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | static_cast<uint32_t>(in[7]) << 24;
+    for (int i = 0; i < 16; ++i) {
+        const int index = (indices >> (i * 2)) & 3;
+        for (int c = 0; c < 3; ++c) out[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        out[i * 4 + 3] = (c0 <= c1 && index == 3) ? 0 : 255;
+    }
+}
+
+uint32_t GetBits(const uint8_t* in, int& position, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; ++i, ++position) value |= ((in[position >> 3] >> (position & 7)) & 1u) << i;
+    return value;
+}
+
+// Mode 6 only; any other mode decodes as magenta so a wrong mode fails loudly.
+void DecodeBc7Block(const uint8_t* in, uint8_t out[64]) {
+    static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    int position = 0;
+    if (GetBits(in, position, 7) != (1u << 6)) {
+        for (int i = 0; i < 16; ++i) {
+            out[i * 4 + 0] = 255; out[i * 4 + 1] = 0; out[i * 4 + 2] = 255; out[i * 4 + 3] = 255;
+        }
+        return;
+    }
+    int e[2][4];
+    for (int c = 0; c < 4; ++c) {
+        e[0][c] = static_cast<int>(GetBits(in, position, 7));
+        e[1][c] = static_cast<int>(GetBits(in, position, 7));
+    }
+    const int p0 = static_cast<int>(GetBits(in, position, 1)), p1 = static_cast<int>(GetBits(in, position, 1));
+    for (int c = 0; c < 4; ++c) {
+        e[0][c] = (e[0][c] << 1) | p0;
+        e[1][c] = (e[1][c] << 1) | p1;
+    }
+    for (int i = 0; i < 16; ++i) {
+        const int index = static_cast<int>(GetBits(in, position, i == 0 ? 3 : 4));
+        for (int c = 0; c < 4; ++c) {
+            out[i * 4 + c] = static_cast<uint8_t>(((64 - weights[index]) * e[0][c] + weights[index] * e[1][c] + 32) >> 6);
+        }
+    }
+}
+
+std::vector<uint8_t> Decode(BlockFormat format, const std::vector<uint8_t>& blocks, uint32_t width, uint32_t height) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    const uint32_t blocksX = (width + 3) / 4;
+    uint8_t block[64];
+    for (uint32_t y = 0; y < height; y += 4) {
+        for (uint32_t x = 0; x < width; x += 4) {
+            const uint8_t* in = &blocks[((y / 4) * blocksX + x / 4) * BlockBytes(format)];
+            if (format == BlockFormat::Bc1) DecodeBc1Block(in, block);
+            else DecodeBc7Block(in, block);
+            for (uint32_t py = 0; py < 4 && y + py < height; ++py) {
+                for (uint32_t px = 0; px < 4 && x + px < width; ++px) {
+                    std::memcpy(&rgba[((y + py) * width + x + px) * 4], &block[(py * 4 + px) * 4], 4);
+                }
+            }
+        }
+    }
+    return rgba;
+}
+
+int MaxError(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    int worst = 0;
+    for (size_t i = 0; i < a.size(); ++i) worst = std::max(worst, std::abs(static_cast<int>(a[i]) - b[i]));
+    return worst;
+}
+
+double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int channels) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (int c = 0; c < channels; ++c, ++count) {
+            const double d = static_cast<double>(a[i + c]) - b[i + c];
+            sum += d * d;
+        }
+    }
+    if (sum == 0.0) return 99.0;
+    return 10.0 * std::log10(255.0 * 255.0 / (sum / count));
+}
+
+// A panel-like image: flat background, a soft gradient header, a few
+// coloured boxes and one-pixel text-ish strokes. Odd size to cover edge
+// blocks.
+std::vector<uint8_t> PanelImage(uint32_t width, uint32_t height) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* p = &rgba[(y * width + x) * 4];
+            p[0] = 30; p[1] = 32; p[2] = 38; p[3] = 255;
+            if (y < 24) {
+                p[0] = static_cast<uint8_t>(40 + x * 60 / width);
+                p[1] = static_cast<uint8_t>(60 + x * 80 / width);
+                p[2] = static_cast<uint8_t>(120 + y * 2);
+            }
+            if (x > 20 && x < 70 && y > 40 && y < 70) { p[0] = 200; p[1] = 80; p[2] = 40; }
+            if (y % 12 == 3 && y > 80 && x % 7 < 5) { p[0] = 220; p[1] = 220; p[2] = 220; }
+        }
+    }
+    return rgba;
+}
+}  // namespace
+
+int main() {
+    std::cout << "Starting block compression test..." << std::endl;
+
+    Check(CompressedSize(BlockFormat::Bc1, 1, 1) == 8, "one partial block for a 1x1 BC1 image");
+    Check(CompressedSize(BlockFormat::Bc7, 1920, 1080) == 1920 * 1080, "BC7 is one byte per pixel");
+    Check(CompressedSize(BlockFormat::Bc1, 1920, 1080) == 1920 * 1080 / 2, "BC1 is half a byte per pixel");
+
+    BlockFormat format = BlockFormat::Bc7;
+    Check(ParseBlockFormat("BC1", format) && format == BlockFormat::Bc1, "format names are case-insensitive");
+    Check(!ParseBlockFormat("etc2", format) && format == BlockFormat::Bc1, "unknown format is rejected and unchanged");
+
+    // A flat block must survive BC1 exactly, including an opaque alpha
+    // (3-colour mode would make index 3 transparent). Mode 6 shares one
+    // p-bit across channels, so pure red is off by at most one in BC7.
+    std::vector<uint8_t> flat(4 * 4 * 4);
+    for (size_t i = 0; i < flat.size(); i += 4) {
+        flat[i] = 255; flat[i + 1] = 0; flat[i + 2] = 0; flat[i + 3] = 255;
+    }
+    Check(Decode(BlockFormat::Bc1, CompressRgba(BlockFormat::Bc1, flat.data(), 4, 4), 4, 4) == flat,
+          "flat red block is exact in BC1");
+    Check(MaxError(flat, Decode(BlockFormat::Bc7, CompressRgba(BlockFormat::Bc7, flat.data(), 4, 4), 4, 4)) <= 1,
+          "flat red block is within one step in BC7");
+
+    const uint32_t width = 203, height = 117;
+    const std::vector<uint8_t> panel = PanelImage(width, height);
+    const double bc1 = Psnr(panel, Decode(BlockFormat::Bc1, CompressRgba(BlockFormat::Bc1, panel.data(), width, height), width, height), 3);
+    const double bc7 = Psnr(panel, Decode(BlockFormat::Bc7, CompressRgba(BlockFormat::Bc7, panel.data(), width, height), width, height), 4);
+    std::cout << "Panel PSNR: bc1 " << bc1 << " dB, bc7 " << bc7 << " dB" << std::endl;
+    Check(bc1 >= 32.0, "BC1 keeps panel content above 32 dB");
+    Check(bc7 >= 40.0, "BC7 keeps panel content above 40 dB");
+
+    // Worker: a second submit for the same key replaces the queued job, and
+    // results carry the generation back.
+    BlockCompressionWorker worker;
+    worker.Start();
+    worker.Submit("panel", 1, BlockFormat::Bc7, width, height, panel);
+    worker.Submit("panel", 2, BlockFormat::Bc7, width, height, panel);
+    std::vector<CompressedTexture> results;
+    for (int i = 0; i < 500 && results.empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        for (CompressedTexture& result : worker.TakeResults()) results.push_back(std::move(result));
+    }
+    // The first job may already have been taken before the second arrived;
+    // either way the newest generation must come back last.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for (CompressedTexture& result : worker.TakeResults()) results.push_back(std::move(result));
+    Check(!results.empty() && results.back().generation == 2, "worker returns the newest generation last");
+    Check(!results.empty() && results.back().blocks.size() == CompressedSize(BlockFormat::Bc7, width, height),
+          "worker result has the compressed size");
+    worker.Stop();
+
+    return CheckSummary("Block compression test");
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <iostream>
+
+// Check harness shared by the test executables. A failed Check is reported
+// and counted, and the test carries on, so one run lists every broken
+// expectation. main() ends with `return CheckSummary("Foo test");`.
+inline int g_checkFailures = 0;
+
+inline void Check(bool condition, const char* description) {
+    if (!condition) {
+        std::cerr << "FAILED: " << description << std::endl;
+        ++g_checkFailures;
+    }
+}
+
+// Prints the outcome and returns main's exit code.
+inline int CheckSummary(const char* testName) {
+    if (g_checkFailures > 0) {
+        std::cerr << g_checkFailures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << testName << " passed" << std::endl;
+    return 0;
+}
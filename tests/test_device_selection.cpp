@@ -0,0 +1,122 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "software_mode.h"
+#include "vulkan_device_selection.h"
+#include "test_check.h"
+
+namespace {
+PhysicalDeviceInfo Device(const std::string& name, PhysicalDeviceKind kind, uint64_t localMb, const std::string& uuid) {
+    PhysicalDeviceInfo device;
+    device.name = name;
+    device.kind = kind;
+    device.deviceLocalBytes = localMb << 20;
+    device.uuid = uuid;
+    device.queueFamily = 0;
+    device.apiVersion = (1u << 22) | (3u << 12);
+    return device;
+}
+
+// What a container with both software ICDs installed reports, in the order
+// the loader tends to enumerate them, plus the hardware of a dual-GPU box.
+std::vector<PhysicalDeviceInfo> MixedDevices() {
+    return {
+        Device("llvmpipe (LLVM 15.0.7, 256 bits)", PhysicalDeviceKind::Cpu, 2048, "6c6c766d-7069-7065-5555-494400000000"),
+        Device("SwiftShader Device (Subzero)", PhysicalDeviceKind::Cpu, 4096, "53776966-7453-6861-6465-720000000000"),
+        Device("Intel(R) UHD Graphics 630", PhysicalDeviceKind::Integrated, 256, "8680923e-0300-0000-0002-000000000000"),
+        Device("NVIDIA GeForce RTX 3060", PhysicalDeviceKind::Discrete, 12288, "a1b2c3d4-e5f6-0708-090a-0b0c0d0e0f10"),
+    };
+}
+}  // namespace
+
+int main() {
+    std::cout << "Starting physical device selection test..." << std::endl;
+
+    std::vector<PhysicalDeviceInfo> devices = MixedDevices();
+    PhysicalDeviceSelection selection = SelectPhysicalDevice(devices, "");
+    Check(selection.index == 3, "discrete GPU wins over integrated and CPU devices");
+
+    // Without the discrete GPU, integrated beats both software rasterizers
+    // even though they report more "device-local" memory.
+    devices.pop_back();
+    selection = SelectPhysicalDevice(devices, "");
+    Check(selection.index == 2, "integrated GPU wins over CPU devices");
+
+    // Software only: memory breaks the tie between lavapipe and SwiftShader.
+    devices.pop_back();
+    selection = SelectPhysicalDevice(devices, "");
+    Check(selection.index == 1, "larger CPU device wins the tie");
+
+    // Unsuitable devices are never picked, whatever their kind.
+    devices = MixedDevices();
+    devices[3].queueFamily = -1;
+    devices[2].missingExtensions.push_back("VK_KHR_swapchain");
+    selection = SelectPhysicalDevice(devices, "");
+    Check(selection.scores[3] < 0 && selection.scores[2] < 0, "devices without present queue or extensions score -1");
+    Check(selection.index == 1, "falls back to the best suitable device");
+    devices[0].missingFeatures.push_back("samplerAnisotropy");
+    devices[1].missingFeatures.push_back("samplerAnisotropy");
+    selection = SelectPhysicalDevice(devices, "");
+    Check(selection.index == -1, "no suitable device selects nothing");
+
+    // Overrides: name substring, UUID (dashes and case ignored), index.
+    devices = MixedDevices();
+    selection = SelectPhysicalDevice(devices, "swiftshader");
+    Check(selection.index == 1, "name override is a case-insensitive substring");
+    selection = SelectPhysicalDevice(devices, "6C6C766D70697065555549440000000");
+    Check(selection.index != 0, "truncated UUID does not match");
+    selection = SelectPhysicalDevice(devices, "6C6C766D706970655555494400000000");
+    Check(selection.index == 0, "UUID override ignores case and dashes");
+    selection = SelectPhysicalDevice(devices, "2");
+    Check(selection.index == 2, "decimal override selects by index");
+    selection = SelectPhysicalDevice(devices, "3060");
+    Check(selection.index == 3, "numbers that are not an index match names");
+
+    // An override that cannot be honored falls back to scoring and says why.
+    selection = SelectPhysicalDevice(devices, "Radeon");
+    Check(selection.index == 3, "unmatched override falls back to scoring");
+    Check(selection.reason.find("matched no device") != std::string::npos, "unmatched override is reported");
+    devices[1].queueFamily = -1;
+    selection = SelectPhysicalDevice(devices, "SwiftShader");
+    Check(selection.index == 3, "override naming an unsuitable device falls back");
+    Check(selection.reason.find("unsuitable") != std::string::npos, "unsuitable override is reported");
+
+    const std::string report = FormatDeviceReport(devices, selection);
+    Check(report.find("* [3] NVIDIA GeForce RTX 3060") != std::string::npos, "report marks the selection");
+    Check(report.find("no graphics+present queue") != std::string::npos, "report lists why a device is unsuitable");
+
+    const uint8_t raw[16] = { 0x6c, 0x6c, 0x76, 0x6d, 0x70, 0x69, 0x70, 0x65, 0x55, 0x55, 0x49, 0x44, 0, 0, 0, 0 };
+    Check(FormatDeviceUuid(raw) == "6c6c766d-7069-7065-5555-494400000000", "UUID formats as 8-4-4-4-12 hex");
+
+    // Software mode: auto follows the device the renderer would pick.
+    devices = MixedDevices();
+    SoftwareModeDecision software = DecideSoftwareMode(SoftwareModeSetting::Auto, devices, "");
+    Check(!software.enabled, "auto stays off when a GPU would be picked");
+    software = DecideSoftwareMode(SoftwareModeSetting::Auto, devices, "llvmpipe");
+    Check(software.enabled, "auto turns on for an overridden CPU device");
+    Check(software.reason.find("llvmpipe") != std::string::npos, "decision names the device");
+    devices.resize(2);
+    Check(DecideSoftwareMode(SoftwareModeSetting::Auto, devices, "").enabled, "auto turns on with only CPU devices");
+    Check(DecideSoftwareMode(SoftwareModeSetting::Auto, {}, "").enabled, "auto turns on without any device");
+    Check(!DecideSoftwareMode(SoftwareModeSetting::Off, devices, "").enabled, "off wins over detection");
+    Check(DecideSoftwareMode(SoftwareModeSetting::On, MixedDevices(), "").enabled, "on wins over detection");
+
+    SoftwareModeSetting setting = SoftwareModeSetting::Off;
+    Check(ParseSoftwareModeSetting("", setting) && setting == SoftwareModeSetting::On, "bare switch means on");
+    Check(ParseSoftwareModeSetting("auto", setting) && setting == SoftwareModeSetting::Auto, "auto parses");
+    Check(ParseSoftwareModeSetting("off", setting) && setting == SoftwareModeSetting::Off, "off parses");
+    Check(!ParseSoftwareModeSetting("yes", setting) && setting == SoftwareModeSetting::Off, "unknown value rejected");
+
+    int probes = 0;
+    auto probe = [&probes] {
+        ++probes;
+        return std::vector<PhysicalDeviceInfo>{ MixedDevices()[0] };
+    };
+    Check(ResolveSoftwareMode(false, "", "", probe).enabled && probes == 1, "absent switch probes and detects");
+    Check(!ResolveSoftwareMode(true, "off", "", probe).enabled && probes == 1, "explicit setting skips the probe");
+    software = ResolveSoftwareMode(true, "maybe", "", probe);
+    Check(software.enabled && probes == 2 && !software.warning.empty(), "invalid value warns and falls back to auto");
+
+    return CheckSummary("Physical device selection test");
+}
@@ -0,0 +1,199 @@
+// Compares the snapshot tool's renders of tests/golden/fixtures against the
+// stored goldens. CTest runs the snapshot tool first (GoldenRender) and this
+// afterwards (GoldenCompare).
+//
+//   test_golden_images --golden=DIR --actual=DIR --diff=DIR
+//                      [--threshold=0.1] [--max-diff-ratio=0.001]
+//
+// For every mismatch <name>.diff.png and <name>.actual.png are written to
+// the diff directory. With IMGUICEF_UPDATE_GOLDENS=1 the actual images
+// replace the goldens instead, after a deliberate rendering change. Goldens
+// are only ever blessed from a real render; an empty golden directory fails
+// the test rather than passing it vacuously. Exits with 77 (skipped) when
+// nothing was rendered because GoldenRender found no CEF runtime or Vulkan
+// device.
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "image_compare.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr int kSkipped = 77;
+
+bool ReadFile(const fs::path& path, std::vector<uint8_t>& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool WriteFile(const fs::path& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
+
+struct Image {
+    std::vector<uint8_t> pixels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+bool Load(const fs::path& path, Image& image) {
+    std::vector<uint8_t> data;
+    std::string error;
+    if (!ReadFile(path, data)) {
+        std::cerr << path.string() << ": cannot read" << std::endl;
+        return false;
+    }
+    if (!DecodePng(data.data(), data.size(), image.pixels, image.width, image.height, &error)) {
+        std::cerr << path.string() << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> ListPngs(const fs::path& dir) {
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        const fs::path& path = entry.path();
+        if (entry.is_regular_file() && path.extension() == ".png") names.push_back(path.filename().string());
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Compares one golden; returns false on a mismatch.
+bool CompareOne(const std::string& name, const fs::path& goldenDir, const fs::path& actualDir,
+                const fs::path& diffDir, const ImageDiffOptions& options) {
+    Image golden, actual;
+    if (!Load(goldenDir / name, golden)) return false;
+    if (!fs::exists(actualDir / name)) {
+        std::cerr << name << ": not rendered (see the GoldenRender output)" << std::endl;
+        return false;
+    }
+    if (!Load(actualDir / name, actual)) return false;
+    if (golden.width != actual.width || golden.height != actual.height) {
+        std::cerr << name << ": size " << actual.width << "x" << actual.height << ", expected " << golden.width
+                  << "x" << golden.height << std::endl;
+        std::error_code ec;
+        fs::copy_file(actualDir / name, diffDir / (fs::path(name).stem().string() + ".actual.png"),
+                      fs::copy_options::overwrite_existing, ec);
+        return false;
+    }
+
+    ImageDiffResult result =
+        CompareImages(golden.pixels.data(), actual.pixels.data(), golden.width, golden.height, options, true);
+    const double ratio = static_cast<double>(result.differentPixels) / (static_cast<double>(golden.width) *
+                                                                        golden.height);
+    if (result.matches) {
+        std::cout << name << ": ok (" << result.differentPixels << " pixels over threshold, max delta "
+                  << result.maxDelta << ")" << std::endl;
+        return true;
+    }
+
+    const std::string stem = fs::path(name).stem().string();
+    const fs::path diffPath = diffDir / (stem + ".diff.png");
+    WriteFile(diffPath, EncodePng(result.diff.data(), golden.width, golden.height, PixelOrder::Rgba));
+    std::error_code ec;
+    fs::copy_file(actualDir / name, diffDir / (stem + ".actual.png"), fs::copy_options::overwrite_existing, ec);
+    std::cerr << name << ": " << result.differentPixels << " pixels differ (" << ratio * 100.0
+              << "%, max delta " << result.maxDelta << "), diff written to " << diffPath.string() << std::endl;
+    return false;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    fs::path goldenDir, actualDir, diffDir;
+    ImageDiffOptions options;
+    options.maxDiffRatio = 0.001;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](const char* prefix) -> const char* {
+            const size_t length = std::char_traits<char>::length(prefix);
+            return arg.compare(0, length, prefix) == 0 ? argv[i] + length : nullptr;
+        };
+        if (const char* v = value("--golden=")) goldenDir = v;
+        else if (const char* v = value("--actual=")) actualDir = v;
+        else if (const char* v = value("--diff=")) diffDir = v;
+        else if (const char* v = value("--threshold=")) options.threshold = std::atof(v);
+        else if (const char* v = value("--max-diff-ratio=")) options.maxDiffRatio = std::atof(v);
+        else {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+    if (goldenDir.empty() || actualDir.empty()) {
+        std::cerr << "usage: " << argv[0] << " --golden=DIR --actual=DIR [--diff=DIR] [--threshold=T]"
+                  << " [--max-diff-ratio=R]" << std::endl;
+        return 2;
+    }
+    if (diffDir.empty()) diffDir = actualDir / "diff";
+    // The snapshot tool creates the directory once CEF and Vulkan are up.
+    if (!fs::is_directory(actualDir)) {
+        std::cout << actualDir.string() << " does not exist: nothing was rendered (no CEF runtime or Vulkan"
+                  << " device), skipping" << std::endl;
+        return kSkipped;
+    }
+
+    const char* update = std::getenv("IMGUICEF_UPDATE_GOLDENS");
+    if (update && std::string(update) == "1") {
+        size_t copied = 0;
+        std::error_code dirError;
+        fs::create_directories(goldenDir, dirError);
+        for (const std::string& name : ListPngs(actualDir)) {
+            std::error_code ec;
+            fs::copy_file(actualDir / name, goldenDir / name, fs::copy_options::overwrite_existing, ec);
+            if (ec) {
+                std::cerr << name << ": " << ec.message() << std::endl;
+                return 1;
+            }
+            ++copied;
+        }
+        std::cout << "Updated " << copied << " golden image(s) in " << goldenDir.string() << std::endl;
+        return 0;
+    }
+
+    const std::vector<std::string> goldens = ListPngs(goldenDir);
+    if (goldens.empty()) {
+        std::cerr << "no golden images in " << goldenDir.string()
+                  << "; render them on lavapipe and bless them with IMGUICEF_UPDATE_GOLDENS=1" << std::endl;
+        return 1;
+    }
+    std::error_code ec;
+    fs::create_directories(diffDir, ec);
+
+    size_t failures = 0;
+    for (const std::string& name : goldens) {
+        if (!CompareOne(name, goldenDir, actualDir, diffDir, options)) ++failures;
+    }
+    // A rendered fixture without a golden is a list entry someone forgot
+    // to bless.
+    const std::set<std::string> known(goldens.begin(), goldens.end());
+    for (const std::string& name : ListPngs(actualDir)) {
+        if (known.count(name) == 0) {
+            std::cerr << name << ": no golden (run with IMGUICEF_UPDATE_GOLDENS=1 to add it)" << std::endl;
+            ++failures;
+        }
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " golden image(s) differ" << std::endl;
+        return 1;
+    }
+    std::cout << "Golden image test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "gpu_frame_converter.h"
+#include "test_check.h"
+
+// Runs frame_convert.comp on a headless device and checks the converted
+// image and tile masks bit for bit. Prefers a CPU device (lavapipe) so CI
+// results do not depend on the GPU. Exits with 77 (skipped) when no Vulkan
+// device is available.
+namespace {
+constexpr int kSkipped = 77;
+constexpr uint32_t kWidth = 67;   // deliberately not a multiple of the tile size
+constexpr uint32_t kHeight = 45;
+constexpr uint32_t kTilesX = (kWidth + GpuFrameConverter::kTileSize - 1) / GpuFrameConverter::kTileSize;
+constexpr uint32_t kTilesY = (kHeight + GpuFrameConverter::kTileSize - 1) / GpuFrameConverter::kTileSize;
+
+struct Context {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+
+    ~Context() {
+        if (device != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(device, commandPool, nullptr);
+            vkDestroyDevice(device, nullptr);
+        }
+        if (instance != VK_NULL_HANDLE) vkDestroyInstance(instance, nullptr);
+    }
+};
+
+bool CreateContext(Context& context) {
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "test_gpu_frame_converter";
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+    VkInstanceCreateInfo instanceInfo{};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    if (vkCreateInstance(&instanceInfo, nullptr, &context.instance) != VK_SUCCESS) return false;
+
+    uint32_t count = 0;
+    vkEnumeratePhysicalDevices(context.instance, &count, nullptr);
+    std::vector<VkPhysicalDevice> devices(count);
+    vkEnumeratePhysicalDevices(context.instance, &count, devices.data());
+    int best = -1;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &familyCount, families.data());
+        for (uint32_t family = 0; family < familyCount; ++family) {
+            if (!(families[family].queueFlags & VK_QUEUE_COMPUTE_BIT)) continue;
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(devices[i], &properties);
+            if (best < 0 || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+                best = static_cast<int>(i);
+                context.queueFamily = family;
+                std::cout << "Using " << properties.deviceName << std::endl;
+            }
+            break;
+        }
+    }
+    if (best < 0) return false;
+    context.physicalDevice = devices[best];
+
+    const float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo{};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = context.queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    if (vkCreateDevice(context.physicalDevice, &deviceInfo, nullptr, &context.device) != VK_SUCCESS) return false;
+    vkGetDeviceQueue(context.device, context.queueFamily, 0, &context.queue);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = context.queueFamily;
+    return vkCreateCommandPool(context.device, &poolInfo, nullptr, &context.commandPool) == VK_SUCCESS;
+}
+
+VkImageView CreateView(const Context& context, VkImage image) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    VkImageView view = VK_NULL_HANDLE;
+    vkCreateImageView(context.device, &viewInfo, nullptr, &view);
+    return view;
+}
+
+// Copies the converted image back to the host as RGBA bytes.
+std::vector<uint8_t> ReadImage(const Context& context, VkImage image) {
+    const VkDeviceSize size = static_cast<VkDeviceSize>(kWidth) * kHeight * 4;
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    vkCreateBuffer(context.device, &bufferInfo, nullptr, &buffer);
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(context.device, buffer, &requirements);
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(context.physicalDevice, &memoryProperties);
+    const VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+        if ((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted) {
+            allocInfo.memoryTypeIndex = i;
+            break;
+        }
+    }
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    vkAllocateMemory(context.device, &allocInfo, nullptr, &memory);
+    vkBindBufferMemory(context.device, buffer, memory, 0);
+
+    VkCommandBufferAllocateInfo commandInfo{};
+    commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandInfo.commandPool = context.commandPool;
+    commandInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    vkAllocateCommandBuffers(context.device, &commandInfo, &commandBuffer);
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { kWidth, kHeight, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    vkQueueSubmit(context.queue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(context.queue);
+
+    std::vector<uint8_t> pixels(size);
+    void* mapped = nullptr;
+    vkMapMemory(context.device, memory, 0, size, 0, &mapped);
+    std::memcpy(pixels.data(), mapped, pixels.size());
+    vkUnmapMemory(context.device, memory);
+    vkFreeCommandBuffers(context.device, context.commandPool, 1, &commandBuffer);
+    vkDestroyBuffer(context.device, buffer, nullptr);
+    vkFreeMemory(context.device, memory, nullptr);
+    return pixels;
+}
+
+std::vector<uint8_t> ToRgba(const std::vector<uint8_t>& bgra) {
+    std::vector<uint8_t> rgba(bgra.size());
+    for (size_t i = 0; i < bgra.size(); i += 4) {
+        rgba[i] = bgra[i + 2];
+        rgba[i + 1] = bgra[i + 1];
+        rgba[i + 2] = bgra[i];
+        rgba[i + 3] = bgra[i + 3];
+    }
+    return rgba;
+}
+
+void SetPixel(std::vector<uint8_t>& bgra, uint32_t x, uint32_t y, uint32_t value) {
+    std::memcpy(&bgra[(static_cast<size_t>(y) * kWidth + x) * 4], &value, 4);
+}
+
+FrameConversionResult Convert(GpuFrameConverter& converter, VkImage image, VkImageView view,
+                              const std::vector<uint8_t>& bgra, VkRect2D damage) {
+    FrameConversionResult result;
+    Check(converter.Convert(image, view, kWidth, kHeight, bgra.data(), damage), "conversion is submitted");
+    Check(converter.PollResult(result, true), "tile mask is read back");
+    return result;
+}
+}  // namespace
+
+int main() {
+    std::cout << "Starting GPU frame converter test..." << std::endl;
+
+    Context context;
+    if (!CreateContext(context)) {
+        std::cout << "No Vulkan device with a compute queue; skipping" << std::endl;
+        return kSkipped;
+    }
+    GpuFrameConverter converter;
+    if (!converter.Initialize(context.physicalDevice, context.device, context.queue, context.queueFamily)) {
+        std::cerr << "FAILED: converter initialization" << std::endl;
+        return 1;
+    }
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImage image = converter.CreateImage(kWidth, kHeight, memory);
+    VkImageView view = CreateView(context, image);
+    Check(image != VK_NULL_HANDLE && view != VK_NULL_HANDLE, "target image and view are created");
+
+    // Every byte value in every channel, so a swapped or rounded channel
+    // cannot go unnoticed.
+    std::mt19937 random(1234);
+    std::vector<uint8_t> frame(static_cast<size_t>(kWidth) * kHeight * 4);
+    for (auto& byte : frame) byte = static_cast<uint8_t>(random());
+    for (uint32_t i = 0; i < 256; ++i) SetPixel(frame, i % kWidth, i / kWidth, i * 0x01010101u);
+
+    // A new image is converted whole and every tile counts as changed.
+    FrameConversionResult result = Convert(converter, image, view, frame, { {10, 10}, {1, 1} });
+    Check(ReadImage(context, image) == ToRgba(frame), "first frame converts pixel-exact");
+    Check(result.tilesChecked == kTilesX * kTilesY, "first frame checks every tile");
+    Check(result.changedTiles.size() == kTilesX * kTilesY, "first frame marks every tile changed");
+
+    // One pixel in tile (2, 1); the damage covers only that pixel.
+    SetPixel(frame, 40, 20, 0x80402010u);
+    result = Convert(converter, image, view, frame, { {40, 20}, {1, 1} });
+    Check(ReadImage(context, image) == ToRgba(frame), "single-pixel update is pixel-exact");
+    Check(result.tilesChecked == 1, "single-pixel damage checks one tile");
+    Check(result.changedTiles == std::vector<uint32_t>{ 1 * kTilesX + 2 }, "only tile (2, 1) changed");
+
+    // Damage without changes: every tile is checked, none changed.
+    result = Convert(converter, image, view, frame, { {0, 0}, {kWidth, kHeight} });
+    Check(result.tilesChecked == kTilesX * kTilesY, "full damage checks every tile");
+    Check(result.changedTiles.empty(), "unchanged frame marks no tile");
+
+    // The partial tile at the bottom-right corner; damage spans two tiles.
+    SetPixel(frame, kWidth - 1, kHeight - 1, 0xff00ff00u);
+    result = Convert(converter, image, view, frame, { {60, 40}, {7, 5} });
+    Check(ReadImage(context, image) == ToRgba(frame), "edge update is pixel-exact");
+    Check(result.tilesChecked == 2, "edge damage widens to two tiles");
+    Check(result.changedTiles == std::vector<uint32_t>{ (kTilesY - 1) * kTilesX + kTilesX - 1 },
+          "only the corner tile changed");
+
+    vkDestroyImageView(context.device, view, nullptr);
+    converter.DestroyImage(image, memory);
+    converter.Cleanup();
+
+    return CheckSummary("GPU frame converter test");
+}
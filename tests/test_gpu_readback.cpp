@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "vulkan_renderer.h"
+#include "test_check.h"
+
+// Uploads a texture and reads it back in the very next frame through the
+// offscreen VulkanRenderer. On the 1.3 path the upload is only ordered
+// before the frame by the timeline wait, so the readback's copy has to be
+// covered by that wait too. Runs the 1.3 path (when the device has it) and
+// the 1.0 path. Exits with 77 (skipped) when no Vulkan device is available.
+namespace {
+constexpr int kSkipped = 77;
+constexpr uint32_t kWidth = 37;
+constexpr uint32_t kHeight = 23;
+constexpr int kRounds = 8;
+
+std::vector<uint8_t> Pattern(int round) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(kWidth) * kHeight * 4);
+    for (size_t i = 0; i < rgba.size(); ++i) {
+        rgba[i] = static_cast<uint8_t>(i * 7 + round * 31 + 1);
+    }
+    return rgba;
+}
+
+// False when the renderer could not be created at all.
+bool RunPath(bool allowVulkan13) {
+    VulkanRenderer renderer;
+    renderer.SetDeviceOverride(VulkanRenderer::EffectiveDeviceOverride(""));
+    renderer.SetAllowVulkan13(allowVulkan13);
+    if (!renderer.Initialize(std::make_unique<OffscreenPresenter>(kWidth, kHeight))) {
+        renderer.Cleanup();
+        return false;
+    }
+    std::cout << (renderer.UsesDynamicRendering() ? "1.3 path" : "1.0 path") << std::endl;
+
+    const std::vector<uint8_t> blank(static_cast<size_t>(kWidth) * kHeight * 4, 0);
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImage image = renderer.CreateTextureImage(kWidth, kHeight, blank.data(), memory);
+    Check(image != VK_NULL_HANDLE, "texture created");
+
+    VkRect2D region{};
+    region.extent = { kWidth, kHeight };
+    for (int round = 0; image != VK_NULL_HANDLE && round < kRounds; ++round) {
+        const std::vector<uint8_t> expected = Pattern(round);
+        renderer.UpdateTextureImage(image, kWidth, kHeight, expected.data());
+        std::future<ReadbackResult> future = renderer.ReadbackImage(
+            image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FORMAT_R8G8B8A8_UNORM, region);
+        Check(renderer.BeginFrame(), "offscreen frame begins");
+        renderer.EndFrame();
+
+        Check(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready,
+              "readback resolves when its frame completes");
+        const ReadbackResult result = future.get();
+        Check(result.ok, "readback succeeds");
+        Check(result.width == kWidth && result.height == kHeight, "readback size");
+        Check(result.pixels == expected, "readback sees the upload made just before its frame");
+    }
+
+    vkDeviceWaitIdle(renderer.GetDevice());
+    vkDestroyImage(renderer.GetDevice(), image, nullptr);
+    vkFreeMemory(renderer.GetDevice(), memory, nullptr);
+    renderer.Cleanup();
+    return true;
+}
+}  // namespace
+
+int main() {
+    if (!RunPath(true)) {
+        std::cout << "No Vulkan device; skipping" << std::endl;
+        return kSkipped;
+    }
+    Check(RunPath(false), "1.0 path initializes");
+
+    return CheckSummary("GPU readback test");
+}
@@ -0,0 +1,119 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "idle_scheduler.h"
+#include "test_check.h"
+
+namespace {
+// Draws frames until the scheduler lets the loop go quiet; returns how many.
+int Settle(IdleScheduler& idle) {
+    int frames = 0;
+    while (idle.ShouldRender(false) && frames < 100) {
+        idle.OnFrameRendered();
+        ++frames;
+    }
+    return frames;
+}
+
+void TestDisabledNeverWaits() {
+    IdleScheduler idle;
+    Check(idle.GetWaitSeconds(false) == 0.0, "disabled scheduler never waits");
+    for (int i = 0; i < 10; ++i) {
+        Check(idle.ShouldRender(false), "disabled scheduler always renders");
+        idle.OnFrameRendered();
+    }
+    Check(idle.GetSkippedIterations() == 0, "disabled scheduler skips nothing");
+}
+
+void TestSettlesThenSleeps() {
+    IdleScheduler idle;
+    idle.SetEnabled(true);
+    Check(idle.GetWaitSeconds(false) == 0.0, "first frame is drawn without waiting");
+    Check(Settle(idle) == IdleScheduler::kSettleFrames, "settle frames drawn after start");
+    const double wait = idle.GetWaitSeconds(false);
+    Check(wait > 0.0 && wait <= IdleScheduler::kMaxWaitSeconds, "idle loop waits up to the pump floor");
+    Check(idle.GetWaitSeconds(true) == 0.0, "busy loop does not wait");
+    const uint64_t skipped = idle.GetSkippedIterations();
+    Check(!idle.ShouldRender(false), "idle iteration is skipped");
+    Check(idle.GetSkippedIterations() == skipped + 1, "skipped iteration counted");
+}
+
+void TestFrameRequestsAndInput() {
+    IdleScheduler idle;
+    idle.SetEnabled(true);
+    Settle(idle);
+
+    idle.RequestFrame();
+    Check(idle.GetWaitSeconds(false) == 0.0, "requested frame is not waited for");
+    Check(Settle(idle) == IdleScheduler::kSettleFrames, "requested frame restarts settling");
+
+    Check(idle.ShouldRender(true), "input renders");
+    idle.OnFrameRendered();
+    Check(Settle(idle) == IdleScheduler::kSettleFrames - 1, "input restarts settling");
+}
+
+void TestWakeCallback() {
+    IdleScheduler idle;
+    std::atomic<int> wakes{0};
+    idle.SetWakeCallback([&] { ++wakes; });
+    idle.SetEnabled(true);
+    Settle(idle);
+
+    // A second request before the loop consumes the first needs no wake.
+    idle.RequestFrame();
+    idle.RequestFrame();
+    Check(wakes == 1, "one wake per pending frame request");
+    Settle(idle);
+
+    // Paints come from CEF threads.
+    std::thread painter([&] { idle.RequestFrame(); });
+    painter.join();
+    Check(wakes == 2, "request from another thread wakes the loop");
+    Check(idle.ShouldRender(false), "request from another thread renders");
+}
+
+void TestPumpScheduling() {
+    IdleScheduler idle;
+    std::atomic<int> wakes{0};
+    idle.SetWakeCallback([&] { ++wakes; });
+    idle.SetEnabled(true);
+    Settle(idle);
+
+    idle.SchedulePumpWork(5);
+    const double wait = idle.GetWaitSeconds(false);
+    Check(wait > 0.0 && wait <= 0.005, "sleep ends at the scheduled pump work");
+    Check(wakes == 0, "pump work is not a frame request");
+
+    // While sleeping until the pump, sooner work wakes the loop and later
+    // work does not.
+    idle.SchedulePumpWork(60000);
+    Check(wakes == 0, "later pump work does not wake");
+    idle.SchedulePumpWork(0);
+    Check(wakes == 1, "immediate pump work wakes a sleeping loop");
+    Check(idle.GetWaitSeconds(false) == 0.0, "due pump work is not waited for");
+
+    idle.OnPumpWork();
+    const double after = idle.GetWaitSeconds(false);
+    Check(after > 0.005, "pumping clears the work that came due");
+    Check(!idle.ShouldRender(false), "pump-only wakeup draws nothing");
+
+    // Work not yet due survives a pump.
+    idle.SchedulePumpWork(10);
+    idle.OnPumpWork();
+    const double pending = idle.GetWaitSeconds(false);
+    Check(pending > 0.0 && pending <= 0.010, "pump work not yet due is kept");
+}
+}  // namespace
+
+int main() {
+    TestDisabledNeverWaits();
+    TestSettlesThenSleeps();
+    TestFrameRequestsAndInput();
+    TestWakeCallback();
+    TestPumpScheduling();
+
+    return CheckSummary("Idle scheduler test");
+}
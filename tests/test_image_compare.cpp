@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "image_compare.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+#include "test_check.h"
+
+namespace {
+std::vector<uint8_t> TestPattern(uint32_t width, uint32_t height) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* p = pixels.data() + (static_cast<size_t>(y) * width + x) * 4;
+            p[0] = static_cast<uint8_t>(x * 7 + y);
+            p[1] = static_cast<uint8_t>((x ^ y) * 13);
+            p[2] = (x / 8 + y / 8) % 2 ? 255 : 0;
+            p[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+void TestEncoderRoundTrip() {
+    const uint32_t width = 67, height = 41;
+    const std::vector<uint8_t> pixels = TestPattern(width, height);
+    const std::vector<uint8_t> png = EncodePng(pixels.data(), width, height, PixelOrder::Rgba);
+    std::vector<uint8_t> decoded;
+    uint32_t w = 0, h = 0;
+    std::string error;
+    Check(DecodePng(png.data(), png.size(), decoded, w, h, &error), "encoder output decodes");
+    Check(w == width && h == height, "decoded size matches");
+    Check(decoded == pixels, "decoded pixels match");
+
+    std::vector<uint8_t> corrupt = png;
+    corrupt[corrupt.size() / 2] ^= 0x40;
+    Check(!DecodePng(corrupt.data(), corrupt.size(), decoded, w, h, &error), "corrupt PNG is rejected");
+    Check(!error.empty(), "rejection says why");
+}
+
+void TestDynamicHuffman() {
+    // zlib.compress(..., 9) of a skewed alphabet: one dynamic block.
+    static const uint8_t kStream[] = { 0x78, 0xda, 0x9d, 0x8b, 0x41, 0x0d, 0x00, 0x30, 0x10, 0xc2, 0xb4,
+                                       0xb6, 0x9c, 0x7f, 0x0d, 0x23, 0xb7, 0xcc, 0xc0, 0x78, 0x14, 0x48,
+                                       0x00, 0x2a, 0x35, 0x6b, 0x24, 0x14, 0xde, 0x84, 0x91, 0x65, 0x3b,
+                                       0x79, 0x33, 0x3e, 0x2e, 0xa5, 0x99, 0x39, 0x1b, 0x98, 0x2a, 0x07 };
+    const std::string half = "aaaaabbbcaaabbaccabacbbbaccaabcbaaabcbbbaacabbbcaaa";
+    const std::string expected = half + half + "abcabcdd";
+    std::vector<uint8_t> out;
+    Check(InflateZlib(kStream, sizeof(kStream), out), "dynamic Huffman stream inflates");
+    Check(std::string(out.begin(), out.end()) == expected, "dynamic Huffman output matches");
+
+    uint8_t bad[sizeof(kStream)];
+    std::memcpy(bad, kStream, sizeof(kStream));
+    bad[sizeof(bad) - 1] ^= 1;
+    Check(!InflateZlib(bad, sizeof(bad), out), "Adler-32 mismatch is rejected");
+}
+
+void TestPaletteAndSixteenBit() {
+    // 5x2, 2-bit palette (red, green, blue, white) with tRNS alpha 255, 128.
+    static const uint8_t kPalette[] = {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+        0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x02, 0x02, 0x03, 0x00, 0x00, 0x00, 0xed, 0x04, 0xfe,
+        0xce, 0x00, 0x00, 0x00, 0x0c, 0x50, 0x4c, 0x54, 0x45, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00,
+        0x00, 0xff, 0xff, 0xff, 0xff, 0xfb, 0x00, 0x60, 0xf6, 0x00, 0x00, 0x00, 0x02, 0x74, 0x52, 0x4e,
+        0x53, 0xff, 0x80, 0x08, 0x0f, 0xb3, 0x6a, 0x00, 0x00, 0x00, 0x0e, 0x49, 0x44, 0x41, 0x54, 0x78,
+        0xda, 0x63, 0x90, 0x66, 0x60, 0x78, 0xe2, 0x00, 0x00, 0x02, 0x95, 0x01, 0x40, 0x16, 0x7c, 0x9f,
+        0x97, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+    };
+    std::vector<uint8_t> rgba;
+    uint32_t w = 0, h = 0;
+    Check(DecodePng(kPalette, sizeof(kPalette), rgba, w, h), "palette PNG decodes");
+    const uint8_t kRow1[] = { 255, 255, 255, 255, 0, 0, 255, 255, 0, 255, 0, 128, 255, 0, 0, 255, 0, 255, 0, 128 };
+    Check(w == 5 && h == 2 && rgba.size() == 40, "palette PNG size");
+    Check(rgba.size() == 40 && rgba[4] == 0 && rgba[5] == 255 && rgba[7] == 128, "palette entry with tRNS alpha");
+    Check(rgba.size() == 40 && std::memcmp(rgba.data() + 20, kRow1, sizeof(kRow1)) == 0,
+          "packed indices unpack MSB first");
+
+    // 2x1, 16-bit gray+alpha, Paeth filtered.
+    static const uint8_t kGrayAlpha[] = {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+        0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x10, 0x04, 0x00, 0x00, 0x00, 0x0e, 0xbb, 0x6b,
+        0x42, 0x00, 0x00, 0x00, 0x11, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x11, 0x32, 0xf9, 0xff,
+        0x3f, 0xef, 0x8c, 0x23, 0x23, 0x00, 0x11, 0xbd, 0x03, 0xc5, 0x7d, 0x4d, 0x46, 0x8f, 0x00, 0x00,
+        0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+    };
+    Check(DecodePng(kGrayAlpha, sizeof(kGrayAlpha), rgba, w, h), "16-bit gray+alpha PNG decodes");
+    const uint8_t kExpected[] = { 0x12, 0x12, 0x12, 0xff, 0x80, 0x80, 0x80, 0x40 };
+    Check(w == 2 && h == 1 && rgba.size() == 8 && std::memcmp(rgba.data(), kExpected, 8) == 0,
+          "16-bit samples keep their high byte");
+}
+
+void TestTolerance() {
+    const uint32_t width = 32, height = 16;
+    const std::vector<uint8_t> expected = TestPattern(width, height);
+    ImageDiffOptions options;
+
+    ImageDiffResult same = CompareImages(expected.data(), expected.data(), width, height, options, false);
+    Check(same.matches && same.differentPixels == 0 && same.maxDelta == 0.0, "identical images match");
+
+    // Off-by-a-few rounding from blending or a different rasterizer.
+    std::vector<uint8_t> rounded = expected;
+    for (size_t i = 0; i < rounded.size(); i += 4) rounded[i + 1] = static_cast<uint8_t>(rounded[i + 1] ^ 2);
+    ImageDiffResult close = CompareImages(expected.data(), rounded.data(), width, height, options, false);
+    Check(close.matches && close.differentPixels == 0, "rounding differences are tolerated");
+
+    // Swapped red and blue, as a wrong swizzle would produce.
+    std::vector<uint8_t> swapped = expected;
+    for (size_t i = 0; i < swapped.size(); i += 4) std::swap(swapped[i], swapped[i + 2]);
+    ImageDiffResult swizzle = CompareImages(expected.data(), swapped.data(), width, height, options, true);
+    Check(!swizzle.matches, "swapped channels are caught");
+    Check(swizzle.diff.size() == expected.size(), "diff image covers every pixel");
+
+    // One wrong pixel, allowed only with a ratio that covers it.
+    std::vector<uint8_t> speck = expected;
+    speck[0] = static_cast<uint8_t>(speck[0] ^ 0xff);
+    speck[1] = static_cast<uint8_t>(speck[1] ^ 0xff);
+    ImageDiffResult strict = CompareImages(expected.data(), speck.data(), width, height, options, true);
+    Check(!strict.matches && strict.differentPixels == 1, "single bad pixel fails without slack");
+    Check(strict.diff[0] == 255 && strict.diff[1] == 0 && strict.diff[2] == 0, "bad pixel drawn red in the diff");
+    Check(strict.diff[4] == strict.diff[5] && strict.diff[5] == strict.diff[6] && strict.diff[4] > 200,
+          "matching pixels drawn as faded gray");
+    options.maxDiffRatio = 1.0 / (width * height);
+    Check(CompareImages(expected.data(), speck.data(), width, height, options, false).matches,
+          "single bad pixel passes within the ratio");
+
+    // Alpha is compared over white: transparent black looks like white.
+    const uint8_t clear[4] = { 0, 0, 0, 0 };
+    const uint8_t white[4] = { 255, 255, 255, 255 };
+    const uint8_t black[4] = { 0, 0, 0, 255 };
+    Check(PixelDelta(clear, white) == 0.0, "transparent pixels compare over white");
+    Check(PixelDelta(black, white) > 0.9 && PixelDelta(black, white) < 1.0, "black to white is near the full scale");
+}
+}  // namespace
+
+int main() {
+    TestEncoderRoundTrip();
+    TestDynamicHuffman();
+    TestPaletteAndSixteenBit();
+    TestTolerance();
+
+    return CheckSummary("Image compare test");
+}
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "page_load_telemetry.h"
+#include "test_check.h"
+
+namespace {
+size_t RecordCount() {
+    return PageLoadLog::Get().GetRecent().size();
+}
+
+PageLoadRecord LastRecord() {
+    const std::vector<PageLoadRecord> recent = PageLoadLog::Get().GetRecent();
+    return recent.empty() ? PageLoadRecord() : recent.back();
+}
+
+void TestPresentBeforeLoadEnd() {
+    CefRefPtr<PageLoadTracker> tracker = new PageLoadTracker("Test");
+    const size_t before = RecordCount();
+    tracker->BeginNavigation("https://example.com/present-first");
+    tracker->OnLoadStart();
+    tracker->OnPaint();
+    tracker->OnUpload();
+    tracker->OnPresent();
+    tracker->OnPresent();
+    Check(RecordCount() == before, "record stays open after first present until load end");
+    tracker->OnLoadEnd(200);
+    Check(RecordCount() == before + 1, "load end after first present finishes the record");
+    const PageLoadRecord record = LastRecord();
+    Check(record.url == "https://example.com/present-first", "record keeps its url");
+    Check(record.completed, "record reached first present");
+    Check(record.firstPresentMs >= 0.0, "record has first present time");
+    Check(record.loadEndMs >= 0.0, "record has load end time");
+    Check(record.httpStatus == 200, "record has http status");
+    tracker->OnClose();
+    Check(RecordCount() == before + 1, "finished record is not logged twice");
+}
+
+void TestLoadEndBeforePresent() {
+    CefRefPtr<PageLoadTracker> tracker = new PageLoadTracker("Test");
+    const size_t before = RecordCount();
+    tracker->BeginNavigation("https://example.com/load-first");
+    tracker->OnLoadStart();
+    tracker->OnLoadEnd(404);
+    Check(RecordCount() == before, "record stays open after load end until first present");
+    tracker->OnPaint();
+    tracker->OnUpload();
+    tracker->OnPresent();
+    Check(RecordCount() == before + 1, "first present after load end finishes the record");
+    const PageLoadRecord record = LastRecord();
+    Check(record.completed && record.httpStatus == 404, "record has present and status");
+}
+
+void TestLoadErrorAfterPresent() {
+    CefRefPtr<PageLoadTracker> tracker = new PageLoadTracker("Test");
+    const size_t before = RecordCount();
+    tracker->BeginNavigation("https://example.com/error");
+    tracker->OnLoadStart();
+    tracker->OnPaint();
+    tracker->OnUpload();
+    tracker->OnPresent();
+    tracker->OnLoadError(-105, "ERR_NAME_NOT_RESOLVED", "");
+    Check(RecordCount() == before + 1, "load error after first present finishes the record");
+    const PageLoadRecord record = LastRecord();
+    Check(record.errorCode == -105 && record.completed, "record has error and present");
+}
+
+void TestNextNavigationFinishesOpenRecord() {
+    CefRefPtr<PageLoadTracker> tracker = new PageLoadTracker("Test");
+    const size_t before = RecordCount();
+    tracker->BeginNavigation("https://example.com/never-ends");
+    tracker->OnLoadStart();
+    tracker->OnPaint();
+    tracker->OnUpload();
+    tracker->OnPresent();
+    tracker->BeginNavigation("https://example.com/next");
+    Check(RecordCount() == before + 1, "next navigation finishes the open record");
+    const PageLoadRecord record = LastRecord();
+    Check(record.url == "https://example.com/never-ends", "open record is the one logged");
+    Check(record.completed && record.loadEndMs < 0.0, "open record has present but no load end");
+    tracker->OnClose();
+    Check(RecordCount() == before + 2, "close finishes the next navigation");
+}
+}  // namespace
+
+int main() {
+    // No log file: records only go to the in-memory ring.
+    PageLoadLog::Get().SetLogFile("", 0);
+
+    TestPresentBeforeLoadEnd();
+    TestLoadEndBeforePresent();
+    TestLoadErrorAfterPresent();
+    TestNextNavigationFinishesOpenRecord();
+
+    return CheckSummary("Page load telemetry test");
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "panel_bench.h"
+#include "process_profile.h"
+#include "test_check.h"
+
+namespace {
+const ProfileSwitch* FindSwitch(const std::vector<ProfileSwitch>& switches, const std::string& name) {
+    for (const ProfileSwitch& entry : switches) {
+        if (entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+bool HasWarning(const ProfileResolution& resolution, const std::string& fragment) {
+    return std::any_of(resolution.warnings.begin(), resolution.warnings.end(),
+                       [&](const std::string& warning) { return warning.find(fragment) != std::string::npos; });
+}
+
+void TestBuiltInProfiles() {
+    Check(GetProcessProfiles().size() == 3, "three built-in profiles");
+    for (const char* name : { "kiosk-lowmem", "operator-lowlatency", "bench" }) {
+        const ProcessProfile* profile = FindProcessProfile(name);
+        Check(profile != nullptr, "built-in profile found by name");
+        if (!profile) continue;
+        // Built-ins must resolve cleanly against an empty command line.
+        const ProfileResolution resolution = ResolveProcessProfile(*profile, {});
+        Check(resolution.warnings.empty(), "built-in profile is coherent on its own");
+        Check(resolution.kept.empty(), "nothing kept from an empty command line");
+        Check(!resolution.apply.empty(), "built-in profile sets switches");
+    }
+    Check(FindProcessProfile("turbo") == nullptr, "unknown profile not found");
+    Check(ProcessProfileNames() == "kiosk-lowmem, operator-lowlatency, bench", "profile names listed in order");
+}
+
+void TestKioskBundle() {
+    const std::vector<ProfileSwitch> switches = GetProfileSwitches(*FindProcessProfile("kiosk-lowmem"));
+    const ProfileSwitch* limit = FindSwitch(switches, "renderer-process-limit");
+    Check(limit && limit->value == "4", "kiosk caps renderer processes");
+    Check(FindSwitch(switches, "process-per-site") && FindSwitch(switches, "disable-site-isolation-trials"),
+          "kiosk shares renderers per site");
+    Check(!FindSwitch(switches, "site-per-process"), "kiosk does not force site isolation");
+    const ProfileSwitch* raster = FindSwitch(switches, "num-raster-threads");
+    Check(raster && raster->value == "1", "kiosk uses one raster thread");
+    const ProfileSwitch* js = FindSwitch(switches, "js-flags");
+    Check(js && js->value == "--max-old-space-size=256", "kiosk caps the V8 heap");
+    Check(FindSwitch(switches, "disable-gpu") && FindSwitch(switches, "disable-gpu-compositing"),
+          "kiosk composites in software");
+    const ProfileSwitch* cache = FindSwitch(switches, "disk-cache-size");
+    Check(cache && cache->value == std::to_string(64ll * 1024 * 1024), "kiosk disk cache in bytes");
+    Check(FormatProfileSwitches({ { "a", "1" }, { "b", "" } }) == "--a=1 --b", "switches format for the log");
+}
+
+void TestCommandLineWins() {
+    const ProcessProfile& kiosk = *FindProcessProfile("kiosk-lowmem");
+    // --panel-cache-mb has already set the disk cache by the time the
+    // profile is applied.
+    std::map<std::string, std::string> existing = { { "disk-cache-size", "1048576" },
+                                                     { "js-flags", "--expose-gc" } };
+    ProfileResolution resolution = ResolveProcessProfile(kiosk, existing);
+    Check(!FindSwitch(resolution.apply, "disk-cache-size"), "explicit disk cache size is not replaced");
+    Check(std::find(resolution.kept.begin(), resolution.kept.end(), "--disk-cache-size=1048576") !=
+              resolution.kept.end(),
+          "explicit disk cache size reported as kept");
+    const ProfileSwitch* js = FindSwitch(resolution.apply, "js-flags");
+    Check(js && js->value == "--expose-gc --max-old-space-size=256", "heap limit appended to existing js-flags");
+
+    existing = { { "js-flags", "--max-old-space-size=1024" } };
+    resolution = ResolveProcessProfile(kiosk, existing);
+    Check(!FindSwitch(resolution.apply, "js-flags"), "explicit heap limit is kept");
+
+    // An explicit isolation switch replaces the profile's whole policy.
+    existing = { { "site-per-process", "" } };
+    resolution = ResolveProcessProfile(kiosk, existing);
+    Check(!FindSwitch(resolution.apply, "process-per-site") &&
+              !FindSwitch(resolution.apply, "disable-site-isolation-trials"),
+          "explicit site isolation replaces the profile's");
+    Check(HasWarning(resolution, "soft cap"), "renderer limit under strict isolation is flagged");
+}
+
+void TestValidation() {
+    const ProcessProfile& operatorProfile = *FindProcessProfile("operator-lowlatency");
+    ProfileResolution resolution = ResolveProcessProfile(operatorProfile, { { "num-raster-threads", "8" } });
+    Check(HasWarning(resolution, "outside 1-4"), "raster thread count out of range is flagged");
+    Check(!FindSwitch(resolution.apply, "num-raster-threads"), "explicit raster thread count is kept");
+
+    resolution = ResolveProcessProfile(operatorProfile, { { "disable-gpu-compositing", "" } });
+    Check(HasWarning(resolution, "GPU compositing"), "GPU profile with compositing disabled is flagged");
+
+    resolution = ResolveProcessProfile(operatorProfile, { { "disable-site-isolation-trials", "" } });
+    Check(!FindSwitch(resolution.apply, "site-per-process"), "explicit isolation opt-out is respected");
+
+    resolution = ResolveProcessProfile(*FindProcessProfile("bench"), { { "renderer-process-limit", "0" } });
+    Check(HasWarning(resolution, "not a positive count"), "zero renderer limit is flagged");
+
+    resolution = ResolveProcessProfile(*FindProcessProfile("bench"), { { "js-flags", "--max-old-space-size=16" } });
+    Check(HasWarning(resolution, "below 64 MB"), "tiny heap limit is flagged");
+}
+
+void TestBenchStatistics() {
+    Check(PanelBench::Percentile({}, 0.5) == 0.0, "percentile of nothing is 0");
+    std::vector<double> values;
+    for (int i = 100; i >= 1; --i) values.push_back(i);
+    Check(PanelBench::Percentile(values, 0.50) == 50.0, "p50 by nearest rank");
+    Check(PanelBench::Percentile(values, 0.95) == 95.0, "p95 by nearest rank");
+    Check(PanelBench::Percentile(values, 0.0) == 1.0, "p0 is the minimum");
+    Check(PanelBench::Percentile(values, 1.0) == 100.0, "p100 is the maximum");
+
+    PanelBench bench("kiosk-lowmem", 30, 0.0, 60.0);
+    bench.OnFrame(50.0, false);
+    Check(!bench.IsDone(), "bench waits for every panel to paint");
+    ProcessTreeMemory small;
+    small.processes = 5;
+    small.rssBytes = 100ull << 20;
+    small.pssBytes = 60ull << 20;
+    ProcessTreeMemory large = small;
+    large.processes = 7;
+    large.rssBytes = 300ull << 20;
+    bench.AddMemorySample(small);
+    bench.AddMemorySample(large);
+    const std::string report = bench.FormatReport();
+    Check(report.rfind("Bench result: profile=kiosk-lowmem panels=30 frames=0 ", 0) == 0, "report header");
+    Check(report.find("processes=7 rss_mb=200.0 rss_peak_mb=300.0 pss_mb=60.0") != std::string::npos,
+          "memory averaged with peak and process count");
+    Check(PanelBench("", 1, 0.0, 1.0).FormatReport().find("profile=none") != std::string::npos,
+          "no profile reported as none");
+
+    bench.AddCpuSample(10.0, 0);
+    bench.AddCpuSample(12.0, 100);
+    bench.AddCpuSample(13.0, 300);
+    bench.SetSoftwareMode(true);
+    Check(bench.FormatReport().find("cpu_ms_per_frame=10.00 software=on") != std::string::npos,
+          "CPU time per frame spans the first and last sample");
+    Check(PanelBench("", 1, 0.0, 1.0).FormatReport().find("cpu_ms_per_frame=0.00 software=off") != std::string::npos,
+          "no CPU samples report 0");
+
+    const ProcessTreeMemory self = SampleProcessTreeMemory();
+#if defined(__linux__) || defined(_WIN32)
+    Check(self.processes >= 1 && self.rssBytes > 0, "own process memory is sampled");
+    Check(SampleProcessTreeCpuSeconds() >= 0.0, "own process CPU time is sampled");
+#endif
+}
+}  // namespace
+
+int main() {
+    TestBuiltInProfiles();
+    TestKioskBundle();
+    TestCommandLineWins();
+    TestValidation();
+    TestBenchStatistics();
+
+    return CheckSummary("Process profile test");
+}
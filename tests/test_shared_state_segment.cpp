@@ -0,0 +1,125 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "shared_state_segment.h"
+#include "test_check.h"
+
+namespace {
+// Every field of write |k| is derived from k, so a torn copy mixing two
+// writes shows up as fields that disagree.
+void Fill(SharedStateColumns& columns, uint32_t k) {
+    columns = {};
+    columns.rows = k % kSharedStateMaxRows + 1;
+    for (uint32_t i = 0; i < kSharedStateMaxRows; ++i) {
+        columns.id[i] = static_cast<int32_t>(k);
+        columns.ptd[i] = static_cast<int32_t>(k + i);
+        columns.delivered[i] = static_cast<int32_t>(k ^ i);
+        columns.eta[i] = -static_cast<int32_t>(k);
+        columns.callDispatch[i] = static_cast<uint8_t>(k);
+        SharedStateColumns::SetText(columns.name[i], "driver " + std::to_string(k));
+        SharedStateColumns::SetText(columns.status[i], std::to_string(k));
+        SharedStateColumns::SetText(columns.statusText[i], std::to_string(k + i));
+    }
+}
+
+bool Consistent(const SharedStateColumns& columns) {
+    const uint32_t k = static_cast<uint32_t>(columns.id[0]);
+    SharedStateColumns expected;
+    Fill(expected, k);
+    for (uint32_t i = 0; i < kSharedStateMaxRows; ++i) {
+        if (columns.id[i] != expected.id[i] || columns.ptd[i] != expected.ptd[i] ||
+            columns.delivered[i] != expected.delivered[i] || columns.eta[i] != expected.eta[i] ||
+            columns.callDispatch[i] != expected.callDispatch[i] ||
+            SharedStateColumns::GetText(columns.name[i]) != SharedStateColumns::GetText(expected.name[i]) ||
+            SharedStateColumns::GetText(columns.status[i]) != SharedStateColumns::GetText(expected.status[i]) ||
+            SharedStateColumns::GetText(columns.statusText[i]) != SharedStateColumns::GetText(expected.statusText[i])) {
+            return false;
+        }
+    }
+    return columns.rows == expected.rows;
+}
+
+void TestWriteSkipsUnchanged(SharedStateSegment& writer, SharedStateSegment& reader) {
+    Check(reader.GetVersion() == 0, "version is 0 before the first write");
+    SharedStateColumns columns;
+    uint64_t version = 0;
+    Check(!reader.Read(columns, version), "read fails before the first write");
+
+    Fill(columns, 1);
+    Check(writer.Write(columns), "first write publishes");
+    Check(!writer.Write(columns), "identical write is skipped");
+    Check(reader.GetVersion() == 1, "skipped write keeps the version");
+
+    SharedStateColumns read;
+    Check(reader.Read(read, version) && version == 1, "reader sees version 1");
+    Check(Consistent(read) && read.id[0] == 1, "reader sees the first write");
+}
+
+// One writer publishing as fast as it can against two readers copying as
+// fast as they can: no read may be torn and versions never go backwards.
+void TestConcurrentReaders(SharedStateSegment& writer, SharedStateSegment& reader) {
+    constexpr uint32_t kWrites = 20000;
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> backwards{0};
+    std::atomic<int> reads{0};
+
+    auto readLoop = [&] {
+        SharedStateColumns columns;
+        uint64_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            uint64_t version = 0;
+            if (!reader.Read(columns, version)) continue;
+            reads.fetch_add(1, std::memory_order_relaxed);
+            if (!Consistent(columns)) torn.fetch_add(1, std::memory_order_relaxed);
+            if (version < last) backwards.fetch_add(1, std::memory_order_relaxed);
+            last = version;
+        }
+    };
+    std::thread first(readLoop);
+    std::thread second(readLoop);
+
+    const uint64_t startVersion = reader.GetVersion();
+    SharedStateColumns columns;
+    for (uint32_t k = 2; k < kWrites + 2; ++k) {
+        Fill(columns, k);
+        writer.Write(columns);
+    }
+    // Let the readers finish on the final version.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    done.store(true, std::memory_order_release);
+    first.join();
+    second.join();
+
+    Check(torn.load() == 0, "no reader saw a torn snapshot");
+    Check(backwards.load() == 0, "versions never go backwards");
+    Check(reads.load() > 0, "readers completed reads while the writer ran");
+    Check(reader.GetVersion() == startVersion + kWrites, "every write bumps the version once");
+
+    uint64_t version = 0;
+    SharedStateColumns last;
+    Check(reader.Read(last, version) && last.id[0] == static_cast<int32_t>(kWrites + 1),
+          "final read sees the last write");
+}
+}  // namespace
+
+int main() {
+    std::cout << "Starting shared state segment test..." << std::endl;
+
+    const std::string name = SharedStateSegment::DefaultName() + "_test";
+    std::unique_ptr<SharedStateSegment> writer = SharedStateSegment::Create(name);
+    Check(writer != nullptr, "writer creates the segment");
+    std::unique_ptr<SharedStateSegment> reader = writer ? SharedStateSegment::Open(name) : nullptr;
+    Check(reader != nullptr, "reader opens the segment");
+    if (writer && reader) {
+        Check(!reader->Write(SharedStateColumns{}), "reader cannot write");
+        TestWriteSkipsUnchanged(*writer, *reader);
+        TestConcurrentReaders(*writer, *reader);
+    }
+
+    return CheckSummary("Shared state segment test");
+}
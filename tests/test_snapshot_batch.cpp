@@ -0,0 +1,275 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "png_encoder.h"
+#include "snapshot_batch.h"
+#include "test_check.h"
+
+namespace {
+uint32_t ReadBigEndian(const uint8_t* p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+
+// Reference inflate for stored and fixed-Huffman blocks (all the encoder
+// emits), written from RFC 1951 rather than sharing code with it.
+class Inflater {
+public:
+    explicit Inflater(const std::vector<uint8_t>& in) : m_In(in) {}
+
+    bool Run(std::vector<uint8_t>& out) {
+        static const int kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                             35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const int kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const int kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                               257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                               8193, 12289, 16385, 24577 };
+        static const int kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        bool last = false;
+        while (!last) {
+            last = Bits(1) == 1;
+            const int type = Bits(2);
+            if (type == 0) {
+                m_Bit = (m_Bit + 7) & ~size_t(7);
+                const int length = Bits(16);
+                Bits(16);
+                for (int i = 0; i < length; ++i) out.push_back(static_cast<uint8_t>(Bits(8)));
+                continue;
+            }
+            if (type != 1) return false;
+            while (true) {
+                const int symbol = FixedSymbol();
+                if (symbol < 0 || m_Bit > m_In.size() * 8) return false;
+                if (symbol < 256) {
+                    out.push_back(static_cast<uint8_t>(symbol));
+                    continue;
+                }
+                if (symbol == 256) break;
+                if (symbol > 285) return false;
+                const int length = kLengthBase[symbol - 257] + Bits(kLengthExtra[symbol - 257]);
+                int distanceCode = 0;
+                for (int i = 0; i < 5; ++i) distanceCode = distanceCode << 1 | Bits(1);
+                if (distanceCode > 29) return false;
+                const size_t distance = kDistanceBase[distanceCode] + Bits(kDistanceExtra[distanceCode]);
+                if (distance > out.size()) return false;
+                for (int i = 0; i < length; ++i) out.push_back(out[out.size() - distance]);
+            }
+        }
+        return m_Bit <= m_In.size() * 8;
+    }
+
+private:
+    int Bits(int count) {
+        int value = 0;
+        for (int i = 0; i < count; ++i, ++m_Bit) {
+            const size_t byte = m_Bit / 8;
+            const int bit = byte < m_In.size() ? (m_In[byte] >> (m_Bit % 8)) & 1 : 0;
+            value |= bit << i;
+        }
+        return value;
+    }
+    int FixedSymbol() {
+        int code = 0;
+        for (int length = 1; length <= 9; ++length) {
+            code = code << 1 | Bits(1);
+            if (length == 7 && code <= 0x17) return 256 + code;
+            if (length == 8 && code >= 0x30 && code <= 0xBF) return code - 0x30;
+            if (length == 8 && code >= 0xC0 && code <= 0xC7) return 280 + code - 0xC0;
+            if (length == 9 && code >= 0x190) return 144 + code - 0x190;
+        }
+        return -1;
+    }
+
+    const std::vector<uint8_t>& m_In;
+    size_t m_Bit = 0;
+};
+
+int Paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// Parses an RGB8 PNG back to pixels, checking chunk CRCs and the Adler-32.
+bool DecodePng(const std::vector<uint8_t>& png, std::vector<uint8_t>& rgb, uint32_t& width, uint32_t& height) {
+    static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (png.size() < 8 || std::memcmp(png.data(), kSignature, 8) != 0) return false;
+    std::vector<uint8_t> zlib;
+    bool sawEnd = false;
+    for (size_t at = 8; at + 12 <= png.size() && !sawEnd;) {
+        const uint32_t length = ReadBigEndian(&png[at]);
+        if (at + 12 + length > png.size()) return false;
+        const std::string type(reinterpret_cast<const char*>(&png[at + 4]), 4);
+        const uint8_t* data = &png[at + 8];
+        if (Crc32(&png[at + 4], length + 4) != ReadBigEndian(data + length)) return false;
+        if (type == "IHDR") {
+            width = ReadBigEndian(data);
+            height = ReadBigEndian(data + 4);
+            if (data[8] != 8 || data[9] != 2 || data[12] != 0) return false;
+        } else if (type == "IDAT") {
+            zlib.insert(zlib.end(), data, data + length);
+        } else if (type == "IEND") {
+            sawEnd = true;
+        }
+        at += 12 + length;
+    }
+    if (!sawEnd || zlib.size() < 6 || ((zlib[0] << 8) | zlib[1]) % 31 != 0) return false;
+    const std::vector<uint8_t> deflate(zlib.begin() + 2, zlib.end() - 4);
+    std::vector<uint8_t> filtered;
+    if (!Inflater(deflate).Run(filtered)) return false;
+    if (Adler32(filtered.data(), filtered.size()) != ReadBigEndian(&zlib[zlib.size() - 4])) return false;
+
+    const size_t stride = static_cast<size_t>(width) * 3;
+    if (filtered.size() != (stride + 1) * height) return false;
+    rgb.assign(stride * height, 0);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t filter = filtered[y * (stride + 1)];
+        const uint8_t* in = &filtered[y * (stride + 1) + 1];
+        uint8_t* row = &rgb[y * stride];
+        const uint8_t* up = y > 0 ? row - stride : nullptr;
+        for (size_t x = 0; x < stride; ++x) {
+            const int a = x >= 3 ? row[x - 3] : 0;
+            const int b = up ? up[x] : 0;
+            const int c = (up && x >= 3) ? up[x - 3] : 0;
+            int predictor = 0;
+            switch (filter) {
+                case 0: break;
+                case 1: predictor = a; break;
+                case 2: predictor = b; break;
+                case 3: predictor = (a + b) / 2; break;
+                case 4: predictor = Paeth(a, b, c); break;
+                default: return false;
+            }
+            row[x] = static_cast<uint8_t>(in[x] + predictor);
+        }
+    }
+    return true;
+}
+
+// Flat panels, a gradient and some noise, so every filter and both
+// literals and long matches get used.
+std::vector<uint8_t> MakePage(uint32_t width, uint32_t height, PixelOrder order) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    uint32_t seed = 12345;
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* p = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+            uint8_t r = y < height / 4 ? 40 : static_cast<uint8_t>(x * 255 / width);
+            uint8_t g = ((x / 8 + y / 8) % 2) ? 220 : 30;
+            uint8_t b = static_cast<uint8_t>(y * 255 / height);
+            if (y > height * 3 / 4) {
+                seed = seed * 1664525u + 1013904223u;
+                g = static_cast<uint8_t>(seed >> 24);
+            }
+            p[0] = order == PixelOrder::Rgba ? r : b;
+            p[1] = g;
+            p[2] = order == PixelOrder::Rgba ? b : r;
+            p[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+}  // namespace
+
+int main() {
+    // Checksums against the published check values.
+    const char* digits = "123456789";
+    Check(Crc32(reinterpret_cast<const uint8_t*>(digits), 9) == 0xCBF43926u, "CRC-32 check value");
+    Check(Adler32(reinterpret_cast<const uint8_t*>("Wikipedia"), 9) == 0x11E60398u, "Adler-32 of \"Wikipedia\"");
+    Check(Crc32(reinterpret_cast<const uint8_t*>(digits + 4), 5, Crc32(reinterpret_cast<const uint8_t*>(digits), 4)) ==
+              0xCBF43926u,
+          "CRC-32 continues across calls");
+
+    // The SIMD swizzle matches the scalar one for every tail length.
+    std::cout << "PackRgb path: " << PackRgbPath() << std::endl;
+    const std::vector<uint8_t> source = MakePage(67, 3, PixelOrder::Bgra);
+    for (PixelOrder order : { PixelOrder::Rgba, PixelOrder::Bgra }) {
+        bool same = true;
+        for (size_t pixels = 0; pixels <= 67 * 3; ++pixels) {
+            std::vector<uint8_t> fast(pixels * 3 + 1, 0xEE), scalar(pixels * 3 + 1, 0xEE);
+            PackRgb(source.data(), fast.data(), pixels, order);
+            PackRgbScalar(source.data(), scalar.data(), pixels, order);
+            same = same && fast == scalar;
+        }
+        Check(same, order == PixelOrder::Rgba ? "PackRgb matches scalar (RGBA)" : "PackRgb matches scalar (BGRA)");
+    }
+
+    // Encode, decode with the reference inflater, compare pixels.
+    const uint32_t width = 203, height = 117;
+    const std::vector<uint8_t> bgra = MakePage(width, height, PixelOrder::Bgra);
+    const std::vector<uint8_t> rgba = MakePage(width, height, PixelOrder::Rgba);
+    const std::vector<uint8_t> png = EncodePng(bgra.data(), width, height, PixelOrder::Bgra);
+    std::vector<uint8_t> decoded;
+    uint32_t decodedWidth = 0, decodedHeight = 0;
+    Check(DecodePng(png, decoded, decodedWidth, decodedHeight), "PNG decodes");
+    Check(decodedWidth == width && decodedHeight == height, "PNG keeps its size");
+    bool pixelsMatch = decoded.size() == static_cast<size_t>(width) * height * 3;
+    for (size_t i = 0; pixelsMatch && i < static_cast<size_t>(width) * height; ++i) {
+        pixelsMatch = std::memcmp(&decoded[i * 3], &rgba[i * 4], 3) == 0;
+    }
+    Check(pixelsMatch, "PNG round-trips the pixels");
+    Check(png.size() < bgra.size() / 3, "PNG compresses flat content");
+    Check(EncodePng(rgba.data(), width, height, PixelOrder::Rgba) == png, "RGBA and BGRA input encode the same");
+
+    // Degenerate sizes still produce valid files.
+    const uint8_t one[4] = { 1, 2, 3, 255 };
+    Check(DecodePng(EncodePng(one, 1, 1, PixelOrder::Rgba), decoded, decodedWidth, decodedHeight) &&
+              decoded.size() == 3 && decoded[0] == 1 && decoded[2] == 3,
+          "1x1 PNG round-trips");
+
+    // Page list.
+    uint32_t listWidth = 0, listHeight = 0;
+    Check(ParseSnapshotSize("1920x1080", listWidth, listHeight) && listWidth == 1920 && listHeight == 1080,
+          "size parses");
+    Check(!ParseSnapshotSize("0x10", listWidth, listHeight) && !ParseSnapshotSize("12x", listWidth, listHeight) &&
+              !ParseSnapshotSize("12x10px", listWidth, listHeight),
+          "bad sizes are rejected");
+    std::istringstream list(
+        "# pages\n"
+        "\n"
+        "https://example.com/a?b=1\n"
+        "file:///srv/pages/b.html 800x600 b.png\n"
+        "pages/c#1.html\n"
+        "https://example.com/ 0x5\n"
+        "https://example.com/ out.png extra\n");
+    std::vector<std::string> errors;
+    const std::vector<SnapshotJob> jobs = ParseSnapshotList(list, 1280, 720, &errors);
+    Check(jobs.size() == 3 && errors.size() == 2, "list keeps valid lines and reports bad ones");
+    if (jobs.size() == 3) {
+        Check(jobs[0].url == "https://example.com/a?b=1" && jobs[0].width == 1280 && jobs[0].output.empty(),
+              "URL line takes the default size");
+        Check(jobs[1].width == 800 && jobs[1].height == 600 && jobs[1].output == "b.png", "size and output parse");
+        Check(jobs[2].url.rfind("file:///", 0) == 0 && jobs[2].url.find("pages/c%231.html") != std::string::npos,
+              "local paths become file URLs");
+    }
+    Check(SnapshotFileName("https://example.com/a?b=1", 7) == "007-example.com_a_b_1.png", "file name is sanitized");
+    Check(SnapshotFileName("about:blank", 0) == "000-about_blank.png", "scheme-only URL names");
+
+    // Writer pool.
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "imguicef_snapshot_test";
+    std::filesystem::remove_all(dir);
+    SnapshotWriter writer;
+    writer.Start(3);
+    for (int i = 0; i < 6; ++i) {
+        writer.Submit((dir / ("page" + std::to_string(i) + ".png")).string(), bgra, width, height, PixelOrder::Bgra);
+    }
+    Check(writer.Wait() == 0 && writer.GetWritten() == 6, "writer writes every page");
+    Check(ReadFile(dir / "page5.png") == png, "written file is the encoded PNG");
+    writer.Stop();
+    std::filesystem::remove_all(dir);
+
+    return CheckSummary("Snapshot batch test");
+}
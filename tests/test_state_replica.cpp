@@ -0,0 +1,194 @@
+#include <deque>
+#include <iostream>
+#include <string>
+
+#include "state_replica.h"
+#include "test_check.h"
+
+namespace {
+// Mirrors the browser -> renderer path: every publish is forwarded as an
+// update carrying the published version.
+void Forward(const StateReplica& source, StateReplica& replica, const std::string& key) {
+    const StateReplica::Entry* entry = source.Find(key);
+    replica.Apply(key, entry->version, entry->json);
+}
+
+constexpr int kBrowserId = 7;
+
+// The main frame's message channel: CEF delivers process messages from the
+// browser to the renderer in the order they were sent. Carries replica
+// updates and cefQuery replies, which report what hostState.read() returned
+// once the page handled them.
+class FrameChannel {
+public:
+    explicit FrameChannel(StateReplicaSet& renderer) : m_Renderer(renderer) {}
+
+    // The renderer is gone (not created yet, or crashed): sends are dropped,
+    // like SendProcessMessage on a frame that has no renderer.
+    void SetConnected(bool connected) { m_Connected = connected; }
+
+    StatePublisher::SendUpdate Sender() {
+        return [this](const StateUpdate& update) {
+            if (m_Connected) m_Queue.push_back({ false, update });
+        };
+    }
+    void SendReply(const std::string& key) {
+        if (m_Connected) m_Queue.push_back({ true, { key, 0, "" } });
+    }
+
+    // Runs the renderer's message loop. Returns what the page read for the
+    // last reply, as the cefQuery callback would see it.
+    std::string Deliver() {
+        std::string read;
+        for (; !m_Queue.empty(); m_Queue.pop_front()) {
+            const Message& message = m_Queue.front();
+            if (!message.reply) {
+                m_Renderer.OnUpdate(kBrowserId, message.update);
+                continue;
+            }
+            const StateReplica::Entry* entry = m_Renderer.Find(kBrowserId, message.update.key);
+            read = entry ? entry->json : "null";
+        }
+        return read;
+    }
+
+private:
+    struct Message {
+        bool reply = false;
+        StateUpdate update;
+    };
+    StateReplicaSet& m_Renderer;
+    std::deque<Message> m_Queue;
+    bool m_Connected = true;
+};
+
+// CefFormsApp::OnContextCreated followed by CefFormsClient answering the
+// resync request.
+void CreateContext(StateReplicaSet& renderer, const StatePublisher& publisher, FrameChannel& channel,
+                   bool isMainFrame) {
+    if (renderer.OnContextCreated(kBrowserId, isMainFrame)) publisher.Resync(channel.Sender());
+}
+
+// A cefQuery handler that writes, publishes, then replies: the page's
+// hostState.read() in the reply callback sees the write.
+void TestReadYourWrite() {
+    StateReplicaSet renderer;
+    StatePublisher publisher;
+    FrameChannel channel(renderer);
+    CreateContext(renderer, publisher, channel, true);
+    channel.Deliver();
+
+    publisher.Publish("todos", "[{\"id\":1}]", channel.Sender());
+    channel.SendReply("todos");
+    Check(channel.Deliver() == "[{\"id\":1}]", "read in the query reply sees the write");
+
+    // Several writes before one reply, and a reply queued behind them: the
+    // reply still sees the last one.
+    publisher.Publish("todos", "[{\"id\":1},{\"id\":2}]", channel.Sender());
+    publisher.Publish("drivers", "[]", channel.Sender());
+    publisher.Publish("todos", "[{\"id\":2}]", channel.Sender());
+    channel.SendReply("todos");
+    Check(channel.Deliver() == "[{\"id\":2}]", "reply sees the latest of several writes");
+    Check(renderer.Find(kBrowserId, "todos")->version == publisher.GetState().Find("todos")->version,
+          "replica version matches the publisher after the reply");
+}
+
+// State published before the page had a V8 context reaches it through the
+// resync its main frame context asks for; a subframe context does not ask.
+void TestContextCreatedResync() {
+    StateReplicaSet renderer;
+    StatePublisher publisher;
+    FrameChannel channel(renderer);
+    channel.SetConnected(false);
+    publisher.Publish("drivers", "v1", channel.Sender());
+    publisher.Publish("drivers", "v2", channel.Sender());
+    channel.SetConnected(true);
+    Check(channel.Deliver().empty() && !renderer.Find(kBrowserId, "drivers"), "no renderer, nothing delivered");
+
+    CreateContext(renderer, publisher, channel, false);
+    channel.Deliver();
+    Check(!renderer.Find(kBrowserId, "drivers"), "subframe context does not resync");
+
+    CreateContext(renderer, publisher, channel, true);
+    channel.SendReply("drivers");
+    Check(channel.Deliver() == "v2", "main frame context resyncs the latest state");
+
+    // A publish racing the resync request arrives twice; the duplicate is
+    // dropped and nothing rolls back.
+    publisher.Publish("drivers", "v3", channel.Sender());
+    publisher.Resync(channel.Sender());
+    channel.SendReply("drivers");
+    Check(channel.Deliver() == "v3", "publish racing a resync keeps the newest state");
+}
+
+// A crashed renderer is replaced by an empty one; the recreated client
+// inherits the publisher (CefFormsClient::InheritState), so the new
+// context's resync restores everything and later writes keep their order.
+void TestRecreatedRendererResync() {
+    StateReplicaSet crashed;
+    StatePublisher publisher;
+    FrameChannel oldChannel(crashed);
+    CreateContext(crashed, publisher, oldChannel, true);
+    publisher.Publish("todos", "[1]", oldChannel.Sender());
+    publisher.Publish("todos", "[1,2]", oldChannel.Sender());
+    oldChannel.Deliver();
+
+    StatePublisher inherited = publisher;
+    StateReplicaSet renderer;
+    FrameChannel channel(renderer);
+    CreateContext(renderer, inherited, channel, true);
+    channel.SendReply("todos");
+    Check(channel.Deliver() == "[1,2]", "recreated renderer resyncs inherited state");
+
+    inherited.Publish("todos", "[1,2,3]", channel.Sender());
+    channel.SendReply("todos");
+    Check(channel.Deliver() == "[1,2,3]", "write after recovery is read back");
+
+    renderer.OnBrowserDestroyed(kBrowserId);
+    Check(!renderer.Find(kBrowserId, "todos"), "destroyed browser drops its replica");
+}
+}  // namespace
+
+int main() {
+    std::cout << "Starting state replica consistency test..." << std::endl;
+
+    StateReplica browser;
+    StateReplica renderer;
+
+    Check(renderer.Find("todos") == nullptr, "unknown key reads as missing");
+
+    // Read-after-write: the update is applied before the page sees the reply.
+    browser.Publish("todos", "[]");
+    Forward(browser, renderer, "todos");
+    browser.Publish("todos", "[{\"id\":1}]");
+    Forward(browser, renderer, "todos");
+    Check(renderer.Find("todos") && renderer.Find("todos")->json == "[{\"id\":1}]", "replica holds latest write");
+    Check(renderer.Find("todos")->version == 2, "replica version follows publisher");
+
+    // A stale or duplicated update must never roll the replica back.
+    Check(!renderer.Apply("todos", 1, "[]"), "stale update rejected");
+    Check(!renderer.Apply("todos", 2, "[]"), "duplicate update rejected");
+    Check(renderer.Find("todos")->json == "[{\"id\":1}]", "rejected updates leave state intact");
+
+    // Reordered delivery: a newer update arriving first wins.
+    Check(renderer.Apply("drivers", 5, "v5"), "newer update accepted");
+    Check(!renderer.Apply("drivers", 4, "v4"), "older update after newer rejected");
+    Check(renderer.Find("drivers")->json == "v5", "reordered updates keep newest");
+
+    // Version 0 means "never published" and must not create an entry.
+    Check(!renderer.Apply("empty", 0, ""), "version zero rejected");
+    Check(renderer.Find("empty") == nullptr, "version zero leaves key missing");
+
+    // A recreated renderer replays everything the browser holds.
+    StateReplica fresh;
+    for (const auto& [key, entry] : browser.GetEntries()) {
+        fresh.Apply(key, entry.version, entry.json);
+    }
+    Check(fresh.Find("todos") && fresh.Find("todos")->version == browser.Find("todos")->version, "resync matches publisher");
+
+    TestReadYourWrite();
+    TestContextCreatedResync();
+    TestRecreatedRendererResync();
+
+    return CheckSummary("State replica consistency test");
+}